@@ -0,0 +1,71 @@
+#include "Auction.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include "Kernels.hpp"
+
+std::optional<AuctionEquilibrium> FindEquilibrium(AuctionLevels &levels, std::optional<Price> referencePrice) {
+	const auto count = levels.prices_.size();
+	if (count == 0)
+		return std::nullopt;
+
+	// Demand curves over contiguous arrays: asks at or below each price and
+	// bids at or above it. Bids at or above a price are all bids less those
+	// below it, so both curves come from forward prefix sums. The scans below
+	// are branch-free so they vectorize.
+	auto &askDemand = levels.askDemand_;
+	auto &bidDemand = levels.bidDemand_;
+	auto &volume = levels.volume_;
+	auto &surplus = levels.surplus_;
+	for (auto *column : {&askDemand, &bidDemand, &volume, &surplus})
+		column->resize(count);
+
+	InclusiveScan(levels.asks_.data(), askDemand.data(), count);
+	InclusiveScan(levels.bids_.data(), bidDemand.data(), count);
+	const auto totalBids = bidDemand[count - 1];
+	for (std::size_t i = 0; i < count; ++i)
+		bidDemand[i] = totalBids - bidDemand[i] + levels.bids_[i];
+
+	std::int64_t maxVolume = 0;
+	for (std::size_t i = 0; i < count; ++i) {
+		volume[i] = std::min(bidDemand[i], askDemand[i]);
+		maxVolume = std::max(maxVolume, volume[i]);
+	}
+	if (maxVolume == 0)
+		return std::nullopt;
+
+	auto minSurplus = std::numeric_limits<std::int64_t>::max();
+	for (std::size_t i = 0; i < count; ++i) {
+		surplus[i] = std::abs(bidDemand[i] - askDemand[i]);
+		minSurplus = std::min(minSurplus, volume[i] == maxVolume ? surplus[i] : std::numeric_limits<std::int64_t>::max());
+	}
+
+	// Ties are rare and few, so the remaining rules run on the candidates only
+	auto &candidates = levels.candidates_;
+	candidates.clear();
+	bool allBuySurplus = true, allSellSurplus = true;
+	for (std::size_t i = 0; i < count; ++i) {
+		if (volume[i] != maxVolume || surplus[i] != minSurplus)
+			continue;
+		candidates.push_back(i);
+		allBuySurplus &= bidDemand[i] > askDemand[i];
+		allSellSurplus &= bidDemand[i] < askDemand[i];
+	}
+
+	std::size_t chosen = candidates.front();
+	if (candidates.size() > 1) {
+		if (allBuySurplus) {
+			chosen = candidates.back();
+		} else if (!allSellSurplus && referencePrice) {
+			auto distance = [&](std::size_t i) { return std::llabs(static_cast<std::int64_t>(levels.prices_[i]) - *referencePrice); };
+			for (auto candidate : candidates) {
+				if (distance(candidate) < distance(chosen))
+					chosen = candidate;
+			}
+		}
+	}
+
+	return AuctionEquilibrium{levels.prices_[chosen], static_cast<Quantity>(maxVolume), bidDemand[chosen] - askDemand[chosen]};
+}
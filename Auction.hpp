@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "Trade.hpp"
+#include "Usings.hpp"
+
+// Visible quantity per price over the crossed part of the book, ascending by
+// price. A price only one side has a level at carries zero for the other.
+// Also holds FindEquilibrium's working arrays, so that levels kept and
+// cleared between uncrosses allocate nothing once they have grown.
+struct AuctionLevels {
+	std::vector<Price> prices_;
+	std::vector<std::int64_t> bids_;
+	std::vector<std::int64_t> asks_;
+
+	// Per price: cumulative demand each side, volume executable, surplus
+	std::vector<std::int64_t> askDemand_;
+	std::vector<std::int64_t> bidDemand_;
+	std::vector<std::int64_t> volume_;
+	std::vector<std::int64_t> surplus_;
+	std::vector<std::size_t> candidates_; // Indexes tied on volume and surplus
+
+	void Clear() {
+		prices_.clear();
+		bids_.clear();
+		asks_.clear();
+		askDemand_.clear();
+		bidDemand_.clear();
+		volume_.clear();
+		surplus_.clear();
+		candidates_.clear();
+	}
+	void Add(Price price, std::int64_t bid, std::int64_t ask) {
+		prices_.push_back(price);
+		bids_.push_back(bid);
+		asks_.push_back(ask);
+	}
+};
+
+struct AuctionEquilibrium {
+	Price price_{};
+	Quantity volume_{};
+	std::int64_t imbalance_{}; // Bid minus ask demand at price_; positive means buy surplus
+};
+
+struct AuctionResult {
+	std::optional<AuctionEquilibrium> equilibrium_; // Empty if the book was not crossed
+	Trades trades_; // Includes any continuous matching right after the uncross
+};
+
+// The uncrossing price: the one that executes the most volume, then leaves
+// the smallest surplus, then follows market pressure (highest price if every
+// remaining candidate has a buy surplus, lowest if a sell surplus), then is
+// closest to the reference price, then the lower price. Empty when nothing
+// can execute. Works in levels' own arrays.
+std::optional<AuctionEquilibrium> FindEquilibrium(AuctionLevels &levels, std::optional<Price> referencePrice);
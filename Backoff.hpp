@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <thread>
+
+// How a thread waits for work before parking on its condition variable.
+// Each stage runs for its count of rounds in turn: plain spins re-check as
+// fast as possible, pauses re-check with the cpu's spin-wait hint so a
+// sibling hyperthread keeps its share, yields give the core away for a turn.
+// Only then does the thread park, and only a parked thread costs its waker a
+// futex call. The default parks at once.
+struct WaitPolicy {
+	static constexpr std::uint32_t Forever = std::numeric_limits<std::uint32_t>::max();
+
+	std::uint32_t spins_{0};
+	std::uint32_t pauses_{0};
+	std::uint32_t yields_{0}; // Forever in any stage never parks
+
+	// Park at once: an idle thread uses no cpu
+	static constexpr WaitPolicy Park() { return {}; }
+	// Cover the gap between back-to-back requests, then park
+	static constexpr WaitPolicy Adaptive() { return {200, 20'000, 100}; }
+	// Never park; for threads with an isolated core to themselves
+	static constexpr WaitPolicy Poll() { return {200, Forever, 0}; }
+
+	bool Parks() const { return spins_ != Forever && pauses_ != Forever && yields_ != Forever; }
+	bool operator==(const WaitPolicy &) const = default;
+};
+
+// One wait under a WaitPolicy. Call Wait() after each failed check for work.
+class Backoff {
+  public:
+	explicit Backoff(const WaitPolicy &policy) : limits_{policy.spins_, policy.pauses_, policy.yields_} {}
+
+	// Waits one round; false once the policy says to park.
+	bool Wait() {
+		for (; stage_ < limits_.size(); ++stage_, round_ = 0) {
+			if (round_ == limits_[stage_])
+				continue;
+			if (limits_[stage_] != WaitPolicy::Forever)
+				++round_;
+			if (stage_ == Pausing)
+				Pause();
+			else if (stage_ == Yielding)
+				std::this_thread::yield();
+			return true;
+		}
+		return false;
+	}
+
+  private:
+	static constexpr std::size_t Pausing = 1;
+	static constexpr std::size_t Yielding = 2;
+
+	std::array<std::uint32_t, 3> limits_;
+	std::size_t stage_{0};
+	std::uint32_t round_{0};
+
+	static void Pause() {
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#elif defined(__aarch64__)
+		asm volatile("yield");
+#endif
+	}
+};
@@ -0,0 +1,290 @@
+#include "Config.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+namespace {
+
+std::string_view Trim(std::string_view text) {
+	const auto first = text.find_first_not_of(" \t\r\n");
+	if (first == std::string_view::npos)
+		return {};
+	return text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+bool EqualsIgnoringCase(std::string_view a, std::string_view b) {
+	return std::ranges::equal(a, b, [](char x, char y) { return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y)); });
+}
+
+template <typename T>
+bool ParseUnsigned(std::string_view text, T &value) {
+	std::uint64_t parsed = 0;
+	const auto *end = text.data() + text.size();
+	const auto [last, error] = std::from_chars(text.data(), end, parsed);
+	if (text.empty() || error != std::errc{} || last != end || parsed > std::numeric_limits<T>::max())
+		return false;
+	value = static_cast<T>(parsed);
+	return true;
+}
+
+bool ParseMilliseconds(std::string_view text, std::chrono::milliseconds &value) {
+	std::uint32_t milliseconds = 0;
+	if (!ParseUnsigned(text, milliseconds))
+		return false;
+	value = std::chrono::milliseconds{milliseconds};
+	return true;
+}
+
+// Comma-separated positive millisecond counts
+bool ParseIntervalList(std::string_view text, std::vector<std::chrono::milliseconds> &intervals) {
+	std::vector<std::chrono::milliseconds> parsed;
+	while (!text.empty()) {
+		const auto comma = text.find(',');
+		std::chrono::milliseconds interval;
+		if (!ParseMilliseconds(Trim(text.substr(0, comma)), interval) || interval.count() == 0)
+			return false;
+		parsed.push_back(interval);
+		text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+	}
+	intervals = std::move(parsed);
+	return true;
+}
+
+bool ParseBool(std::string_view text, bool &value) {
+	for (const auto *yes : {"true", "1", "on", "yes"}) {
+		if (EqualsIgnoringCase(text, yes)) {
+			value = true;
+			return true;
+		}
+	}
+	for (const auto *no : {"false", "0", "off", "no"}) {
+		if (EqualsIgnoringCase(text, no)) {
+			value = false;
+			return true;
+		}
+	}
+	return false;
+}
+
+// A thread count; "auto" is 0, for the default
+bool ParseThreadCount(std::string_view text, std::size_t &value) {
+	if (EqualsIgnoringCase(text, "auto")) {
+		value = 0;
+		return true;
+	}
+	return ParseUnsigned(text, value);
+}
+
+bool ParseLogLevel(std::string_view text, LogLevel &level) {
+	if (EqualsIgnoringCase(text, "DEBUG"))
+		level = LogLevel::Debug;
+	else if (EqualsIgnoringCase(text, "INFO"))
+		level = LogLevel::Information;
+	else if (EqualsIgnoringCase(text, "WARN") || EqualsIgnoringCase(text, "WARNING"))
+		level = LogLevel::Warning;
+	else if (EqualsIgnoringCase(text, "ERROR"))
+		level = LogLevel::Error;
+	else
+		return false;
+	return true;
+}
+
+// park, adaptive, poll, or explicit "spins,pauses,yields" counts
+bool ParseWaitPolicy(std::string_view text, WaitPolicy &policy) {
+	if (EqualsIgnoringCase(text, "park")) {
+		policy = WaitPolicy::Park();
+		return true;
+	}
+	if (EqualsIgnoringCase(text, "adaptive")) {
+		policy = WaitPolicy::Adaptive();
+		return true;
+	}
+	if (EqualsIgnoringCase(text, "poll")) {
+		policy = WaitPolicy::Poll();
+		return true;
+	}
+
+	WaitPolicy parsed;
+	for (auto *count : {&parsed.spins_, &parsed.pauses_, &parsed.yields_}) {
+		const auto comma = text.find(',');
+		const auto last = count == &parsed.yields_;
+		if (last != (comma == std::string_view::npos) || !ParseUnsigned(Trim(text.substr(0, comma)), *count))
+			return false;
+		text = last ? std::string_view{} : text.substr(comma + 1);
+	}
+	policy = parsed;
+	return true;
+}
+
+struct Setting {
+	const char *name_;
+	bool (*set_)(std::string_view value, ServerConfig &config);
+};
+
+const Setting Settings[] = {
+	{"SERVER_ADDRESS", [](std::string_view value, ServerConfig &config) { config.address_ = value; return !value.empty(); }},
+	{"SERVER_PORT", [](std::string_view value, ServerConfig &config) { return ParseUnsigned(value, config.port_); }},
+	{"THREAD_COUNT", [](std::string_view value, ServerConfig &config) { return ParseThreadCount(value, config.gatewayThreads_); }},
+	{"MAX_STREAMS", [](std::string_view value, ServerConfig &config) { return ParseUnsigned(value, config.maxStreams_); }},
+	{"MATCHING_THREADS", [](std::string_view value, ServerConfig &config) { return ParseThreadCount(value, config.matchingThreads_); }},
+	{"GATEWAY_CPUS", [](std::string_view value, ServerConfig &config) { return ParseCpuList(value, config.gatewayCpus_); }},
+	{"MATCHING_CPUS", [](std::string_view value, ServerConfig &config) { return ParseCpuList(value, config.matchingCpus_); }},
+	{"BATCH_CPUS", [](std::string_view value, ServerConfig &config) { return ParseCpuList(value, config.batchCpus_); }},
+	{"MATCHING_WAIT", [](std::string_view value, ServerConfig &config) { return ParseWaitPolicy(value, config.matchingWait_); }},
+	{"GATEWAY_WAIT", [](std::string_view value, ServerConfig &config) { return ParseWaitPolicy(value, config.gatewayWait_); }},
+	{"INSTRUMENT_COUNT", [](std::string_view value, ServerConfig &config) { return ParseUnsigned(value, config.instrumentCount_); }},
+	{"MATCHING_ALGORITHM", [](std::string_view value, ServerConfig &config) {
+		 if (value == ToString(MatchingAlgorithm::Fifo))
+			 config.matchingPolicy_.algorithm_ = MatchingAlgorithm::Fifo;
+		 else if (value == ToString(MatchingAlgorithm::ProRata))
+			 config.matchingPolicy_.algorithm_ = MatchingAlgorithm::ProRata;
+		 else
+			 return false;
+		 return true;
+	 }},
+	{"MATCHING_TOP_ORDER", [](std::string_view value, ServerConfig &config) { return ParseBool(value, config.matchingPolicy_.topOrder_); }},
+	{"MATCHING_FIFO_PERCENT", [](std::string_view value, ServerConfig &config) {
+		 return ParseUnsigned(value, config.matchingPolicy_.fifoPercent_) && config.matchingPolicy_.fifoPercent_ <= 100;
+	 }},
+	{"MAX_ORDERS", [](std::string_view value, ServerConfig &config) { return ParseUnsigned(value, config.maxOrders_); }},
+	{"LOCK_MEMORY", [](std::string_view value, ServerConfig &config) { return ParseBool(value, config.lockMemory_); }},
+	{"HUGE_PAGES", [](std::string_view value, ServerConfig &config) { return ParseBool(value, config.hugePages_); }},
+	{"PREFAULT", [](std::string_view value, ServerConfig &config) { return ParseBool(value, config.prefault_); }},
+	{"THROTTLE_MESSAGES_PER_SECOND", [](std::string_view value, ServerConfig &config) { return ParseUnsigned(value, config.throttle_.messagesPerSecond_); }},
+	{"THROTTLE_ORDERS_PER_SECOND", [](std::string_view value, ServerConfig &config) { return ParseUnsigned(value, config.throttle_.ordersPerSecond_); }},
+	{"THROTTLE_BURST", [](std::string_view value, ServerConfig &config) { return ParseUnsigned(value, config.throttle_.burst_); }},
+	{"THROTTLE_IN_FLIGHT_HIGH_WATER", [](std::string_view value, ServerConfig &config) { return ParseUnsigned(value, config.throttle_.inFlightHighWater_); }},
+	{"EXECUTION_REPORT_CAPACITY", [](std::string_view value, ServerConfig &config) { return ParseUnsigned(value, config.executionReportCapacity_) && config.executionReportCapacity_ != 0; }},
+	{"TRADE_TAPE_DIR", [](std::string_view value, ServerConfig &config) { config.tradeTape_.directory_ = value; return true; }},
+	{"TRADE_TAPE_CAPACITY", [](std::string_view value, ServerConfig &config) { return ParseUnsigned(value, config.tradeTape_.capacity_) && config.tradeTape_.capacity_ != 0; }},
+	{"TRADE_BAR_INTERVALS_MS", [](std::string_view value, ServerConfig &config) { return ParseIntervalList(value, config.tradeTape_.barIntervals_); }},
+	{"LOG_LEVEL", [](std::string_view value, ServerConfig &config) { return ParseLogLevel(value, config.logLevel_); }},
+	{"LOG_FILE", [](std::string_view value, ServerConfig &config) { config.logFile_ = value; return !value.empty(); }},
+	{"ENABLE_PROFILING", [](std::string_view value, ServerConfig &config) { return ParseBool(value, config.profiling_); }},
+	{"STATS_DUMP_INTERVAL_MS", [](std::string_view value, ServerConfig &config) { return ParseMilliseconds(value, config.statsDumpInterval_); }},
+	{"TSC_CALIBRATION_INTERVAL_MS", [](std::string_view value, ServerConfig &config) { return ParseMilliseconds(value, config.tscCalibrationInterval_); }},
+};
+
+const Setting *FindSetting(std::string_view name) {
+	const auto it = std::ranges::find_if(Settings, [name](const Setting &setting) { return name == setting.name_; });
+	return it != std::end(Settings) ? it : nullptr;
+}
+
+std::string Apply(const Setting &setting, std::string_view value, ServerConfig &config, const std::string &source) {
+	if (setting.set_(value, config))
+		return {};
+	return source + ": invalid " + setting.name_ + " '" + std::string{value} + "'";
+}
+
+std::string LoadFile(const std::string &path, ServerConfig &config) {
+	std::ifstream file{path};
+	if (!file)
+		return path + ": cannot open";
+
+	std::string line;
+	for (std::size_t number = 1; std::getline(file, line); ++number) {
+		const auto text = Trim(line);
+		if (text.empty() || text.front() == '#')
+			continue;
+
+		const auto equals = text.find('=');
+		const auto source = path + ":" + std::to_string(number);
+		if (equals == std::string_view::npos)
+			return source + ": expected KEY=VALUE";
+
+		auto value = Trim(text.substr(equals + 1));
+		if (value.size() >= 2 && (value.front() == '"' || value.front() == '\'') && value.back() == value.front())
+			value = value.substr(1, value.size() - 2);
+		if (const auto *setting = FindSetting(Trim(text.substr(0, equals)))) {
+			if (auto error = Apply(*setting, value, config, source); !error.empty())
+				return error;
+		}
+	}
+	return {};
+}
+
+// --server-port -> SERVER_PORT
+std::string FlagToName(std::string_view flag) {
+	std::string name{flag};
+	for (auto &c : name)
+		c = c == '-' ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+	return name;
+}
+
+} // namespace
+
+bool ParseCpuList(std::string_view text, std::vector<int> &cpus) {
+	std::vector<int> parsed;
+	while (!text.empty()) {
+		const auto comma = text.find(',');
+		const auto range = Trim(text.substr(0, comma));
+		text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+
+		const auto dash = range.find('-');
+		int first = 0;
+		int last = 0;
+		if (!ParseUnsigned(range.substr(0, dash), first))
+			return false;
+		if (dash == std::string_view::npos)
+			last = first;
+		else if (!ParseUnsigned(range.substr(dash + 1), last) || last < first)
+			return false;
+		for (auto cpu = first; cpu <= last; ++cpu)
+			parsed.push_back(cpu);
+	}
+	cpus = std::move(parsed);
+	return true;
+}
+
+std::string LoadConfig(int argc, const char *const *argv, ServerConfig &config) {
+	std::string path;
+	if (const char *file = std::getenv("CONFIG_FILE"); file && *file)
+		path = file;
+	for (int i = 1; i < argc; ++i) {
+		const std::string_view flag{argv[i]};
+		if (flag.starts_with("--config="))
+			path = flag.substr(9);
+	}
+	if (path.empty() && std::filesystem::exists(".env"))
+		path = ".env";
+
+	if (!path.empty()) {
+		if (auto error = LoadFile(path, config); !error.empty())
+			return error;
+	}
+
+	for (const auto &setting : Settings) {
+		if (const char *value = std::getenv(setting.name_); value && *value) {
+			if (auto error = Apply(setting, value, config, "environment"); !error.empty())
+				return error;
+		}
+	}
+
+	for (int i = 1; i < argc; ++i) {
+		std::string_view flag{argv[i]};
+		if (!flag.starts_with("--"))
+			return std::string{"unexpected argument '"} + argv[i] + "'";
+		if (flag.starts_with("--config="))
+			continue;
+
+		// A bare boolean flag turns the setting on
+		flag.remove_prefix(2);
+		const auto equals = flag.find('=');
+		const auto value = equals == std::string_view::npos ? std::string_view{"true"} : flag.substr(equals + 1);
+		const auto *setting = FindSetting(FlagToName(flag.substr(0, equals)));
+		if (!setting)
+			return std::string{"unknown flag '"} + argv[i] + "'";
+		if (auto error = Apply(*setting, value, config, "command line"); !error.empty())
+			return error;
+	}
+
+	// Streams each hold a gateway thread; order entry needs one left over
+	if (config.gatewayThreads_ != 0 && config.maxStreams_ >= config.gatewayThreads_)
+		return "MAX_STREAMS " + std::to_string(config.maxStreams_) + " leaves no THREAD_COUNT threads for order entry";
+	return {};
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Backoff.hpp"
+#include "ExecutionReports.hpp"
+#include "Logging.hpp"
+#include "MatchingPolicy.hpp"
+#include "Throttle.hpp"
+#include "TradeTape.hpp"
+
+// Everything the server reads at startup. Settings are named like their
+// environment variables (SERVER_PORT) and come from, in increasing priority:
+// the defaults below, a KEY=VALUE file, the environment, and command-line
+// flags spelled --server-port=5001.
+struct ServerConfig {
+	std::string address_{"0.0.0.0"}; // SERVER_ADDRESS
+	std::uint16_t port_{5001}; // SERVER_PORT
+	std::size_t gatewayThreads_{0}; // THREAD_COUNT; 0 or "auto" leaves it to gRPC
+	// MAX_STREAMS: sessions and execution streams open at once, below
+	// THREAD_COUNT; 0 for half of THREAD_COUNT, or unlimited without a cap
+	std::size_t maxStreams_{0};
+	std::size_t matchingThreads_{0}; // MATCHING_THREADS; 0 matches on the gateway threads
+	std::vector<int> gatewayCpus_; // GATEWAY_CPUS, e.g. "0-3,8"; empty for no pinning
+	std::vector<int> matchingCpus_; // MATCHING_CPUS, one per worker in turn
+	std::vector<int> batchCpus_; // BATCH_CPUS, for frequent batch auction threads; empty for any cpu
+	// How idle threads wait: park, adaptive, poll, or "spins,pauses,yields"
+	WaitPolicy matchingWait_; // MATCHING_WAIT: matching workers waiting for books
+	WaitPolicy gatewayWait_; // GATEWAY_WAIT: gateway threads waiting for their book operation
+
+	std::uint32_t instrumentCount_{1}; // INSTRUMENT_COUNT
+	MatchingPolicy matchingPolicy_; // MATCHING_ALGORITHM, MATCHING_TOP_ORDER, MATCHING_FIFO_PERCENT
+
+	// Memory
+	std::size_t maxOrders_{0}; // MAX_ORDERS per book arena, committed as orders arrive; 0 for no arena
+	bool lockMemory_{false}; // LOCK_MEMORY: mlockall, current and future pages
+	bool hugePages_{false}; // HUGE_PAGES for the book arenas
+	bool prefault_{false}; // PREFAULT the book arenas, creating every listed book at startup
+
+	ThrottleConfig throttle_; // THROTTLE_*
+
+	// EXECUTION_REPORT_CAPACITY: reports kept for drop-copy readers, rounded up to a power of two
+	std::size_t executionReportCapacity_{ExecutionReportRing::DefaultCapacity};
+	// TRADE_TAPE_DIR (empty keeps tapes in memory), TRADE_TAPE_CAPACITY trades
+	// per instrument and session, TRADE_BAR_INTERVALS_MS like "1000,60000"
+	TradeTapeConfig tradeTape_;
+
+	LogLevel logLevel_{LogLevel::Information}; // LOG_LEVEL: DEBUG, INFO, WARN or ERROR
+	std::string logFile_{"trading_server.log"}; // LOG_FILE
+	bool profiling_{false}; // ENABLE_PROFILING
+	std::chrono::milliseconds statsDumpInterval_{10'000}; // STATS_DUMP_INTERVAL_MS
+	std::chrono::milliseconds tscCalibrationInterval_{1'000}; // TSC_CALIBRATION_INTERVAL_MS
+};
+
+// Fills config from the file named by --config=path or CONFIG_FILE (.env in
+// the working directory if it exists), then the environment, then the other
+// flags. Unknown keys in the file and environment are ignored; an unknown
+// flag or a malformed value is an error. Returns the error, empty on success.
+std::string LoadConfig(int argc, const char *const *argv, ServerConfig &config);
+
+// "0-3,8" -> {0, 1, 2, 3, 8}. Returns false on a malformed list.
+bool ParseCpuList(std::string_view text, std::vector<int> &cpus);
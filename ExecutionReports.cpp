@@ -0,0 +1,116 @@
+#include "ExecutionReports.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "Backoff.hpp"
+
+const char *ToString(ExecutionType type) {
+	switch (type) {
+	case ExecutionType::Fill:
+		return "fill";
+	case ExecutionType::Cancel:
+		return "cancel";
+	case ExecutionType::Expire:
+		return "expire";
+	case ExecutionType::Replace:
+		return "replace";
+	default:
+		return "unknown";
+	}
+}
+
+ExecutionReportRing::ExecutionReportRing(std::size_t capacity)
+	: slots_{std::make_unique<Slot[]>(std::bit_ceil(std::max<std::size_t>(capacity, 1)))},
+	  mask_{std::bit_ceil(std::max<std::size_t>(capacity, 1)) - 1} {}
+
+std::uint64_t ExecutionReportRing::GetOldestSequence() const {
+	const auto next = GetNextSequence();
+	return next > GetCapacity() ? next - GetCapacity() : 1;
+}
+
+std::uint64_t ExecutionReportRing::Publish(ExecutionReport report) {
+	const auto sequence = nextSequence_.fetch_add(1, std::memory_order_relaxed);
+	report.sequence_ = sequence;
+
+	std::array<std::uint64_t, Words> words{};
+	std::memcpy(words.data(), &report, sizeof(report));
+
+	// Claim the slot by moving its stamp forward, never back: a producer that
+	// took its sequence a lap ago can still be writing it, and one that took
+	// it a lap later may already have. The first waits for the older writer
+	// to finish; the second finds its report lapped before it was written and
+	// drops it, as a reader would have found it overwritten anyway.
+	auto &slot = slots_[sequence & mask_];
+	auto stamp = slot.stamp_.load(std::memory_order_acquire);
+	Backoff backoff{WaitPolicy{200, 20'000, WaitPolicy::Forever}};
+	while (true) {
+		if ((stamp & ~Writing) >= sequence)
+			return sequence;
+		if (stamp & Writing) {
+			backoff.Wait();
+			stamp = slot.stamp_.load(std::memory_order_acquire);
+		} else if (slot.stamp_.compare_exchange_weak(stamp, sequence | Writing, std::memory_order_acquire, std::memory_order_acquire)) {
+			break;
+		}
+	}
+
+	// Stamp, words, stamp: the release fence keeps the word stores after the
+	// writing stamp, and the final release store keeps them before the sequence
+	std::atomic_thread_fence(std::memory_order_release);
+	for (std::size_t i = 0; i < Words; ++i)
+		slot.words_[i].store(words[i], std::memory_order_relaxed);
+	slot.stamp_.store(sequence, std::memory_order_release);
+
+	// Pairs with the fence in WaitFor: either the waiter sees the stamp or
+	// this sees the waiter, whose check under the mutex then cannot miss the
+	// notify
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (waiters_.load(std::memory_order_relaxed) != 0) {
+		// A waiter between its check and its wait holds the mutex
+		std::scoped_lock waitLock{waitMutex_};
+		publishedConditionVariable_.notify_all();
+	}
+	return sequence;
+}
+
+ExecutionReportRing::ReadResult ExecutionReportRing::Read(std::uint64_t sequence, ExecutionReport &report) const {
+	const auto &slot = slots_[sequence & mask_];
+	const auto before = slot.stamp_.load(std::memory_order_acquire);
+	if ((before & ~Writing) > sequence)
+		return ReadResult::Overwritten;
+	if (before != sequence)
+		return ReadResult::NotYet;
+
+	std::array<std::uint64_t, Words> words;
+	for (std::size_t i = 0; i < Words; ++i)
+		words[i] = slot.words_[i].load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (slot.stamp_.load(std::memory_order_relaxed) != sequence)
+		return ReadResult::Overwritten;
+
+	std::memcpy(static_cast<void *>(&report), words.data(), sizeof(report));
+	return ReadResult::Read;
+}
+
+bool ExecutionReportRing::WaitFor(std::uint64_t sequence, std::chrono::nanoseconds timeout) const {
+	if (IsPublished(sequence))
+		return true;
+
+	waiters_.fetch_add(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	bool published;
+	{
+		std::unique_lock waitLock{waitMutex_};
+		published = publishedConditionVariable_.wait_for(waitLock, timeout, [&] { return IsPublished(sequence); });
+	}
+	waiters_.fetch_sub(1, std::memory_order_relaxed);
+	return published;
+}
+
+bool ExecutionReportRing::IsPublished(std::uint64_t sequence) const {
+	// Written and not being rewritten, or already overwritten by a later lap
+	const auto stamp = slots_[sequence & mask_].stamp_.load(std::memory_order_acquire);
+	return stamp == sequence || (stamp & ~Writing) > sequence;
+}
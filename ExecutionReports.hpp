@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+#include "Side.hpp"
+#include "Usings.hpp"
+
+enum class ExecutionType : std::uint8_t {
+	Fill,
+	Cancel, // By the client, a mass cancel or quote, or a fill-and-kill remainder
+	Expire, // Good-for-day order at the close
+	Replace, // Modified or requoted: new price and quantity, back of the queue
+};
+
+const char *ToString(ExecutionType type);
+
+// What happened to one order. A trade produces one fill for each side,
+// sharing the trade id.
+struct ExecutionReport {
+	std::uint64_t sequence_{}; // Stamped by the ring; gap-free across every book
+	Timestamp time_{};
+	OrderId orderId_{};
+	TradeId tradeId_{}; // Fills only
+	OrderId counterpartyOrderId_{}; // Fills only
+	InstrumentId instrumentId_{};
+	ClientId clientId_{};
+	ClientId counterpartyClientId_{}; // Fills only
+	Price price_{}; // Fills: the trade price; otherwise the order's price
+	Quantity quantity_{}; // Filled, taken off the book, or the replacement's quantity
+	Quantity leavesQuantity_{}; // Still open after this report
+	ExecutionType type_{ExecutionType::Fill};
+	Side side_{Side::Buy};
+	bool aggressor_{false}; // Fills only: this order took liquidity; neither side does in an auction
+	bool counterpartyAggressor_{false}; // Fills only
+};
+
+// Execution reports from every book in one sequence, for any number of
+// readers each going at its own pace. The producer takes the next sequence
+// number with one fetch-add and writes its slot, and a full ring overwrites
+// its oldest report. Publishing waits only when the slot's previous report,
+// a whole ring earlier, is still being written. A reader that falls a whole
+// ring behind finds its next report overwritten and has to resume from
+// elsewhere.
+//
+// Each slot is a seqlock over atomic words, so a reader copying a slot while
+// it is rewritten sees the stamp change rather than a torn report.
+class ExecutionReportRing {
+  public:
+	enum class ReadResult {
+		Read,
+		NotYet, // Not published yet
+		Overwritten, // Lapped: the ring no longer holds it
+	};
+
+	// 8 MiB of two-cache-line slots
+	static constexpr std::size_t DefaultCapacity = std::size_t{1} << 16;
+
+	// capacity is rounded up to a power of two.
+	explicit ExecutionReportRing(std::size_t capacity);
+	ExecutionReportRing(const ExecutionReportRing &) = delete;
+	void operator=(const ExecutionReportRing &) = delete;
+
+	std::size_t GetCapacity() const { return mask_ + 1; }
+	// The sequence the next report will get; sequences start at 1.
+	std::uint64_t GetNextSequence() const { return nextSequence_.load(std::memory_order_acquire); }
+	// The oldest sequence a reader starting now could still read.
+	std::uint64_t GetOldestSequence() const;
+
+	// Stamps report with the next sequence number and publishes it. Returns
+	// the sequence number.
+	std::uint64_t Publish(ExecutionReport report);
+	// Copies out the report with the given sequence number.
+	ReadResult Read(std::uint64_t sequence, ExecutionReport &report) const;
+	// Blocks until the report with the given sequence number is published or
+	// overwritten, or for timeout at most. Returns false on timeout. Publish
+	// only pays for the wake while someone is waiting.
+	bool WaitFor(std::uint64_t sequence, std::chrono::nanoseconds timeout) const;
+
+  private:
+	static_assert(std::is_trivially_copyable_v<ExecutionReport>);
+	static constexpr std::size_t Words = (sizeof(ExecutionReport) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+	// Marks a slot's stamp while its words are being rewritten
+	static constexpr std::uint64_t Writing = std::uint64_t{1} << 63;
+
+	struct alignas(64) Slot {
+		std::atomic<std::uint64_t> stamp_{0}; // Sequence of the report held; 0 before the first
+		std::array<std::atomic<std::uint64_t>, Words> words_{};
+	};
+
+	std::unique_ptr<Slot[]> slots_;
+	std::size_t mask_;
+	alignas(64) std::atomic<std::uint64_t> nextSequence_{1};
+	alignas(64) mutable std::atomic<std::uint32_t> waiters_{0};
+	mutable std::mutex waitMutex_;
+	mutable std::condition_variable publishedConditionVariable_;
+
+	bool IsPublished(std::uint64_t sequence) const;
+};
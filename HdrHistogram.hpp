@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// High dynamic range histogram: values are bucketed log-linearly so
+// recording is a couple of shifts and an increment regardless of magnitude.
+// 2^SubBucketHalfCountMagnitude sets the relative precision (10 gives three
+// significant digits). Not thread-safe; keep one per thread and merge with Add().
+template <int SubBucketHalfCountMagnitude>
+class BasicHdrHistogram {
+  public:
+	static constexpr std::int64_t SubBucketHalfCount = std::int64_t{1} << SubBucketHalfCountMagnitude;
+	static constexpr std::int64_t SubBucketCount = SubBucketHalfCount * 2;
+	static constexpr std::uint64_t SubBucketMask = SubBucketCount - 1;
+
+	explicit BasicHdrHistogram(std::uint64_t highestTrackableValue = 3'600'000'000'000ULL)
+		: highestTrackableValue_{std::max<std::uint64_t>(highestTrackableValue, SubBucketCount)},
+		  counts_(CountsLength(highestTrackableValue_)) {}
+
+	static std::size_t CountsLength(std::uint64_t highestTrackableValue) {
+		int bucketCount = 1;
+		for (std::uint64_t smallestUntrackable = SubBucketCount; smallestUntrackable <= highestTrackableValue; smallestUntrackable <<= 1)
+			++bucketCount;
+
+		return static_cast<std::size_t>((bucketCount + 1) * SubBucketHalfCount);
+	}
+
+	static std::size_t CountsIndex(std::uint64_t value) {
+		const int bucketIndex = BucketIndex(value);
+		const auto subBucketIndex = static_cast<std::int64_t>(value >> bucketIndex);
+		return static_cast<std::size_t>(((static_cast<std::int64_t>(bucketIndex) + 1) << SubBucketHalfCountMagnitude) + (subBucketIndex - SubBucketHalfCount));
+	}
+
+	static std::uint64_t ValueFromIndex(std::size_t index) {
+		std::int64_t bucketIndex = static_cast<std::int64_t>(index >> SubBucketHalfCountMagnitude) - 1;
+		std::int64_t subBucketIndex = static_cast<std::int64_t>(index & (SubBucketHalfCount - 1)) + SubBucketHalfCount;
+		if (bucketIndex < 0) {
+			subBucketIndex -= SubBucketHalfCount;
+			bucketIndex = 0;
+		}
+		return static_cast<std::uint64_t>(subBucketIndex) << bucketIndex;
+	}
+
+	void RecordValue(std::uint64_t value, std::uint64_t count = 1) {
+		value = std::min(value, highestTrackableValue_);
+		counts_[CountsIndex(value)] += count;
+		totalCount_ += count;
+		minValue_ = std::min(minValue_, value);
+		maxValue_ = std::max(maxValue_, value);
+	}
+
+	// Coordinated-omission correction: a response that took longer than the
+	// expected send interval also delayed the requests that should have been
+	// sent meanwhile, so back-fill the samples they would have produced.
+	void RecordCorrectedValue(std::uint64_t value, std::uint64_t expectedInterval) {
+		RecordValue(value);
+		if (expectedInterval == 0)
+			return;
+
+		for (std::uint64_t missing = value > expectedInterval ? value - expectedInterval : 0; missing >= expectedInterval; missing -= expectedInterval)
+			RecordValue(missing);
+	}
+
+	void Add(const BasicHdrHistogram &other) {
+		if (other.counts_.size() != counts_.size())
+			throw std::invalid_argument("Cannot merge histograms with different ranges");
+
+		for (std::size_t i = 0; i < counts_.size(); ++i)
+			counts_[i] += other.counts_[i];
+
+		totalCount_ += other.totalCount_;
+		minValue_ = std::min(minValue_, other.minValue_);
+		maxValue_ = std::max(maxValue_, other.maxValue_);
+	}
+
+	void Reset() {
+		std::fill(counts_.begin(), counts_.end(), 0);
+		totalCount_ = 0;
+		minValue_ = UINT64_MAX;
+		maxValue_ = 0;
+	}
+
+	std::uint64_t GetTotalCount() const { return totalCount_; }
+	std::uint64_t GetMin() const { return totalCount_ == 0 ? 0 : minValue_; }
+	std::uint64_t GetMax() const { return maxValue_; }
+
+	double GetMean() const {
+		if (totalCount_ == 0)
+			return 0.0;
+
+		double total = 0.0;
+		for (std::size_t i = 0; i < counts_.size(); ++i) {
+			if (counts_[i] != 0)
+				total += static_cast<double>(counts_[i]) * MedianEquivalentValue(ValueFromIndex(i));
+		}
+		return total / static_cast<double>(totalCount_);
+	}
+
+	// Highest value (within bucket precision) that `percentile` percent of samples are at or below.
+	std::uint64_t GetValueAtPercentile(double percentile) const {
+		if (totalCount_ == 0)
+			return 0;
+
+		const auto target = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::min(percentile, 100.0) / 100.0 * totalCount_ + 0.5));
+		std::uint64_t running = 0;
+		for (std::size_t i = 0; i < counts_.size(); ++i) {
+			running += counts_[i];
+			if (running >= target)
+				return std::min(HighestEquivalentValue(ValueFromIndex(i)), maxValue_);
+		}
+		return maxValue_;
+	}
+
+	// Calls visitor(valueAtIndex, count) for every non-empty bucket in value order.
+	template <typename Visitor>
+	void ForEachBucket(Visitor &&visitor) const {
+		for (std::size_t i = 0; i < counts_.size(); ++i) {
+			if (counts_[i] != 0)
+				visitor(HighestEquivalentValue(ValueFromIndex(i)), counts_[i]);
+		}
+	}
+
+  private:
+	std::uint64_t highestTrackableValue_;
+	std::vector<std::uint64_t> counts_;
+	std::uint64_t totalCount_{0};
+	std::uint64_t minValue_{UINT64_MAX};
+	std::uint64_t maxValue_{0};
+
+	static int BucketIndex(std::uint64_t value) {
+		return (63 - std::countl_zero(value | SubBucketMask)) - SubBucketHalfCountMagnitude;
+	}
+
+	static std::uint64_t SizeOfEquivalentValueRange(std::uint64_t value) {
+		return std::uint64_t{1} << BucketIndex(value);
+	}
+
+	static std::uint64_t HighestEquivalentValue(std::uint64_t value) {
+		return value + SizeOfEquivalentValueRange(value) - 1;
+	}
+
+	static double MedianEquivalentValue(std::uint64_t value) {
+		return static_cast<double>(value) + static_cast<double>(SizeOfEquivalentValueRange(value)) / 2.0;
+	}
+};
+
+using HdrHistogram = BasicHdrHistogram<10>;
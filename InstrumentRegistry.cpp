@@ -0,0 +1,154 @@
+#include "InstrumentRegistry.hpp"
+
+#include <ctime>
+
+InstrumentRegistry::InstrumentRegistry() : endOfDayThread_{[this] { RunEndOfDay(); }} {}
+
+InstrumentRegistry::~InstrumentRegistry() {
+	{
+		std::scoped_lock instrumentsLock{instrumentsMutex_};
+		shutdown_ = true;
+	}
+	shutdownConditionVariable_.notify_one();
+	endOfDayThread_.join();
+}
+
+bool InstrumentRegistry::List(InstrumentId id, const InstrumentDefinition &definition) {
+	std::scoped_lock instrumentsLock{instrumentsMutex_};
+	return instruments_.try_emplace(id, Instrument{definition, nullptr, false, std::nullopt}).second;
+}
+
+bool InstrumentRegistry::List(InstrumentId id, std::shared_ptr<Orderbook> orderbook) {
+	std::scoped_lock instrumentsLock{instrumentsMutex_};
+	if (stats_)
+		orderbook->AttachStats(stats_);
+	if (reports_)
+		orderbook->AttachExecutionReports(reports_, id);
+	InstrumentDefinition definition;
+	definition.matchingPolicy_ = orderbook->GetMatchingPolicy();
+	return instruments_.try_emplace(id, Instrument{definition, std::move(orderbook), true, std::nullopt}).second;
+}
+
+bool InstrumentRegistry::IsListed(InstrumentId id) const {
+	std::scoped_lock instrumentsLock{instrumentsMutex_};
+	return instruments_.contains(id);
+}
+
+std::size_t InstrumentRegistry::ListedCount() const {
+	std::scoped_lock instrumentsLock{instrumentsMutex_};
+	return instruments_.size();
+}
+
+std::size_t InstrumentRegistry::BookCount() const {
+	std::scoped_lock instrumentsLock{instrumentsMutex_};
+	std::size_t count = 0;
+	for (const auto &[_, instrument] : instruments_)
+		count += instrument.orderbook_ != nullptr;
+	return count;
+}
+
+std::shared_ptr<Orderbook> InstrumentRegistry::Find(InstrumentId id) const {
+	std::scoped_lock instrumentsLock{instrumentsMutex_};
+	const auto it = instruments_.find(id);
+	return it != instruments_.end() ? it->second.orderbook_ : nullptr;
+}
+
+std::shared_ptr<Orderbook> InstrumentRegistry::GetOrCreate(InstrumentId id) {
+	std::scoped_lock instrumentsLock{instrumentsMutex_};
+	const auto it = instruments_.find(id);
+	if (it == instruments_.end())
+		return nullptr;
+
+	auto &instrument = it->second;
+	if (!instrument.orderbook_) {
+		instrument.orderbook_ = std::make_shared<Orderbook>(instrument.definition_.capacity_);
+		instrument.orderbook_->SetMatchingPolicy(instrument.definition_.matchingPolicy_);
+		instrument.orderbook_->SetBatchCpus(instrument.definition_.batchCpus_);
+		if (stats_)
+			instrument.orderbook_->AttachStats(stats_);
+		if (reports_)
+			instrument.orderbook_->AttachExecutionReports(reports_, id);
+		if (instrument.lastTradePrice_)
+			instrument.orderbook_->SeedLastTradePrice(*instrument.lastTradePrice_);
+	}
+	return instrument.orderbook_;
+}
+
+std::vector<std::shared_ptr<Orderbook>> InstrumentRegistry::GetBooks() const {
+	std::scoped_lock instrumentsLock{instrumentsMutex_};
+	std::vector<std::shared_ptr<Orderbook>> books;
+	for (const auto &[_, instrument] : instruments_) {
+		if (instrument.orderbook_)
+			books.push_back(instrument.orderbook_);
+	}
+	return books;
+}
+
+std::size_t InstrumentRegistry::CloseDay() {
+	// Cancelling takes each book's own lock, so do it outside the registry's
+	for (const auto &orderbook : GetBooks())
+		orderbook->CancelGoodForDayOrders();
+
+	// A book held elsewhere may be about to take an order; only the
+	// registry's own reference can be dropped safely, and no new one can be
+	// handed out while the lock is held.
+	std::scoped_lock instrumentsLock{instrumentsMutex_};
+	std::size_t dropped = 0;
+	for (auto &[_, instrument] : instruments_) {
+		auto &orderbook = instrument.orderbook_;
+		if (orderbook && !instrument.pinned_ && orderbook.use_count() == 1 && orderbook->IsIdle()) {
+			if (const auto price = orderbook->GetLastTradePrice())
+				instrument.lastTradePrice_ = price;
+			orderbook.reset();
+			++dropped;
+		}
+	}
+	return dropped;
+}
+
+void InstrumentRegistry::AttachStats(std::shared_ptr<Stats> stats) {
+	std::scoped_lock instrumentsLock{instrumentsMutex_};
+	stats_ = std::move(stats);
+	for (const auto &[_, instrument] : instruments_) {
+		if (instrument.orderbook_)
+			instrument.orderbook_->AttachStats(stats_);
+	}
+}
+
+void InstrumentRegistry::AttachExecutionReports(std::shared_ptr<ExecutionReportRing> reports) {
+	std::scoped_lock instrumentsLock{instrumentsMutex_};
+	reports_ = std::move(reports);
+	for (const auto &[id, instrument] : instruments_) {
+		if (instrument.orderbook_)
+			instrument.orderbook_->AttachExecutionReports(reports_, id);
+	}
+}
+
+void InstrumentRegistry::RunEndOfDay() {
+	using namespace std::chrono;
+
+	while (true) {
+		const auto now = system_clock::now();
+		const auto now_c = system_clock::to_time_t(now);
+		std::tm now_parts;
+		localtime_r(&now_c, &now_parts);
+
+		if (now_parts.tm_hour >= EndOfDay.count())
+			now_parts.tm_mday += 1;
+
+		now_parts.tm_hour = EndOfDay.count();
+		now_parts.tm_min = 0;
+		now_parts.tm_sec = 0;
+
+		const auto next = system_clock::from_time_t(mktime(&now_parts));
+		const auto till = next - now + 100ms; // Buffer to ensure we don't miss the deadline
+
+		{
+			std::unique_lock instrumentsLock{instrumentsMutex_};
+			if (shutdownConditionVariable_.wait_for(instrumentsLock, till, [this] { return shutdown_; }))
+				return;
+		}
+
+		CloseDay();
+	}
+}
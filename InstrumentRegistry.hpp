@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ExecutionReports.hpp"
+#include "MatchingPolicy.hpp"
+#include "Orderbook.hpp"
+#include "Stats.hpp"
+#include "Usings.hpp"
+
+// How a listed instrument's book is set up when it is first traded.
+struct InstrumentDefinition {
+	MatchingPolicy matchingPolicy_;
+	BookCapacity capacity_;
+	std::vector<int> batchCpus_; // Frequent batch auction thread; empty runs it on any cpu
+};
+
+// Every listed instrument, with its book created on first use. A listed
+// instrument that has never traded costs one small map entry and no book.
+// At the daily close one thread cancels good-for-day orders across all books
+// and drops the books left idle, so a quiet instrument goes back to costing
+// nothing until it trades again. A dropped book's last trade price is kept
+// and seeds the next book, so the next session's auctions and stops still
+// have a reference.
+class InstrumentRegistry {
+  public:
+	// The instrument requests without an instrument id refer to
+	static constexpr InstrumentId DefaultInstrument = 0;
+	// Local time at which the trading day ends
+	static constexpr std::chrono::hours EndOfDay{16};
+
+	InstrumentRegistry();
+	InstrumentRegistry(const InstrumentRegistry &) = delete;
+	void operator=(const InstrumentRegistry &) = delete;
+	~InstrumentRegistry();
+
+	// Returns false if id is already listed.
+	bool List(InstrumentId id, const InstrumentDefinition &definition = {});
+	// Lists id with an existing book, which is never dropped.
+	bool List(InstrumentId id, std::shared_ptr<Orderbook> orderbook);
+	bool IsListed(InstrumentId id) const;
+	std::size_t ListedCount() const;
+	std::size_t BookCount() const;
+
+	// The book of id if it exists, without creating it.
+	std::shared_ptr<Orderbook> Find(InstrumentId id) const;
+	// The book of id, created if needed; nullptr if id is not listed.
+	std::shared_ptr<Orderbook> GetOrCreate(InstrumentId id);
+	std::vector<std::shared_ptr<Orderbook>> GetBooks() const;
+
+	// Cancels good-for-day orders in every book, then drops idle books that
+	// nothing else holds, keeping their last trade prices. Returns how many
+	// books were dropped. Runs on the
+	// registry's own thread at EndOfDay.
+	std::size_t CloseDay();
+
+	// Attached to every book, now and later. Not thread-safe with respect to
+	// in-flight requests; attach before serving.
+	void AttachStats(std::shared_ptr<Stats> stats);
+	// Every book publishes its execution reports to reports under its
+	// instrument id, now and later. Attach before serving.
+	void AttachExecutionReports(std::shared_ptr<ExecutionReportRing> reports);
+
+  private:
+	struct Instrument {
+		InstrumentDefinition definition_;
+		std::shared_ptr<Orderbook> orderbook_;
+		bool pinned_{false}; // Listed with an existing book
+		std::optional<Price> lastTradePrice_; // Of the last book dropped
+	};
+
+	std::unordered_map<InstrumentId, Instrument> instruments_;
+	std::shared_ptr<Stats> stats_;
+	std::shared_ptr<ExecutionReportRing> reports_;
+	mutable std::mutex instrumentsMutex_;
+	std::condition_variable shutdownConditionVariable_;
+	bool shutdown_{false};
+	std::thread endOfDayThread_; // Declared last: started in the constructor and uses every member above
+
+	void RunEndOfDay();
+};
@@ -0,0 +1,243 @@
+#include "Kernels.hpp"
+
+#include <algorithm>
+
+#include <immintrin.h>
+
+namespace {
+
+std::uint64_t SumQuantitiesScalar(const Quantity *quantities, std::size_t count) {
+	std::uint64_t total = 0;
+	for (std::size_t i = 0; i < count; ++i)
+		total += quantities[i];
+	return total;
+}
+
+void InclusiveScanScalar(const std::int64_t *values, std::int64_t *sums, std::size_t count) {
+	std::int64_t running = 0;
+	for (std::size_t i = 0; i < count; ++i) {
+		running += values[i];
+		sums[i] = running;
+	}
+}
+
+std::size_t FindCumulativeScalar(const Quantity *quantities, std::size_t count, std::uint64_t target) {
+	std::uint64_t running = 0;
+	for (std::size_t i = 0; i < count; ++i) {
+		running += quantities[i];
+		if (running >= target)
+			return i;
+	}
+	return count;
+}
+
+// Quantities are widened to 64 bits before adding so no lane can overflow.
+__attribute__((target("avx2"))) std::uint64_t SumQuantitiesAvx2(const Quantity *quantities, std::size_t count) {
+	auto low = _mm256_setzero_si256();
+	auto high = _mm256_setzero_si256();
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(quantities + i));
+		low = _mm256_add_epi64(low, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(chunk)));
+		high = _mm256_add_epi64(high, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(chunk, 1)));
+	}
+
+	alignas(32) std::uint64_t lanes[4];
+	_mm256_store_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi64(low, high));
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3] + SumQuantitiesScalar(quantities + i, count - i);
+}
+
+// In-register scan of four lanes: add the vector shifted up one lane, then
+// two, then carry the previous block's total into every lane.
+__attribute__((target("avx2"))) void InclusiveScanAvx2(const std::int64_t *values, std::int64_t *sums, std::size_t count) {
+	const auto zero = _mm256_setzero_si256();
+	auto carry = zero;
+	std::size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+		x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0b00000011));
+		x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0b00001111));
+		x = _mm256_add_epi64(x, carry);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(sums + i), x);
+		carry = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+
+	auto running = i != 0 ? sums[i - 1] : 0;
+	for (; i < count; ++i) {
+		running += values[i];
+		sums[i] = running;
+	}
+}
+
+// Scans four widened quantities at a time as InclusiveScanAvx2 does and
+// stops at the first block with a lane past target - 1. Sums stay far below
+// 2^63, so the signed compare is exact.
+__attribute__((target("avx2"))) std::size_t FindCumulativeAvx2(const Quantity *quantities, std::size_t count, std::uint64_t target) {
+	const auto zero = _mm256_setzero_si256();
+	const auto threshold = _mm256_set1_epi64x(static_cast<std::int64_t>(target) - 1);
+	auto carry = zero;
+	std::size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		auto x = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i *>(quantities + i)));
+		x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0b00000011));
+		x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0b00001111));
+		x = _mm256_add_epi64(x, carry);
+		const auto reached = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(x, threshold)));
+		if (reached != 0)
+			return i + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned>(reached)));
+		carry = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+
+	const auto before = static_cast<std::uint64_t>(_mm256_extract_epi64(carry, 0));
+	return i + FindCumulativeScalar(quantities + i, count - i, target - std::min(before, target));
+}
+
+// The all-lanes maskz forms are used throughout: the plain intrinsics pass an
+// undefined vector that trips -Wmaybe-uninitialized under LTO.
+__attribute__((target("avx512f"))) std::uint64_t SumQuantitiesAvx512(const Quantity *quantities, std::size_t count) {
+	constexpr __mmask8 All = 0xff;
+	auto low = _mm512_setzero_si512();
+	auto high = _mm512_setzero_si512();
+	const auto accumulate = [&](__m512i chunk) __attribute__((target("avx512f"))) {
+		low = _mm512_add_epi64(low, _mm512_maskz_cvtepu32_epi64(All, _mm512_maskz_extracti64x4_epi64(All, chunk, 0)));
+		high = _mm512_add_epi64(high, _mm512_maskz_cvtepu32_epi64(All, _mm512_maskz_extracti64x4_epi64(All, chunk, 1)));
+	};
+
+	std::size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+		accumulate(_mm512_loadu_si512(quantities + i));
+
+	// The tail is one masked load rather than a scalar loop
+	const auto remaining = static_cast<unsigned>(count - i);
+	if (remaining != 0)
+		accumulate(_mm512_maskz_loadu_epi32(static_cast<__mmask16>((1u << remaining) - 1), quantities + i));
+
+	alignas(64) std::uint64_t lanes[8];
+	_mm512_store_si512(lanes, _mm512_add_epi64(low, high));
+	std::uint64_t total = 0;
+	for (auto lane : lanes)
+		total += lane;
+	return total;
+}
+
+__attribute__((target("avx512f"))) void InclusiveScanAvx512(const std::int64_t *values, std::int64_t *sums, std::size_t count) {
+	constexpr __mmask8 All = 0xff;
+	const auto zero = _mm512_setzero_si512();
+	const auto last = _mm512_set1_epi64(7);
+	auto carry = zero;
+	std::size_t i = 0;
+	for (; i < count; i += 8) {
+		const auto remaining = count - i;
+		const auto mask = static_cast<__mmask8>(remaining >= 8 ? 0xff : (1u << remaining) - 1);
+
+		// alignr with zero shifts the lanes up by 8 - imm
+		auto x = _mm512_maskz_loadu_epi64(mask, values + i);
+		x = _mm512_add_epi64(x, _mm512_maskz_alignr_epi64(All, x, zero, 7));
+		x = _mm512_add_epi64(x, _mm512_maskz_alignr_epi64(All, x, zero, 6));
+		x = _mm512_add_epi64(x, _mm512_maskz_alignr_epi64(All, x, zero, 4));
+		x = _mm512_add_epi64(x, carry);
+		_mm512_mask_storeu_epi64(sums + i, mask, x);
+		carry = _mm512_maskz_permutexvar_epi64(All, last, x);
+	}
+}
+
+// Eight widened quantities per step, the tail in one masked load; lanes past
+// the end are masked out of the compare.
+__attribute__((target("avx512f"))) std::size_t FindCumulativeAvx512(const Quantity *quantities, std::size_t count, std::uint64_t target) {
+	constexpr __mmask8 All = 0xff;
+	const auto zero = _mm512_setzero_si512();
+	const auto last = _mm512_set1_epi64(7);
+	const auto threshold = _mm512_set1_epi64(static_cast<std::int64_t>(target) - 1);
+	auto carry = zero;
+	for (std::size_t i = 0; i < count; i += 8) {
+		const auto remaining = count - i;
+		const auto mask = static_cast<__mmask8>(remaining >= 8 ? 0xff : (1u << remaining) - 1);
+
+		const auto chunk = _mm512_maskz_loadu_epi32(static_cast<__mmask16>(mask), quantities + i);
+		auto x = _mm512_maskz_cvtepu32_epi64(All, _mm512_maskz_extracti64x4_epi64(All, chunk, 0));
+		x = _mm512_add_epi64(x, _mm512_maskz_alignr_epi64(All, x, zero, 7));
+		x = _mm512_add_epi64(x, _mm512_maskz_alignr_epi64(All, x, zero, 6));
+		x = _mm512_add_epi64(x, _mm512_maskz_alignr_epi64(All, x, zero, 4));
+		x = _mm512_add_epi64(x, carry);
+		const auto reached = _mm512_mask_cmpgt_epi64_mask(mask, x, threshold);
+		if (reached != 0)
+			return i + static_cast<std::size_t>(__builtin_ctz(reached));
+		carry = _mm512_maskz_permutexvar_epi64(All, last, x);
+	}
+	return count;
+}
+
+struct KernelTable {
+	KernelIsa isa_;
+	std::uint64_t (*sumQuantities_)(const Quantity *, std::size_t);
+	void (*inclusiveScan_)(const std::int64_t *, std::int64_t *, std::size_t);
+	std::size_t (*findCumulative_)(const Quantity *, std::size_t, std::uint64_t);
+};
+
+constexpr KernelTable ScalarKernels{KernelIsa::Scalar, SumQuantitiesScalar, InclusiveScanScalar, FindCumulativeScalar};
+constexpr KernelTable Avx2Kernels{KernelIsa::Avx2, SumQuantitiesAvx2, InclusiveScanAvx2, FindCumulativeAvx2};
+constexpr KernelTable Avx512Kernels{KernelIsa::Avx512, SumQuantitiesAvx512, InclusiveScanAvx512, FindCumulativeAvx512};
+
+const KernelTable *Lookup(KernelIsa isa) {
+	__builtin_cpu_init();
+	switch (isa) {
+	case KernelIsa::Avx512:
+		return __builtin_cpu_supports("avx512f") ? &Avx512Kernels : nullptr;
+	case KernelIsa::Avx2:
+		return __builtin_cpu_supports("avx2") ? &Avx2Kernels : nullptr;
+	case KernelIsa::Scalar:
+		return &ScalarKernels;
+	default:
+		return nullptr;
+	}
+}
+
+const KernelTable *&Active() {
+	static const KernelTable *table = [] {
+		for (auto isa : {KernelIsa::Avx512, KernelIsa::Avx2}) {
+			if (const auto *kernels = Lookup(isa))
+				return kernels;
+		}
+		return &ScalarKernels;
+	}();
+	return table;
+}
+
+} // namespace
+
+const char *ToString(KernelIsa isa) {
+	switch (isa) {
+	case KernelIsa::Scalar:
+		return "scalar";
+	case KernelIsa::Avx2:
+		return "avx2";
+	case KernelIsa::Avx512:
+		return "avx512";
+	default:
+		return "unknown";
+	}
+}
+
+KernelIsa GetKernelIsa() {
+	return Active()->isa_;
+}
+
+bool SetKernelIsa(KernelIsa isa) {
+	const auto *kernels = Lookup(isa);
+	if (!kernels)
+		return false;
+	Active() = kernels;
+	return true;
+}
+
+std::uint64_t SumQuantities(const Quantity *quantities, std::size_t count) {
+	return Active()->sumQuantities_(quantities, count);
+}
+
+void InclusiveScan(const std::int64_t *values, std::int64_t *sums, std::size_t count) {
+	Active()->inclusiveScan_(values, sums, count);
+}
+
+std::size_t FindCumulative(const Quantity *quantities, std::size_t count, std::uint64_t target) {
+	return Active()->findCumulative_(quantities, count, target);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Usings.hpp"
+
+// Reductions and searches over contiguous quantity arrays, with AVX2 and AVX-512
+// versions picked once at startup from what the CPU supports. Every
+// instruction set gives exactly the same results.
+enum class KernelIsa {
+	Scalar,
+	Avx2,
+	Avx512,
+};
+
+const char *ToString(KernelIsa isa);
+
+// The instruction set the kernels run on.
+KernelIsa GetKernelIsa();
+// Switches every kernel to isa. Returns false, changing nothing, if the CPU
+// does not support it. Not thread-safe with respect to running kernels.
+bool SetKernelIsa(KernelIsa isa);
+
+// Sum of count quantities, without overflow.
+std::uint64_t SumQuantities(const Quantity *quantities, std::size_t count);
+
+// sums[i] = values[0] + ... + values[i]. sums may alias values.
+void InclusiveScan(const std::int64_t *values, std::int64_t *sums, std::size_t count);
+
+// The first i with quantities[0] + ... + quantities[i] >= target, or count if
+// the whole array falls short. target must be below 2^63.
+std::size_t FindCumulative(const Quantity *quantities, std::size_t count, std::uint64_t target);
@@ -64,6 +64,7 @@ class AbstractLogger : public ILogger {
 
 class TextLogger : public AbstractLogger {
 	std::ofstream logFile;
+	LogLevel minimumLevel;
 	std::queue<std::string> logQueue;
 	std::mutex queueMutex;
 	std::condition_variable cv;
@@ -83,6 +84,8 @@ class TextLogger : public AbstractLogger {
 
   protected:
 	void Log(LogLevel level, const std::string &module, const std::string &message) override {
+		if (level < minimumLevel)
+			return;
 		std::ostringstream oss;
 		oss << "[" << ToString(level) << "] " << module << ": " << message;
 		{
@@ -93,8 +96,8 @@ class TextLogger : public AbstractLogger {
 	}
 
   public:
-	TextLogger(const std::string &filePath)
-		: logFile(filePath), running(true), worker(&TextLogger::ProcessQueue, this) {}
+	TextLogger(const std::string &filePath, LogLevel minimumLevel = LogLevel::Debug)
+		: logFile(filePath), minimumLevel(minimumLevel), running(true), worker(&TextLogger::ProcessQueue, this) {}
 
 	~TextLogger() {
 		running = false;
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+
+#include "PreTradeRisk.hpp"
+#include "Side.hpp"
+#include "Trade.hpp"
+#include "Usings.hpp"
+
+// One level of a two-sided quote. Entries are matched to the resting quote
+// orders of the same set by position; a zero quantity pulls that slot.
+struct QuoteEntry {
+	Side side_;
+	Price price_;
+	Quantity quantity_;
+};
+
+using QuoteEntries = std::vector<QuoteEntry>;
+
+struct MassQuoteResult {
+	bool accepted_{false};
+	RiskCheck riskCheck_{RiskCheck::Passed}; // Why an otherwise valid set was rejected
+	OrderIds orderIds_; // Engine-assigned order id per entry, 0 for pulled slots
+	Trades trades_;
+};
@@ -0,0 +1,80 @@
+#include "MatchingPolicy.hpp"
+
+#include <algorithm>
+
+#include "Kernels.hpp"
+
+const char *ToString(MatchingAlgorithm algorithm) {
+	switch (algorithm) {
+	case MatchingAlgorithm::Fifo:
+		return "fifo";
+	case MatchingAlgorithm::ProRata:
+		return "pro_rata";
+	default:
+		return "unknown";
+	}
+}
+
+namespace {
+
+// Gives out quantity in time priority up to each order's room; returns what is left.
+Quantity AllocateFifo(const Quantity *quantities, Quantity *allocations, std::size_t count, Quantity quantity) {
+	for (std::size_t i = 0; i < count && quantity != 0; ++i) {
+		const auto share = std::min(quantities[i] - allocations[i], quantity);
+		allocations[i] += share;
+		quantity -= share;
+	}
+	return quantity;
+}
+
+} // namespace
+
+Quantity AllocateProRata(const MatchingPolicy &policy, const Quantity *quantities, Quantity *allocations, std::size_t count, Quantity quantity) {
+	const auto total = SumQuantities(quantities, count);
+
+	// Everything at the level fills
+	if (quantity >= total) {
+		std::copy(quantities, quantities + count, allocations);
+		return static_cast<Quantity>(total);
+	}
+
+	std::fill(allocations, allocations + count, Quantity{0});
+	auto remaining = quantity;
+
+	if (policy.topOrder_ && count != 0) {
+		allocations[0] = std::min(quantities[0], remaining);
+		remaining -= allocations[0];
+	}
+
+	if (policy.fifoPercent_ != 0) {
+		const auto fifo = static_cast<Quantity>(static_cast<std::uint64_t>(remaining) * std::min<std::uint8_t>(policy.fifoPercent_, 100) / 100);
+		remaining -= fifo - AllocateFifo(quantities, allocations, count, fifo);
+	}
+
+	if (remaining == 0)
+		return quantity;
+
+	// Pro-rata over what each order has left. remaining < total, so the
+	// ratio fits in 32 bits and each product in 64.
+	const auto base = total - (quantity - remaining);
+	const auto ratio = (static_cast<std::uint64_t>(remaining) << 32) / base;
+	Quantity allocated = 0;
+	for (std::size_t i = 0; i < count; ++i) {
+		const auto share = static_cast<Quantity>((static_cast<std::uint64_t>(quantities[i] - allocations[i]) * ratio) >> 32);
+		allocations[i] += share;
+		allocated += share;
+	}
+
+	// Leftover lots, one per order per pass, in time priority
+	remaining -= allocated;
+	while (remaining != 0) {
+		for (std::size_t i = 0; i < count && remaining != 0; ++i) {
+			if (allocations[i] < quantities[i]) {
+				++allocations[i];
+				--remaining;
+			}
+		}
+	}
+
+	return quantity;
+}
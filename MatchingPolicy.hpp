@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Usings.hpp"
+
+enum class MatchingAlgorithm {
+	Fifo,    // Price-time priority
+	ProRata, // Each level shares an incoming order in proportion to resting size
+};
+
+const char *ToString(MatchingAlgorithm algorithm);
+
+// How an incoming order is allocated across the resting orders at a level.
+// Under ProRata the options run in this order: the top order fills first,
+// then fifoPercent_ of what is left goes in time priority, and the rest is
+// split pro rata.
+struct MatchingPolicy {
+	MatchingAlgorithm algorithm_{MatchingAlgorithm::Fifo};
+	bool topOrder_{false};
+	std::uint8_t fifoPercent_{0}; // 0 to 100
+};
+
+// Allocates quantity across a level's visible quantities, given in time
+// priority. Pro-rata shares are rounded down; the lots left over go one at a
+// time, in time priority, to orders with room left. Shares are computed in
+// 32.32 fixed point in one branch-free pass so the loop vectorizes, which can
+// round a share one lot below the exact floor; the leftover pass absorbs it.
+// Returns the quantity allocated, min(quantity, sum of quantities).
+Quantity AllocateProRata(const MatchingPolicy &policy, const Quantity *quantities, Quantity *allocations, std::size_t count, Quantity quantity);
@@ -0,0 +1,149 @@
+#include "MatchingScheduler.hpp"
+
+#include <algorithm>
+
+#include "Orderbook.hpp"
+#include "Platform.hpp"
+
+namespace {
+
+// The scheduler and worker the calling thread belongs to, if any, so a book
+// made ready on a worker stays on that worker's deque.
+thread_local const MatchingScheduler *currentScheduler = nullptr;
+thread_local std::size_t currentWorker = 0;
+
+} // namespace
+
+MatchingScheduler::MatchingScheduler(std::size_t workers, std::vector<int> cpus, WaitPolicy workerWait, WaitPolicy callerWait)
+	: cpus_{std::move(cpus)}, workerWait_{workerWait}, callerWait_{callerWait} {
+	workers = std::max<std::size_t>(workers, 1);
+	workers_.reserve(workers);
+	for (std::size_t i = 0; i < workers; ++i)
+		workers_.push_back(std::make_unique<Worker>());
+
+	threads_.reserve(workers);
+	for (std::size_t i = 0; i < workers; ++i)
+		threads_.emplace_back([this, i] { RunWorker(i); });
+}
+
+MatchingScheduler::~MatchingScheduler() {
+	{
+		std::scoped_lock idleLock{idleMutex_};
+		shutdown_ = true;
+	}
+	idleConditionVariable_.notify_all();
+	for (auto &thread : threads_)
+		thread.join();
+}
+
+void MatchingScheduler::Submit(std::shared_ptr<Orderbook> orderbook, std::function<void()> command) {
+	auto &queue = orderbook->matchingQueue_;
+	{
+		std::scoped_lock queueLock{queue.mutex_};
+		queue.pending_.push_back(std::move(command));
+		if (queue.scheduled_)
+			return;
+		queue.scheduled_ = true;
+	}
+	Schedule(std::move(orderbook));
+}
+
+void MatchingScheduler::Schedule(std::shared_ptr<Orderbook> orderbook, bool requeue) {
+	const auto target = currentScheduler == this ? currentWorker : nextWorker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+	{
+		auto &worker = *workers_[target];
+		std::scoped_lock workerLock{worker.mutex_};
+		if (requeue)
+			worker.ready_.push_front(std::move(orderbook));
+		else
+			worker.ready_.push_back(std::move(orderbook));
+	}
+
+	// Pairs with the sleeping side of RunWorker(): either the sleeper sees the
+	// new book or this sees the sleeper and wakes it under the lock.
+	readyBooks_.fetch_add(1);
+	if (sleepingWorkers_.load() != 0) {
+		std::scoped_lock idleLock{idleMutex_};
+		idleConditionVariable_.notify_one();
+	}
+}
+
+std::shared_ptr<Orderbook> MatchingScheduler::Take(std::size_t self) {
+	std::shared_ptr<Orderbook> orderbook;
+	{
+		auto &own = *workers_[self];
+		std::scoped_lock workerLock{own.mutex_};
+		if (!own.ready_.empty()) {
+			orderbook = std::move(own.ready_.back());
+			own.ready_.pop_back();
+		}
+	}
+
+	// Steal the book that has waited longest elsewhere
+	for (std::size_t i = 1; !orderbook && i < workers_.size(); ++i) {
+		auto &victim = *workers_[(self + i) % workers_.size()];
+		std::scoped_lock workerLock{victim.mutex_};
+		if (!victim.ready_.empty()) {
+			orderbook = std::move(victim.ready_.front());
+			victim.ready_.pop_front();
+		}
+	}
+
+	if (orderbook)
+		readyBooks_.fetch_sub(1);
+	return orderbook;
+}
+
+void MatchingScheduler::Drain(std::size_t self, std::shared_ptr<Orderbook> orderbook) {
+	auto &queue = orderbook->matchingQueue_;
+	auto &batch = workers_[self]->batch_;
+	{
+		std::scoped_lock queueLock{queue.mutex_};
+		batch.swap(queue.pending_);
+	}
+
+	for (auto &command : batch)
+		command();
+	batch.clear();
+
+	// A book still busy goes behind the others ready here, at the end an
+	// idle worker steals from, so a hot book moves to a free worker rather
+	// than starving its neighbours.
+	{
+		std::scoped_lock queueLock{queue.mutex_};
+		if (queue.pending_.empty()) {
+			queue.scheduled_ = false;
+			return;
+		}
+	}
+	Schedule(std::move(orderbook), true);
+}
+
+void MatchingScheduler::RunWorker(std::size_t self) {
+	currentScheduler = this;
+	currentWorker = self;
+	if (!cpus_.empty())
+		PinCurrentThread({cpus_[self % cpus_.size()]});
+
+	while (true) {
+		if (auto orderbook = Take(self)) {
+			Drain(self, std::move(orderbook));
+			continue;
+		}
+
+		// Watch the ready count for a while first: a book made ready meanwhile
+		// is picked up without Schedule() having to wake anyone.
+		Backoff backoff{workerWait_};
+		while (readyBooks_.load(std::memory_order_relaxed) <= 0 && !shutdown_.load(std::memory_order_relaxed) && backoff.Wait())
+			;
+		if (readyBooks_.load() > 0)
+			continue;
+
+		std::unique_lock idleLock{idleMutex_};
+		sleepingWorkers_.fetch_add(1);
+		idleConditionVariable_.wait(idleLock, [this] { return shutdown_ || readyBooks_.load() > 0; });
+		sleepingWorkers_.fetch_sub(1);
+		if (shutdown_ && readyBooks_.load() <= 0)
+			return;
+	}
+}
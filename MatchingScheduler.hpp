@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "Backoff.hpp"
+
+class Orderbook;
+
+// Commands waiting to run against one book, in arrival order. Owned by the
+// book; only MatchingScheduler touches it.
+class MatchingQueue {
+  private:
+	friend class MatchingScheduler;
+
+	std::mutex mutex_;
+	std::vector<std::function<void()>> pending_;
+	bool scheduled_{false}; // Ready in some worker's deque or being drained
+};
+
+// Runs book operations on a small pool of workers instead of the calling
+// threads. Each book has its own command queue; a book with pending commands
+// is put on one worker's deque, and a worker with nothing of its own steals
+// the oldest ready book from another. A book is drained by one worker at a
+// time, so its commands run one after another in arrival order, while a
+// handful of workers serve any number of books and follow the busy ones.
+class MatchingScheduler {
+  public:
+	// Worker i is pinned to cpus[i % cpus.size()] if cpus is not empty; a cpu
+	// the machine does not have leaves that worker unpinned. An idle worker
+	// waits for books under workerWait, and a thread in Run() waits for its
+	// result under callerWait.
+	explicit MatchingScheduler(std::size_t workers, std::vector<int> cpus = {}, WaitPolicy workerWait = {}, WaitPolicy callerWait = {});
+	MatchingScheduler(const MatchingScheduler &) = delete;
+	void operator=(const MatchingScheduler &) = delete;
+	// Finishes every command already submitted, then stops the workers.
+	~MatchingScheduler();
+
+	std::size_t GetWorkerCount() const { return workers_.size(); }
+
+	// Queues command to run against orderbook after the book's earlier
+	// commands. command must not throw.
+	void Submit(std::shared_ptr<Orderbook> orderbook, std::function<void()> command);
+
+	// Runs operation against orderbook on a worker and returns its result,
+	// rethrowing anything it throws. Blocks the caller until it has run, so
+	// it must not be called from a command.
+	template <typename Operation>
+	std::invoke_result_t<Operation &> Run(std::shared_ptr<Orderbook> orderbook, Operation &&operation);
+
+  private:
+	struct alignas(64) Worker {
+		std::mutex mutex_;
+		std::deque<std::shared_ptr<Orderbook>> ready_; // Own end at the back, thieves take the front
+		std::vector<std::function<void()>> batch_; // Swapped with a book's queue to drain it
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers_;
+	std::atomic<std::size_t> nextWorker_{0}; // Round robin for books made ready off the pool
+	// May dip below zero while a book taken from a deque has yet to be counted in
+	std::atomic<std::ptrdiff_t> readyBooks_{0};
+	std::atomic<std::size_t> sleepingWorkers_{0};
+	std::mutex idleMutex_;
+	std::condition_variable idleConditionVariable_;
+	std::atomic<bool> shutdown_{false}; // Set under idleMutex_; read bare by spinning workers
+	std::vector<int> cpus_;
+	WaitPolicy workerWait_;
+	WaitPolicy callerWait_;
+	std::vector<std::thread> threads_; // Declared last: started in the constructor and uses every member above
+
+	void Schedule(std::shared_ptr<Orderbook> orderbook, bool requeue = false);
+	std::shared_ptr<Orderbook> Take(std::size_t self);
+	void Drain(std::size_t self, std::shared_ptr<Orderbook> orderbook);
+	void RunWorker(std::size_t self);
+};
+
+template <typename Operation>
+std::invoke_result_t<Operation &> MatchingScheduler::Run(std::shared_ptr<Orderbook> orderbook, Operation &&operation) {
+	using Result = std::invoke_result_t<Operation &>;
+
+	// Lives on the caller's stack; the command only carries its address, so
+	// it fits in std::function without allocating.
+	struct Task {
+		explicit Task(Operation &operation) : operation_{operation} {}
+
+		Operation &operation_;
+		std::conditional_t<std::is_void_v<Result>, bool, std::optional<Result>> result_{};
+		std::exception_ptr exception_;
+		std::mutex mutex_;
+		std::condition_variable doneConditionVariable_;
+		std::atomic<bool> done_{false}; // Set under mutex_; read bare while the caller spins
+		bool parked_{false};
+	} task{operation};
+
+	Submit(std::move(orderbook), [&task] {
+		try {
+			if constexpr (std::is_void_v<Result>)
+				task.operation_();
+			else
+				task.result_.emplace(task.operation_());
+		} catch (...) {
+			task.exception_ = std::current_exception();
+		}
+		// Set under the lock: the caller takes it before destroying the task,
+		// so it cannot do so while the worker is still touching it. Only a
+		// parked caller needs the futex wake.
+		std::scoped_lock doneLock{task.mutex_};
+		task.done_.store(true, std::memory_order_release);
+		if (task.parked_)
+			task.doneConditionVariable_.notify_one();
+	});
+
+	Backoff backoff{callerWait_};
+	while (!task.done_.load(std::memory_order_acquire) && backoff.Wait())
+		;
+	{
+		std::unique_lock doneLock{task.mutex_};
+		task.parked_ = true;
+		task.doneConditionVariable_.wait(doneLock, [&task] { return task.done_.load(std::memory_order_relaxed); });
+	}
+	if (task.exception_)
+		std::rethrow_exception(task.exception_);
+	if constexpr (!std::is_void_v<Result>)
+		return std::move(*task.result_);
+}
@@ -1,18 +1,31 @@
 #pragma once
 
+#include <algorithm>
 #include <list>
 #include <memory>
 #include <stdexcept>
 
 #include "Constants.hpp"
 #include "OrderType.hpp"
+#include "PegType.hpp"
 #include "Side.hpp"
 #include "Usings.hpp"
 
 class Order {
   public:
 	Order(OrderType orderType, OrderId orderId, Side side, Price price, Quantity quantity)
-		: orderType_{orderType}, orderId_{orderId}, side_{side}, price_{price}, initialQuantity_{quantity}, remainingQuantity_{quantity} {}
+		: orderType_{orderType}, orderId_{orderId}, side_{side}, price_{price}, initialQuantity_{quantity}, remainingQuantity_{quantity},
+		  visibleQuantity_{quantity} {}
+
+	// Iceberg: only displayQuantity is visible at a time; a zero or oversized
+	// displayQuantity makes a plain, fully visible order.
+	Order(OrderType orderType, OrderId orderId, Side side, Price price, Quantity quantity, Quantity displayQuantity)
+		: Order(orderType, orderId, side, price, quantity) {
+		if (displayQuantity > 0 && displayQuantity < quantity) {
+			displayQuantity_ = displayQuantity;
+			visibleQuantity_ = displayQuantity;
+		}
+	}
 
 	Order(OrderId orderId, Side side, Quantity quantity)
 		: Order(OrderType::Market, orderId, side, Constants::InvalidPrice, quantity) {}
@@ -25,11 +38,57 @@ class Order {
 	Quantity GetRemainingQuantity() const { return remainingQuantity_; }
 	Quantity GetFilledQuantity() const { return GetInitialQuantity() - GetRemainingQuantity(); }
 	bool IsFilled() const { return GetRemainingQuantity() == 0; }
+	Timestamp GetReceiveTime() const { return receiveTime_; }
+	void SetReceiveTime(Timestamp receiveTime) { receiveTime_ = receiveTime; }
+	// Owning client for MassCancel; 0 when the order has none.
+	ClientId GetClientId() const { return clientId_; }
+	void SetClientId(ClientId clientId) { clientId_ = clientId; }
+
+	bool IsIceberg() const { return displayQuantity_ != 0; }
+	Quantity GetDisplayQuantity() const { return displayQuantity_; }
+	// Quantity currently shown in the book and available to match: the whole
+	// remaining quantity, or the current tranche of an iceberg.
+	Quantity GetVisibleQuantity() const { return visibleQuantity_; }
+	bool NeedsReplenish() const { return visibleQuantity_ == 0 && remainingQuantity_ != 0; }
+
+	// Stop and stop-limit: the order is parked until a trade prints at or
+	// through the stop price (at/above for buys, at/below for sells).
+	Price GetStopPrice() const { return stopPrice_; }
+	void SetStopPrice(Price stopPrice) { stopPrice_ = stopPrice; }
+	bool IsStopPending() const { return stopPrice_ != Constants::InvalidPrice && !stopTriggered_; }
+	void TriggerStop() { stopTriggered_ = true; }
+
+	// Pegged: the engine sets the price from the best bid/offer. The price the
+	// order was created with, if any, becomes a limit the peg never passes.
+	bool IsPegged() const { return pegType_ != PegType::None; }
+	PegType GetPegType() const { return pegType_; }
+	Price GetPegOffset() const { return pegOffset_; }
+	Price GetPegLimit() const { return pegLimit_; }
+	void SetPeg(PegType pegType, Price pegOffset) {
+		pegType_ = pegType;
+		pegOffset_ = pegOffset;
+		pegLimit_ = price_;
+	}
+	void Reprice(Price price) { price_ = price; }
+	// Reuses a resting quote order for a new price and size.
+	void Requote(Price price, Quantity quantity) {
+		price_ = price;
+		initialQuantity_ = quantity;
+		remainingQuantity_ = quantity;
+		visibleQuantity_ = quantity;
+	}
+
 	void Fill(Quantity quantity) {
-		if (quantity > GetRemainingQuantity())
-			throw std::logic_error("Order (" + std::to_string(GetOrderId()) + ") cannot be filled for more than its remaining quantity.");
+		if (quantity > GetVisibleQuantity())
+			throw std::logic_error("Order (" + std::to_string(GetOrderId()) + ") cannot be filled for more than its visible quantity.");
 
 		remainingQuantity_ -= quantity;
+		visibleQuantity_ -= quantity;
+	}
+	// Shows the next iceberg tranche; returns its size.
+	Quantity Replenish() {
+		visibleQuantity_ = std::min(displayQuantity_, remainingQuantity_);
+		return visibleQuantity_;
 	}
 	void ToGoodTillCancel(Price price) {
 		if (GetOrderType() != OrderType::Market)
@@ -46,6 +105,15 @@ class Order {
 	Price price_;
 	Quantity initialQuantity_;
 	Quantity remainingQuantity_;
+	Quantity displayQuantity_{};
+	Quantity visibleQuantity_;
+	Price stopPrice_{Constants::InvalidPrice};
+	bool stopTriggered_{false};
+	PegType pegType_{PegType::None};
+	Price pegOffset_{};
+	Price pegLimit_{Constants::InvalidPrice};
+	Timestamp receiveTime_{};
+	ClientId clientId_{};
 };
 
 using OrderPointer = std::shared_ptr<Order>;
@@ -16,10 +16,14 @@ public:
     Price GetPrice() const { return price_; }
     Side GetSide() const { return side_; }
     Quantity GetQuantity() const { return quantity_; }
+    Timestamp GetReceiveTime() const { return receiveTime_; }
+    void SetReceiveTime(Timestamp receiveTime) { receiveTime_ = receiveTime; }
 
-    OrderPointer ToOrderPointer(OrderType type) const
+    OrderPointer ToOrderPointer(OrderType type, Quantity displayQuantity = 0) const
     {
-        return std::make_shared<Order>(type, GetOrderId(), GetSide(), GetPrice(), GetQuantity());
+        auto order = std::make_shared<Order>(type, GetOrderId(), GetSide(), GetPrice(), GetQuantity(), displayQuantity);
+        order->SetReceiveTime(GetReceiveTime());
+        return order;
     }
 
 private:
@@ -27,5 +31,6 @@ private:
     Price price_;
     Side side_;
     Quantity quantity_;
+    Timestamp receiveTime_{};
 };
 
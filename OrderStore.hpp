@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Kernels.hpp"
+#include "Order.hpp"
+#include "Usings.hpp"
+
+using OrderHandle = std::uint32_t;
+constexpr OrderHandle InvalidOrderHandle = std::numeric_limits<OrderHandle>::max();
+
+// Resting orders indexed by a compact handle, as parallel arrays. The fields
+// every fill reads or writes (id, price, remaining and visible quantity,
+// client) are packed here and are the order's live state while it rests; the
+// Order record keeps the cold terms (type, side, iceberg, stop and peg) and
+// its quantities as they were when it entered the book. positions_ is where
+// the order sits in its level's queue. Released handles are reused, so live
+// handles stay dense.
+class OrderStore {
+  public:
+	OrderHandle Add(OrderPointer order) {
+		OrderHandle handle;
+		if (free_.empty()) {
+			handle = static_cast<OrderHandle>(orders_.size());
+			orderIds_.emplace_back();
+			prices_.emplace_back();
+			remaining_.emplace_back();
+			visible_.emplace_back();
+			clientIds_.emplace_back();
+			positions_.emplace_back();
+			orders_.emplace_back();
+		} else {
+			handle = free_.back();
+			free_.pop_back();
+		}
+
+		orderIds_[handle] = order->GetOrderId();
+		prices_[handle] = order->GetPrice();
+		remaining_[handle] = order->GetRemainingQuantity();
+		visible_[handle] = order->GetVisibleQuantity();
+		clientIds_[handle] = order->GetClientId();
+		orders_[handle] = std::move(order);
+		return handle;
+	}
+
+	void Release(OrderHandle handle) {
+		orders_[handle].reset();
+		free_.push_back(handle);
+	}
+
+	const OrderPointer &Get(OrderHandle handle) const { return orders_[handle]; }
+	OrderId GetOrderId(OrderHandle handle) const { return orderIds_[handle]; }
+	Price GetPrice(OrderHandle handle) const { return prices_[handle]; }
+	Quantity GetRemaining(OrderHandle handle) const { return remaining_[handle]; }
+	Quantity GetVisible(OrderHandle handle) const { return visible_[handle]; }
+	ClientId GetClientId(OrderHandle handle) const { return clientIds_[handle]; }
+	std::uint32_t GetPosition(OrderHandle handle) const { return positions_[handle]; }
+	void SetPosition(OrderHandle handle, std::uint32_t position) { positions_[handle] = position; }
+
+	// Takes quantity off the visible tranche; returns what remains of the order.
+	Quantity Fill(OrderHandle handle, Quantity quantity) {
+		if (quantity > visible_[handle])
+			throw std::logic_error("Order (" + std::to_string(orderIds_[handle]) + ") cannot be filled for more than its visible quantity.");
+
+		visible_[handle] -= quantity;
+		return remaining_[handle] -= quantity;
+	}
+	bool NeedsReplenish(OrderHandle handle) const { return visible_[handle] == 0 && remaining_[handle] != 0; }
+	// Shows the next iceberg tranche, sized from the cold record; returns it.
+	Quantity Replenish(OrderHandle handle) {
+		visible_[handle] = std::min(orders_[handle]->GetDisplayQuantity(), remaining_[handle]);
+		return visible_[handle];
+	}
+	void Reprice(OrderHandle handle, Price price) { prices_[handle] = price; }
+	void Requote(OrderHandle handle, Price price, Quantity quantity) {
+		prices_[handle] = price;
+		remaining_[handle] = quantity;
+		visible_[handle] = quantity;
+	}
+
+  private:
+	std::vector<OrderId> orderIds_;
+	std::vector<Price> prices_;
+	std::vector<Quantity> remaining_;
+	std::vector<Quantity> visible_;
+	std::vector<ClientId> clientIds_;
+	std::vector<std::uint32_t> positions_;
+	std::vector<OrderPointer> orders_;
+	std::vector<OrderHandle> free_;
+};
+
+// The resting orders at one price in time priority, with their visible
+// quantities packed alongside so the matching sweep and level scans read
+// contiguous memory. Removing an order leaves a tombstone (an invalid handle
+// with zero quantity) that a later append compacts away; the front is always
+// live. Positions are indexes into the arrays and are kept in the OrderStore.
+class LevelQueue {
+  public:
+	bool empty() const { return live_ == 0; }
+	std::uint32_t size() const { return live_; }
+
+	OrderHandle FrontHandle() const { return handles_[head_]; }
+	Quantity FrontQuantity() const { return quantities_[head_]; }
+
+	// Everything from the front, tombstones included: their zero quantity
+	// drops out of sums and allocations without a branch.
+	std::size_t Span() const { return handles_.size() - head_; }
+	const OrderHandle *Handles() const { return handles_.data() + head_; }
+	const Quantity *Quantities() const { return quantities_.data() + head_; }
+
+	std::uint64_t Visible() const { return SumQuantities(Quantities(), Span()); }
+
+	Quantity GetQuantity(std::uint32_t position) const { return quantities_[position]; }
+	void SetQuantity(std::uint32_t position, Quantity quantity) { quantities_[position] = quantity; }
+
+	void PushBack(OrderStore &store, OrderHandle handle, Quantity quantity) {
+		// Compact once tombstones outnumber live orders
+		if (handles_.size() >= MinCompactSize && handles_.size() - live_ > live_)
+			Compact(store);
+
+		store.SetPosition(handle, static_cast<std::uint32_t>(handles_.size()));
+		handles_.push_back(handle);
+		quantities_.push_back(quantity);
+		++live_;
+	}
+
+	void Remove(std::uint32_t position) {
+		handles_[position] = InvalidOrderHandle;
+		quantities_[position] = 0;
+		if (--live_ == 0) {
+			handles_.clear();
+			quantities_.clear();
+			head_ = 0;
+			return;
+		}
+
+		while (handles_[head_] == InvalidOrderHandle)
+			++head_;
+	}
+
+  private:
+	static constexpr std::size_t MinCompactSize = 16;
+
+	std::vector<OrderHandle> handles_;
+	std::vector<Quantity> quantities_;
+	std::uint32_t head_{0};
+	std::uint32_t live_{0};
+
+	void Compact(OrderStore &store) {
+		std::uint32_t to = 0;
+		for (auto from = head_; from < handles_.size(); ++from) {
+			if (handles_[from] == InvalidOrderHandle)
+				continue;
+			handles_[to] = handles_[from];
+			quantities_[to] = quantities_[from];
+			store.SetPosition(handles_[to], to);
+			++to;
+		}
+		handles_.resize(to);
+		quantities_.resize(to);
+		head_ = 0;
+	}
+};
@@ -1,102 +1,156 @@
 #include "Orderbook.hpp"
+#include "Kernels.hpp"
 #include "Order.hpp"
 #include "OrderModify.hpp"
 #include "OrderType.hpp"
 #include "OrderbookLevelInfos.hpp"
+#include "PegType.hpp"
 #include "Side.hpp"
+#include "TscClock.hpp"
 #include "Usings.hpp"
 
+#include <algorithm>
+#include <array>
 #include <chrono>
-#include <ctime>
 #include <numeric>
 #include <optional>
+#include <utility>
 
-void Orderbook::PruneGoodForDayOrders() {
-	using namespace std::chrono;
-	const auto end = 16h;
+namespace {
 
-	while (true) {
-		const auto now = system_clock::now();
-		const auto now_c = system_clock::to_time_t(now);
-		std::tm now_parts;
-		localtime_r(&now_c, &now_parts);
+// Trade ids a book takes from the shared counter at once
+constexpr TradeId TradeIdBlock = 1024;
+std::atomic<TradeId> nextTradeIdBlock{1};
 
-		if (now_parts.tm_hour >= end.count())
-			now_parts.tm_mday += 1;
+} // namespace
 
-		now_parts.tm_hour = end.count();
-		now_parts.tm_min = 0;
-		now_parts.tm_sec = 0;
+std::size_t Orderbook::CancelGoodForDayOrders() {
+	std::scoped_lock ordersLock{ordersMutex_};
 
-		auto next = system_clock::from_time_t(mktime(&now_parts));
-		auto till = next - now + 100ms; // Buffer to ensure we don't miss the deadline
+	const OrderIds orderIds{goodForDayOrders_.begin(), goodForDayOrders_.end()};
+	for (const auto &orderId : orderIds)
+		CancelOrderInternal(orderId, ExecutionType::Expire);
 
-		{
-			std::unique_lock ordersLock{ordersMutex_};
+	Trades trades;
+	Settle(trades);
+	Count(StatsCounter::Trades, trades.size());
+	return orderIds.size();
+}
 
-			if (shutdown_.load(std::memory_order_acquire) ||
-				shutdownConditionVariable_.wait_for(ordersLock, till) == std::cv_status::no_timeout)
-				return;
-		}
+void Orderbook::CancelOrderInternal(OrderId orderId, ExecutionType reason) {
+	ScopedPerfCounters perfCounters{stats_.get(), PerfRegion::CancelOrder};
+
+	auto it = orders_.find(orderId);
+	if (it == orders_.end())
+		return;
 
-		// {
-		// 	std::scoped_lock ordersLock{ordersMutex_};
+	const auto entry = it->second;
+	const auto &order = entry.order_;
+	EraseOrder(it, order->GetClientId());
 
-		// 	for (const auto &[_, entry] : orders_) {
-		// 		const auto &[order, iterator] = entry;
+	// A replacement is reported by ModifyOrder with its new terms. A resting
+	// order's live quantity is in the store; a parked stop's in the order.
+	if (reason != ExecutionType::Replace) {
+		const auto remaining = entry.handle_ != InvalidOrderHandle ? store_.GetRemaining(entry.handle_) : order->GetRemainingQuantity();
+		ReportExecution(*order, reason, remaining, 0);
+	}
 
-		// 		if (order->GetOrderType() == OrderType::GoodForDay)
-		// 			orderIds.push_back(order->GetOrderId());
-		// 	}
-		// }
+	if (order->GetOrderType() == OrderType::GoodForDay)
+		goodForDayOrders_.erase(orderId);
 
-		OrderIds orderIds = {goodForDayOrders_.begin(), goodForDayOrders_.end()};
+	if (order->GetSide() == Side::Buy)
+		RemoveOrder<Side::Buy>(order, entry);
+	else
+		RemoveOrder<Side::Sell>(order, entry);
+}
 
-		CancelOrders(orderIds);
-		// goodForDayOrders_.clear(); // Just to make sure we don't keep them in memory, as they are cleared in CancelOrders() anyway
+template <Side S>
+void Orderbook::RemoveOrder(const OrderPointer &order, const OrderEntry &entry) {
+	// Parked stops have no displayed quantity, so the level data is untouched
+	if (order->IsStopPending()) {
+		auto &stops = Stops<S>();
+		auto level = stops.find(order->GetStopPrice());
+		level->second.erase(entry.location_);
+		if (level->second.empty())
+			stops.erase(level);
+		return;
 	}
+
+	if (order->IsPegged())
+		RemovePeg<S>(*order, entry.pegLocation_);
+
+	auto level = Levels<S>().find(order->GetPrice());
+	level->second.Remove(store_.GetPosition(entry.handle_));
+	if (level->second.empty())
+		EraseLevel<S>(level);
+	OnOrderCancelled(order->GetPrice(), store_.GetVisible(entry.handle_));
+	store_.Release(entry.handle_);
 }
 
-void Orderbook::CancelOrders(OrderIds orderIds) {
-	std::scoped_lock ordersLock{ordersMutex_};
+template <Side S>
+LevelQueue &Orderbook::GetOrAddLevel(Price price) {
+	auto &levels = Levels<S>();
+	auto level = levels.lower_bound(price);
+	if (level != levels.end() && level->first == price)
+		return level->second;
+
+	auto &spares = SpareLevels<S>();
+	if (spares.empty())
+		return levels.emplace_hint(level, price, LevelQueue{})->second;
+
+	auto node = std::move(spares.back());
+	spares.pop_back();
+	node.key() = price;
+	return levels.insert(level, std::move(node))->second;
+}
 
-	for (const auto &orderId : orderIds)
-		CancelOrderInternal(orderId);
+template <Side S>
+void Orderbook::EraseLevel(typename BookLevels<S>::iterator level) {
+	auto &spares = SpareLevels<S>();
+	if (spares.size() < MaxSpareLevels)
+		spares.push_back(Levels<S>().extract(level));
+	else
+		Levels<S>().erase(level);
 }
 
-void Orderbook::CancelOrderInternal(OrderId orderId) {
-	if (orders_.find(orderId) == orders_.end())
-		return;
+void Orderbook::EraseOrder(OrderEntries::iterator it, ClientId clientId) {
+	if (clientId != 0) {
+		clientOrders_.at(clientId).erase(it->second.clientLocation_);
+		risk_.OnOrderClosed(clientId);
+	}
+	orders_.erase(it);
+}
 
-	const auto [order, iterator] = orders_.at(orderId);
-	orders_.erase(orderId);
+void Orderbook::AddClientOrder(const OrderPointer &order, OrderEntry &entry) {
+	auto &orders = clientOrders_[order->GetClientId()];
+	entry.clientLocation_ = orders.insert(orders.end(), order);
+	risk_.OnOrderOpened(order->GetClientId());
+}
 
-	if (order->GetOrderType() == OrderType::GoodForDay)
-		goodForDayOrders_.erase(orderId);
+RiskCheck Orderbook::CheckRisk(ClientId clientId, Side side, Price price, Quantity quantity, bool opensOrder) const {
+	if (!risk_.Find(clientId)) [[likely]]
+		return RiskCheck::Passed;
 
-	if (order->GetSide() == Side::Sell) {
-		auto price = order->GetPrice();
-		auto &orders = asks_.at(price);
-		orders.erase(iterator);
-		if (orders.empty())
-			asks_.erase(price);
-	} else {
-		auto price = order->GetPrice();
-		auto &orders = bids_.at(price);
-		orders.erase(iterator);
-		if (orders.empty())
-			bids_.erase(price);
+	const auto bestBid = bids_.empty() ? std::nullopt : std::optional<Price>{bids_.begin()->first};
+	const auto bestAsk = asks_.empty() ? std::nullopt : std::optional<Price>{asks_.begin()->first};
+	const auto check = risk_.Check(clientId, side, price, quantity, bestBid, bestAsk, opensOrder);
+	if (check != RiskCheck::Passed) {
+		Count(StatsCounter::Rejects);
+		Count(StatsCounter::RiskRejects);
 	}
+	return check;
+}
 
-	OnOrderCancelled(order);
+void Orderbook::OnOrderCancelled(Price price, Quantity visible) {
+	UpdateLevelData(price, visible, LevelData::Action::Remove);
 }
 
-void Orderbook::OnOrderCancelled(OrderPointer order) {
-	UpdateLevelData(order->GetPrice(), order->GetRemainingQuantity(), LevelData::Action::Remove);
+void Orderbook::OnOrderAdded(Price price, Quantity visible) {
+	UpdateLevelData(price, visible, LevelData::Action::Add);
 }
 
-void Orderbook::OnOrderAdded(OrderPointer order) {
-	UpdateLevelData(order->GetPrice(), order->GetInitialQuantity(), LevelData::Action::Add);
+void Orderbook::OnOrderReplenished(Price price, Quantity visible) {
+	UpdateLevelData(price, visible, LevelData::Action::Replenish);
 }
 
 void Orderbook::OnOrderMatched(Price price, Quantity quantity, bool isFullyFilled) {
@@ -107,7 +161,7 @@ void Orderbook::UpdateLevelData(Price price, Quantity quantity, LevelData::Actio
 	auto &data = data_[price];
 
 	data.count_ += action == LevelData::Action::Remove ? -1 : action == LevelData::Action::Add ? 1
-																							   : 0;
+																							   : 0; // Match and Replenish keep the count
 	if (action == LevelData::Action::Remove || action == LevelData::Action::Match) {
 		data.quantity_ -= quantity;
 	} else {
@@ -118,58 +172,177 @@ void Orderbook::UpdateLevelData(Price price, Quantity quantity, LevelData::Actio
 		data_.erase(price);
 }
 
-bool Orderbook::CanFullyFill(Side side, Price price, Quantity quantity) const {
-	if (!CanMatch(side, price))
-		return false;
-
-	std::optional<Price> threshold;
+template <Side S>
+bool Orderbook::CanFullyFill(Price price, Quantity quantity) const {
+	// Opposite levels best first, only as far as the limit price reaches.
+	// Level totals are gathered a block at a time for the search kernel, so
+	// a deep check scans contiguous totals and a shallow one stops after the
+	// first block.
+	constexpr std::size_t BlockLevels = 64;
+	std::array<Quantity, BlockLevels> available;
+	std::uint64_t needed = quantity;
+	std::size_t count = 0;
+
+	for (const auto &[levelPrice, _] : Levels<SideTraits<S>::Opposite>()) {
+		if (!Reaches<S>(price, levelPrice))
+			break;
 
-	if (side == Side::Buy) {
-		const auto [askPrice, _] = *asks_.begin();
-		threshold = askPrice;
-	} else {
-		const auto [bidPrice, _] = *bids_.begin();
-		threshold = bidPrice;
+		available[count++] = data_.at(levelPrice).quantity_;
+		if (count == BlockLevels) {
+			if (FindCumulative(available.data(), count, needed) != count)
+				return true;
+			needed -= SumQuantities(available.data(), count);
+			count = 0;
+		}
 	}
 
-	for (const auto &[levelPrice, levelData] : data_) {
-		if (threshold.has_value() &&
-			((side == Side::Buy && threshold.value() > levelPrice) ||
-			 (side == Side::Sell && threshold.value() < levelPrice)))
-			continue;
+	return count != 0 && FindCumulative(available.data(), count, needed) != count;
+}
 
-		if ((side == Side::Buy && levelPrice > price) ||
-			(side == Side::Sell && levelPrice < price))
-			continue;
+template <Side S>
+bool Orderbook::CanMatch(Price price) const {
+	const auto &opposite = Levels<SideTraits<S>::Opposite>();
+	return !opposite.empty() && Reaches<S>(price, opposite.begin()->first);
+}
 
-		if (quantity <= levelData.quantity_)
-			return true;
+Trade Orderbook::Fill(LevelQueue &bids, OrderHandle bidHandle, LevelQueue &asks, OrderHandle askHandle,
+					 Quantity quantity, Price bidPrice, Price askPrice, Timestamp matchTime) {
+	const auto bidId = store_.GetOrderId(bidHandle);
+	const auto askId = store_.GetOrderId(askHandle);
+	const auto tradeId = NextTradeId();
+
+	// Before settling, which releases a filled order. Trades print at the
+	// resting order's price; in an auction both prices are the same.
+	if (reports_)
+		ReportFill(bidHandle, askHandle, quantity, aggressor_ == Side::Sell ? bidPrice : askPrice, matchTime, tradeId);
+
+	SettleFill<Side::Buy>(bids, bidHandle, quantity);
+	SettleFill<Side::Sell>(asks, askHandle, quantity);
+
+	return Trade{
+		TradeInfo{bidId, bidPrice, quantity},
+		TradeInfo{askId, askPrice, quantity},
+		matchTime,
+		tradeId,
+		aggressor_};
+}
 
-		quantity -= levelData.quantity_;
+TradeId Orderbook::NextTradeId() {
+	if (nextTradeId_ == tradeIdBlockEnd_) {
+		nextTradeId_ = nextTradeIdBlock.fetch_add(TradeIdBlock, std::memory_order_relaxed);
+		tradeIdBlockEnd_ = nextTradeId_ + TradeIdBlock;
 	}
+	return nextTradeId_++;
+}
 
-	return false;
+void Orderbook::ReportFill(OrderHandle bid, OrderHandle ask, Quantity quantity, Price price, Timestamp matchTime, TradeId tradeId) {
+	for (const auto side : {Side::Buy, Side::Sell}) {
+		const auto order = side == Side::Buy ? bid : ask;
+		const auto counterparty = side == Side::Buy ? ask : bid;
+		const auto counterpartySide = side == Side::Buy ? Side::Sell : Side::Buy;
+		ExecutionReport report;
+		report.time_ = matchTime;
+		report.orderId_ = store_.GetOrderId(order);
+		report.tradeId_ = tradeId;
+		report.counterpartyOrderId_ = store_.GetOrderId(counterparty);
+		report.instrumentId_ = instrumentId_;
+		report.clientId_ = store_.GetClientId(order);
+		report.counterpartyClientId_ = store_.GetClientId(counterparty);
+		report.price_ = price;
+		report.quantity_ = quantity;
+		report.leavesQuantity_ = store_.GetRemaining(order) - quantity;
+		report.type_ = ExecutionType::Fill;
+		report.side_ = side;
+		report.aggressor_ = aggressor_ == side;
+		report.counterpartyAggressor_ = aggressor_ == counterpartySide;
+		reports_->Publish(report);
+	}
 }
 
-bool Orderbook::CanMatch(Side side, Price price) const {
-	if (side == Side::Buy) {
-		if (asks_.empty())
-			return false;
+void Orderbook::ReportExecution(const Order &order, ExecutionType type, Quantity quantity, Quantity leavesQuantity) {
+	if (!reports_)
+		return;
 
-		const auto &[bestAsk, _] = *asks_.begin();
-		return price >= bestAsk;
-	} else {
-		if (bids_.empty())
-			return false;
+	ExecutionReport report;
+	report.time_ = TscClock::Now();
+	report.orderId_ = order.GetOrderId();
+	report.instrumentId_ = instrumentId_;
+	report.clientId_ = order.GetClientId();
+	report.price_ = order.GetPrice();
+	report.quantity_ = quantity;
+	report.leavesQuantity_ = leavesQuantity;
+	report.type_ = type;
+	report.side_ = order.GetSide();
+	reports_->Publish(report);
+}
 
-		const auto &[bestBid, _] = *bids_.begin();
-		return price <= bestBid;
+template <Side S>
+void Orderbook::SettleFill(LevelQueue &level, OrderHandle handle, Quantity quantity) {
+	// The store's packed fields only: the Order record is read just for a
+	// pegged order leaving the book and for a new iceberg tranche
+	const auto price = store_.GetPrice(handle);
+	const auto clientId = store_.GetClientId(handle);
+	const auto position = store_.GetPosition(handle);
+	const auto remaining = store_.Fill(handle, quantity);
+	risk_.OnFill(clientId, S, quantity);
+
+	if (remaining == 0) {
+		OnOrderMatched(price, quantity, true);
+		level.Remove(position);
+		auto entry = orders_.find(store_.GetOrderId(handle));
+		if (entry->second.pegged_)
+			RemovePeg<S>(*entry->second.order_, entry->second.pegLocation_);
+		EraseOrder(entry, clientId);
+		store_.Release(handle); // Last reference: order is gone after this
+		return;
 	}
+
+	OnOrderMatched(price, quantity, false);
+
+	// An exhausted iceberg tranche is refilled and loses time priority; the
+	// handle moves to the back of the level and stays valid
+	if (store_.NeedsReplenish(handle)) {
+		const auto visible = store_.Replenish(handle);
+		level.Remove(position);
+		level.PushBack(store_, handle, visible);
+		OnOrderReplenished(price, visible);
+		return;
+	}
+
+	level.SetQuantity(position, store_.GetVisible(handle));
 }
 
-Trades Orderbook::MatchOrders() {
+template <Side RestingSide>
+void Orderbook::MatchProRata(LevelQueue &bids, LevelQueue &asks, Price bidPrice, Price askPrice, Timestamp matchTime, Trades &trades) {
+	auto &incoming = RestingSide == Side::Buy ? asks : bids;
+	auto &resting = RestingSide == Side::Buy ? bids : asks;
+
+	// Allocate straight over the level's packed quantities; tombstones have
+	// none and get nothing. The handles are copied first since fills that
+	// replenish an iceberg can compact the level.
+	const auto span = resting.Span();
+	proRataHandles_.assign(resting.Handles(), resting.Handles() + span);
+	proRataAllocations_.resize(span);
+	AllocateProRata(matchingPolicy_, resting.Quantities(), proRataAllocations_.data(), span, incoming.FrontQuantity());
+
+	// The incoming order is only exhausted by the last allocation
+	for (std::size_t i = 0; i < span; ++i) {
+		if (proRataAllocations_[i] == 0)
+			continue;
+		if constexpr (RestingSide == Side::Buy)
+			trades.push_back(Fill(bids, proRataHandles_[i], asks, asks.FrontHandle(), proRataAllocations_[i], bidPrice, askPrice, matchTime));
+		else
+			trades.push_back(Fill(bids, bids.FrontHandle(), asks, proRataHandles_[i], proRataAllocations_[i], bidPrice, askPrice, matchTime));
+	}
+}
+
+Trades Orderbook::MatchOrders(std::optional<Side> aggressor) {
+	ScopedPerfCounters perfCounters{stats_.get(), PerfRegion::MatchOrders};
+	aggressor_ = aggressor;
+
 	Trades trades;
-	trades.reserve(orders_.size());
+	if (IsAccumulating())
+		return trades; // Orders accumulate until the book is uncrossed
 
 	while (true) {
 		if (bids_.empty() || asks_.empty())
@@ -181,155 +354,813 @@ Trades Orderbook::MatchOrders() {
 		if (bidPrice < askPrice)
 			break;
 
-		while (!bids.empty() && !asks.empty()) {
-			auto bid = bids.front();
-			auto ask = asks.front();
-
-			Quantity quantity = std::min(bid->GetRemainingQuantity(), ask->GetRemainingQuantity());
-
-			bid->Fill(quantity);
-			ask->Fill(quantity);
+		// Sized on the first cross from the levels it touches, not the whole
+		// book: most orders never cross, and most that do stop at one level
+		if (trades.empty())
+			trades.reserve(bids.size() + asks.size());
 
-			if (bid->IsFilled()) {
-				bids.pop_front();
-				orders_.erase(bid->GetOrderId());
-			}
+		const auto matchTime = TscClock::Now();
 
-			if (ask->IsFilled()) {
-				asks.pop_front();
-				orders_.erase(ask->GetOrderId());
+		while (!bids.empty() && !asks.empty()) {
+			// Under pro-rata the level opposite the aggressor shares out the
+			// front of the aggressor's level, which may hold earlier orders
+			// too (pegs move as a group). A level of one fills the same
+			// either way. Without an aggressor, in the residual match after
+			// an uncross, neither side took liquidity and both go FIFO.
+			if (matchingPolicy_.algorithm_ == MatchingAlgorithm::ProRata && aggressor_) [[unlikely]] {
+				if (*aggressor_ == Side::Buy && asks.size() > 1) {
+					MatchProRata<Side::Sell>(bids, asks, bidPrice, askPrice, matchTime, trades);
+					continue;
+				}
+				if (*aggressor_ == Side::Sell && bids.size() > 1) {
+					MatchProRata<Side::Buy>(bids, asks, bidPrice, askPrice, matchTime, trades);
+					continue;
+				}
 			}
 
-			trades.push_back(Trade{
-				TradeInfo{bid->GetOrderId(), bid->GetPrice(), quantity},
-				TradeInfo{ask->GetOrderId(), ask->GetPrice(), quantity}});
-
-			OnOrderMatched(bid->GetPrice(), quantity, bid->IsFilled());
-			OnOrderMatched(ask->GetPrice(), quantity, ask->IsFilled());
+			const auto quantity = std::min(bids.FrontQuantity(), asks.FrontQuantity());
+			trades.push_back(FillFront(bids, asks, quantity, bidPrice, askPrice, matchTime));
 		}
 
-		if (bids.empty()) {
-			bids_.erase(bidPrice);
-			data_.erase(bidPrice);
-		}
+		// Level data removes itself with the last order at a price
+		if (bids.empty())
+			EraseLevel<Side::Buy>(bids_.begin());
 
-		if (asks.empty()) {
-			asks_.erase(askPrice);
-			data_.erase(askPrice);
-		}
+		if (asks.empty())
+			EraseLevel<Side::Sell>(asks_.begin());
 	}
 
-	if (!bids_.empty()) {
-		auto &[_, bids] = *bids_.begin();
-		auto &order = bids.front();
-		if (order->GetOrderType() == OrderType::FillAndKill)
-			CancelOrderInternal(order->GetOrderId());  // Use internal method to avoid mutex deadlock
-	}
+	CancelFillAndKillFront<Side::Buy>();
+	CancelFillAndKillFront<Side::Sell>();
+	return trades;
+}
 
-	if (!asks_.empty()) {
-		auto &[_, asks] = *asks_.begin();
-		auto &order = asks.front();
-		if (order->GetOrderType() == OrderType::FillAndKill)
-			CancelOrderInternal(order->GetOrderId());  // Use internal method to avoid mutex deadlock
-	}
+template <Side S>
+void Orderbook::CancelFillAndKillFront() {
+	const auto &levels = Levels<S>();
+	if (levels.empty())
+		return;
 
-	return trades;
+	const auto &order = store_.Get(levels.begin()->second.FrontHandle());
+	if (order->GetOrderType() == OrderType::FillAndKill)
+		CancelOrderInternal(order->GetOrderId());  // Use internal method to avoid mutex deadlock
 }
 
-Orderbook::Orderbook() : ordersPruneThread_{[this] { PruneGoodForDayOrders(); }} {}
+Orderbook::Orderbook() = default;
+
+Orderbook::Orderbook(const BookCapacity &capacity) {
+	if (capacity.orders_ != 0)
+		arenaMemory_.Reserve(capacity.orders_ * ArenaBytesPerOrder, capacity.hugePages_, capacity.prefault_);
+}
 
 Orderbook::~Orderbook() {
 	shutdown_.store(true, std::memory_order_release);
-	shutdownConditionVariable_.notify_one();
-	ordersPruneThread_.join();
+	StopBatches();
+	JoinBatchThread();
+}
+
+Trades Orderbook::AddOrder(OrderPointer order, RiskCheck *riskCheck) {
+	Count(StatsCounter::Adds);
+
+	auto ordersLock = LockOrders(StatsOperation::AddOrder);
+	ScopedStageTimer matchTimer{stats_.get(), StatsOperation::AddOrder, StatsStage::Match};
+	ScopedPerfCounters perfCounters{stats_.get(), PerfRegion::AddOrder};
+
+	if (order && order->GetOrderId() >= QuoteOrderIdBase) { // Reserved for MassQuote
+		Count(StatsCounter::Rejects);
+		return {};
+	}
+
+	if (order) {
+		const auto check = CheckRisk(order->GetClientId(), order->GetSide(), order->GetPrice(), order->GetInitialQuantity(), true);
+		if (riskCheck)
+			*riskCheck = check;
+		if (check != RiskCheck::Passed)
+			return {};
+	}
+
+	return AddOrderInternal(order);
 }
 
-Trades Orderbook::AddOrder(OrderPointer order) {
+Trades Orderbook::AddOrderInternal(OrderPointer order) {
 	// Input validation
 	if (!order || order->GetInitialQuantity() == 0) {
+		Count(StatsCounter::Rejects);
 		return {};
 	}
 	
-	if (order->GetPrice() < 0 || order->GetPrice() > 1000000) { // Reasonable price bounds
+	if (order->GetPrice() < 0 || order->GetPrice() > 1000000 ||
+		order->GetStopPrice() < 0 || order->GetStopPrice() > 1000000) { // Reasonable price bounds
+		Count(StatsCounter::Rejects);
 		return {};
 	}
 	
-	std::scoped_lock ordersLock{ordersMutex_};
-
 	// if (orders_.find(order->GetOrderId()) != orders_.end())
 	// 	return {};
 
 	auto [it, inserted] = orders_.insert({order->GetOrderId(), OrderEntry{order, OrderPointers::iterator()}});
-	if (!inserted) // Saves one map lookup if the order already exists
+	if (!inserted) { // Saves one map lookup if the order already exists
+		Count(StatsCounter::Rejects);
 		return {};
+	}
+
+	if (order->GetOrderType() == OrderType::GoodForDay)
+		goodForDayOrders_.insert(order->GetOrderId());
+	if (order->GetClientId() != 0)
+		AddClientOrder(order, it->second);
+
+	if (order->IsStopPending()) {
+		if (!IsStopTriggered(*order)) {
+			order->GetSide() == Side::Buy ? ParkStopOrder<Side::Buy>(order, it->second) : ParkStopOrder<Side::Sell>(order, it->second);
+			return {};
+		}
+		order->TriggerStop();
+	}
+
+	auto trades = ActivateOrder(order, it->second);
+	Settle(trades);
+
+	Count(StatsCounter::Trades, trades.size());
+	return trades;
+}
+
+void Orderbook::Settle(Trades &trades) {
+	// Trades may trigger stops whose own trades trigger further stops, and any
+	// change to the best prices moves the pegs. Run rounds here until nothing
+	// changes rather than recursing through ActivateOrder.
+	while (true) {
+		auto triggered = CollectTriggeredStops();
+		for (const auto &stop : triggered) {
+			auto stopTrades = ActivateOrder(stop, orders_.at(stop->GetOrderId()));
+			trades.insert(trades.end(), stopTrades.begin(), stopTrades.end());
+		}
+
+		if (triggered.empty() && !RepricePegs(trades))
+			break;
+	}
+}
+
+Trades Orderbook::ActivateOrder(OrderPointer order, OrderEntry &entry) {
+	return order->GetSide() == Side::Buy ? ActivateOrder<Side::Buy>(std::move(order), entry) : ActivateOrder<Side::Sell>(std::move(order), entry);
+}
+
+template <Side S>
+Trades Orderbook::ActivateOrder(OrderPointer order, OrderEntry &entry) {
+	if (IsAccumulating() && (order->IsPegged() || order->GetOrderType() == OrderType::Market ||
+							 order->GetOrderType() == OrderType::FillAndKill || order->GetOrderType() == OrderType::FillOrKill)) {
+		EraseOrder(orders_.find(order->GetOrderId()), order->GetClientId());
+		Count(StatsCounter::Rejects);
+		return {};
+	}
+
+	if (order->IsPegged()) {
+		const auto price = PegPrice<S>(order->GetPegType(), order->GetPegOffset(), BestLimitPrice<Side::Buy>(), BestLimitPrice<Side::Sell>());
+		if (!price) {
+			EraseOrder(orders_.find(order->GetOrderId()), order->GetClientId());
+			Count(StatsCounter::Rejects);
+			return {};
+		}
+		order->Reprice(LimitPegPrice<S>(*order, *price));
+	}
 
 	if (order->GetOrderType() == OrderType::Market) {
-		if (order->GetSide() == Side::Buy && !asks_.empty()) {
-			const auto &[worstAsk, _] = *asks_.rbegin();
-			order->ToGoodTillCancel(worstAsk);
-		} else if (order->GetSide() == Side::Sell && !bids_.empty()) {
-			const auto &[worstBid, _] = *bids_.rbegin();
-			order->ToGoodTillCancel(worstBid);
-		} else {
-			orders_.erase(it);
+		const auto &opposite = Levels<SideTraits<S>::Opposite>();
+		if (opposite.empty()) {
+			EraseOrder(orders_.find(order->GetOrderId()), order->GetClientId());
+			Count(StatsCounter::Rejects);
 			return {};
 		}
+		const auto &[worstPrice, _] = *opposite.rbegin();
+		order->ToGoodTillCancel(worstPrice);
 	}
-	if (order->GetOrderType() == OrderType::GoodForDay)
-		goodForDayOrders_.insert(order->GetOrderId());
 
-	if (order->GetOrderType() == OrderType::FillAndKill && !CanMatch(order->GetSide(), order->GetPrice())) {
-		orders_.erase(it);
+	if (order->GetOrderType() == OrderType::FillAndKill && !CanMatch<S>(order->GetPrice())) {
+		EraseOrder(orders_.find(order->GetOrderId()), order->GetClientId());
+		Count(StatsCounter::Rejects);
 		return {};
 	}
 
-	if (order->GetOrderType() == OrderType::FillOrKill && !CanFullyFill(order->GetSide(), order->GetPrice(), order->GetInitialQuantity())) {
-		orders_.erase(it);
+	if (order->GetOrderType() == OrderType::FillOrKill && !CanFullyFill<S>(order->GetPrice(), order->GetInitialQuantity())) {
+		EraseOrder(orders_.find(order->GetOrderId()), order->GetClientId());
+		Count(StatsCounter::Rejects);
 		return {};
 	}
 
-	// OrderPointers::iterator iterator;
+	entry.handle_ = store_.Add(order);
+	GetOrAddLevel<S>(order->GetPrice()).PushBack(store_, entry.handle_, order->GetVisibleQuantity());
 
-	// if (order->GetSide() == Side::Buy) {
-	// 	auto &orders = bids_[order->GetPrice()];
-	// 	orders.push_back(order);
-	// 	iterator = std::prev(orders.end());
-	// } else {
-	// 	auto &orders = asks_[order->GetPrice()];
-	// 	orders.push_back(order);
-	// 	iterator = std::prev(orders.end());
-	// }
+	OnOrderAdded(order->GetPrice(), order->GetVisibleQuantity());
+	if (order->IsPegged())
+		AddPeg<S>(order, entry);
 
-	auto &ordersAtPrice = (order->GetSide() == Side::Buy ? bids_[order->GetPrice()] : asks_[order->GetPrice()]);
-	ordersAtPrice.push_back(order);
-	it->second.location_ = std::prev(ordersAtPrice.end());
+	auto trades = MatchOrders(S);
+	RecordTradePrices<S>(trades);
+	return trades;
+}
+
+template <Side S>
+void Orderbook::ParkStopOrder(OrderPointer order, OrderEntry &entry) {
+	auto &ordersAtStop = Stops<S>()[order->GetStopPrice()];
+	ordersAtStop.push_back(order);
+	entry.location_ = std::prev(ordersAtStop.end());
+}
+
+bool Orderbook::IsStopTriggered(const Order &order) const {
+	if (!lastTradePrice_)
+		return false;
+
+	return order.GetSide() == Side::Buy ? Reaches<Side::Buy>(*lastTradePrice_, order.GetStopPrice())
+										: Reaches<Side::Sell>(*lastTradePrice_, order.GetStopPrice());
+}
+
+template <Side AggressorSide>
+void Orderbook::RecordTradePrices(const Trades &trades) {
+	for (const auto &trade : trades) {
+		// Trades print at the resting order's price
+		const auto price = AggressorSide == Side::Buy ? trade.GetAskTrade().price_ : trade.GetBidTrade().price_;
+
+		lastTradePrice_ = price;
+		if (!tradedRange_)
+			tradedRange_ = std::make_pair(price, price);
+		tradedRange_->first = std::min(tradedRange_->first, price);
+		tradedRange_->second = std::max(tradedRange_->second, price);
+	}
+}
+
+OrderPointers Orderbook::CollectTriggeredStops() {
+	OrderPointers triggered;
+	if (!tradedRange_)
+		return triggered;
+
+	const auto [low, high] = *tradedRange_;
+	tradedRange_.reset();
+
+	CollectTriggeredStops<Side::Buy>(high, triggered);
+	CollectTriggeredStops<Side::Sell>(low, triggered);
+
+	for (const auto &order : triggered)
+		order->TriggerStop();
+
+	return triggered;
+}
+
+template <Side S>
+void Orderbook::CollectTriggeredStops(Price tradedThrough, OrderPointers &triggered) {
+	// The stop book is ordered so the next stop to trigger is at begin(); only
+	// the levels the trades reached are visited. Whole levels are spliced out,
+	// which keeps time priority within a stop price and allocates nothing.
+	auto &stops = Stops<S>();
+	while (!stops.empty() && Reaches<S>(tradedThrough, stops.begin()->first)) {
+		triggered.splice(triggered.end(), stops.begin()->second);
+		stops.erase(stops.begin());
+	}
+}
+
+template <Side S>
+std::optional<Price> Orderbook::BestLimitPrice() const {
+	// Pegs follow the best non-pegged price, never each other
+	for (const auto &[price, level] : Levels<S>()) {
+		for (std::size_t i = 0; i < level.Span(); ++i) {
+			const auto handle = level.Handles()[i];
+			if (handle != InvalidOrderHandle && !store_.Get(handle)->IsPegged())
+				return price;
+		}
+	}
+	return std::nullopt;
+}
 
-	OnOrderAdded(order);
+template <Side S>
+std::optional<Price> Orderbook::PegPrice(PegType pegType, Price offset, std::optional<Price> bid, std::optional<Price> ask) {
+	const auto own = S == Side::Buy ? bid : ask;
+	const auto opposite = S == Side::Buy ? ask : bid;
+
+	std::optional<Price> reference;
+	switch (pegType) {
+	case PegType::Primary:
+		reference = own;
+		break;
+	case PegType::Market:
+		reference = opposite;
+		break;
+	case PegType::Midpoint:
+		// Round away from the other side so the midpoint never improves on it
+		if (bid && ask)
+			reference = S == Side::Buy ? (*bid + *ask) / 2 : (*bid + *ask + 1) / 2;
+		break;
+	default:
+		break;
+	}
+
+	if (!reference)
+		return std::nullopt;
+
+	// Pegs rest passively: never at or through the opposite best price
+	auto price = *reference + offset;
+	if (opposite)
+		price = Worse<S>(price, *opposite - SideTraits<S>::Improve);
 
-	return MatchOrders();
+	if (price <= 0 || price > 1000000)
+		return std::nullopt;
+	return price;
+}
+
+template <Side S>
+Price Orderbook::LimitPegPrice(const Order &order, Price price) {
+	if (order.GetPegLimit() == Constants::InvalidPrice)
+		return price;
+
+	return Worse<S>(price, order.GetPegLimit());
+}
+
+template <Side S>
+void Orderbook::AddPeg(OrderPointer order, OrderEntry &entry) {
+	auto [it, inserted] = Pegs<S>().try_emplace(PegKey{order->GetPegType(), order->GetPegOffset()});
+	auto &group = it->second;
+	if (inserted)
+		group.price_ = order->GetPrice();
+
+	group.orders_.push_back(order);
+	entry.pegLocation_ = std::prev(group.orders_.end());
+	entry.pegged_ = true;
+}
+
+template <Side S>
+void Orderbook::RemovePeg(const Order &order, OrderPointers::iterator pegLocation) {
+	auto &pegs = Pegs<S>();
+	auto it = pegs.find(PegKey{order.GetPegType(), order.GetPegOffset()});
+	it->second.orders_.erase(pegLocation);
+	if (it->second.orders_.empty())
+		pegs.erase(it);
+}
+
+template <Side S>
+void Orderbook::Relink(OrderHandle handle, Price from, Price to, Quantity visible) {
+	// Moves the order to the back of the new level under the same handle
+	auto level = Levels<S>().find(from);
+	level->second.Remove(store_.GetPosition(handle));
+	if (level->second.empty())
+		EraseLevel<S>(level);
+	GetOrAddLevel<S>(to).PushBack(store_, handle, visible);
+}
+
+template <Side S>
+void Orderbook::MovePeggedOrder(OrderPointer order, Price price) {
+	const auto handle = orders_.at(order->GetOrderId()).handle_;
+	const auto previous = order->GetPrice();
+	const auto visible = store_.GetVisible(handle);
+	Relink<S>(handle, previous, price, visible);
+
+	UpdateLevelData(previous, visible, LevelData::Action::Remove);
+	order->Reprice(price);
+	store_.Reprice(handle, price);
+	UpdateLevelData(price, visible, LevelData::Action::Add);
+}
+
+bool Orderbook::RepricePegs(Trades &trades) {
+	if ((buyPegs_.empty() && sellPegs_.empty()) || IsAccumulating())
+		return false;
+
+	const auto bid = BestLimitPrice<Side::Buy>();
+	const auto ask = BestLimitPrice<Side::Sell>();
+	if (bid == pegBid_ && ask == pegAsk_)
+		return false;
+
+	pegBid_ = bid;
+	pegAsk_ = ask;
+
+	RepricePegs<Side::Buy>(bid, ask, trades);
+	RepricePegs<Side::Sell>(bid, ask, trades);
+	return true;
+}
+
+template <Side S>
+void Orderbook::RepricePegs(std::optional<Price> bid, std::optional<Price> ask, Trades &trades) {
+	// One pass: each group's peg price is computed once and only orders whose
+	// limited price actually changes are relinked
+	for (auto &[key, group] : Pegs<S>()) {
+		const auto price = PegPrice<S>(key.first, key.second, bid, ask);
+		if (!price || *price == group.price_)
+			continue; // Without a reference price a peg keeps its last price
+
+		group.price_ = *price;
+		for (const auto &order : group.orders_) {
+			const auto limited = LimitPegPrice<S>(*order, *price);
+			if (limited != order->GetPrice())
+				MovePeggedOrder<S>(order, limited);
+		}
+	}
+
+	// Pegs never cross the non-pegged book, but opposite pegs can cross each other
+	auto matched = MatchOrders(S);
+	RecordTradePrices<S>(matched);
+	trades.insert(trades.end(), matched.begin(), matched.end());
 }
 
 void Orderbook::CancelOrder(OrderId orderId) {
-	std::scoped_lock ordersLock{ordersMutex_};
+	Count(StatsCounter::Cancels);
+
+	auto ordersLock = LockOrders(StatsOperation::CancelOrder);
+	ScopedStageTimer matchTimer{stats_.get(), StatsOperation::CancelOrder, StatsStage::Match};
 
 	CancelOrderInternal(orderId);
+
+	// Removing the best order can move pegs, which may in turn cross each other
+	Trades trades;
+	Settle(trades);
+	Count(StatsCounter::Trades, trades.size());
 }
 
-Trades Orderbook::ModifyOrder(OrderModify order) {
-	OrderType orderType;
+Trades Orderbook::ModifyOrder(OrderModify order, RiskCheck *riskCheck) {
+	Count(StatsCounter::Modifies);
+
+	// Cancel and re-add under one lock so no other operation can observe the order missing
+	auto ordersLock = LockOrders(StatsOperation::ModifyOrder);
+	ScopedStageTimer matchTimer{stats_.get(), StatsOperation::ModifyOrder, StatsStage::Match};
+
+	// A quote is owned by its quote set and changed only by the next MassQuote
+	auto it = orders_.find(order.GetOrderId());
+	if (it == orders_.end() || order.GetOrderId() >= QuoteOrderIdBase) {
+		Count(StatsCounter::Rejects);
+		return {};
+	}
+
+	const auto existing = it->second.order_;
+
+	// The replacement takes over the existing order's open-order slot
+	const auto check = CheckRisk(existing->GetClientId(), order.GetSide(), order.GetPrice(), order.GetQuantity(), false);
+	if (riskCheck)
+		*riskCheck = check;
+	if (check != RiskCheck::Passed)
+		return {};
+
+	CancelOrderInternal(order.GetOrderId(), ExecutionType::Replace);
+
+	auto replacement = order.ToOrderPointer(existing->GetOrderType(), existing->GetDisplayQuantity());
+	replacement->SetClientId(existing->GetClientId());
+	if (existing->IsStopPending())
+		replacement->SetStopPrice(existing->GetStopPrice());
+	if (existing->IsPegged())
+		replacement->SetPeg(existing->GetPegType(), existing->GetPegOffset());
+	ReportExecution(*replacement, ExecutionType::Replace, replacement->GetInitialQuantity(), replacement->GetRemainingQuantity());
+	return AddOrderInternal(replacement);
+}
+
+MassQuoteResult Orderbook::MassQuote(ClientId clientId, QuoteSetId quoteSetId, const QuoteEntries &entries) {
+	Count(StatsCounter::Quotes, entries.size());
+
+	auto ordersLock = LockOrders(StatsOperation::MassQuote);
+	ScopedStageTimer matchTimer{stats_.get(), StatsOperation::MassQuote, StatsStage::Match};
+
+	MassQuoteResult result;
+	if (!IsValidQuote(entries)) {
+		Count(StatsCounter::Rejects);
+		return result;
+	}
+
+	// All or nothing, like the crossing check. Quotes count as open orders but
+	// are not refused by that limit: a set mostly replaces itself.
+	for (const auto &entry : entries) {
+		if (entry.quantity_ == 0)
+			continue;
+		result.riskCheck_ = CheckRisk(clientId, entry.side_, entry.price_, entry.quantity_, false);
+		if (result.riskCheck_ != RiskCheck::Passed)
+			return result;
+	}
+
+	auto &slots = quoteSets_[(static_cast<std::uint64_t>(clientId) << 32) | quoteSetId];
+	if (slots.size() < entries.size())
+		slots.resize(entries.size());
+
+	result.orderIds_.reserve(entries.size());
+	for (std::size_t index = 0; index < entries.size(); ++index) {
+		auto trades = ApplyQuote(clientId, slots[index], entries[index]);
+		result.trades_.insert(result.trades_.end(), trades.begin(), trades.end());
+		result.orderIds_.push_back(slots[index] ? slots[index]->GetOrderId() : 0);
+	}
+
+	// Slots the new set no longer has are pulled
+	for (std::size_t index = entries.size(); index < slots.size(); ++index) {
+		if (slots[index])
+			CancelOrderInternal(slots[index]->GetOrderId());
+	}
+	slots.resize(entries.size());
 
+	Settle(result.trades_);
+	Count(StatsCounter::Trades, result.trades_.size());
+	result.accepted_ = true;
+	return result;
+}
+
+std::size_t Orderbook::MassCancel(ClientId clientId, std::optional<Side> side, Price minPrice, Price maxPrice) {
+	auto ordersLock = LockOrders(StatsOperation::MassCancel);
+	ScopedStageTimer matchTimer{stats_.get(), StatsOperation::MassCancel, StatsStage::Match};
+
+	auto client = clientOrders_.find(clientId);
+	if (clientId == 0 || client == clientOrders_.end())
+		return 0;
+
+	std::size_t cancelled = 0;
+	auto &orders = client->second;
+	for (auto it = orders.begin(); it != orders.end();) {
+		// Step past the node first: cancelling unlinks it from this list
+		const auto order = *it++;
+		if (side && order->GetSide() != *side)
+			continue;
+		if (order->GetPrice() < minPrice || order->GetPrice() > maxPrice)
+			continue;
+
+		CancelOrderInternal(order->GetOrderId());
+		++cancelled;
+	}
+
+	Trades trades;
+	Settle(trades);
+	Count(StatsCounter::Cancels, cancelled);
+	Count(StatsCounter::Trades, trades.size());
+	return cancelled;
+}
+
+bool Orderbook::IsValidQuote(const QuoteEntries &entries) const {
+	std::optional<Price> bestBid, bestAsk;
+
+	for (const auto &entry : entries) {
+		if (entry.quantity_ == 0)
+			continue;
+		if (entry.price_ <= 0 || entry.price_ > 1000000) // Reasonable price bounds
+			return false;
+
+		if (entry.side_ == Side::Buy)
+			bestBid = std::max(bestBid.value_or(entry.price_), entry.price_);
+		else
+			bestAsk = std::min(bestAsk.value_or(entry.price_), entry.price_);
+	}
+
+	// A set that crosses itself would trade with itself
+	return !bestBid || !bestAsk || *bestBid < *bestAsk;
+}
+
+Trades Orderbook::ApplyQuote(ClientId clientId, OrderPointer &slot, const QuoteEntry &entry) {
+	// Resting only if the book still holds this very order under its id
+	auto it = slot ? orders_.find(slot->GetOrderId()) : orders_.end();
+	const bool resting = it != orders_.end() && it->second.order_ == slot;
+
+	if (entry.quantity_ == 0 || (resting && slot->GetSide() != entry.side_)) {
+		if (resting)
+			CancelOrderInternal(slot->GetOrderId());
+		slot.reset();
+		if (entry.quantity_ == 0)
+			return {};
+	} else if (resting) {
+		if (slot->GetPrice() == entry.price_ && store_.GetRemaining(it->second.handle_) == entry.quantity_)
+			return {}; // Unchanged: keeps its place in the queue
+
+		return entry.side_ == Side::Buy ? Requote<Side::Buy>(slot, it->second, entry) : Requote<Side::Sell>(slot, it->second, entry);
+	}
+
+	// Empty slot, or its order was filled or cancelled since the last quote
+	slot = std::make_shared<Order>(OrderType::GoodTillCancel, nextQuoteOrderId_++, entry.side_, entry.price_, entry.quantity_);
+	slot->SetClientId(clientId);
+	auto [inserted, _] = orders_.insert({slot->GetOrderId(), OrderEntry{slot, OrderPointers::iterator()}});
+	if (clientId != 0)
+		AddClientOrder(slot, inserted->second);
+	return ActivateOrder(slot, inserted->second);
+}
+
+template <Side S>
+Trades Orderbook::Requote(const OrderPointer &order, OrderEntry &entry, const QuoteEntry &quote) {
+	// Rewrite the resting order and move it to the back of its new level
+	const auto previous = order->GetPrice();
+	UpdateLevelData(previous, store_.GetVisible(entry.handle_), LevelData::Action::Remove);
+	order->Requote(quote.price_, quote.quantity_);
+	store_.Requote(entry.handle_, quote.price_, quote.quantity_);
+	Relink<S>(entry.handle_, previous, quote.price_, quote.quantity_);
+	UpdateLevelData(quote.price_, quote.quantity_, LevelData::Action::Add);
+	ReportExecution(*order, ExecutionType::Replace, quote.quantity_, quote.quantity_);
+
+	auto trades = MatchOrders(S);
+	RecordTradePrices<S>(trades);
+	return trades;
+}
+
+void Orderbook::StartAuction() {
 	{
 		std::scoped_lock ordersLock{ordersMutex_};
+		tradingPhase_ = TradingPhase::Auction;
+	}
+	StopBatches();
+}
 
-		if (orders_.find(order.GetOrderId()) == orders_.end())
-			return {};
+void Orderbook::StartFrequentBatchAuctions(std::chrono::microseconds interval) {
+	std::scoped_lock batchThreadLock{batchThreadMutex_};
+	if (GetTradingPhase() == TradingPhase::FrequentBatch)
+		return;
 
-		const auto &[existingOrder, _] = orders_.at(order.GetOrderId());
-		orderType = existingOrder->GetOrderType();
+	// A thread left from an earlier batch period exits once it sees the phase
+	// changed; it must be gone before the phase goes back to FrequentBatch.
+	if (batchThread_.joinable())
+		batchThread_.join();
+
+	// Before the phase changes, so that a StartAuction() or Uncross() racing
+	// with this one stops the new thread
+	{
+		std::scoped_lock batchWaitLock{batchWaitMutex_};
+		stopBatches_ = false;
 	}
+	{
+		std::scoped_lock ordersLock{ordersMutex_};
+		tradingPhase_ = TradingPhase::FrequentBatch;
+	}
+	batchThread_ = std::thread{[this, interval, cpus = batchCpus_] { RunBatches(interval, cpus); }};
+}
+
+void Orderbook::SetBatchCpus(std::vector<int> cpus) {
+	std::scoped_lock batchThreadLock{batchThreadMutex_};
+	batchCpus_ = std::move(cpus);
+}
+
+AuctionResult Orderbook::Uncross(std::optional<Price> referencePrice) {
+	AuctionResult result;
+	{
+		auto ordersLock = LockOrders(StatsOperation::Uncross);
+		ScopedStageTimer matchTimer{stats_.get(), StatsOperation::Uncross, StatsStage::Match};
+
+		if (!IsAccumulating())
+			return result;
+
+		result = ClearCrossedBook(referencePrice);
+		auto &trades = result.trades_;
+
+		// Refilled iceberg tranches can still cross; continuous matching takes those
+		tradingPhase_ = TradingPhase::Continuous;
+		auto residual = MatchOrders(std::nullopt);
+		RecordTradePrices<Side::Buy>(residual);
+		trades.insert(trades.end(), residual.begin(), residual.end());
+
+		Settle(trades);
+		Count(StatsCounter::Trades, trades.size());
+	}
+
+	StopBatches();
+	JoinBatchThread();
+	return result;
+}
+
+AuctionResult Orderbook::ClearCrossedBook(std::optional<Price> referencePrice) {
+	AuctionResult result;
+	CollectAuctionLevels(auctionLevels_);
+	result.equilibrium_ = FindEquilibrium(auctionLevels_, referencePrice ? referencePrice : lastTradePrice_);
+	if (result.equilibrium_)
+		result.trades_ = ExecuteAuction(*result.equilibrium_);
+	RecordTradePrices<Side::Buy>(result.trades_); // Both sides print at the uncrossing price
+	return result;
+}
+
+void Orderbook::RunBatches(std::chrono::microseconds interval, const std::vector<int> &cpus) {
+	using namespace std::chrono;
+	// Set either way: a thread inherits the mask of the one that started it,
+	// here a gateway thread. Failing leaves it where it was.
+	if (cpus.empty())
+		UnpinCurrentThread();
+	else
+		PinCurrentThread(cpus);
+
+	auto deadline = steady_clock::now() + interval;
+	std::unique_lock batchWaitLock{batchWaitMutex_};
+	while (!batchConditionVariable_.wait_until(batchWaitLock, deadline, [this] { return stopBatches_; })) {
+		batchWaitLock.unlock();
+		// Skip batches missed while clearing took longer than the interval
+		deadline = std::max(deadline + interval, steady_clock::now());
+
+		AuctionResult result;
+		{
+			std::scoped_lock ordersLock{ordersMutex_};
+			// Batches can have ended between the timeout and taking the lock
+			if (tradingPhase_ != TradingPhase::FrequentBatch || shutdown_.load(std::memory_order_acquire))
+				return;
+
+			ScopedStageTimer matchTimer{stats_.get(), StatsOperation::Uncross, StatsStage::Match};
+			result = ClearCrossedBook(std::nullopt);
+			Settle(result.trades_);
+			Count(StatsCounter::Trades, result.trades_.size());
+		}
+
+		if (batchListener_ && !result.trades_.empty())
+			batchListener_(result);
+		batchWaitLock.lock();
+	}
+}
+
+void Orderbook::StopBatches() {
+	{
+		std::scoped_lock batchWaitLock{batchWaitMutex_};
+		stopBatches_ = true;
+	}
+	batchConditionVariable_.notify_one();
+}
+
+void Orderbook::JoinBatchThread() {
+	std::scoped_lock batchThreadLock{batchThreadMutex_};
+	if (batchThread_.joinable())
+		batchThread_.join();
+}
+
+std::optional<AuctionEquilibrium> Orderbook::GetIndicativeUncross(std::optional<Price> referencePrice) const {
+	std::scoped_lock ordersLock{ordersMutex_};
+
+	AuctionLevels levels;
+	CollectAuctionLevels(levels);
+	return FindEquilibrium(levels, referencePrice ? referencePrice : lastTradePrice_);
+}
+
+void Orderbook::SetMatchingPolicy(const MatchingPolicy &policy) {
+	std::scoped_lock ordersLock{ordersMutex_};
+	matchingPolicy_ = policy;
+}
+
+MatchingPolicy Orderbook::GetMatchingPolicy() const {
+	std::scoped_lock ordersLock{ordersMutex_};
+	return matchingPolicy_;
+}
+
+BookStatus Orderbook::GetStatusLocked() const {
+	BookStatus status{tradingPhase_, std::nullopt};
+	if (IsAccumulating()) {
+		AuctionLevels levels;
+		CollectAuctionLevels(levels);
+		status.indicativeUncross_ = FindEquilibrium(levels, lastTradePrice_);
+	}
+	return status;
+}
+
+TradingPhase Orderbook::GetTradingPhase() const {
+	std::scoped_lock ordersLock{ordersMutex_};
+	return tradingPhase_;
+}
+
+void Orderbook::CollectAuctionLevels(AuctionLevels &levels) const {
+	levels.Clear();
+	if (bids_.empty() || asks_.empty() || bids_.begin()->first < asks_.begin()->first)
+		return;
+
+	auto visible = [](const LevelQueue &level) { return static_cast<std::int64_t>(level.Visible()); };
+
+	// Only the crossed range can trade: bids at or above the best ask and asks
+	// at or below the best bid. Merge both into one ascending price array.
+	auto bid = std::make_reverse_iterator(bids_.upper_bound(asks_.begin()->first));
+	const auto bidEnd = bids_.rend();
+	auto ask = asks_.begin();
+	const auto askEnd = asks_.upper_bound(bids_.begin()->first);
+
+	while (bid != bidEnd || ask != askEnd) {
+		if (ask == askEnd || (bid != bidEnd && bid->first < ask->first)) {
+			levels.Add(bid->first, visible(bid->second), 0);
+			++bid;
+		} else if (bid == bidEnd || ask->first < bid->first) {
+			levels.Add(ask->first, 0, visible(ask->second));
+			++ask;
+		} else {
+			levels.Add(bid->first, visible(bid->second), visible(ask->second));
+			++bid;
+			++ask;
+		}
+	}
+}
+
+Trades Orderbook::ExecuteAuction(const AuctionEquilibrium &equilibrium) {
+	Trades trades;
+	aggressor_.reset(); // Nobody takes liquidity in an uncross
+	const auto price = equilibrium.price_;
+	const auto matchTime = TscClock::Now();
+
+	// Price-time priority from the top of each side; every order reached is
+	// priced through the equilibrium, so all fills print at it.
+	for (auto remaining = equilibrium.volume_; remaining != 0;) {
+		auto bidLevel = bids_.begin();
+		auto askLevel = asks_.begin();
+		auto &bids = bidLevel->second;
+		auto &asks = askLevel->second;
+
+		const auto quantity = std::min({bids.FrontQuantity(), asks.FrontQuantity(), remaining});
+		trades.push_back(FillFront(bids, asks, quantity, price, price, matchTime));
+		remaining -= quantity;
+
+		// Level data is shared by both sides at a price and removes itself
+		// once its count drops to zero, so only the book levels go here
+		if (bids.empty())
+			EraseLevel<Side::Buy>(bidLevel);
+		if (asks.empty())
+			EraseLevel<Side::Sell>(askLevel);
+	}
+
+	return trades;
+}
 
-	CancelOrder(order.GetOrderId());
-	return AddOrder(order.ToOrderPointer(orderType));
+bool Orderbook::SetRiskLimits(ClientId clientId, const RiskLimits &limits) {
+	std::scoped_lock ordersLock{ordersMutex_};
+
+	auto client = clientOrders_.find(clientId);
+	const auto openOrders = client == clientOrders_.end() ? 0 : client->second.size();
+	return risk_.SetLimits(clientId, limits, static_cast<std::uint32_t>(openOrders));
 }
 
 bool Orderbook::OrderExists(OrderId orderId) const {
@@ -342,21 +1173,52 @@ std::size_t Orderbook::Size() const {
 	return orders_.size();
 }
 
+std::optional<Price> Orderbook::GetLastTradePrice() const {
+	std::scoped_lock ordersLock{ordersMutex_};
+	return lastTradePrice_;
+}
+
+void Orderbook::SeedLastTradePrice(Price price) {
+	std::scoped_lock ordersLock{ordersMutex_};
+	if (!lastTradePrice_)
+		lastTradePrice_ = price;
+}
+
+bool Orderbook::IsIdle() const {
+	std::scoped_lock ordersLock{ordersMutex_};
+	return orders_.empty() && tradingPhase_ == TradingPhase::Continuous && !risk_.HasClients();
+}
+
+BookDepth Orderbook::GetDepth() const {
+	std::scoped_lock ordersLock{ordersMutex_};
+	return BookDepth{orders_.size(), bids_.size(), asks_.size()};
+}
+
 OrderbookLevelInfos Orderbook::GetOrderInfos() const {
 	LevelInfos bidInfos, askInfos;
-	bidInfos.reserve(orders_.size());
-	askInfos.reserve(orders_.size());
+	VisitLevels([&](std::size_t bidLevels, std::size_t askLevels) {
+		bidInfos.reserve(bidLevels);
+		askInfos.reserve(askLevels);
+	}, [&](Side side, const LevelInfo &level) {
+		(side == Side::Buy ? bidInfos : askInfos).push_back(level);
+	});
+	return OrderbookLevelInfos{std::move(bidInfos), std::move(askInfos)};
+}
 
-	auto CreateLevelInfos = [](Price price, const OrderPointers &orders) {
-		return LevelInfo{price, std::accumulate(orders.begin(), orders.end(), (Quantity)0,
-												[](Quantity runningSum, const OrderPointer &order) { return runningSum + order->GetRemainingQuantity(); })};
-	};
+std::unique_lock<std::mutex> Orderbook::LockOrders(StatsOperation operation) const {
+	if (!stats_)
+		return std::unique_lock{ordersMutex_};
 
-	for (const auto &[price, orders] : bids_)
-		bidInfos.push_back(CreateLevelInfos(price, orders));
+	const auto start = TscClock::Now();
+	std::unique_lock ordersLock{ordersMutex_};
+	const auto waited = static_cast<std::uint64_t>(TscClock::ToNanoseconds(TscClock::Now() - start));
 
-	for (const auto &[price, orders] : asks_)
-		askInfos.push_back(CreateLevelInfos(price, orders));
+	stats_->Record(operation, StatsStage::LockWait, waited);
+	stats_->Increment(StatsCounter::LockWaitNanoseconds, waited);
+	return ordersLock;
+}
 
-	return OrderbookLevelInfos{bidInfos, askInfos};
-}
\ No newline at end of file
+void Orderbook::Count(StatsCounter counter, std::uint64_t amount) const {
+	if (stats_)
+		stats_->Increment(counter, amount);
+}
@@ -1,25 +1,71 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <functional>
+#include <limits>
 #include <map>
+#include <memory_resource>
 #include <mutex>
+#include <optional>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "Auction.hpp"
+#include "ExecutionReports.hpp"
+#include "MassQuote.hpp"
+#include "MatchingPolicy.hpp"
+#include "MatchingScheduler.hpp"
 #include "Order.hpp"
 #include "OrderModify.hpp"
+#include "OrderStore.hpp"
 #include "OrderbookLevelInfos.hpp"
+#include "Platform.hpp"
+#include "PreTradeRisk.hpp"
+#include "SideTraits.hpp"
+#include "Stats.hpp"
 #include "Trade.hpp"
+#include "TradingPhase.hpp"
 #include "Usings.hpp"
 
+// What a book sets aside when it is created: address space for its order
+// arena, committed page by page as orders arrive unless prefaulted. The order
+// tables themselves grow with the book, so a book touched once stays small.
+struct BookCapacity {
+	std::size_t orders_{}; // Orders the arena has room for; 0 for none, on the heap
+	bool hugePages_{false}; // Map the order arena on huge pages
+	bool prefault_{false}; // Fault the order arena in up front
+};
+
+// A book's trading phase and, outside continuous trading, where it would
+// uncross, as of one instant.
+struct BookStatus {
+	TradingPhase phase_{TradingPhase::Continuous};
+	std::optional<AuctionEquilibrium> indicativeUncross_;
+};
+
 class Orderbook {
   private:
 	struct OrderEntry {
 		OrderPointer order_{nullptr};
-		OrderPointers::iterator location_;
+		OrderPointers::iterator location_; // Parked stops only
+		OrderHandle handle_{InvalidOrderHandle}; // Resting in the book only
+		OrderPointers::iterator pegLocation_{};
+		OrderPointers::iterator clientLocation_{};
+		bool pegged_{false}; // In a peg group, so a fill need not read the order to know
+	};
+
+	// Pegged orders sharing a peg type and offset, in time order. price_ is the
+	// unlimited peg price the group was last moved to.
+	struct PegGroup {
+		Price price_{};
+		OrderPointers orders_;
 	};
+	using PegKey = std::pair<PegType, Price>;
 
 	struct LevelData {
 		Quantity quantity_{};
@@ -29,46 +75,316 @@ class Orderbook {
 			Add,
 			Remove,
 			Match,
+			Replenish,
 		};
 	};
 
-	std::unordered_map<Price, LevelData> data_;
-	std::map<Price, OrderPointers, std::greater<Price>> bids_;
-	std::map<Price, OrderPointers, std::less<Price>> asks_;
-	std::unordered_map<OrderId, OrderEntry> orders_;
+	// Per-order bookkeeping nodes come from the book's own pool rather than the
+	// global heap; they go back in one piece when the book is destroyed. The
+	// pool draws on a region reserved from the book's capacity, then the heap.
+	ArenaResource arenaMemory_;
+	std::pmr::unsynchronized_pool_resource arena_{&arenaMemory_};
+	std::pmr::unordered_map<Price, LevelData> data_{&arena_};
+	OrderStore store_;
+	BookLevels<Side::Buy> bids_;
+	BookLevels<Side::Sell> asks_;
+	// Emptied levels, kept with their map node and array capacity for the next new price
+	static constexpr std::size_t MaxSpareLevels = 64;
+	std::vector<BookLevels<Side::Buy>::node_type> spareBidLevels_;
+	std::vector<BookLevels<Side::Sell>::node_type> spareAskLevels_;
+	using OrderEntries = std::pmr::unordered_map<OrderId, OrderEntry>;
+	OrderEntries orders_{&arena_};
+	// Parked stop orders keyed by stop price, each ordered so begin() is the next to trigger
+	StopLevels<Side::Buy> buyStops_;
+	StopLevels<Side::Sell> sellStops_;
+	std::optional<Price> lastTradePrice_;
+	std::optional<std::pair<Price, Price>> tradedRange_; // Low/high trade price since stops were last checked
+	std::map<PegKey, PegGroup> buyPegs_;
+	std::map<PegKey, PegGroup> sellPegs_;
+	std::optional<Price> pegBid_; // Best non-pegged prices the pegs were last priced from
+	std::optional<Price> pegAsk_;
+	// Resting orders of each (client, quote set), by entry position
+	std::unordered_map<std::uint64_t, std::vector<OrderPointer>> quoteSets_;
+	OrderId nextQuoteOrderId_{QuoteOrderIdBase};
+	// Live orders of each client, so a mass cancel only walks that client's orders.
+	// Lists are kept once created; there are few clients and many orders.
+	std::unordered_map<ClientId, OrderPointers> clientOrders_;
+	PreTradeRisk risk_;
+	TradingPhase tradingPhase_{TradingPhase::Continuous};
+	AuctionLevels auctionLevels_; // Reused by every uncross
+	MatchingPolicy matchingPolicy_;
+	// Pro-rata scratch, reused by every allocation
+	std::vector<OrderHandle> proRataHandles_;
+	std::vector<Quantity> proRataAllocations_;
+	std::function<void(const AuctionResult &)> batchListener_;
 	mutable std::mutex ordersMutex_;
-	std::thread ordersPruneThread_;
-	std::condition_variable shutdownConditionVariable_;
+	// The batch thread sleeps out each interval on its own mutex and takes
+	// the orders lock only to clear the batch
+	std::mutex batchWaitMutex_;
+	std::condition_variable batchConditionVariable_;
+	bool stopBatches_{false}; // Guarded by batchWaitMutex_
+	std::mutex batchThreadMutex_; // Serializes starting and joining batchThread_
+	std::vector<int> batchCpus_; // Guarded by batchThreadMutex_
+	std::thread batchThread_;
 	std::atomic<bool> shutdown_{false};
-	std::unordered_set<OrderId> goodForDayOrders_;
+	std::pmr::unordered_set<OrderId> goodForDayOrders_{&arena_};
+	std::shared_ptr<Stats> stats_;
+	std::shared_ptr<ExecutionReportRing> reports_;
+	InstrumentId instrumentId_{0}; // Stamped on execution reports
+	// Trade ids come from a process-wide counter a block at a time, so they
+	// stay unique across books, including one recreated after the close
+	TradeId nextTradeId_{0};
+	TradeId tradeIdBlockEnd_{0};
+	std::optional<Side> aggressor_; // Side of the order being matched; none while uncrossing
+	MatchingQueue matchingQueue_; // Commands for this book when it runs on a MatchingScheduler
+	friend class MatchingScheduler;
+
+	// Per-side members for code templated on the side
+	template <Side S>
+	auto &Levels() {
+		if constexpr (S == Side::Buy)
+			return bids_;
+		else
+			return asks_;
+	}
+	template <Side S>
+	const auto &Levels() const {
+		if constexpr (S == Side::Buy)
+			return bids_;
+		else
+			return asks_;
+	}
+	template <Side S>
+	auto &SpareLevels() {
+		if constexpr (S == Side::Buy)
+			return spareBidLevels_;
+		else
+			return spareAskLevels_;
+	}
+	template <Side S>
+	auto &Stops() {
+		if constexpr (S == Side::Buy)
+			return buyStops_;
+		else
+			return sellStops_;
+	}
+	template <Side S>
+	auto &Pegs() {
+		if constexpr (S == Side::Buy)
+			return buyPegs_;
+		else
+			return sellPegs_;
+	}
+
+	void CancelOrderInternal(OrderId orderId, ExecutionType reason = ExecutionType::Cancel);
+	// Publishes an order leaving the book, or its replacement, if reports are attached
+	void ReportExecution(const Order &order, ExecutionType type, Quantity quantity, Quantity leavesQuantity);
+	template <Side S>
+	LevelQueue &GetOrAddLevel(Price price);
+	template <Side S>
+	void EraseLevel(typename BookLevels<S>::iterator level);
+	template <Side S>
+	void RemoveOrder(const OrderPointer &order, const OrderEntry &entry);
+	void EraseOrder(OrderEntries::iterator it, ClientId clientId);
+	void AddClientOrder(const OrderPointer &order, OrderEntry &entry);
+
+	std::unique_lock<std::mutex> LockOrders(StatsOperation operation) const;
+	void Count(StatsCounter counter, std::uint64_t amount = 1) const;
+
+	Trades AddOrderInternal(OrderPointer order);
+	RiskCheck CheckRisk(ClientId clientId, Side side, Price price, Quantity quantity, bool opensOrder) const;
+	Trades ActivateOrder(OrderPointer order, OrderEntry &entry);
+	template <Side S>
+	Trades ActivateOrder(OrderPointer order, OrderEntry &entry);
 
-	void PruneGoodForDayOrders();
+	template <Side S>
+	void ParkStopOrder(OrderPointer order, OrderEntry &entry);
+	bool IsStopTriggered(const Order &order) const;
+	template <Side AggressorSide>
+	void RecordTradePrices(const Trades &trades);
+	template <Side S>
+	void CollectTriggeredStops(Price tradedThrough, OrderPointers &triggered);
+	OrderPointers CollectTriggeredStops();
+	void Settle(Trades &trades);
 
-	void CancelOrders(OrderIds orderIds);
-	void CancelOrderInternal(OrderId orderId);
+	template <Side S>
+	std::optional<Price> BestLimitPrice() const;
+	template <Side S>
+	static std::optional<Price> PegPrice(PegType pegType, Price offset, std::optional<Price> bid, std::optional<Price> ask);
+	template <Side S>
+	static Price LimitPegPrice(const Order &order, Price price);
+	template <Side S>
+	void AddPeg(OrderPointer order, OrderEntry &entry);
+	template <Side S>
+	void RemovePeg(const Order &order, OrderPointers::iterator pegLocation);
+	template <Side S>
+	void MovePeggedOrder(OrderPointer order, Price price);
+	template <Side S>
+	void RepricePegs(std::optional<Price> bid, std::optional<Price> ask, Trades &trades);
+	bool RepricePegs(Trades &trades);
 
-	void OnOrderCancelled(OrderPointer order);
-	void OnOrderAdded(OrderPointer order);
+	template <Side S>
+	void Relink(OrderHandle handle, Price from, Price to, Quantity visible);
+	bool IsValidQuote(const QuoteEntries &entries) const;
+	Trades ApplyQuote(ClientId clientId, OrderPointer &slot, const QuoteEntry &entry);
+	template <Side S>
+	Trades Requote(const OrderPointer &order, OrderEntry &entry, const QuoteEntry &quote);
+
+	void OnOrderCancelled(Price price, Quantity visible);
+	void OnOrderAdded(Price price, Quantity visible);
+	void OnOrderReplenished(Price price, Quantity visible);
 	void OnOrderMatched(Price price, Quantity quantity, bool isFullyFilled);
 	void UpdateLevelData(Price price, Quantity quantity, LevelData::Action action);
 
-	bool CanFullyFill(Side side, Price price, Quantity quantity) const;
-	bool CanMatch(Side side, Price price) const;
-	Trades MatchOrders();
+	template <Side S>
+	bool CanFullyFill(Price price, Quantity quantity) const;
+	template <Side S>
+	bool CanMatch(Price price) const;
+	Trade Fill(LevelQueue &bids, OrderHandle bid, LevelQueue &asks, OrderHandle ask, Quantity quantity, Price bidPrice, Price askPrice, Timestamp matchTime);
+	TradeId NextTradeId();
+	void ReportFill(OrderHandle bid, OrderHandle ask, Quantity quantity, Price price, Timestamp matchTime, TradeId tradeId);
+	Trade FillFront(LevelQueue &bids, LevelQueue &asks, Quantity quantity, Price bidPrice, Price askPrice, Timestamp matchTime) {
+		return Fill(bids, bids.FrontHandle(), asks, asks.FrontHandle(), quantity, bidPrice, askPrice, matchTime);
+	}
+	template <Side S>
+	void SettleFill(LevelQueue &level, OrderHandle handle, Quantity quantity);
+	template <Side RestingSide>
+	void MatchProRata(LevelQueue &bids, LevelQueue &asks, Price bidPrice, Price askPrice, Timestamp matchTime, Trades &trades);
+	template <Side S>
+	void CancelFillAndKillFront();
+	Trades MatchOrders(std::optional<Side> aggressor);
+
+	bool IsAccumulating() const { return tradingPhase_ != TradingPhase::Continuous; }
+	template <typename Reserve, typename Visit>
+	void VisitLevelsLocked(Reserve &reserve, Visit &visit) const;
+	BookStatus GetStatusLocked() const;
+	void CollectAuctionLevels(AuctionLevels &levels) const;
+	Trades ExecuteAuction(const AuctionEquilibrium &equilibrium);
+	AuctionResult ClearCrossedBook(std::optional<Price> referencePrice);
+	void RunBatches(std::chrono::microseconds interval, const std::vector<int> &cpus);
+	void StopBatches();
+	void JoinBatchThread();
 
   public:
+	// Quote orders get engine-assigned ids from here up; client order ids must stay below it
+	static constexpr OrderId QuoteOrderIdBase = OrderId{1} << 63;
+
+	// An order node, its bucket and room for the pool's chunk growth
+	static constexpr std::size_t ArenaBytesPerOrder = 2 * (sizeof(OrderEntries::value_type) + 2 * sizeof(void *));
+
 	Orderbook();
+	explicit Orderbook(const BookCapacity &capacity);
 	Orderbook(const Orderbook &) = delete;
 	void operator=(const Orderbook &) = delete;
 	Orderbook(Orderbook &&) = delete;
 	void operator=(Orderbook &&) = delete;
 	~Orderbook();
 
-	Trades AddOrder(OrderPointer order);
+	// Orders of a client with risk limits are checked against them first; a
+	// failed check rejects the order and is reported through riskCheck.
+	Trades AddOrder(OrderPointer order, RiskCheck *riskCheck = nullptr);
 	void CancelOrder(OrderId orderId);
-	Trades ModifyOrder(OrderModify order);
+	// End of the trading day: cancels every good-for-day order. Returns how
+	// many were cancelled. Books do not keep a clock; InstrumentRegistry
+	// calls this for all of its books at the close, and the owner of a book
+	// outside a registry must call it itself or its good-for-day orders rest
+	// until cancelled.
+	std::size_t CancelGoodForDayOrders();
+	Trades ModifyOrder(OrderModify order, RiskCheck *riskCheck = nullptr);
+	// Replaces the client's quote set in one critical section. Slots whose side,
+	// price and size are unchanged keep their priority; other live slots are
+	// rewritten in place rather than cancelled and re-added.
+	MassQuoteResult MassQuote(ClientId clientId, QuoteSetId quoteSetId, const QuoteEntries &entries);
+	// Cancels the client's orders, parked stops included, optionally only on
+	// one side and with a price in [minPrice, maxPrice]. Returns how many were
+	// cancelled. Costs O(orders of that client), not O(book).
+	std::size_t MassCancel(ClientId clientId, std::optional<Side> side = std::nullopt,
+						   Price minPrice = std::numeric_limits<Price>::min(), Price maxPrice = std::numeric_limits<Price>::max());
+	// Starts an auction (opening, closing or a volatility halt). Until Uncross(),
+	// orders rest without matching; market, fill-and-kill, fill-or-kill and new
+	// pegged orders are rejected, and resting pegs stop repricing.
+	void StartAuction();
+	// Frequent batch auctions: orders accumulate as in an auction and a
+	// background thread clears the book at one uniform price every interval.
+	// StartAuction() or Uncross() ends the mode.
+	void StartFrequentBatchAuctions(std::chrono::microseconds interval);
+	// Cpus the batch thread is pinned to. Empty, the default, lets it run on
+	// any cpu, rather than on whichever the thread starting batches was
+	// pinned to. Applies from the next start.
+	void SetBatchCpus(std::vector<int> cpus);
+	// Receives each batch that traded, on the batch thread and without the
+	// orders lock held. Not thread-safe; set before starting batches.
+	void SetBatchListener(std::function<void(const AuctionResult &)> listener) { batchListener_ = std::move(listener); }
+	// Executes every crossing order at a single equilibrium price in one pass
+	// and resumes continuous trading. referencePrice breaks the final tie; the
+	// last trade price is used without one.
+	AuctionResult Uncross(std::optional<Price> referencePrice = std::nullopt);
+	// Where the book would uncross now, if anywhere.
+	std::optional<AuctionEquilibrium> GetIndicativeUncross(std::optional<Price> referencePrice = std::nullopt) const;
+	TradingPhase GetTradingPhase() const;
+	// The price of the latest trade, which references auctions and triggers
+	// stops; empty until the first trade unless seeded.
+	std::optional<Price> GetLastTradePrice() const;
+	// Seeds the last trade price of a book that has not traded yet, e.g. with
+	// the previous session's close. Ignored once the book has a price.
+	void SeedLastTradePrice(Price price);
+
+	// How a level shares an incoming order; FIFO unless set. Auctions and
+	// batches always allocate in time priority at the uncrossing price.
+	void SetMatchingPolicy(const MatchingPolicy &policy);
+	MatchingPolicy GetMatchingPolicy() const;
+
+	// Client 0 and ids at or above PreTradeRisk::MaxClients cannot have limits.
+	bool SetRiskLimits(ClientId clientId, const RiskLimits &limits);
 	bool OrderExists(OrderId orderId) const;
 
 	std::size_t Size() const;
+	// No orders, no risk limits and trading continuously: nothing would be
+	// lost if the book were dropped and created again.
+	bool IsIdle() const;
+	BookDepth GetDepth() const;
 	OrderbookLevelInfos GetOrderInfos() const;
+	// Hands every level to the caller under the book lock, without copying
+	// them out first: reserve(bidLevels, askLevels) once, then
+	// visit(side, LevelInfo) for each level, best first, bids then asks.
+	template <typename Reserve, typename Visit>
+	void VisitLevels(Reserve &&reserve, Visit &&visit) const;
+	// VisitLevels, returning the phase and indicative uncross from the same
+	// book state, under the one lock.
+	template <typename Reserve, typename Visit>
+	BookStatus VisitSnapshot(Reserve &&reserve, Visit &&visit) const;
+
+	// Not thread-safe with respect to in-flight operations; attach before use.
+	void AttachStats(std::shared_ptr<Stats> stats) { stats_ = std::move(stats); }
+	// Every fill, cancel, expiry and replacement is published to reports,
+	// stamped with instrumentId. Not thread-safe with respect to in-flight
+	// operations; attach before use.
+	void AttachExecutionReports(std::shared_ptr<ExecutionReportRing> reports, InstrumentId instrumentId) {
+		reports_ = std::move(reports);
+		instrumentId_ = instrumentId;
+	}
 };
+
+template <typename Reserve, typename Visit>
+void Orderbook::VisitLevels(Reserve &&reserve, Visit &&visit) const {
+	auto ordersLock = LockOrders(StatsOperation::GetOrderbook);
+	ScopedStageTimer matchTimer{stats_.get(), StatsOperation::GetOrderbook, StatsStage::Match};
+	VisitLevelsLocked(reserve, visit);
+}
+
+template <typename Reserve, typename Visit>
+BookStatus Orderbook::VisitSnapshot(Reserve &&reserve, Visit &&visit) const {
+	auto ordersLock = LockOrders(StatsOperation::GetOrderbook);
+	ScopedStageTimer matchTimer{stats_.get(), StatsOperation::GetOrderbook, StatsStage::Match};
+	VisitLevelsLocked(reserve, visit);
+	return GetStatusLocked();
+}
+
+template <typename Reserve, typename Visit>
+void Orderbook::VisitLevelsLocked(Reserve &reserve, Visit &visit) const {
+	reserve(bids_.size(), asks_.size());
+	for (const auto &[price, level] : bids_)
+		visit(Side::Buy, LevelInfo{price, static_cast<Quantity>(level.Visible())});
+	for (const auto &[price, level] : asks_)
+		visit(Side::Sell, LevelInfo{price, static_cast<Quantity>(level.Visible())});
+}
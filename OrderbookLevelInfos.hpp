@@ -2,12 +2,14 @@
 
 #include "LevelInfo.hpp"
 
+#include <utility>
+
 class OrderbookLevelInfos
 {
 public:
-    OrderbookLevelInfos(const LevelInfos& bids, const LevelInfos& asks)
-        : bids_{ bids }
-        , asks_{ asks }
+    OrderbookLevelInfos(LevelInfos bids, LevelInfos asks)
+        : bids_{ std::move(bids) }
+        , asks_{ std::move(asks) }
     { }
 
     const LevelInfos& GetBids() const { return bids_; }
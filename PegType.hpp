@@ -0,0 +1,10 @@
+#pragma once
+
+// Reference a pegged order's price follows; the peg offset is added to it.
+enum class PegType
+{
+	None,
+	Primary,  // Same-side best price
+	Midpoint, // Midpoint of the best bid and offer
+	Market,   // Opposite-side best price
+};
@@ -0,0 +1,151 @@
+#include "PerfCounters.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char *ToString(PerfEvent event) {
+	switch (event) {
+	case PerfEvent::Cycles:
+		return "cycles";
+	case PerfEvent::Instructions:
+		return "instructions";
+	case PerfEvent::L1DMisses:
+		return "l1d_misses";
+	case PerfEvent::LlcMisses:
+		return "llc_misses";
+	case PerfEvent::BranchMisses:
+		return "branch_misses";
+	default:
+		return "unknown";
+	}
+}
+
+bool ScaleDifference(const PerfCounterReading &start, const PerfCounterReading &end, PerfCounterValues &delta) {
+	const auto running = end.timeRunning_ - start.timeRunning_;
+	if (running == 0)
+		return false;
+
+	const auto enabled = end.timeEnabled_ - start.timeEnabled_;
+	for (std::size_t index = 0; index < delta.size(); ++index) {
+		const auto counted = end.values_[index] - start.values_[index];
+		delta[index] = enabled == running ? counted : static_cast<std::uint64_t>(static_cast<long double>(counted) * enabled / running);
+	}
+	return true;
+}
+
+#if defined(__linux__)
+
+namespace {
+
+perf_event_attr MakeAttributes(PerfEvent event) {
+	perf_event_attr attributes;
+	std::memset(&attributes, 0, sizeof(attributes));
+	attributes.size = sizeof(attributes);
+	attributes.exclude_kernel = 1;
+	attributes.exclude_hv = 1;
+	attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	switch (event) {
+	case PerfEvent::Cycles:
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case PerfEvent::Instructions:
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case PerfEvent::L1DMisses:
+		attributes.type = PERF_TYPE_HW_CACHE;
+		attributes.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	case PerfEvent::LlcMisses:
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+		break;
+	case PerfEvent::BranchMisses:
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+		break;
+	default:
+		break;
+	}
+
+	return attributes;
+}
+
+} // namespace
+
+PerfCounterGroup::PerfCounterGroup() {
+	descriptors_.fill(-1);
+
+	for (std::size_t index = 0; index < EventCount; ++index) {
+		const auto event = static_cast<PerfEvent>(index);
+		auto attributes = MakeAttributes(event);
+		// Only the leader starts disabled so the whole group is enabled at once below
+		attributes.disabled = index == 0;
+
+		const auto descriptor = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, index == 0 ? -1 : descriptors_[0], 0));
+		if (descriptor < 0) {
+			error_ = std::string("perf_event_open(") + ToString(event) + "): " + std::strerror(errno);
+			Close();
+			return;
+		}
+		descriptors_[index] = descriptor;
+	}
+
+	leader_ = descriptors_[0];
+	ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounterGroup::~PerfCounterGroup() {
+	Close();
+}
+
+bool PerfCounterGroup::Read(PerfCounterReading &reading) const {
+	if (!IsOpen())
+		return false;
+
+	// Group read layout: event count, time enabled, time running, then one
+	// value per event in open order
+	std::array<std::uint64_t, EventCount + 3> buffer;
+	if (read(leader_, buffer.data(), sizeof(buffer)) != static_cast<ssize_t>(sizeof(buffer)))
+		return false;
+
+	reading.timeEnabled_ = buffer[1];
+	reading.timeRunning_ = buffer[2];
+	for (std::size_t index = 0; index < EventCount; ++index)
+		reading.values_[index] = buffer[index + 3];
+	return true;
+}
+
+void PerfCounterGroup::Close() {
+	for (auto &descriptor : descriptors_) {
+		if (descriptor >= 0)
+			close(descriptor);
+		descriptor = -1;
+	}
+	leader_ = -1;
+}
+
+#else
+
+PerfCounterGroup::PerfCounterGroup() : error_{"hardware counters require Linux perf_event_open"} {
+	descriptors_.fill(-1);
+}
+
+PerfCounterGroup::~PerfCounterGroup() = default;
+
+bool PerfCounterGroup::Read(PerfCounterReading & /*reading*/) const {
+	return false;
+}
+
+void PerfCounterGroup::Close() {}
+
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+enum class PerfEvent {
+	Cycles,
+	Instructions,
+	L1DMisses,
+	LlcMisses,
+	BranchMisses,
+	Count,
+};
+
+const char *ToString(PerfEvent event);
+
+using PerfCounterValues = std::array<std::uint64_t, static_cast<std::size_t>(PerfEvent::Count)>;
+
+// Counter values with the nanoseconds the group has been enabled and actually
+// on the PMU. Running falls behind enabled when the kernel multiplexes the
+// group with other events.
+struct PerfCounterReading {
+	PerfCounterValues values_{};
+	std::uint64_t timeEnabled_{};
+	std::uint64_t timeRunning_{};
+};
+
+// The counts between two readings, scaled up by enabled over running time to
+// estimate what a group on the PMU throughout would have counted. False if the
+// group never ran in between, leaving delta untouched.
+bool ScaleDifference(const PerfCounterReading &start, const PerfCounterReading &end, PerfCounterValues &delta);
+
+// One perf_event_open group counting the PerfEvent set for the calling thread,
+// user space only. Counters run freely from construction; callers measure a
+// region by reading before and after and taking ScaleDifference. Linux only:
+// elsewhere the group never opens.
+class PerfCounterGroup {
+  public:
+	PerfCounterGroup();
+	PerfCounterGroup(const PerfCounterGroup &) = delete;
+	void operator=(const PerfCounterGroup &) = delete;
+	~PerfCounterGroup();
+
+	bool IsOpen() const { return leader_ >= 0; }
+	const std::string &GetError() const { return error_; }
+
+	bool Read(PerfCounterReading &reading) const;
+
+  private:
+	static constexpr std::size_t EventCount = static_cast<std::size_t>(PerfEvent::Count);
+
+	int leader_{-1};
+	std::array<int, EventCount> descriptors_;
+	std::string error_;
+
+	void Close();
+};
@@ -0,0 +1,99 @@
+#include "Platform.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+namespace {
+
+constexpr std::size_t HugePageSize = 2 << 20;
+
+std::string ErrorText(const char *call, int error) {
+	return std::string{call} + ": " + std::strerror(error);
+}
+
+} // namespace
+
+std::string PinCurrentThread(const std::vector<int> &cpus) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (const auto cpu : cpus) {
+		if (cpu < 0 || cpu >= CPU_SETSIZE)
+			return "cpu " + std::to_string(cpu) + " out of range";
+		CPU_SET(cpu, &set);
+	}
+	if (const auto error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); error != 0)
+		return ErrorText("pthread_setaffinity_np", error);
+	return {};
+}
+
+std::string UnpinCurrentThread() {
+	// The kernel narrows the mask to the cpus that exist and the cpuset allows
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+		CPU_SET(cpu, &set);
+	if (const auto error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); error != 0)
+		return ErrorText("pthread_setaffinity_np", error);
+	return {};
+}
+
+std::string LockMemory() {
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+		return ErrorText("mlockall", errno);
+	return {};
+}
+
+ArenaResource::~ArenaResource() {
+	if (region_)
+		munmap(region_, size_);
+}
+
+bool ArenaResource::Reserve(std::size_t bytes, bool hugePages, bool prefault) {
+	if (region_ || bytes == 0)
+		return false;
+
+	const int populate = prefault ? MAP_POPULATE : 0;
+	void *region = MAP_FAILED;
+	if (hugePages) {
+		bytes = (bytes + HugePageSize - 1) & ~(HugePageSize - 1);
+		region = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | populate, -1, 0);
+	}
+	if (region == MAP_FAILED) {
+		// No reserved huge pages: ask for transparent ones before faulting in.
+		// Not counted against overcommit until touched, so an idle book's
+		// region costs nothing.
+		region = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | (prefault ? 0 : MAP_NORESERVE), -1, 0);
+		if (region == MAP_FAILED)
+			return false;
+		if (hugePages)
+			madvise(region, bytes, MADV_HUGEPAGE);
+		if (prefault)
+			madvise(region, bytes, MADV_POPULATE_WRITE);
+	}
+
+	region_ = static_cast<std::byte *>(region);
+	size_ = bytes;
+	return true;
+}
+
+void *ArenaResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+	const auto start = (used_ + alignment - 1) & ~(alignment - 1);
+	if (region_ && start + bytes <= size_) {
+		used_ = start + bytes;
+		return region_ + start;
+	}
+	return ::operator new(bytes, std::align_val_t{alignment});
+}
+
+void ArenaResource::do_deallocate(void *pointer, std::size_t bytes, std::size_t alignment) {
+	// Region memory comes back all at once when the arena is destroyed
+	const auto *address = static_cast<std::byte *>(pointer);
+	if (region_ && address >= region_ && address < region_ + size_)
+		return;
+	::operator delete(pointer, bytes, std::align_val_t{alignment});
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+// Restricts the calling thread to cpus; threads it starts afterwards inherit
+// the mask. Returns the error, empty on success.
+std::string PinCurrentThread(const std::vector<int> &cpus);
+// Lets the calling thread run on any cpu the process is allowed, dropping a
+// mask it inherited. Returns the error, empty on success.
+std::string UnpinCurrentThread();
+
+// Locks every current and future page of the process in memory, so the
+// kernel never pages the engine out and new mappings are faulted in when
+// made rather than on first touch. Returns the error, empty on success.
+std::string LockMemory();
+
+// Upstream memory for a book's pool. Reserve() maps a region up front,
+// optionally on huge pages and prefaulted, that is handed out by bumping a
+// pointer and never given back until destruction; past the region, and
+// without one, allocations go to the heap. Unless prefaulted, normal pages
+// are only address space until first touched.
+class ArenaResource final : public std::pmr::memory_resource {
+  public:
+	ArenaResource() = default;
+	ArenaResource(const ArenaResource &) = delete;
+	void operator=(const ArenaResource &) = delete;
+	~ArenaResource() override;
+
+	// Call before the first allocation. Huge pages fall back to transparent
+	// huge pages, then to normal pages. Returns false, keeping the heap, if
+	// nothing could be mapped.
+	bool Reserve(std::size_t bytes, bool hugePages, bool prefault);
+	std::size_t GetReserved() const { return size_; }
+	std::size_t GetUsed() const { return used_; }
+
+  private:
+	std::byte *region_{nullptr};
+	std::size_t size_{0};
+	std::size_t used_{0};
+
+	void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+	void do_deallocate(void *pointer, std::size_t bytes, std::size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+};
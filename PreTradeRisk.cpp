@@ -0,0 +1,34 @@
+#include "PreTradeRisk.hpp"
+
+const char *ToString(RiskCheck check) {
+	switch (check) {
+	case RiskCheck::Passed:
+		return "passed";
+	case RiskCheck::OrderQuantity:
+		return "order_quantity";
+	case RiskCheck::Notional:
+		return "notional";
+	case RiskCheck::OpenOrders:
+		return "open_orders";
+	case RiskCheck::Position:
+		return "position";
+	case RiskCheck::PriceBand:
+		return "price_band";
+	default:
+		return "unknown";
+	}
+}
+
+bool PreTradeRisk::SetLimits(ClientId clientId, const RiskLimits &limits, std::uint32_t openOrders) {
+	if (clientId == 0 || clientId >= MaxClients)
+		return false;
+
+	if (clientId >= clients_.size())
+		clients_.resize(clientId + 1);
+
+	auto &client = clients_[clientId];
+	client.limits_ = limits;
+	client.openOrders_ = openOrders;
+	client.enabled_ = true;
+	return true;
+}
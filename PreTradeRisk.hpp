@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <vector>
+
+#include "Side.hpp"
+#include "Usings.hpp"
+
+// Per-client pre-trade limits. A zero disables that limit.
+struct RiskLimits {
+	Quantity maxOrderQuantity_{};
+	std::int64_t maxNotional_{}; // price * quantity of one order
+	std::uint32_t maxOpenOrders_{};
+	std::int64_t maxPosition_{}; // Absolute net filled position, including the new order
+	std::uint32_t priceBandBps_{}; // Fat-finger band around the price the order would trade against
+};
+
+enum class RiskCheck {
+	Passed,
+	OrderQuantity,
+	Notional,
+	OpenOrders,
+	Position,
+	PriceBand,
+};
+
+const char *ToString(RiskCheck check);
+
+// Limits and live state of every client with limits, in a flat table indexed
+// by client id: a check is one bounds test and one cache line. Client ids are
+// expected to be small, densely assigned integers; ids at or above MaxClients
+// cannot have limits. Clients without limits are not checked, and positions
+// are only tracked once the table has a slot for the client.
+// Not synchronized: the Orderbook calls it under its orders lock.
+class PreTradeRisk {
+  public:
+	static constexpr ClientId MaxClients = 1 << 16;
+
+	struct alignas(64) ClientRisk {
+		RiskLimits limits_;
+		bool enabled_{false};
+		std::uint32_t openOrders_{};
+		std::int64_t position_{}; // Bought minus sold
+	};
+
+	// Returns false for client 0 (no client) and ids at or above MaxClients.
+	bool SetLimits(ClientId clientId, const RiskLimits &limits, std::uint32_t openOrders);
+	bool HasClients() const { return !clients_.empty(); }
+	const ClientRisk *Find(ClientId clientId) const {
+		return clientId < clients_.size() && clients_[clientId].enabled_ ? &clients_[clientId] : nullptr;
+	}
+
+	// opensOrder is false when the order replaces one already counted as open.
+	RiskCheck Check(ClientId clientId, Side side, Price price, Quantity quantity,
+					std::optional<Price> bestBid, std::optional<Price> bestAsk, bool opensOrder) const {
+		const auto *client = Find(clientId);
+		if (!client) [[likely]]
+			return RiskCheck::Passed;
+
+		const auto &limits = client->limits_;
+		if (limits.maxOrderQuantity_ != 0 && quantity > limits.maxOrderQuantity_)
+			return RiskCheck::OrderQuantity;
+
+		// Market orders are valued at the price they would trade against
+		const auto reference = side == Side::Buy ? (bestAsk ? bestAsk : bestBid) : (bestBid ? bestBid : bestAsk);
+		const auto valuation = price != 0 ? price : reference.value_or(0);
+		if (limits.maxNotional_ != 0 && static_cast<std::int64_t>(valuation) * quantity > limits.maxNotional_)
+			return RiskCheck::Notional;
+
+		if (opensOrder && limits.maxOpenOrders_ != 0 && client->openOrders_ >= limits.maxOpenOrders_)
+			return RiskCheck::OpenOrders;
+
+		const auto signedQuantity = side == Side::Buy ? static_cast<std::int64_t>(quantity) : -static_cast<std::int64_t>(quantity);
+		if (limits.maxPosition_ != 0 && std::llabs(client->position_ + signedQuantity) > limits.maxPosition_)
+			return RiskCheck::Position;
+
+		if (limits.priceBandBps_ != 0 && price != 0 && reference) {
+			const auto deviation = std::llabs(static_cast<std::int64_t>(price) - *reference);
+			if (deviation * 10000 > static_cast<std::int64_t>(*reference) * limits.priceBandBps_)
+				return RiskCheck::PriceBand;
+		}
+
+		return RiskCheck::Passed;
+	}
+
+	void OnOrderOpened(ClientId clientId) {
+		if (clientId < clients_.size())
+			++clients_[clientId].openOrders_;
+	}
+	void OnOrderClosed(ClientId clientId) {
+		if (clientId < clients_.size() && clients_[clientId].openOrders_ != 0)
+			--clients_[clientId].openOrders_;
+	}
+	void OnFill(ClientId clientId, Side side, Quantity quantity) {
+		if (clientId < clients_.size())
+			clients_[clientId].position_ += side == Side::Buy ? static_cast<std::int64_t>(quantity) : -static_cast<std::int64_t>(quantity);
+	}
+
+  private:
+	std::vector<ClientRisk> clients_;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <functional>
+#include <map>
+
+#include "Order.hpp"
+#include "OrderStore.hpp"
+#include "Side.hpp"
+#include "Usings.hpp"
+
+// What differs between the two sides of the book. Book code is written once
+// against these and instantiated per side, so the side is dispatched once on
+// entry rather than branched on inside the loops.
+template <Side S>
+struct SideTraits;
+
+template <>
+struct SideTraits<Side::Buy> {
+	static constexpr Side Opposite = Side::Sell;
+	using Compare = std::greater<Price>; // Best bid first
+	static constexpr Price Improve = 1; // A price step towards the other side
+};
+
+template <>
+struct SideTraits<Side::Sell> {
+	static constexpr Side Opposite = Side::Buy;
+	using Compare = std::less<Price>; // Best ask first
+	static constexpr Price Improve = -1;
+};
+
+// Whether a ranks ahead of b on side S.
+template <Side S>
+constexpr bool IsBetter(Price a, Price b) {
+	return typename SideTraits<S>::Compare{}(a, b);
+}
+
+// Whether price is at or through threshold from side S: a buy at price meets
+// an ask at threshold, and a trade at price triggers a buy stop at threshold.
+template <Side S>
+constexpr bool Reaches(Price price, Price threshold) {
+	return !IsBetter<S>(threshold, price);
+}
+
+// The less aggressive of two prices for side S.
+template <Side S>
+constexpr Price Worse(Price a, Price b) {
+	return IsBetter<S>(a, b) ? b : a;
+}
+
+// Resting orders of one side by price, best first.
+template <Side S>
+using BookLevels = std::map<Price, LevelQueue, typename SideTraits<S>::Compare>;
+
+// Parked stops of one side by stop price. A stop triggers as the price moves
+// against its side, so the next to trigger ranks first in the opposite order.
+template <Side S>
+using StopLevels = std::map<Price, OrderPointers, typename SideTraits<SideTraits<S>::Opposite>::Compare>;
@@ -0,0 +1,325 @@
+#include "Stats.hpp"
+
+#include <cstdio>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+std::atomic<std::uint64_t> nextStatsId{1};
+
+// One-entry cache of the calling thread's slab for the most recently used Stats.
+struct LocalSlab {
+	std::uint64_t owner_{0};
+	void *slab_{nullptr};
+};
+
+thread_local LocalSlab localSlab;
+
+// Counters are per thread, so every thread that profiles opens its own group.
+PerfCounterGroup &LocalCounterGroup() {
+	thread_local PerfCounterGroup group;
+	return group;
+}
+
+} // namespace
+
+const char *ToString(StatsOperation operation) {
+	switch (operation) {
+	case StatsOperation::AddOrder:
+		return "AddOrder";
+	case StatsOperation::CancelOrder:
+		return "CancelOrder";
+	case StatsOperation::ModifyOrder:
+		return "ModifyOrder";
+	case StatsOperation::GetOrderbook:
+		return "GetOrderbook";
+	case StatsOperation::MassQuote:
+		return "MassQuote";
+	case StatsOperation::MassCancel:
+		return "MassCancel";
+	case StatsOperation::Uncross:
+		return "Uncross";
+	default:
+		return "Unknown";
+	}
+}
+
+const char *ToString(StatsStage stage) {
+	switch (stage) {
+	case StatsStage::Decode:
+		return "decode";
+	case StatsStage::LockWait:
+		return "lock_wait";
+	case StatsStage::Match:
+		return "match";
+	case StatsStage::Encode:
+		return "encode";
+	case StatsStage::Total:
+		return "total";
+	default:
+		return "unknown";
+	}
+}
+
+const char *ToString(StatsCounter counter) {
+	switch (counter) {
+	case StatsCounter::Adds:
+		return "adds";
+	case StatsCounter::Cancels:
+		return "cancels";
+	case StatsCounter::Modifies:
+		return "modifies";
+	case StatsCounter::Trades:
+		return "trades";
+	case StatsCounter::Rejects:
+		return "rejects";
+	case StatsCounter::LockWaitNanoseconds:
+		return "lock_wait_ns";
+	case StatsCounter::Quotes:
+		return "quotes";
+	case StatsCounter::RiskRejects:
+		return "risk_rejects";
+	case StatsCounter::Throttled:
+		return "throttled";
+	case StatsCounter::Shed:
+		return "shed";
+	default:
+		return "unknown";
+	}
+}
+
+const char *ToString(PerfRegion region) {
+	switch (region) {
+	case PerfRegion::AddOrder:
+		return "Orderbook::AddOrder";
+	case PerfRegion::MatchOrders:
+		return "Orderbook::MatchOrders";
+	case PerfRegion::CancelOrder:
+		return "Orderbook::CancelOrder";
+	case PerfRegion::RpcAddOrder:
+		return "rpc AddOrder";
+	case PerfRegion::RpcCancelOrder:
+		return "rpc CancelOrder";
+	case PerfRegion::RpcModifyOrder:
+		return "rpc ModifyOrder";
+	case PerfRegion::RpcGetOrderbook:
+		return "rpc GetOrderbook";
+	case PerfRegion::RpcMassQuote:
+		return "rpc MassQuote";
+	case PerfRegion::RpcMassCancel:
+		return "rpc MassCancel";
+	default:
+		return "unknown";
+	}
+}
+
+StatsSnapshot::StatsSnapshot() {
+	latencies_.reserve(OperationCount * StageCount);
+	for (std::size_t i = 0; i < OperationCount * StageCount; ++i)
+		latencies_.emplace_back(Stats::HighestTrackableNanoseconds);
+}
+
+std::string StatsSnapshot::ToText() const {
+	std::ostringstream out;
+
+	out << "counters:";
+	for (std::size_t counter = 0; counter < CounterCount; ++counter)
+		out << ' ' << ToString(static_cast<StatsCounter>(counter)) << '=' << counters_[counter];
+	out << "\ndepth: orders=" << depth_.orders_ << " bid_levels=" << depth_.bidLevels_ << " ask_levels=" << depth_.askLevels_ << '\n';
+
+	char line[160];
+	std::snprintf(line, sizeof(line), "%-13s %-10s %10s %10s %10s %10s %10s %10s\n",
+				  "operation", "stage", "count", "p50 ns", "p90 ns", "p99 ns", "p99.9 ns", "max ns");
+	out << line;
+
+	for (std::size_t operation = 0; operation < OperationCount; ++operation) {
+		for (std::size_t stage = 0; stage < StageCount; ++stage) {
+			const auto &histogram = GetLatency(static_cast<StatsOperation>(operation), static_cast<StatsStage>(stage));
+			if (histogram.GetTotalCount() == 0)
+				continue;
+
+			std::snprintf(line, sizeof(line), "%-13s %-10s %10llu %10llu %10llu %10llu %10llu %10llu\n",
+						  ToString(static_cast<StatsOperation>(operation)), ToString(static_cast<StatsStage>(stage)),
+						  static_cast<unsigned long long>(histogram.GetTotalCount()),
+						  static_cast<unsigned long long>(histogram.GetValueAtPercentile(50.0)),
+						  static_cast<unsigned long long>(histogram.GetValueAtPercentile(90.0)),
+						  static_cast<unsigned long long>(histogram.GetValueAtPercentile(99.0)),
+						  static_cast<unsigned long long>(histogram.GetValueAtPercentile(99.9)),
+						  static_cast<unsigned long long>(histogram.GetMax()));
+			out << line;
+		}
+	}
+
+	bool headerWritten = false;
+	for (std::size_t region = 0; region < RegionCount; ++region) {
+		const auto &totals = perf_[region];
+		if (totals.samples_ == 0)
+			continue;
+
+		if (!headerWritten) {
+			std::snprintf(line, sizeof(line), "%-24s %10s %12s %12s %6s %10s %10s %10s\n",
+						  "region", "samples", "cycles/op", "instr/op", "ipc", "l1d/op", "llc/op", "brmiss/op");
+			out << line;
+			headerWritten = true;
+		}
+
+		const auto perOperation = [&totals](PerfEvent event) {
+			return static_cast<double>(totals.events_[static_cast<std::size_t>(event)]) / static_cast<double>(totals.samples_);
+		};
+		const auto cycles = perOperation(PerfEvent::Cycles);
+
+		std::snprintf(line, sizeof(line), "%-24s %10llu %12.1f %12.1f %6.2f %10.2f %10.2f %10.2f\n",
+					  ToString(static_cast<PerfRegion>(region)), static_cast<unsigned long long>(totals.samples_),
+					  cycles, perOperation(PerfEvent::Instructions), cycles > 0 ? perOperation(PerfEvent::Instructions) / cycles : 0.0,
+					  perOperation(PerfEvent::L1DMisses), perOperation(PerfEvent::LlcMisses), perOperation(PerfEvent::BranchMisses));
+		out << line;
+	}
+
+	return out.str();
+}
+
+const std::size_t Stats::BucketsPerHistogram = StatsHistogram::CountsLength(Stats::HighestTrackableNanoseconds);
+
+Stats::ThreadStats::ThreadStats()
+	: buckets_{new std::atomic<std::uint64_t>[BucketsPerHistogram * StatsSnapshot::OperationCount * StatsSnapshot::StageCount]()} {}
+
+void Stats::ThreadStats::Record(StatsOperation operation, StatsStage stage, std::uint64_t nanoseconds) {
+	const auto histogram = static_cast<std::size_t>(operation) * StatsSnapshot::StageCount + static_cast<std::size_t>(stage);
+	auto &bucket = buckets_[histogram * BucketsPerHistogram + StatsHistogram::CountsIndex(std::min(nanoseconds, HighestTrackableNanoseconds))];
+	bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+Stats::Stats() : id_{nextStatsId.fetch_add(1, std::memory_order_relaxed)}, registry_{std::make_shared<Registry>()} {}
+
+Stats::ThreadStats &Stats::Local() {
+	if (localSlab.owner_ == id_) [[likely]]
+		return *static_cast<ThreadStats *>(localSlab.slab_);
+
+	return Register();
+}
+
+Stats::ThreadStats &Stats::Register() {
+	// Slow path: first record from this thread, or the thread alternates between Stats instances.
+	struct Owned {
+		std::uint64_t owner_;
+		std::weak_ptr<Registry> registry_;
+		ThreadStats *slab_;
+	};
+	// Gives each slab back as the thread exits
+	struct OwnedSlabs {
+		std::vector<Owned> slabs_;
+		~OwnedSlabs() {
+			for (const auto &owned : slabs_) {
+				if (const auto registry = owned.registry_.lock()) {
+					std::scoped_lock registryLock{registry->mutex_};
+					registry->free_.push_back(owned.slab_);
+				}
+			}
+		}
+	};
+	thread_local OwnedSlabs owned;
+
+	ThreadStats *slab = nullptr;
+	std::erase_if(owned.slabs_, [](const Owned &candidate) { return candidate.registry_.expired(); });
+	for (const auto &candidate : owned.slabs_) {
+		if (candidate.owner_ == id_)
+			slab = candidate.slab_;
+	}
+
+	if (!slab) {
+		// Adding to an exited thread's counts: the lock orders its last
+		// records before this thread's first
+		std::scoped_lock registryLock{registry_->mutex_};
+		if (!registry_->free_.empty()) {
+			slab = registry_->free_.back();
+			registry_->free_.pop_back();
+		} else {
+			registry_->threads_.push_back(std::make_unique<ThreadStats>());
+			slab = registry_->threads_.back().get();
+		}
+		owned.slabs_.push_back(Owned{id_, registry_, slab});
+	}
+
+	localSlab = LocalSlab{id_, slab};
+	return *slab;
+}
+
+std::string Stats::EnableHardwareCounters() {
+	const auto &group = LocalCounterGroup();
+	if (!group.IsOpen())
+		return group.GetError();
+
+	hardwareCounters_.store(true, std::memory_order_relaxed);
+	return {};
+}
+
+bool Stats::ReadCounters(PerfCounterReading &reading) {
+	return LocalCounterGroup().Read(reading);
+}
+
+void Stats::RecordCounters(PerfRegion region, const PerfCounterReading &start, const PerfCounterReading &end) {
+	PerfCounterValues delta;
+	if (!ScaleDifference(start, end, delta))
+		return;
+
+	auto *slots = &Local().perf_[static_cast<std::size_t>(region) * PerfSlotsPerRegion];
+	for (std::size_t event = 0; event < StatsSnapshot::EventCount; ++event)
+		slots[event].store(slots[event].load(std::memory_order_relaxed) + delta[event], std::memory_order_relaxed);
+
+	auto &samples = slots[StatsSnapshot::EventCount];
+	samples.store(samples.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+StatsSnapshot Stats::Snapshot() const {
+	StatsSnapshot snapshot;
+
+	std::scoped_lock registryLock{registry_->mutex_};
+	for (const auto &thread : registry_->threads_) {
+		for (std::size_t counter = 0; counter < StatsSnapshot::CounterCount; ++counter)
+			snapshot.counters_[counter] += thread->counters_[counter].load(std::memory_order_relaxed);
+
+		for (std::size_t region = 0; region < StatsSnapshot::RegionCount; ++region) {
+			auto &totals = snapshot.perf_[region];
+			const auto *slots = &thread->perf_[region * PerfSlotsPerRegion];
+			for (std::size_t event = 0; event < StatsSnapshot::EventCount; ++event)
+				totals.events_[event] += slots[event].load(std::memory_order_relaxed);
+			totals.samples_ += slots[StatsSnapshot::EventCount].load(std::memory_order_relaxed);
+		}
+
+		for (std::size_t histogram = 0; histogram < snapshot.latencies_.size(); ++histogram) {
+			const auto *buckets = &thread->buckets_[histogram * BucketsPerHistogram];
+			for (std::size_t index = 0; index < BucketsPerHistogram; ++index) {
+				const auto count = buckets[index].load(std::memory_order_relaxed);
+				if (count != 0)
+					snapshot.latencies_[histogram].RecordValue(StatsHistogram::ValueFromIndex(index), count);
+			}
+		}
+	}
+
+	return snapshot;
+}
+
+std::size_t Stats::GetSlabCount() const {
+	std::scoped_lock registryLock{registry_->mutex_};
+	return registry_->threads_.size();
+}
+
+StatsReporter::StatsReporter(SnapshotProvider provider, std::shared_ptr<ILogger> logger, std::chrono::milliseconds interval)
+	: provider_{std::move(provider)}, logger_{std::move(logger)}, interval_{interval}, thread_{[this] {
+		  std::unique_lock lock{mutex_};
+		  while (!shutdownConditionVariable_.wait_for(lock, interval_, [this] { return shutdown_; })) {
+			  lock.unlock();
+			  logger_->Information("Stats", "\n" + provider_().ToText());
+			  lock.lock();
+		  }
+	  }} {}
+
+StatsReporter::~StatsReporter() {
+	{
+		std::scoped_lock lock{mutex_};
+		shutdown_ = true;
+	}
+	shutdownConditionVariable_.notify_one();
+	thread_.join();
+}
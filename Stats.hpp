@@ -0,0 +1,248 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HdrHistogram.hpp"
+#include "Logging.hpp"
+#include "PerfCounters.hpp"
+#include "TscClock.hpp"
+
+// Two significant digits keeps a per-thread recorder for every
+// operation/stage pair small enough to allocate for each gRPC thread.
+using StatsHistogram = BasicHdrHistogram<7>;
+
+enum class StatsOperation {
+	AddOrder,
+	CancelOrder,
+	ModifyOrder,
+	GetOrderbook,
+	MassQuote,
+	MassCancel,
+	Uncross,
+	Count,
+};
+
+enum class StatsStage {
+	Decode,
+	LockWait,
+	Match,
+	Encode,
+	Total,
+	Count,
+};
+
+enum class StatsCounter {
+	Adds,
+	Cancels,
+	Modifies,
+	Trades,
+	Rejects,
+	LockWaitNanoseconds,
+	Quotes,
+	RiskRejects,
+	Throttled,
+	Shed,
+	Count,
+};
+
+// Code regions measured with hardware counters when profiling is enabled.
+enum class PerfRegion {
+	AddOrder,
+	MatchOrders,
+	CancelOrder,
+	RpcAddOrder,
+	RpcCancelOrder,
+	RpcModifyOrder,
+	RpcGetOrderbook,
+	RpcMassQuote,
+	RpcMassCancel,
+	Count,
+};
+
+const char *ToString(StatsOperation operation);
+const char *ToString(StatsStage stage);
+const char *ToString(StatsCounter counter);
+const char *ToString(PerfRegion region);
+
+struct BookDepth {
+	std::size_t orders_{};
+	std::size_t bidLevels_{};
+	std::size_t askLevels_{};
+};
+
+struct PerfRegionTotals {
+	std::uint64_t samples_{};
+	PerfCounterValues events_{};
+};
+
+struct StatsSnapshot {
+	static constexpr std::size_t OperationCount = static_cast<std::size_t>(StatsOperation::Count);
+	static constexpr std::size_t StageCount = static_cast<std::size_t>(StatsStage::Count);
+	static constexpr std::size_t CounterCount = static_cast<std::size_t>(StatsCounter::Count);
+	static constexpr std::size_t RegionCount = static_cast<std::size_t>(PerfRegion::Count);
+	static constexpr std::size_t EventCount = static_cast<std::size_t>(PerfEvent::Count);
+
+	std::array<std::uint64_t, CounterCount> counters_{};
+	std::vector<StatsHistogram> latencies_; // OperationCount * StageCount, operation-major
+	std::array<PerfRegionTotals, RegionCount> perf_{};
+	BookDepth depth_;
+
+	StatsSnapshot();
+
+	std::uint64_t GetCounter(StatsCounter counter) const { return counters_[static_cast<std::size_t>(counter)]; }
+	const StatsHistogram &GetLatency(StatsOperation operation, StatsStage stage) const {
+		return latencies_[static_cast<std::size_t>(operation) * StageCount + static_cast<std::size_t>(stage)];
+	}
+	const PerfRegionTotals &GetPerf(PerfRegion region) const { return perf_[static_cast<std::size_t>(region)]; }
+
+	std::string ToText() const;
+};
+
+// Engine-wide counters and latency histograms. Every thread that records gets
+// its own slab on first use; recording is a relaxed load/store on memory only
+// that thread writes, so the hot path takes no locks and shares no cache
+// lines. Readers merge all slabs into a StatsSnapshot. A slab outlives its
+// thread: the next thread to start recording carries on with it, counts and
+// all, so there are only ever as many slabs as threads recording at once.
+class Stats {
+  public:
+	static constexpr std::uint64_t HighestTrackableNanoseconds = 60'000'000'000ULL;
+
+	Stats();
+	Stats(const Stats &) = delete;
+	void operator=(const Stats &) = delete;
+
+	void Increment(StatsCounter counter, std::uint64_t amount = 1) {
+		auto &value = Local().counters_[static_cast<std::size_t>(counter)];
+		value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+	void Record(StatsOperation operation, StatsStage stage, std::uint64_t nanoseconds) {
+		Local().Record(operation, stage, nanoseconds);
+	}
+
+	void Record(StatsOperation operation, StatsStage stage, Timestamp start, Timestamp end) {
+		Record(operation, stage, end > start ? static_cast<std::uint64_t>(TscClock::ToNanoseconds(end - start)) : 0);
+	}
+
+	// Starts sampling hardware counters for PerfRegion scopes. Returns an empty
+	// string on success, otherwise why the counters could not be opened.
+	std::string EnableHardwareCounters();
+	bool HardwareCountersEnabled() const { return hardwareCounters_.load(std::memory_order_relaxed); }
+
+	// Reads the calling thread's counter group, opening it on first use.
+	static bool ReadCounters(PerfCounterReading &reading);
+	// Adds the region's counts, scaled for multiplexing; drops the sample if
+	// the group was off the PMU for the whole region.
+	void RecordCounters(PerfRegion region, const PerfCounterReading &start, const PerfCounterReading &end);
+
+	StatsSnapshot Snapshot() const;
+	// Slabs allocated so far, each about a megabyte
+	std::size_t GetSlabCount() const;
+
+  private:
+	static constexpr std::size_t PerfSlotsPerRegion = StatsSnapshot::EventCount + 1; // Events, then sample count
+
+	struct ThreadStats {
+		std::array<std::atomic<std::uint64_t>, StatsSnapshot::CounterCount> counters_{};
+		std::array<std::atomic<std::uint64_t>, StatsSnapshot::RegionCount * PerfSlotsPerRegion> perf_{};
+		std::unique_ptr<std::atomic<std::uint64_t>[]> buckets_;
+
+		ThreadStats();
+		void Record(StatsOperation operation, StatsStage stage, std::uint64_t nanoseconds);
+	};
+
+	static const std::size_t BucketsPerHistogram;
+
+	// Shared with the threads holding its slabs, so that one exiting can
+	// give its slab back, or find the Stats gone
+	struct Registry {
+		std::mutex mutex_;
+		std::vector<std::unique_ptr<ThreadStats>> threads_;
+		std::vector<ThreadStats *> free_; // Of exited threads
+	};
+
+	const std::uint64_t id_;
+	std::atomic<bool> hardwareCounters_{false};
+	std::shared_ptr<Registry> registry_;
+
+	ThreadStats &Local();
+	ThreadStats &Register();
+};
+
+// Records the elapsed time between construction and destruction (or Stop()).
+class ScopedStageTimer {
+  public:
+	ScopedStageTimer(Stats *stats, StatsOperation operation, StatsStage stage)
+		: stats_{stats}, operation_{operation}, stage_{stage} {
+		if (stats_)
+			start_ = TscClock::Now();
+	}
+	ScopedStageTimer(const ScopedStageTimer &) = delete;
+	void operator=(const ScopedStageTimer &) = delete;
+	~ScopedStageTimer() { Stop(); }
+
+	void Stop() {
+		if (stats_)
+			stats_->Record(operation_, stage_, start_, TscClock::Now());
+		stats_ = nullptr;
+	}
+
+  private:
+	Stats *stats_;
+	StatsOperation operation_;
+	StatsStage stage_;
+	Timestamp start_{};
+};
+
+// Adds the hardware counter deltas between construction and destruction to a
+// PerfRegion. A no-op unless hardware counters are enabled on the Stats.
+class ScopedPerfCounters {
+  public:
+	ScopedPerfCounters(Stats *stats, PerfRegion region) : region_{region} {
+		if (stats && stats->HardwareCountersEnabled() && Stats::ReadCounters(start_))
+			stats_ = stats;
+	}
+	ScopedPerfCounters(const ScopedPerfCounters &) = delete;
+	void operator=(const ScopedPerfCounters &) = delete;
+	~ScopedPerfCounters() {
+		PerfCounterReading end;
+		if (stats_ && Stats::ReadCounters(end))
+			stats_->RecordCounters(region_, start_, end);
+	}
+
+  private:
+	Stats *stats_{nullptr};
+	PerfRegion region_;
+	PerfCounterReading start_;
+};
+
+// Periodically writes a text snapshot to a logger.
+class StatsReporter {
+  public:
+	using SnapshotProvider = std::function<StatsSnapshot()>;
+
+	StatsReporter(SnapshotProvider provider, std::shared_ptr<ILogger> logger, std::chrono::milliseconds interval);
+	StatsReporter(const StatsReporter &) = delete;
+	void operator=(const StatsReporter &) = delete;
+	~StatsReporter();
+
+  private:
+	SnapshotProvider provider_;
+	std::shared_ptr<ILogger> logger_;
+	std::chrono::milliseconds interval_;
+	std::mutex mutex_;
+	std::condition_variable shutdownConditionVariable_;
+	bool shutdown_{false};
+	std::thread thread_; // Declared last: started in the constructor
+};
@@ -0,0 +1,95 @@
+#include "Throttle.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+const char *ToString(Admission admission) {
+	switch (admission) {
+	case Admission::Admitted:
+		return "admitted";
+	case Admission::MessageRate:
+		return "message_rate";
+	case Admission::OrderRate:
+		return "order_rate";
+	case Admission::Overloaded:
+		return "overloaded";
+	case Admission::TooManyOrders:
+		return "too_many_orders";
+	default:
+		return "unknown";
+	}
+}
+
+Admission Throttle::Admit(ClientId clientId, std::uint32_t orders, Timestamp now) {
+	if (highWater_ != 0 && orders != 0 && inFlight_.load(std::memory_order_relaxed) >= highWater_)
+		return Admission::Overloaded;
+
+	if (!buckets_) [[likely]]
+		return Admission::Admitted;
+
+	// However long it waited, this request would never fit the order bucket
+	if (orderRate_.interval_ != 0 && orderRate_.interval_ * orders > orderRate_.depth_)
+		return Admission::TooManyOrders;
+
+	auto &buckets = buckets_[clientId % MaxClients];
+	if (!Fits(buckets.messages_, messageRate_, 1, now))
+		return Admission::MessageRate;
+	if (orders != 0 && !Fits(buckets.orders_, orderRate_, orders, now))
+		return Admission::OrderRate;
+
+	// Both had room; a concurrent request of the same client can still take
+	// it first, and then the message token goes back
+	if (!Take(buckets.messages_, messageRate_, 1, now))
+		return Admission::MessageRate;
+	if (orders != 0 && !Take(buckets.orders_, orderRate_, orders, now)) {
+		Refund(buckets.messages_, messageRate_, 1);
+		return Admission::OrderRate;
+	}
+
+	return Admission::Admitted;
+}
+
+void Throttle::Configure(const ThrottleConfig &config) {
+	messageRate_ = MakeRate(config.messagesPerSecond_, config.burst_);
+	orderRate_ = MakeRate(config.ordersPerSecond_, config.burst_);
+	highWater_ = config.inFlightHighWater_;
+
+	if (messageRate_.interval_ == 0 && orderRate_.interval_ == 0)
+		buckets_.reset();
+	else
+		buckets_ = std::make_unique<Buckets[]>(MaxClients);
+}
+
+Throttle::Rate Throttle::MakeRate(std::uint32_t perSecond, std::uint32_t burst) {
+	if (perSecond == 0)
+		return {};
+
+	const auto ticksPerSecond = 1e9 / TscClock::NanosecondsPerTick();
+	const auto interval = std::max<Timestamp>(1, static_cast<Timestamp>(std::llround(ticksPerSecond / perSecond)));
+	return Rate{interval, interval * (burst != 0 ? burst : perSecond)};
+}
+
+bool Throttle::Fits(const std::atomic<Timestamp> &arrival, const Rate &rate, std::uint32_t tokens, Timestamp now) {
+	return rate.interval_ == 0 || std::max(arrival.load(std::memory_order_relaxed), now) + rate.interval_ * tokens - now <= rate.depth_;
+}
+
+bool Throttle::Take(std::atomic<Timestamp> &arrival, const Rate &rate, std::uint32_t tokens, Timestamp now) {
+	if (rate.interval_ == 0)
+		return true;
+
+	auto expected = arrival.load(std::memory_order_relaxed);
+	while (true) {
+		// The bucket is empty once the theoretical arrival time runs more
+		// than its depth ahead of now
+		const auto next = std::max(expected, now) + rate.interval_ * tokens;
+		if (next - now > rate.depth_)
+			return false;
+		if (arrival.compare_exchange_weak(expected, next, std::memory_order_relaxed))
+			return true;
+	}
+}
+
+void Throttle::Refund(std::atomic<Timestamp> &arrival, const Rate &rate, std::uint32_t tokens) {
+	if (rate.interval_ != 0)
+		arrival.fetch_sub(rate.interval_ * tokens, std::memory_order_relaxed);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "TscClock.hpp"
+#include "Usings.hpp"
+
+struct ThrottleConfig {
+	std::uint32_t messagesPerSecond_{}; // Per client, every request; 0 disables
+	std::uint32_t ordersPerSecond_{}; // Per client, orders and quote entries; 0 disables
+	std::uint32_t burst_{}; // Bucket depth in requests; 0 for one second's worth
+	std::uint32_t inFlightHighWater_{}; // Shed new orders at this many in-flight requests; 0 disables
+};
+
+enum class Admission {
+	Admitted,
+	MessageRate,
+	OrderRate,
+	Overloaded,
+	TooManyOrders, // More orders in one request than the order bucket holds
+};
+
+const char *ToString(Admission admission);
+
+// Gateway admission control, checked on the gRPC threads before a request
+// takes the orderbook lock. Each client has a message and an order token
+// bucket, kept as a GCRA theoretical arrival time in TSC ticks so taking a
+// token is one compare-and-swap. A request is only charged when both
+// buckets have room for it. Client ids share buckets modulo MaxClients. Backpressure counts requests in flight through the orderbook
+// and sheds new orders above the high-water mark; cancels are never shed.
+class Throttle {
+  public:
+	static constexpr std::size_t MaxClients = 1 << 16;
+
+	// Admits or refuses one request carrying the given number of orders.
+	Admission Admit(ClientId clientId, std::uint32_t orders, Timestamp now = TscClock::Now());
+
+	// Not thread-safe with respect to in-flight requests; configure before serving.
+	void Configure(const ThrottleConfig &config);
+
+	// Marks a request in flight through the orderbook for its lifetime.
+	class InFlight {
+	  public:
+		explicit InFlight(Throttle &throttle) : count_{throttle.inFlight_} { count_.fetch_add(1, std::memory_order_relaxed); }
+		InFlight(const InFlight &) = delete;
+		void operator=(const InFlight &) = delete;
+		~InFlight() { count_.fetch_sub(1, std::memory_order_relaxed); }
+
+	  private:
+		std::atomic<std::uint32_t> &count_;
+	};
+
+	std::uint32_t GetInFlight() const { return inFlight_.load(std::memory_order_relaxed); }
+
+  private:
+	struct Buckets {
+		std::atomic<Timestamp> messages_{0};
+		std::atomic<Timestamp> orders_{0};
+	};
+
+	// Interval between tokens and the bucket depth, in ticks; interval 0 disables.
+	struct Rate {
+		Timestamp interval_{};
+		Timestamp depth_{};
+	};
+
+	std::unique_ptr<Buckets[]> buckets_;
+	Rate messageRate_;
+	Rate orderRate_;
+	std::uint32_t highWater_{};
+	std::atomic<std::uint32_t> inFlight_{0};
+
+	static Rate MakeRate(std::uint32_t perSecond, std::uint32_t burst);
+	static bool Fits(const std::atomic<Timestamp> &arrival, const Rate &rate, std::uint32_t tokens, Timestamp now);
+	static bool Take(std::atomic<Timestamp> &arrival, const Rate &rate, std::uint32_t tokens, Timestamp now);
+	static void Refund(std::atomic<Timestamp> &arrival, const Rate &rate, std::uint32_t tokens);
+};
@@ -1,22 +1,34 @@
 #pragma once
 
+#include <optional>
+
+#include "Side.hpp"
 #include "TradeInfo.hpp"
 
 class Trade
 {
 public:
-    Trade(const TradeInfo& bidTrade, const TradeInfo& askTrade)
+    Trade(const TradeInfo& bidTrade, const TradeInfo& askTrade, Timestamp matchTime, TradeId tradeId = 0, std::optional<Side> aggressor = std::nullopt)
         : bidTrade_{ bidTrade }
         , askTrade_{ askTrade }
+        , matchTime_{ matchTime }
+        , tradeId_{ tradeId }
+        , aggressor_{ aggressor }
     { }
 
     const TradeInfo& GetBidTrade() const { return bidTrade_; }
     const TradeInfo& GetAskTrade() const { return askTrade_; }
+    Timestamp GetMatchTime() const { return matchTime_; }
+    TradeId GetTradeId() const { return tradeId_; }
+    // The side that took liquidity; none when an auction uncrossed the book
+    std::optional<Side> GetAggressor() const { return aggressor_; }
 
 private:
     TradeInfo bidTrade_;
     TradeInfo askTrade_;
+    Timestamp matchTime_;
+    TradeId tradeId_;
+    std::optional<Side> aggressor_;
 };
 
 using Trades = std::vector<Trade>;
-
@@ -0,0 +1,365 @@
+#include "TradeTape.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+
+#include "InstrumentRegistry.hpp"
+#include "TscClock.hpp"
+
+namespace {
+
+constexpr std::array<char, 8> Magic{'T', 'R', 'A', 'D', 'E', 'T', 'P', '1'};
+// The header has a page to itself; the columns follow it in field order
+constexpr std::size_t HeaderSize = 4096;
+constexpr std::size_t BytesPerTrade = sizeof(std::int64_t) + sizeof(Price) + sizeof(Quantity) + sizeof(std::uint8_t);
+
+std::size_t MappingSize(std::size_t capacity) {
+	return HeaderSize + capacity * BytesPerTrade;
+}
+
+std::string ErrorText(const std::string &path, const char *call, int error) {
+	return path + ": " + call + ": " + std::strerror(error);
+}
+
+constexpr std::int64_t NanosecondsPerSecond = 1'000'000'000;
+
+// Start of the interval that time falls in
+std::int64_t IntervalStart(std::int64_t time, std::int64_t width) {
+	const auto remainder = time % width;
+	return time - (remainder < 0 ? remainder + width : remainder);
+}
+
+// hour on the local day dayOffset days after the one in parts, in epoch nanoseconds
+std::int64_t AtHour(std::tm parts, int dayOffset, std::chrono::hours hour) {
+	parts.tm_mday += dayOffset;
+	parts.tm_hour = static_cast<int>(hour.count());
+	parts.tm_min = 0;
+	parts.tm_sec = 0;
+	parts.tm_isdst = -1;
+	return static_cast<std::int64_t>(std::mktime(&parts)) * NanosecondsPerSecond;
+}
+
+} // namespace
+
+struct TradeTape::Header {
+	std::array<char, 8> magic_;
+	std::uint64_t capacity_;
+	std::uint64_t count_; // Trades written; advanced only after their columns
+};
+
+void TradeBar::Add(Price price, Quantity quantity) {
+	if (trades_ == 0) {
+		open_ = high_ = low_ = price;
+	} else {
+		high_ = std::max(high_, price);
+		low_ = std::min(low_, price);
+	}
+	close_ = price;
+	volume_ += quantity;
+	turnover_ += static_cast<std::int64_t>(price) * quantity;
+	++trades_;
+}
+
+TradeTape::TradeTape(std::vector<std::chrono::milliseconds> barIntervals)
+	: barIntervals_{std::move(barIntervals)}, rollingBars_(barIntervals_.size()) {}
+
+TradeTape::~TradeTape() {
+	if (region_)
+		munmap(region_, size_);
+}
+
+std::string TradeTape::Open(const std::string &path, std::size_t capacity) {
+	if (region_)
+		return "trade tape already open";
+
+	void *region = MAP_FAILED;
+	bool created = true;
+	if (path.empty()) {
+		if (capacity == 0)
+			return "trade tape capacity is 0";
+		region = mmap(nullptr, MappingSize(capacity), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (region == MAP_FAILED)
+			return ErrorText("trade tape", "mmap", errno);
+	} else {
+		const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+		if (fd < 0)
+			return ErrorText(path, "open", errno);
+
+		// An existing tape keeps the capacity it was created with
+		struct stat status;
+		Header header;
+		std::string error;
+		if (fstat(fd, &status) != 0) {
+			error = ErrorText(path, "fstat", errno);
+		} else if (status.st_size != 0) {
+			created = false;
+			if (pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) || header.magic_ != Magic ||
+				static_cast<std::size_t>(status.st_size) != MappingSize(header.capacity_) || header.count_ > header.capacity_)
+				error = path + ": not a trade tape";
+			else
+				capacity = header.capacity_;
+		} else if (capacity == 0) {
+			error = "trade tape capacity is 0";
+		} else if (ftruncate(fd, static_cast<off_t>(MappingSize(capacity))) != 0) {
+			error = ErrorText(path, "ftruncate", errno);
+		}
+
+		if (error.empty()) {
+			region = mmap(nullptr, MappingSize(capacity), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (region == MAP_FAILED)
+				error = ErrorText(path, "mmap", errno);
+		}
+		close(fd); // The mapping keeps the file open
+		if (!error.empty())
+			return error;
+	}
+
+	region_ = static_cast<std::byte *>(region);
+	size_ = MappingSize(capacity);
+	capacity_ = capacity;
+	header_ = reinterpret_cast<Header *>(region_);
+	times_ = reinterpret_cast<std::int64_t *>(region_ + HeaderSize);
+	prices_ = reinterpret_cast<Price *>(times_ + capacity);
+	quantities_ = reinterpret_cast<Quantity *>(prices_ + capacity);
+	aggressors_ = reinterpret_cast<std::uint8_t *>(quantities_ + capacity);
+
+	if (created) {
+		header_->magic_ = Magic;
+		header_->capacity_ = capacity;
+		header_->count_ = 0;
+	}
+
+	// Rebuild the summary and open bars of a reopened tape
+	std::scoped_lock summaryLock{summaryMutex_};
+	for (std::size_t i = 0; i < header_->count_; ++i)
+		Record(times_[i], prices_[i], quantities_[i]);
+	return {};
+}
+
+std::size_t TradeTape::Size() const {
+	if (!header_)
+		return 0;
+	return std::atomic_ref<std::uint64_t>{header_->count_}.load(std::memory_order_acquire);
+}
+
+bool TradeTape::Append(std::int64_t time, Price price, Quantity quantity, std::optional<Side> aggressor) {
+	if (!header_)
+		return false;
+	// Only this thread writes the count or the summary
+	const auto count = header_->count_;
+	if (count == capacity_)
+		return false;
+	if (summary_.trades_ != 0)
+		time = std::max(time, summary_.lastTime_);
+
+	times_[count] = time;
+	prices_[count] = price;
+	quantities_[count] = quantity;
+	aggressors_[count] = aggressor ? static_cast<std::uint8_t>(1 + static_cast<int>(*aggressor)) : 0;
+	std::atomic_ref<std::uint64_t>{header_->count_}.store(count + 1, std::memory_order_release);
+
+	std::scoped_lock summaryLock{summaryMutex_};
+	Record(time, price, quantity);
+	return true;
+}
+
+void TradeTape::Record(std::int64_t time, Price price, Quantity quantity) {
+	summary_.lastPrice_ = price;
+	summary_.lastQuantity_ = quantity;
+	summary_.lastTime_ = time;
+	summary_.volume_ += quantity;
+	summary_.turnover_ += static_cast<std::int64_t>(price) * quantity;
+	++summary_.trades_;
+
+	for (std::size_t i = 0; i < barIntervals_.size(); ++i) {
+		const auto start = IntervalStart(time, std::chrono::nanoseconds{barIntervals_[i]}.count());
+		auto &bar = rollingBars_[i];
+		if (bar.trades_ == 0 || bar.start_ != start) {
+			bar = TradeBar{};
+			bar.start_ = start;
+		}
+		bar.Add(price, quantity);
+	}
+}
+
+TradeSummary TradeTape::GetSummary() const {
+	std::scoped_lock summaryLock{summaryMutex_};
+	return summary_;
+}
+
+std::vector<std::pair<std::chrono::milliseconds, TradeBar>> TradeTape::GetRollingBars() const {
+	std::vector<std::pair<std::chrono::milliseconds, TradeBar>> bars;
+	std::scoped_lock summaryLock{summaryMutex_};
+	for (std::size_t i = 0; i < barIntervals_.size(); ++i) {
+		if (rollingBars_[i].trades_ != 0)
+			bars.emplace_back(barIntervals_[i], rollingBars_[i]);
+	}
+	return bars;
+}
+
+std::vector<TradeBar> TradeTape::GetBars(std::int64_t from, std::int64_t to, std::chrono::nanoseconds interval) const {
+	std::vector<TradeBar> bars;
+	if (interval.count() <= 0 || from >= to)
+		return bars;
+
+	// The time column is sorted, so the range is found by bisection and
+	// only its own rows are read
+	const std::int64_t *begin = times_;
+	const auto *end = begin + Size();
+	const auto *first = std::lower_bound(begin, end, from);
+	const auto *last = std::lower_bound(first, end, to);
+	for (const auto *time = first; time != last; ++time) {
+		const auto start = IntervalStart(*time, interval.count());
+		if (bars.empty() || bars.back().start_ != start) {
+			bars.emplace_back();
+			bars.back().start_ = start;
+		}
+		const auto index = static_cast<std::size_t>(time - begin);
+		bars.back().Add(prices_[index], quantities_[index]);
+	}
+	return bars;
+}
+
+std::optional<Side> TradeTape::GetAggressor(std::size_t index) const {
+	if (aggressors_[index] == 0)
+		return std::nullopt;
+	return static_cast<Side>(aggressors_[index] - 1);
+}
+
+TradingSession GetTradingSession(std::int64_t time, std::chrono::hours endOfDay) {
+	// The end of day at or after time, as InstrumentRegistry::RunEndOfDay
+	// finds it, and the one before
+	const auto seconds = static_cast<std::time_t>(IntervalStart(time, NanosecondsPerSecond) / NanosecondsPerSecond);
+	std::tm parts;
+	localtime_r(&seconds, &parts);
+	const int dayOffset = parts.tm_hour >= endOfDay.count() ? 1 : 0;
+
+	TradingSession session;
+	session.start_ = AtHour(parts, dayOffset - 1, endOfDay);
+	session.end_ = AtHour(parts, dayOffset, endOfDay);
+	const auto end = static_cast<std::time_t>(session.end_ / NanosecondsPerSecond);
+	localtime_r(&end, &parts);
+	session.date_ = static_cast<std::uint32_t>((parts.tm_year + 1900) * 10'000 + (parts.tm_mon + 1) * 100 + parts.tm_mday);
+	return session;
+}
+
+TradeTapeRecorder::TradeTapeRecorder(std::shared_ptr<ExecutionReportRing> reports, TradeTapeConfig config, std::shared_ptr<ILogger> logger)
+	: reports_{std::move(reports)}, config_{std::move(config)}, logger_{std::move(logger)}, thread_{[this] { Run(); }} {}
+
+TradeTapeRecorder::~TradeTapeRecorder() {
+	shutdown_.store(true, std::memory_order_release);
+	thread_.join();
+}
+
+std::shared_ptr<const TradeTape> TradeTapeRecorder::Find(InstrumentId id) const {
+	std::scoped_lock tapesLock{tapesMutex_};
+	const auto it = tapes_.find(id);
+	return it != tapes_.end() ? it->second : nullptr;
+}
+
+std::string TradeTapeRecorder::GetError() const {
+	std::scoped_lock tapesLock{tapesMutex_};
+	return error_;
+}
+
+void TradeTapeRecorder::Run() {
+	if (!config_.directory_.empty()) {
+		std::error_code error;
+		std::filesystem::create_directories(config_.directory_, error);
+		if (error)
+			ReportProblem(config_.directory_ + ": " + error.message());
+	}
+
+	auto sequence = reports_->GetOldestSequence();
+	ExecutionReport report;
+	while (true) {
+		switch (reports_->Read(sequence, report)) {
+		case ExecutionReportRing::ReadResult::Read:
+			++sequence;
+			// Each trade once, from its buy side
+			if (report.type_ == ExecutionType::Fill && report.side_ == Side::Buy)
+				Record(report);
+			break;
+		case ExecutionReportRing::ReadResult::NotYet:
+			// Everything published before shutdown is recorded first
+			if (shutdown_.load(std::memory_order_acquire))
+				return;
+			reports_->WaitFor(sequence, IdleCheckInterval);
+			break;
+		case ExecutionReportRing::ReadResult::Overwritten: {
+			const auto oldest = std::max(reports_->GetOldestSequence(), sequence + 1);
+			lostReports_.fetch_add(oldest - sequence, std::memory_order_relaxed);
+			sequence = oldest;
+			break;
+		}
+		}
+	}
+}
+
+void TradeTapeRecorder::Record(const ExecutionReport &report) {
+	std::optional<Side> aggressor;
+	if (report.aggressor_)
+		aggressor = Side::Buy;
+	else if (report.counterpartyAggressor_)
+		aggressor = Side::Sell;
+
+	// A trade stamped before the session start, by a clock stepped back,
+	// stays on the current session's tapes
+	const auto time = TscClock::ToEpochNanoseconds(report.time_);
+	if (time >= session_.end_)
+		StartSession(time);
+
+	const auto tape = GetOrOpen(report.instrumentId_);
+	if (tape && tape->Append(time, report.price_, report.quantity_, aggressor))
+		return;
+	droppedTrades_.fetch_add(1, std::memory_order_relaxed);
+	if (tape && fullTapes_.insert(report.instrumentId_).second)
+		ReportProblem("instrument " + std::to_string(report.instrumentId_) + ": trade tape full at " + std::to_string(tape->GetCapacity()) +
+					  " trades; dropping its trades until the session ends");
+}
+
+void TradeTapeRecorder::StartSession(std::int64_t time) {
+	session_ = GetTradingSession(time, InstrumentRegistry::EndOfDay);
+	fullTapes_.clear();
+	// Readers holding the last session's tapes keep them until they let go
+	std::scoped_lock tapesLock{tapesMutex_};
+	tapes_.clear();
+}
+
+void TradeTapeRecorder::ReportProblem(std::string problem) {
+	if (logger_)
+		logger_->Warning("TradeTape", problem);
+	std::scoped_lock tapesLock{tapesMutex_};
+	error_ = std::move(problem);
+}
+
+std::shared_ptr<TradeTape> TradeTapeRecorder::GetOrOpen(InstrumentId id) {
+	{
+		std::scoped_lock tapesLock{tapesMutex_};
+		if (const auto it = tapes_.find(id); it != tapes_.end())
+			return it->second;
+	}
+
+	// Only this thread adds tapes, so the file can be opened outside the lock.
+	// A tape that fails to open stays null rather than being retried per trade.
+	auto tape = std::make_shared<TradeTape>(config_.barIntervals_);
+	std::string path;
+	if (!config_.directory_.empty())
+		path = config_.directory_ + "/instrument-" + std::to_string(id) + "-" + std::to_string(session_.date_) + ".tape";
+	if (auto error = tape->Open(path, config_.capacity_); !error.empty()) {
+		tape.reset();
+		ReportProblem(std::move(error));
+	}
+	std::scoped_lock tapesLock{tapesMutex_};
+	tapes_.emplace(id, tape);
+	return tape;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "ExecutionReports.hpp"
+#include "Logging.hpp"
+#include "Side.hpp"
+#include "Usings.hpp"
+
+// Open, high, low, close and volume of the trades in one interval. Times are
+// nanoseconds since the Unix epoch.
+struct TradeBar {
+	std::int64_t start_{}; // A multiple of the interval
+	Price open_{};
+	Price high_{};
+	Price low_{};
+	Price close_{};
+	std::uint64_t volume_{};
+	std::int64_t turnover_{}; // Sum of price * quantity
+	std::uint32_t trades_{};
+
+	void Add(Price price, Quantity quantity);
+	double GetVwap() const { return volume_ != 0 ? static_cast<double>(turnover_) / static_cast<double>(volume_) : 0.0; }
+};
+
+// Everything traded on the tape so far: with one tape per session, the
+// session's trading
+struct TradeSummary {
+	Price lastPrice_{};
+	Quantity lastQuantity_{};
+	std::int64_t lastTime_{};
+	std::uint64_t volume_{};
+	std::int64_t turnover_{};
+	std::uint64_t trades_{};
+
+	double GetVwap() const { return volume_ != 0 ? static_cast<double>(turnover_) / static_cast<double>(volume_) : 0.0; }
+};
+
+// One instrument's trades in a memory-mapped file, a column per field:
+// times, prices, quantities and aggressor sides, each contiguous, so a scan
+// over a time range reads only the columns it needs and the file outlives
+// the process. Reopening a file carries on where it ended.
+//
+// One thread appends; any number read. A trade becomes visible to readers
+// when the count in the file header is advanced past it. The summary and
+// the open bar of each configured interval are kept up to date on append.
+class TradeTape {
+  public:
+	explicit TradeTape(std::vector<std::chrono::milliseconds> barIntervals = {});
+	TradeTape(const TradeTape &) = delete;
+	void operator=(const TradeTape &) = delete;
+	~TradeTape();
+
+	// Maps path, created with room for capacity trades if it does not exist,
+	// or anonymous memory if path is empty. Call once, before appending.
+	// Returns the error, empty on success.
+	std::string Open(const std::string &path, std::size_t capacity);
+
+	std::size_t GetCapacity() const { return capacity_; }
+	std::size_t Size() const;
+
+	// Appends one trade; false once the tape is full. A time before the last
+	// trade's is recorded as the last trade's, keeping the time column sorted.
+	bool Append(std::int64_t time, Price price, Quantity quantity, std::optional<Side> aggressor);
+
+	TradeSummary GetSummary() const;
+	// The open bar of each configured interval that has trades, kept on append.
+	std::vector<std::pair<std::chrono::milliseconds, TradeBar>> GetRollingBars() const;
+	// Bars of interval over [from, to), leaving out intervals without trades,
+	// built by scanning the columns.
+	std::vector<TradeBar> GetBars(std::int64_t from, std::int64_t to, std::chrono::nanoseconds interval) const;
+	// The trade at index, for index < Size().
+	std::int64_t GetTime(std::size_t index) const { return times_[index]; }
+	Price GetPrice(std::size_t index) const { return prices_[index]; }
+	Quantity GetQuantity(std::size_t index) const { return quantities_[index]; }
+	std::optional<Side> GetAggressor(std::size_t index) const;
+
+  private:
+	struct Header;
+
+	std::vector<std::chrono::milliseconds> barIntervals_;
+	std::byte *region_{nullptr};
+	std::size_t size_{0};
+	std::size_t capacity_{0};
+	Header *header_{nullptr};
+	std::int64_t *times_{nullptr};
+	Price *prices_{nullptr};
+	Quantity *quantities_{nullptr};
+	std::uint8_t *aggressors_{nullptr}; // 0 for none, else 1 + Side
+
+	mutable std::mutex summaryMutex_;
+	TradeSummary summary_;
+	std::vector<TradeBar> rollingBars_; // One per bar interval
+
+	void Record(std::int64_t time, Price price, Quantity quantity);
+};
+
+// The trading session a time falls in, from one end of day to the next in
+// local time. Times are nanoseconds since the Unix epoch.
+struct TradingSession {
+	std::int64_t start_{}; // Inclusive
+	std::int64_t end_{}; // Exclusive
+	std::uint32_t date_{}; // The day the session ends, as YYYYMMDD
+};
+
+TradingSession GetTradingSession(std::int64_t time, std::chrono::hours endOfDay);
+
+struct TradeTapeConfig {
+	std::string directory_; // One file per instrument and session; empty keeps the tapes in memory only
+	std::size_t capacity_{std::size_t{1} << 20}; // Trades per instrument and session
+	std::vector<std::chrono::milliseconds> barIntervals_{std::chrono::seconds{1}, std::chrono::minutes{1}};
+};
+
+// Records every trade from an execution report ring onto a tape per
+// instrument and trading session, on a thread of its own, off the matching
+// path. Each trade is taken from its buy side's fill report. The thread
+// sleeps on the ring until a report is published, so a tape lags its book by
+// a wakeup and the time to record what came before.
+//
+// Sessions end at InstrumentRegistry::EndOfDay, and the first trade after it
+// starts new tapes, named for the session's date, so a tape's summary is the
+// session's and a restart carries on that session's file. A full tape drops
+// its instrument's trades until the session ends; that is logged once.
+class TradeTapeRecorder {
+  public:
+	// How long the thread, once caught up, waits for the next report before
+	// checking for shutdown; Publish wakes it as soon as one arrives
+	static constexpr std::chrono::milliseconds IdleCheckInterval{50};
+
+	// Starts from the oldest report reports still holds.
+	TradeTapeRecorder(std::shared_ptr<ExecutionReportRing> reports, TradeTapeConfig config, std::shared_ptr<ILogger> logger = nullptr);
+	TradeTapeRecorder(const TradeTapeRecorder &) = delete;
+	void operator=(const TradeTapeRecorder &) = delete;
+	~TradeTapeRecorder();
+
+	// The tape of id for the current session; nullptr before its first trade.
+	std::shared_ptr<const TradeTape> Find(InstrumentId id) const;
+
+	// Reports overwritten before the thread got to them
+	std::uint64_t GetLostReports() const { return lostReports_.load(std::memory_order_relaxed); }
+	// Trades that found their tape full or unopenable
+	std::uint64_t GetDroppedTrades() const { return droppedTrades_.load(std::memory_order_relaxed); }
+	// Why the last tape failed to open or filled up, empty if none did
+	std::string GetError() const;
+
+  private:
+	std::shared_ptr<ExecutionReportRing> reports_;
+	TradeTapeConfig config_;
+	std::shared_ptr<ILogger> logger_;
+	TradingSession session_; // Of the tapes in tapes_; the recorder thread's own
+	std::unordered_set<InstrumentId> fullTapes_; // This session's, already reported; the recorder thread's own
+	mutable std::mutex tapesMutex_;
+	std::unordered_map<InstrumentId, std::shared_ptr<TradeTape>> tapes_;
+	std::string error_; // Guarded by tapesMutex_
+	std::atomic<std::uint64_t> lostReports_{0};
+	std::atomic<std::uint64_t> droppedTrades_{0};
+	std::atomic<bool> shutdown_{false};
+	std::thread thread_; // Declared last: started in the constructor and uses every member above
+
+	void Run();
+	void Record(const ExecutionReport &report);
+	std::shared_ptr<TradeTape> GetOrOpen(InstrumentId id);
+	void StartSession(std::int64_t time);
+	void ReportProblem(std::string problem);
+};
@@ -2,106 +2,636 @@
 
 grpc::Status TradingEngineServer::AddOrder(grpc::ServerContext * /*context*/, const trading::OrderRequest *request,
 										   trading::TradeResponse *response) {
+	const auto receiveTime = TscClock::Now();
+	ScopedStageTimer totalTimer{stats_.get(), StatsOperation::AddOrder, StatsStage::Total};
+	ScopedPerfCounters perfCounters{stats_.get(), PerfRegion::RpcAddOrder};
 
+	if (const auto admission = Admit(request->client_id(), 1); admission != Admission::Admitted) {
+		response->set_status(::trading::OrderStatus::REJECTED);
+		response->set_reject_reason(ToString(admission));
+		response->set_receive_timestamp(TscClock::ToEpochNanoseconds(receiveTime));
+		response->set_timestamp(TscClock::EpochNanoseconds());
+		return grpc::Status::OK;
+	}
+
+	// First order of the day for an instrument creates its book
+	const auto orderbook = instruments_->GetOrCreate(request->instrument_id());
+	if (!orderbook) {
+		stats_->Increment(StatsCounter::Rejects);
+		response->set_status(::trading::OrderStatus::REJECTED);
+		response->set_reject_reason(UnknownInstrument);
+		response->set_receive_timestamp(TscClock::ToEpochNanoseconds(receiveTime));
+		response->set_timestamp(TscClock::EpochNanoseconds());
+		return grpc::Status::OK;
+	}
+
+	ScopedStageTimer decodeTimer{stats_.get(), StatsOperation::AddOrder, StatsStage::Decode};
 	OrderPointer order = std::make_shared<Order>(
 		ParseOrderType(request->order_type()),
 		request->order_id(),
 		ParseSide(request->side()),
 		request->price(),
-		request->quantity());
+		request->quantity(),
+		request->display_quantity());
+	order->SetStopPrice(request->stop_price());
+	if (request->peg_type() != trading::PegType::PEG_TYPE_UNSPECIFIED)
+		order->SetPeg(ParsePegType(request->peg_type()), request->peg_offset());
+	order->SetReceiveTime(receiveTime);
+	order->SetClientId(request->client_id());
+	decodeTimer.Stop();
 
-	auto trades = orderbook_->AddOrder(order);
-	
+	auto riskCheck = RiskCheck::Passed;
+	Throttle::InFlight inFlight{throttle_};
+	auto trades = Execute(orderbook, [&] { return orderbook->AddOrder(order, &riskCheck); });
+
+	ScopedStageTimer encodeTimer{stats_.get(), StatsOperation::AddOrder, StatsStage::Encode};
 	// Set status based on whether order was filled or just placed
-	if (trades.empty()) {
+	if (riskCheck != RiskCheck::Passed) {
+		response->set_status(::trading::OrderStatus::REJECTED);
+		response->set_reject_reason(ToString(riskCheck));
+	} else if (trades.empty()) {
 		// Order was added to orderbook without matches
 		response->set_status(::trading::OrderStatus::ACCEPTED);
 	} else {
 		// Order was matched and generated trades
 		response->set_status(::trading::OrderStatus::FILLED);
-		for (const auto &trade : trades) {
-			auto *bidTradeInfo = response->add_trades();
-			bidTradeInfo->set_order_id(trade.GetBidTrade().orderId_);
-			bidTradeInfo->set_price(trade.GetBidTrade().price_);
-			bidTradeInfo->set_quantity(trade.GetBidTrade().quantity_);
-
-			auto *askTradeInfo = response->add_trades();
-			askTradeInfo->set_order_id(trade.GetAskTrade().orderId_);
-			askTradeInfo->set_price(trade.GetAskTrade().price_);
-			askTradeInfo->set_quantity(trade.GetAskTrade().quantity_);
-		}
+		EncodeTrades(trades, response->mutable_trades());
 	}
 
+	response->set_receive_timestamp(TscClock::ToEpochNanoseconds(receiveTime));
+	response->set_timestamp(TscClock::EpochNanoseconds());
 	return grpc::Status::OK;
 }
 
 grpc::Status TradingEngineServer::CancelOrder(grpc::ServerContext * /*context*/, const trading::CancelOrderRequest *request,
 											  trading::CancelOrderResponse *response) {
-	orderbook_->CancelOrder(request->order_id());
+	const auto receiveTime = TscClock::Now();
+	ScopedStageTimer totalTimer{stats_.get(), StatsOperation::CancelOrder, StatsStage::Total};
+	ScopedPerfCounters perfCounters{stats_.get(), PerfRegion::RpcCancelOrder};
+
+	if (const auto admission = Admit(request->client_id(), 0); admission != Admission::Admitted) {
+		response->set_success(false);
+		response->set_reject_reason(ToString(admission));
+		response->set_receive_timestamp(TscClock::ToEpochNanoseconds(receiveTime));
+		response->set_timestamp(TscClock::EpochNanoseconds());
+		return grpc::Status::OK;
+	}
+
+	// No book yet means no orders to cancel
+	const auto orderbook = instruments_->Find(request->instrument_id());
+	if (!orderbook && !instruments_->IsListed(request->instrument_id())) {
+		response->set_success(false);
+		response->set_reject_reason(UnknownInstrument);
+		response->set_receive_timestamp(TscClock::ToEpochNanoseconds(receiveTime));
+		response->set_timestamp(TscClock::EpochNanoseconds());
+		return grpc::Status::OK;
+	}
+
+	if (orderbook) {
+		Throttle::InFlight inFlight{throttle_};
+		Execute(orderbook, [&] { orderbook->CancelOrder(request->order_id()); });
+	}
+
+	ScopedStageTimer encodeTimer{stats_.get(), StatsOperation::CancelOrder, StatsStage::Encode};
 	response->set_success(true);
 
+	response->set_receive_timestamp(TscClock::ToEpochNanoseconds(receiveTime));
+	response->set_timestamp(TscClock::EpochNanoseconds());
 	return grpc::Status::OK;
 }
 
 grpc::Status TradingEngineServer::ModifyOrder(grpc::ServerContext * /*context*/, const trading::ModifyOrderRequest *request,
 											  trading::TradeResponse *response) {
+	const auto receiveTime = TscClock::Now();
+	ScopedStageTimer totalTimer{stats_.get(), StatsOperation::ModifyOrder, StatsStage::Total};
+	ScopedPerfCounters perfCounters{stats_.get(), PerfRegion::RpcModifyOrder};
+
+	if (const auto admission = Admit(request->client_id(), 1); admission != Admission::Admitted) {
+		response->set_status(::trading::OrderStatus::REJECTED);
+		response->set_reject_reason(ToString(admission));
+		response->set_receive_timestamp(TscClock::ToEpochNanoseconds(receiveTime));
+		response->set_timestamp(TscClock::EpochNanoseconds());
+		return grpc::Status::OK;
+	}
+
 	// Check if order exists first
-	if (!orderbook_->OrderExists(request->order_id())) {
+	const auto orderbook = instruments_->Find(request->instrument_id());
+	if (!orderbook || !orderbook->OrderExists(request->order_id())) {
+		stats_->Increment(StatsCounter::Rejects);
 		response->set_status(::trading::OrderStatus::REJECTED);
+		if (!orderbook && !instruments_->IsListed(request->instrument_id()))
+			response->set_reject_reason(UnknownInstrument);
+		response->set_receive_timestamp(TscClock::ToEpochNanoseconds(receiveTime));
+		response->set_timestamp(TscClock::EpochNanoseconds());
 		return grpc::Status::OK;
 	}
 
+	ScopedStageTimer decodeTimer{stats_.get(), StatsOperation::ModifyOrder, StatsStage::Decode};
 	OrderModify order(
 		request->order_id(),
 		ParseSide(request->side()),
 		request->new_price(),
 		request->new_quantity());
+	order.SetReceiveTime(receiveTime);
+	decodeTimer.Stop();
+
+	auto riskCheck = RiskCheck::Passed;
+	Throttle::InFlight inFlight{throttle_};
+	Trades trades = Execute(orderbook, [&] { return orderbook->ModifyOrder(order, &riskCheck); });
 
-	Trades trades = orderbook_->ModifyOrder(order);
-	
+	ScopedStageTimer encodeTimer{stats_.get(), StatsOperation::ModifyOrder, StatsStage::Encode};
 	// Set status based on whether order modification resulted in trades
-	if (trades.empty()) {
+	if (riskCheck != RiskCheck::Passed) {
+		response->set_status(::trading::OrderStatus::REJECTED);
+		response->set_reject_reason(ToString(riskCheck));
+	} else if (trades.empty()) {
 		// Order was modified successfully without matches
 		response->set_status(::trading::OrderStatus::ACCEPTED);
 	} else {
 		// Order modification resulted in trades
 		response->set_status(::trading::OrderStatus::FILLED);
-		for (const auto &trade : trades) {
-			auto *bidTradeInfo = response->add_trades();
-			bidTradeInfo->set_order_id(trade.GetBidTrade().orderId_);
-			bidTradeInfo->set_price(trade.GetBidTrade().price_);
-			bidTradeInfo->set_quantity(trade.GetBidTrade().quantity_);
-
-			auto *askTradeInfo = response->add_trades();
-			askTradeInfo->set_order_id(trade.GetAskTrade().orderId_);
-			askTradeInfo->set_price(trade.GetAskTrade().price_);
-			askTradeInfo->set_quantity(trade.GetAskTrade().quantity_);
-		}
+		EncodeTrades(trades, response->mutable_trades());
 	}
 
+	response->set_receive_timestamp(TscClock::ToEpochNanoseconds(receiveTime));
+	response->set_timestamp(TscClock::EpochNanoseconds());
 	return grpc::Status::OK;
 }
 
-grpc::Status TradingEngineServer::GetOrderbook(grpc::ServerContext * /*context*/, const trading::OrderbookRequest * /*request*/,
+grpc::Status TradingEngineServer::GetOrderbook(grpc::ServerContext * /*context*/, const trading::OrderbookRequest *request,
 											   trading::OrderbookResponse *response) {
-	OrderbookLevelInfos orderInfos = orderbook_->GetOrderInfos();
+	ScopedStageTimer totalTimer{stats_.get(), StatsOperation::GetOrderbook, StatsStage::Total};
+	ScopedPerfCounters perfCounters{stats_.get(), PerfRegion::RpcGetOrderbook};
+
+	// A listed instrument without a book is an empty book in continuous trading
+	const auto orderbook = instruments_->Find(request->instrument_id());
+	if (!orderbook) {
+		if (!instruments_->IsListed(request->instrument_id()))
+			return grpc::Status(grpc::StatusCode::NOT_FOUND, "Unknown instrument");
+		response->set_phase(trading::TradingPhase::CONTINUOUS);
+		EncodeTradeSummary(request->instrument_id(), response);
+		response->set_timestamp(TscClock::EpochNanoseconds());
+		return grpc::Status::OK;
+	}
+
+	// Levels go from the book straight into the response; the encode stage
+	// overlaps the book's match stage for this call. The phase and indicative
+	// uncross come from the same book state as the levels.
+	ScopedStageTimer encodeTimer{stats_.get(), StatsOperation::GetOrderbook, StatsStage::Encode};
+	auto *bids = response->mutable_bids();
+	auto *asks = response->mutable_asks();
+	const auto status = orderbook->VisitSnapshot([&](std::size_t bidLevels, std::size_t askLevels) {
+		bids->Reserve(static_cast<int>(bidLevels));
+		asks->Reserve(static_cast<int>(askLevels));
+	}, [&](Side side, const LevelInfo &level) {
+		auto *levelInfo = (side == Side::Buy ? bids : asks)->Add();
+		levelInfo->set_price(level.price_);
+		levelInfo->set_quantity(level.quantity_);
+	});
+
+	switch (status.phase_) {
+	case TradingPhase::Auction:
+		response->set_phase(trading::TradingPhase::AUCTION);
+		break;
+	case TradingPhase::FrequentBatch:
+		response->set_phase(trading::TradingPhase::FREQUENT_BATCH);
+		break;
+	default:
+		response->set_phase(trading::TradingPhase::CONTINUOUS);
+		break;
+	}
+	if (status.indicativeUncross_) {
+		response->set_indicative_price(status.indicativeUncross_->price_);
+		response->set_indicative_volume(status.indicativeUncross_->volume_);
+	}
+	EncodeTradeSummary(request->instrument_id(), response);
+	response->set_timestamp(TscClock::EpochNanoseconds());
+	return grpc::Status::OK;
+}
+
+grpc::Status TradingEngineServer::MassQuote(grpc::ServerContext * /*context*/, const trading::MassQuoteRequest *request,
+											trading::MassQuoteResponse *response) {
+	const auto receiveTime = TscClock::Now();
+	ScopedStageTimer totalTimer{stats_.get(), StatsOperation::MassQuote, StatsStage::Total};
+	ScopedPerfCounters perfCounters{stats_.get(), PerfRegion::RpcMassQuote};
+
+	if (const auto admission = Admit(request->client_id(), request->entries_size()); admission != Admission::Admitted) {
+		response->set_status(::trading::OrderStatus::REJECTED);
+		response->set_reject_reason(ToString(admission));
+		response->set_receive_timestamp(TscClock::ToEpochNanoseconds(receiveTime));
+		response->set_timestamp(TscClock::EpochNanoseconds());
+		return grpc::Status::OK;
+	}
+
+	const auto orderbook = instruments_->GetOrCreate(request->instrument_id());
+	if (!orderbook) {
+		stats_->Increment(StatsCounter::Rejects);
+		response->set_status(::trading::OrderStatus::REJECTED);
+		response->set_reject_reason(UnknownInstrument);
+		response->set_receive_timestamp(TscClock::ToEpochNanoseconds(receiveTime));
+		response->set_timestamp(TscClock::EpochNanoseconds());
+		return grpc::Status::OK;
+	}
+
+	ScopedStageTimer decodeTimer{stats_.get(), StatsOperation::MassQuote, StatsStage::Decode};
+	QuoteEntries entries;
+	entries.reserve(request->entries_size());
+	for (const auto &entry : request->entries())
+		entries.push_back(QuoteEntry{ParseSide(entry.side()), entry.price(), entry.quantity()});
+	decodeTimer.Stop();
+
+	Throttle::InFlight inFlight{throttle_};
+	auto result = Execute(orderbook, [&] { return orderbook->MassQuote(request->client_id(), request->quote_set_id(), entries); });
+
+	ScopedStageTimer encodeTimer{stats_.get(), StatsOperation::MassQuote, StatsStage::Encode};
+	if (!result.accepted_) {
+		response->set_status(::trading::OrderStatus::REJECTED);
+		if (result.riskCheck_ != RiskCheck::Passed)
+			response->set_reject_reason(ToString(result.riskCheck_));
+	} else if (result.trades_.empty())
+		response->set_status(::trading::OrderStatus::ACCEPTED);
+	else
+		response->set_status(::trading::OrderStatus::FILLED);
+
+	response->mutable_order_ids()->Add(result.orderIds_.begin(), result.orderIds_.end());
+	EncodeTrades(result.trades_, response->mutable_trades());
+
+	response->set_receive_timestamp(TscClock::ToEpochNanoseconds(receiveTime));
+	response->set_timestamp(TscClock::EpochNanoseconds());
+	return grpc::Status::OK;
+}
+
+grpc::Status TradingEngineServer::MassCancel(grpc::ServerContext * /*context*/, const trading::MassCancelRequest *request,
+											 trading::MassCancelResponse *response) {
+	const auto receiveTime = TscClock::Now();
+	ScopedStageTimer totalTimer{stats_.get(), StatsOperation::MassCancel, StatsStage::Total};
+	ScopedPerfCounters perfCounters{stats_.get(), PerfRegion::RpcMassCancel};
+
+	std::optional<Side> side;
+	if (request->side() != trading::Side::SIDE_UNSPECIFIED)
+		side = ParseSide(request->side());
+	const auto minPrice = request->min_price() != 0 ? request->min_price() : std::numeric_limits<Price>::min();
+	const auto maxPrice = request->max_price() != 0 ? request->max_price() : std::numeric_limits<Price>::max();
+
+	// Held to the message rate like a single cancel, but never shed: it is
+	// how a client gets out of the market
+	if (const auto admission = Admit(request->client_id(), 0); admission != Admission::Admitted) {
+		response->set_reject_reason(ToString(admission));
+		response->set_receive_timestamp(TscClock::ToEpochNanoseconds(receiveTime));
+		response->set_timestamp(TscClock::EpochNanoseconds());
+		return grpc::Status::OK;
+	}
+
+	std::size_t cancelled = 0;
+	{
+		Throttle::InFlight inFlight{throttle_};
+		if (request->all_instruments()) {
+			for (const auto &orderbook : instruments_->GetBooks())
+				cancelled += Execute(orderbook, [&] { return orderbook->MassCancel(request->client_id(), side, minPrice, maxPrice); });
+		} else if (const auto orderbook = instruments_->Find(request->instrument_id())) {
+			cancelled = Execute(orderbook, [&] { return orderbook->MassCancel(request->client_id(), side, minPrice, maxPrice); });
+		}
+	}
+
+	ScopedStageTimer encodeTimer{stats_.get(), StatsOperation::MassCancel, StatsStage::Encode};
+	response->set_cancelled(static_cast<std::uint32_t>(cancelled));
+
+	response->set_receive_timestamp(TscClock::ToEpochNanoseconds(receiveTime));
+	response->set_timestamp(TscClock::EpochNanoseconds());
+	return grpc::Status::OK;
+}
+
+grpc::Status TradingEngineServer::OpenSession(grpc::ServerContext *context, const trading::SessionRequest *request,
+											  grpc::ServerWriter<trading::SessionEvent> *writer) {
+	OpenStream stream{*this};
+	if (!stream.Admitted())
+		return TooManyStreams();
+
+	const auto clientId = request->client_id();
+	const bool cancelOnDisconnect = request->cancel_on_disconnect() && clientId != 0;
+
+	if (cancelOnDisconnect) {
+		std::scoped_lock sessionsLock{sessionsMutex_};
+		++cancelOnDisconnectSessions_[clientId];
+	}
+
+	trading::SessionEvent opened;
+	opened.set_timestamp(TscClock::EpochNanoseconds());
+	writer->Write(opened);
+
+	// The sync API has no disconnect callback, so the call's state is checked
+	// every SessionCheckInterval in between sleeping on shutdown
+	{
+		std::unique_lock shutdownLock{shutdownMutex_};
+		while (!shutdown_.load(std::memory_order_relaxed) && !context->IsCancelled())
+			shutdownConditionVariable_.wait_for(shutdownLock, SessionCheckInterval);
+	}
+
+	if (cancelOnDisconnect) {
+		bool lastSession;
+		{
+			std::scoped_lock sessionsLock{sessionsMutex_};
+			lastSession = --cancelOnDisconnectSessions_[clientId] == 0;
+			if (lastSession)
+				cancelOnDisconnectSessions_.erase(clientId);
+		}
+
+		// Another connection of the same client keeps its orders alive
+		if (lastSession) {
+			for (const auto &orderbook : instruments_->GetBooks())
+				Execute(orderbook, [&] { return orderbook->MassCancel(clientId); });
+		}
+	}
+
+	return grpc::Status::CANCELLED;
+}
+
+grpc::Status TradingEngineServer::StreamExecutions(grpc::ServerContext *context, const trading::ExecutionStreamRequest *request,
+												   grpc::ServerWriter<trading::ExecutionReport> *writer) {
+	OpenStream stream{*this};
+	if (!stream.Admitted())
+		return TooManyStreams();
+
+	auto sequence = request->from_sequence() != 0 ? request->from_sequence() : reports_->GetNextSequence();
+	if (sequence < reports_->GetOldestSequence())
+		return grpc::Status(grpc::StatusCode::OUT_OF_RANGE, "Oldest sequence held is " + std::to_string(reports_->GetOldestSequence()));
+
+	const auto clientId = request->client_id();
+	ExecutionReport report;
+	trading::ExecutionReport message;
+	// Publish wakes the handler for each report; the wait is bounded only so
+	// an idle stream notices its client going away
+	while (!context->IsCancelled() && !shutdown_.load(std::memory_order_acquire)) {
+		switch (reports_->Read(sequence, report)) {
+		case ExecutionReportRing::ReadResult::NotYet:
+			reports_->WaitFor(sequence, StreamIdleCheckInterval);
+			continue;
+		case ExecutionReportRing::ReadResult::Overwritten:
+			return grpc::Status(grpc::StatusCode::DATA_LOSS, "Fell behind; resume from sequence " + std::to_string(reports_->GetOldestSequence()));
+		case ExecutionReportRing::ReadResult::Read:
+			break;
+		}
+		++sequence;
+		if (clientId != 0 && report.clientId_ != clientId)
+			continue;
+
+		message.set_sequence(report.sequence_);
+		message.set_timestamp(TscClock::ToEpochNanoseconds(report.time_));
+		message.set_execution_type(EncodeExecutionType(report.type_));
+		message.set_instrument_id(report.instrumentId_);
+		message.set_order_id(report.orderId_);
+		message.set_client_id(report.clientId_);
+		message.set_side(report.side_ == Side::Buy ? trading::Side::BUY : trading::Side::SELL);
+		message.set_price(report.price_);
+		message.set_quantity(report.quantity_);
+		message.set_leaves_quantity(report.leavesQuantity_);
+		message.set_trade_id(report.tradeId_);
+		message.set_counterparty_order_id(report.counterpartyOrderId_);
+		message.set_counterparty_client_id(report.counterpartyClientId_);
+		message.set_aggressor(report.aggressor_);
+		if (!writer->Write(message))
+			break;
+	}
+	return grpc::Status::CANCELLED;
+}
+
+grpc::Status TradingEngineServer::GetTradeBars(grpc::ServerContext * /*context*/, const trading::TradeBarsRequest *request,
+											   trading::TradeBarsResponse *response) {
+	if (!tape_)
+		return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "No trade tape");
+	if (!instruments_->IsListed(request->instrument_id()))
+		return grpc::Status(grpc::StatusCode::NOT_FOUND, "Unknown instrument");
+	if (request->interval_ms() == 0)
+		return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "interval_ms must be positive");
+
+	// No tape yet means no trades yet
+	const auto tape = tape_->Find(request->instrument_id());
+	if (!tape)
+		return grpc::Status::OK;
+
+	const std::chrono::milliseconds interval{request->interval_ms()};
+	const auto to = request->to_timestamp() != 0 ? request->to_timestamp() : std::numeric_limits<std::int64_t>::max();
+	const auto bars = tape->GetBars(request->from_timestamp(), to, interval);
+	response->mutable_bars()->Reserve(static_cast<int>(bars.size()));
+	for (const auto &bar : bars)
+		EncodeTradeBar(bar, interval, response->add_bars());
+	for (const auto &[rollingInterval, bar] : tape->GetRollingBars())
+		EncodeTradeBar(bar, rollingInterval, response->add_rolling_bars());
+	return grpc::Status::OK;
+}
+
+grpc::Status TradingEngineServer::SetRiskLimits(grpc::ServerContext * /*context*/, const trading::RiskLimitsRequest *request,
+												trading::RiskLimitsResponse *response) {
+	RiskLimits limits;
+	limits.maxOrderQuantity_ = request->max_order_quantity();
+	limits.maxNotional_ = request->max_notional();
+	limits.maxOpenOrders_ = request->max_open_orders();
+	limits.maxPosition_ = request->max_position();
+	limits.priceBandBps_ = request->price_band_bps();
+
+	const auto orderbook = instruments_->GetOrCreate(request->instrument_id());
+	response->set_success(orderbook && Execute(orderbook, [&] { return orderbook->SetRiskLimits(request->client_id(), limits); }));
+	return grpc::Status::OK;
+}
 
-	const auto &bids = orderInfos.GetBids();
-	const auto &asks = orderInfos.GetAsks();
+grpc::Status TradingEngineServer::SetTradingPhase(grpc::ServerContext * /*context*/, const trading::TradingPhaseRequest *request,
+												  trading::TradingPhaseResponse *response) {
+	const auto orderbook = instruments_->GetOrCreate(request->instrument_id());
+	if (!orderbook)
+		return grpc::Status(grpc::StatusCode::NOT_FOUND, "Unknown instrument");
 
-	for (const auto &bid : bids) {
-		auto *bidInfo = response->add_bids();
-		bidInfo->set_price(bid.price_);
-		bidInfo->set_quantity(bid.quantity_);
+	switch (request->phase()) {
+	case trading::TradingPhase::AUCTION:
+		Execute(orderbook, [&] { orderbook->StartAuction(); });
+		break;
+	case trading::TradingPhase::FREQUENT_BATCH: {
+		const auto interval = request->batch_interval_us() != 0 ? std::chrono::microseconds{request->batch_interval_us()} : MinBatchInterval;
+		if (interval < MinBatchInterval || interval > MaxBatchInterval)
+			return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Batch interval out of range");
+		Execute(orderbook, [&] { orderbook->StartFrequentBatchAuctions(interval); });
+		break;
 	}
-	for (const auto &ask : asks) {
-		auto *askInfo = response->add_asks();
-		askInfo->set_price(ask.price_);
-		askInfo->set_quantity(ask.quantity_);
+	case trading::TradingPhase::CONTINUOUS: {
+		std::optional<Price> referencePrice;
+		if (request->reference_price() != 0)
+			referencePrice = request->reference_price();
+
+		const auto result = Execute(orderbook, [&] { return orderbook->Uncross(referencePrice); });
+		if (result.equilibrium_) {
+			response->set_uncross_price(result.equilibrium_->price_);
+			response->set_uncross_volume(result.equilibrium_->volume_);
+		}
+		EncodeTrades(result.trades_, response->mutable_trades());
+		break;
+	}
+	default:
+		return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Unknown trading phase");
 	}
+
+	response->set_phase(request->phase());
+	response->set_timestamp(TscClock::EpochNanoseconds());
 	return grpc::Status::OK;
 }
 
+grpc::Status TradingEngineServer::GetStats(grpc::ServerContext * /*context*/, const trading::StatsRequest * /*request*/,
+										   trading::StatsResponse *response) {
+	const auto snapshot = GetStatsSnapshot();
+
+	response->set_adds(snapshot.GetCounter(StatsCounter::Adds));
+	response->set_cancels(snapshot.GetCounter(StatsCounter::Cancels));
+	response->set_modifies(snapshot.GetCounter(StatsCounter::Modifies));
+	response->set_trades(snapshot.GetCounter(StatsCounter::Trades));
+	response->set_rejects(snapshot.GetCounter(StatsCounter::Rejects));
+	response->set_lock_wait_ns(snapshot.GetCounter(StatsCounter::LockWaitNanoseconds));
+	response->set_quotes(snapshot.GetCounter(StatsCounter::Quotes));
+	response->set_risk_rejects(snapshot.GetCounter(StatsCounter::RiskRejects));
+	response->set_throttled(snapshot.GetCounter(StatsCounter::Throttled));
+	response->set_shed(snapshot.GetCounter(StatsCounter::Shed));
+	response->set_resting_orders(snapshot.depth_.orders_);
+	response->set_bid_levels(snapshot.depth_.bidLevels_);
+	response->set_ask_levels(snapshot.depth_.askLevels_);
+
+	for (std::size_t region = 0; region < StatsSnapshot::RegionCount; ++region) {
+		const auto &totals = snapshot.GetPerf(static_cast<PerfRegion>(region));
+		if (totals.samples_ == 0)
+			continue;
+
+		auto *counters = response->add_perf_counters();
+		counters->set_region(ToString(static_cast<PerfRegion>(region)));
+		counters->set_samples(totals.samples_);
+		counters->set_cycles(totals.events_[static_cast<std::size_t>(PerfEvent::Cycles)]);
+		counters->set_instructions(totals.events_[static_cast<std::size_t>(PerfEvent::Instructions)]);
+		counters->set_l1d_misses(totals.events_[static_cast<std::size_t>(PerfEvent::L1DMisses)]);
+		counters->set_llc_misses(totals.events_[static_cast<std::size_t>(PerfEvent::LlcMisses)]);
+		counters->set_branch_misses(totals.events_[static_cast<std::size_t>(PerfEvent::BranchMisses)]);
+	}
+
+	for (std::size_t operation = 0; operation < StatsSnapshot::OperationCount; ++operation) {
+		for (std::size_t stage = 0; stage < StatsSnapshot::StageCount; ++stage) {
+			const auto &histogram = snapshot.GetLatency(static_cast<StatsOperation>(operation), static_cast<StatsStage>(stage));
+			if (histogram.GetTotalCount() == 0)
+				continue;
+
+			auto *latency = response->add_latencies();
+			latency->set_operation(ToString(static_cast<StatsOperation>(operation)));
+			latency->set_stage(ToString(static_cast<StatsStage>(stage)));
+			latency->set_count(histogram.GetTotalCount());
+			latency->set_p50_ns(histogram.GetValueAtPercentile(50.0));
+			latency->set_p90_ns(histogram.GetValueAtPercentile(90.0));
+			latency->set_p99_ns(histogram.GetValueAtPercentile(99.0));
+			latency->set_p999_ns(histogram.GetValueAtPercentile(99.9));
+			latency->set_max_ns(histogram.GetMax());
+			latency->set_mean_ns(histogram.GetMean());
+		}
+	}
+
+	return grpc::Status::OK;
+}
+
+std::string TradingEngineServer::EnableHardwareCounters() {
+	return stats_->EnableHardwareCounters();
+}
+
+void TradingEngineServer::Shutdown() {
+	{
+		std::scoped_lock shutdownLock{shutdownMutex_};
+		shutdown_.store(true, std::memory_order_release);
+	}
+	shutdownConditionVariable_.notify_all();
+}
+
+StatsSnapshot TradingEngineServer::GetStatsSnapshot() const {
+	auto snapshot = stats_->Snapshot();
+	for (const auto &orderbook : instruments_->GetBooks()) {
+		const auto depth = orderbook->GetDepth();
+		snapshot.depth_.orders_ += depth.orders_;
+		snapshot.depth_.bidLevels_ += depth.bidLevels_;
+		snapshot.depth_.askLevels_ += depth.askLevels_;
+	}
+	return snapshot;
+}
+
+grpc::Status TradingEngineServer::TooManyStreams() {
+	stats_->Increment(StatsCounter::Rejects);
+	return grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, std::to_string(maxStreams_) + " streams already open");
+}
+
+Admission TradingEngineServer::Admit(ClientId clientId, std::uint32_t orders) {
+	const auto admission = throttle_.Admit(clientId, orders);
+	if (admission != Admission::Admitted) {
+		stats_->Increment(StatsCounter::Rejects);
+		stats_->Increment(admission == Admission::Overloaded ? StatsCounter::Shed : StatsCounter::Throttled);
+	}
+	return admission;
+}
+
+void TradingEngineServer::EncodeTradeSummary(InstrumentId instrumentId, trading::OrderbookResponse *response) const {
+	const auto tape = tape_ ? tape_->Find(instrumentId) : nullptr;
+	if (!tape)
+		return;
+
+	const auto summary = tape->GetSummary();
+	response->set_last_trade_price(summary.lastPrice_);
+	response->set_last_trade_quantity(summary.lastQuantity_);
+	response->set_last_trade_timestamp(summary.lastTime_);
+	response->set_session_volume(summary.volume_);
+	response->set_session_turnover(summary.turnover_);
+	response->set_session_trades(summary.trades_);
+	response->set_vwap(summary.GetVwap());
+}
+
+void TradingEngineServer::EncodeTradeBar(const TradeBar &bar, std::chrono::milliseconds interval, trading::TradeBar *message) {
+	message->set_timestamp(bar.start_);
+	message->set_interval_ms(static_cast<std::uint32_t>(interval.count()));
+	message->set_open(bar.open_);
+	message->set_high(bar.high_);
+	message->set_low(bar.low_);
+	message->set_close(bar.close_);
+	message->set_volume(bar.volume_);
+	message->set_turnover(bar.turnover_);
+	message->set_trades(bar.trades_);
+	message->set_vwap(bar.GetVwap());
+}
+
+void TradingEngineServer::EncodeTrades(const Trades &trades, google::protobuf::RepeatedPtrField<trading::TradeInfo> *tradeInfos) {
+	// One allocation for the element array rather than one per doubling
+	tradeInfos->Reserve(tradeInfos->size() + static_cast<int>(2 * trades.size()));
+	for (const auto &trade : trades) {
+		const auto matchTime = TscClock::ToEpochNanoseconds(trade.GetMatchTime());
+
+		auto *bidTradeInfo = tradeInfos->Add();
+		bidTradeInfo->set_order_id(trade.GetBidTrade().orderId_);
+		bidTradeInfo->set_price(trade.GetBidTrade().price_);
+		bidTradeInfo->set_quantity(trade.GetBidTrade().quantity_);
+		bidTradeInfo->set_timestamp(matchTime);
+		bidTradeInfo->set_trade_id(trade.GetTradeId());
+		bidTradeInfo->set_aggressor(trade.GetAggressor() == Side::Buy);
+
+		auto *askTradeInfo = tradeInfos->Add();
+		askTradeInfo->set_order_id(trade.GetAskTrade().orderId_);
+		askTradeInfo->set_price(trade.GetAskTrade().price_);
+		askTradeInfo->set_quantity(trade.GetAskTrade().quantity_);
+		askTradeInfo->set_timestamp(matchTime);
+		askTradeInfo->set_trade_id(trade.GetTradeId());
+		askTradeInfo->set_aggressor(trade.GetAggressor() == Side::Sell);
+	}
+}
+
+trading::ExecutionType TradingEngineServer::EncodeExecutionType(ExecutionType type) {
+	switch (type) {
+	case ExecutionType::Fill:
+		return trading::ExecutionType::FILL;
+	case ExecutionType::Cancel:
+		return trading::ExecutionType::CANCEL;
+	case ExecutionType::Expire:
+		return trading::ExecutionType::EXPIRE;
+	case ExecutionType::Replace:
+		return trading::ExecutionType::REPLACE;
+	default:
+		return trading::ExecutionType::EXECUTION_TYPE_UNSPECIFIED;
+	}
+}
+
 OrderType TradingEngineServer::ParseOrderType(trading::OrderType type) {
 	switch (type) {
 	case trading::OrderType::MARKET:
@@ -119,6 +649,19 @@ OrderType TradingEngineServer::ParseOrderType(trading::OrderType type) {
 	}
 }
 
+PegType TradingEngineServer::ParsePegType(trading::PegType type) {
+	switch (type) {
+	case trading::PegType::PRIMARY_PEG:
+		return PegType::Primary;
+	case trading::PegType::MIDPOINT_PEG:
+		return PegType::Midpoint;
+	case trading::PegType::MARKET_PEG:
+		return PegType::Market;
+	default:
+		return PegType::None;
+	}
+}
+
 Side TradingEngineServer::ParseSide(::trading::Side side) {
 	switch (side) {
 	case trading::Side::BUY:
@@ -1,17 +1,130 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+
+#include "ExecutionReports.hpp"
+#include "InstrumentRegistry.hpp"
+#include "MatchingScheduler.hpp"
 #include "Orderbook.hpp"
+#include "Stats.hpp"
+#include "Throttle.hpp"
+#include "TradeTape.hpp"
+#include "TscClock.hpp"
 #include "trading_optimized.grpc.pb.h"
 
 class TradingEngineServer final : public trading::TradingEngine::Service {
   private:
-	std::shared_ptr<Orderbook> orderbook_;
+	std::shared_ptr<InstrumentRegistry> instruments_;
+	std::shared_ptr<MatchingScheduler> scheduler_;
+	std::shared_ptr<Stats> stats_;
+	std::shared_ptr<ExecutionReportRing> reports_;
+	std::shared_ptr<TradeTapeRecorder> tape_;
+	Throttle throttle_;
+	std::mutex sessionsMutex_;
+	std::unordered_map<ClientId, std::size_t> cancelOnDisconnectSessions_; // Open sessions per client
+	std::size_t maxStreams_{0};
+	std::atomic<std::size_t> openStreams_{0};
+	// Shutdown() wakes open sessions from their wait between call checks
+	std::mutex shutdownMutex_;
+	std::condition_variable shutdownConditionVariable_;
+	std::atomic<bool> shutdown_{false};
+
+	// Counts a streaming call open for its lifetime; admitted while no more
+	// than maxStreams_ are open.
+	class OpenStream {
+	  public:
+		explicit OpenStream(TradingEngineServer &server)
+			: count_{server.openStreams_},
+			  admitted_{count_.fetch_add(1, std::memory_order_relaxed) < server.maxStreams_ || server.maxStreams_ == 0} {}
+		OpenStream(const OpenStream &) = delete;
+		void operator=(const OpenStream &) = delete;
+		~OpenStream() { count_.fetch_sub(1, std::memory_order_relaxed); }
+
+		bool Admitted() const { return admitted_; }
+
+	  private:
+		std::atomic<std::size_t> &count_;
+		bool admitted_;
+	};
 
 	OrderType ParseOrderType(trading::OrderType type);
 	Side ParseSide(::trading::Side side);
+	PegType ParsePegType(trading::PegType type);
+	// Runs gateway admission and counts a refusal.
+	Admission Admit(ClientId clientId, std::uint32_t orders);
+	// Counts and returns the refusal of a stream over maxStreams_.
+	grpc::Status TooManyStreams();
+	// Runs a book operation on the scheduler if there is one, else on the calling thread.
+	template <typename Operation>
+	auto Execute(const std::shared_ptr<Orderbook> &orderbook, Operation &&operation) {
+		if (scheduler_)
+			return scheduler_->Run(orderbook, operation);
+		return operation();
+	}
+	static trading::ExecutionType EncodeExecutionType(ExecutionType type);
+	void EncodeTradeSummary(InstrumentId instrumentId, trading::OrderbookResponse *response) const;
+	static void EncodeTradeBar(const TradeBar &bar, std::chrono::milliseconds interval, trading::TradeBar *message);
+	static void EncodeTrades(const Trades &trades, google::protobuf::RepeatedPtrField<trading::TradeInfo> *tradeInfos);
 
   public:
-	TradingEngineServer(std::shared_ptr<Orderbook> orderbook) : orderbook_(std::move(orderbook)) {}
+	// How often an open session checks whether its client went away, and so
+	// how long after a disconnect cancel-on-disconnect can take to run
+	static constexpr std::chrono::milliseconds SessionCheckInterval{100};
+	// How long an idle execution stream waits for a report before checking
+	// whether its client went away
+	static constexpr std::chrono::milliseconds StreamIdleCheckInterval{50};
+	// Accepted frequent batch intervals; the minimum is also the default
+	static constexpr std::chrono::microseconds MinBatchInterval{1'000};
+	static constexpr std::chrono::microseconds MaxBatchInterval{100'000};
+
+	// Reject reason for requests naming an instrument that is not listed
+	static constexpr const char *UnknownInstrument = "unknown_instrument";
+
+	TradingEngineServer(std::shared_ptr<InstrumentRegistry> instruments)
+		: instruments_(std::move(instruments)), stats_(std::make_shared<Stats>()),
+		  reports_(std::make_shared<ExecutionReportRing>(ExecutionReportRing::DefaultCapacity)) {
+		instruments_->AttachStats(stats_);
+		instruments_->AttachExecutionReports(reports_);
+	}
+	// Serves a single book as the default instrument
+	TradingEngineServer(std::shared_ptr<Orderbook> orderbook)
+		: TradingEngineServer(std::make_shared<InstrumentRegistry>()) {
+		instruments_->List(InstrumentRegistry::DefaultInstrument, std::move(orderbook));
+	}
+
+	StatsSnapshot GetStatsSnapshot() const;
+	// Book operations run on scheduler's workers rather than the gRPC threads.
+	// Not thread-safe with respect to in-flight requests; set before serving.
+	void SetScheduler(std::shared_ptr<MatchingScheduler> scheduler) { scheduler_ = std::move(scheduler); }
+	// See Throttle::Configure()
+	void ConfigureThrottle(const ThrottleConfig &config) { throttle_.Configure(config); }
+	// OpenSession and StreamExecutions each hold a handler thread for as long
+	// as they are open. Past max open at once, further calls fail with
+	// RESOURCE_EXHAUSTED, so streams cannot take every thread under the gRPC
+	// thread cap and starve order entry. 0 is unlimited. Not thread-safe with
+	// respect to in-flight requests; set before serving.
+	void SetMaxStreams(std::size_t max) { maxStreams_ = max; }
+	// Every book's execution reports go to reports, which StreamExecutions
+	// reads. Not thread-safe with respect to in-flight requests; set before serving.
+	void AttachExecutionReports(std::shared_ptr<ExecutionReportRing> reports) {
+		reports_ = std::move(reports);
+		instruments_->AttachExecutionReports(reports_);
+	}
+	const std::shared_ptr<ExecutionReportRing> &GetExecutionReports() const { return reports_; }
+	// Trade statistics in GetOrderbook and GetTradeBars come from tape, which
+	// should record this server's execution reports. Not thread-safe with
+	// respect to in-flight requests; set before serving.
+	void SetTradeTape(std::shared_ptr<TradeTapeRecorder> tape) { tape_ = std::move(tape); }
+	// See Stats::EnableHardwareCounters()
+	std::string EnableHardwareCounters();
+	// Ends open sessions and execution streams without waiting out their
+	// check intervals. Call before grpc::Server::Shutdown(), which waits for
+	// them; no new ones should be opened after.
+	void Shutdown();
 
 	grpc::Status AddOrder(grpc::ServerContext *context, const trading::OrderRequest *request,
 						  trading::TradeResponse *response) override;
@@ -24,4 +137,34 @@ class TradingEngineServer final : public trading::TradingEngine::Service {
 
 	grpc::Status GetOrderbook(grpc::ServerContext *context, const trading::OrderbookRequest *request,
 							  trading::OrderbookResponse *response) override;
+
+	grpc::Status MassQuote(grpc::ServerContext *context, const trading::MassQuoteRequest *request,
+						   trading::MassQuoteResponse *response) override;
+
+	grpc::Status MassCancel(grpc::ServerContext *context, const trading::MassCancelRequest *request,
+							trading::MassCancelResponse *response) override;
+
+	// Blocks its handler thread until the client disconnects, which is
+	// noticed within SessionCheckInterval, or Shutdown(). Counts against
+	// SetMaxStreams().
+	grpc::Status OpenSession(grpc::ServerContext *context, const trading::SessionRequest *request,
+							 grpc::ServerWriter<trading::SessionEvent> *writer) override;
+
+	// Drop copy: blocks its handler thread, woken to write each report as it
+	// is published, until the client goes away. Counts against
+	// SetMaxStreams().
+	grpc::Status StreamExecutions(grpc::ServerContext *context, const trading::ExecutionStreamRequest *request,
+								  grpc::ServerWriter<trading::ExecutionReport> *writer) override;
+
+	grpc::Status GetTradeBars(grpc::ServerContext *context, const trading::TradeBarsRequest *request,
+							  trading::TradeBarsResponse *response) override;
+
+	grpc::Status SetRiskLimits(grpc::ServerContext *context, const trading::RiskLimitsRequest *request,
+							   trading::RiskLimitsResponse *response) override;
+
+	grpc::Status SetTradingPhase(grpc::ServerContext *context, const trading::TradingPhaseRequest *request,
+								 trading::TradingPhaseResponse *response) override;
+
+	grpc::Status GetStats(grpc::ServerContext *context, const trading::StatsRequest *request,
+						  trading::StatsResponse *response) override;
 };
\ No newline at end of file
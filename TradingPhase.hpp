@@ -0,0 +1,8 @@
+#pragma once
+
+enum class TradingPhase
+{
+	Continuous,    // Orders match on arrival
+	Auction,       // Orders rest without matching until the book is uncrossed
+	FrequentBatch, // As Auction, with the book uncrossed every batch interval
+};
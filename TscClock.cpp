@@ -0,0 +1,225 @@
+#include "TscClock.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace {
+
+struct Sample {
+	Timestamp ticks_{};
+	std::int64_t nanoseconds_{};
+};
+
+// Conversion parameters, published with a sequence lock so readers on the
+// hot path never block on a concurrent Calibrate(). Epoch conversions use the
+// measured rate plus any slew; durations use the measured rate alone.
+std::atomic<std::uint64_t> sequence{0};
+std::atomic<Timestamp> anchorTicks{0};
+std::atomic<std::int64_t> anchorNanoseconds{0};
+std::atomic<double> epochNanosecondsPerTick{1.0};
+std::atomic<double> nanosecondsPerTick{1.0};
+
+std::mutex calibrationMutex;
+Sample origin;
+bool hasOrigin = false;
+
+// Largest relative change in the tick rate accepted from one calibration; a
+// bigger jump means the wall clock was stepped, so the baseline restarts.
+constexpr double MaxRateChange = 0.001;
+// Offsets from the wall clock are slewed away over about this long.
+constexpr double SlewNanoseconds = 1'000'000'000.0;
+
+std::int64_t RealtimeNanoseconds() {
+	timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	return static_cast<std::int64_t>(now.tv_sec) * 1'000'000'000 + now.tv_nsec;
+}
+
+// Pairs a tick reading with a wall-clock reading, keeping the tightest of a
+// few brackets so a preemption between the two reads does not skew the pair.
+Sample TakeSample() {
+	Sample best;
+	auto bestWidth = std::numeric_limits<Timestamp>::max();
+
+	for (int attempt = 0; attempt < 8; ++attempt) {
+		const auto before = TscClock::Now();
+		const auto nanoseconds = RealtimeNanoseconds();
+		const auto after = TscClock::Now();
+
+		if (after - before < bestWidth) {
+			bestWidth = after - before;
+			best = Sample{before + (after - before) / 2, nanoseconds};
+		}
+	}
+
+	return best;
+}
+
+std::int64_t Convert(Timestamp ticks, Timestamp baseTicks, std::int64_t baseNanoseconds, double rate) {
+	// Signed so ticks taken before the latest anchor convert correctly
+	const auto elapsed = static_cast<std::int64_t>(ticks - baseTicks);
+	return baseNanoseconds + std::llround(static_cast<double>(elapsed) * rate);
+}
+
+void Publish(const Sample &anchor, double epochRate, double rate) {
+	const auto current = sequence.load(std::memory_order_relaxed);
+	sequence.store(current + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	anchorTicks.store(anchor.ticks_, std::memory_order_relaxed);
+	anchorNanoseconds.store(anchor.nanoseconds_, std::memory_order_relaxed);
+	epochNanosecondsPerTick.store(epochRate, std::memory_order_relaxed);
+	nanosecondsPerTick.store(rate, std::memory_order_relaxed);
+
+	sequence.store(current + 2, std::memory_order_release);
+}
+
+// Publishes a new rate, anchored where the current parameters put the
+// sample's ticks so conversions do not step, and slews towards the sample's
+// wall-clock time. The caller holds calibrationMutex.
+void Republish(const Sample &now, double rate) {
+	const auto continued = Convert(now.ticks_, anchorTicks.load(std::memory_order_relaxed), anchorNanoseconds.load(std::memory_order_relaxed),
+	                               epochNanosecondsPerTick.load(std::memory_order_relaxed));
+	const auto offset = now.nanoseconds_ - continued;
+	if (std::llabs(offset) > TscClock::MaxOffset) {
+		Publish(now, rate, rate);
+		return;
+	}
+
+	const auto slew = std::clamp(static_cast<double>(offset) / SlewNanoseconds, -TscClock::MaxSlew, TscClock::MaxSlew);
+	Publish(Sample{now.ticks_, continued}, rate * (1.0 + slew), rate);
+}
+
+} // namespace
+
+bool TscClock::HasInvariantTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned eax, ebx, ecx, edx;
+	if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+		return false;
+
+	__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+	return (edx & (1u << 8)) != 0;
+#else
+	return false;
+#endif
+}
+
+void TscClock::EnsureCalibrated() {
+	static std::once_flag calibrated;
+	std::call_once(calibrated, [] {
+		// TscCalibrator or an explicit Calibrate() may already have published a rate
+		if (sequence.load(std::memory_order_acquire) == 0)
+			Calibrate();
+	});
+}
+
+Timestamp TscClock::FallbackNow() {
+	return static_cast<Timestamp>(RealtimeNanoseconds());
+}
+
+std::int64_t TscClock::ToEpochNanoseconds(Timestamp ticks) {
+	if (!UsesTsc())
+		return static_cast<std::int64_t>(ticks);
+	EnsureCalibrated();
+
+	Timestamp baseTicks;
+	std::int64_t baseNanoseconds;
+	double rate;
+	std::uint64_t before;
+
+	do {
+		before = sequence.load(std::memory_order_acquire);
+		baseTicks = anchorTicks.load(std::memory_order_relaxed);
+		baseNanoseconds = anchorNanoseconds.load(std::memory_order_relaxed);
+		rate = epochNanosecondsPerTick.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((before & 1) != 0 || before != sequence.load(std::memory_order_relaxed));
+
+	return Convert(ticks, baseTicks, baseNanoseconds, rate);
+}
+
+std::int64_t TscClock::ToNanoseconds(Timestamp elapsedTicks) {
+	if (!UsesTsc())
+		return static_cast<std::int64_t>(elapsedTicks);
+	EnsureCalibrated();
+
+	return std::llround(static_cast<double>(elapsedTicks) * nanosecondsPerTick.load(std::memory_order_relaxed));
+}
+
+double TscClock::NanosecondsPerTick() {
+	if (UsesTsc())
+		EnsureCalibrated();
+	return nanosecondsPerTick.load(std::memory_order_relaxed);
+}
+
+void TscClock::Calibrate() {
+	if (!UsesTsc())
+		return;
+
+	std::scoped_lock calibrationLock{calibrationMutex};
+
+	if (!hasOrigin) {
+		origin = TakeSample();
+		hasOrigin = true;
+
+		// Spin rather than sleep, which could overshoot by a scheduler tick;
+		// 10ms is enough for a rate within a few ppm to start with.
+		const auto deadline = RealtimeNanoseconds() + 10'000'000;
+		while (RealtimeNanoseconds() < deadline) {
+		}
+	}
+
+	const auto now = TakeSample();
+	const auto published = sequence.load(std::memory_order_relaxed) != 0;
+	const auto previous = nanosecondsPerTick.load(std::memory_order_relaxed);
+	if (now.ticks_ <= origin.ticks_ || now.nanoseconds_ <= origin.nanoseconds_) {
+		// Wall clock stepped back past the origin: measure afresh from here
+		origin = now;
+		if (published)
+			Republish(now, previous);
+		return;
+	}
+
+	const auto rate = static_cast<double>(now.nanoseconds_ - origin.nanoseconds_) / static_cast<double>(now.ticks_ - origin.ticks_);
+	if (!published) {
+		Publish(now, rate, rate);
+		return;
+	}
+
+	if (std::abs(rate - previous) > previous * MaxRateChange) {
+		// Wall clock stepped: keep the old rate and measure afresh from here
+		origin = now;
+		Republish(now, previous);
+		return;
+	}
+
+	Republish(now, rate);
+}
+
+TscCalibrator::TscCalibrator(std::chrono::milliseconds interval)
+	: interval_{interval}, thread_{[this] {
+		  std::unique_lock lock{mutex_};
+		  while (!shutdownConditionVariable_.wait_for(lock, interval_, [this] { return shutdown_; })) {
+			  lock.unlock();
+			  TscClock::Calibrate();
+			  lock.lock();
+		  }
+	  }} {
+	TscClock::Calibrate();
+}
+
+TscCalibrator::~TscCalibrator() {
+	{
+		std::scoped_lock lock{mutex_};
+		shutdown_ = true;
+	}
+	shutdownConditionVariable_.notify_one();
+	thread_.join();
+}
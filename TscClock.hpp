@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "Usings.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Event clock backed by the invariant TSC. Now() is a single rdtsc; ticks are
+// converted to wall-clock nanoseconds only when a timestamp leaves the engine.
+// The TSC is detected on the first Now(). The first Calibrate() measures the
+// tick rate against CLOCK_REALTIME, spinning for 10ms, so servers call it at
+// startup (TscCalibrator does); a conversion before then calibrates itself.
+// Later calls refine the rate and slew conversions back onto the wall clock
+// without stepping them. Without an invariant TSC (or off x86) ticks are
+// CLOCK_REALTIME nanoseconds and the conversion is the identity.
+class TscClock {
+  public:
+	static Timestamp Now() {
+#if defined(__x86_64__) || defined(__i386__)
+		if (UsesTsc()) [[likely]]
+			return __rdtsc();
+#endif
+		return FallbackNow();
+	}
+
+	// Wall-clock nanoseconds since the Unix epoch for a tick value from Now().
+	static std::int64_t ToEpochNanoseconds(Timestamp ticks);
+	// Nanoseconds spanned by a tick interval.
+	static std::int64_t ToNanoseconds(Timestamp elapsedTicks);
+	static std::int64_t EpochNanoseconds() { return ToEpochNanoseconds(Now()); }
+
+	// Takes a fresh (tick, wall-clock) sample and refines the tick rate over
+	// the interval since the first calibration. Conversions continue from the
+	// value they had at the sample, gaining or losing at most MaxSlew until
+	// they meet the wall clock again; only an offset beyond MaxOffset (the
+	// wall clock was stepped) makes them jump.
+	static void Calibrate();
+
+	static constexpr double MaxSlew = 0.0005;
+	static constexpr std::int64_t MaxOffset = 100'000'000;
+
+	static bool UsesTsc() {
+		static const bool useTsc = HasInvariantTsc();
+		return useTsc;
+	}
+	static double NanosecondsPerTick();
+
+  private:
+	static bool HasInvariantTsc();
+	static Timestamp FallbackNow();
+	// Runs the initial calibration unless it has already run; only processes
+	// that convert before calling Calibrate() pay for it there.
+	static void EnsureCalibrated();
+};
+
+// Calibrates TscClock on construction, so the first timestamped request does
+// not pay for it, then periodically so conversions track the wall clock.
+class TscCalibrator {
+  public:
+	explicit TscCalibrator(std::chrono::milliseconds interval);
+	TscCalibrator(const TscCalibrator &) = delete;
+	void operator=(const TscCalibrator &) = delete;
+	~TscCalibrator();
+
+  private:
+	std::chrono::milliseconds interval_;
+	std::mutex mutex_;
+	std::condition_variable shutdownConditionVariable_;
+	bool shutdown_{false};
+	std::thread thread_; // Declared last: started in the constructor
+};
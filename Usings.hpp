@@ -7,3 +7,8 @@ using Price = std::int32_t;
 using Quantity = std::uint32_t;
 using OrderId = std::uint64_t;
 using OrderIds = std::vector<OrderId>;
+using Timestamp = std::uint64_t; // TscClock ticks
+using ClientId = std::uint32_t;
+using QuoteSetId = std::uint32_t;
+using InstrumentId = std::uint32_t;
+using TradeId = std::uint64_t; // Unique across books for the life of the process
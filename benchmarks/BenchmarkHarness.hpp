@@ -0,0 +1,368 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace bench {
+
+struct Options {
+	std::string baselinePath;
+	std::string outputPath;
+	int cpu{-1};
+	std::size_t warmup{20000};
+	std::size_t iterations{200000};
+	std::size_t repetitions{3};
+	double medianTolerancePct{-1.0}; // < 0: use the baseline's value
+	double p99TolerancePct{-1.0};
+	bool updateBaseline{false};
+
+	static Options Parse(int argc, char **argv) {
+		Options options;
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			auto next = [&]() -> std::string {
+				if (i + 1 >= argc)
+					throw std::invalid_argument("Missing value for " + arg);
+				return argv[++i];
+			};
+
+			if (arg == "--baseline")
+				options.baselinePath = next();
+			else if (arg == "--output")
+				options.outputPath = next();
+			else if (arg == "--cpu")
+				options.cpu = std::stoi(next());
+			else if (arg == "--warmup")
+				options.warmup = std::stoul(next());
+			else if (arg == "--iterations")
+				options.iterations = std::stoul(next());
+			else if (arg == "--repetitions")
+				options.repetitions = std::max<std::size_t>(1, std::stoul(next()));
+			else if (arg == "--median-tolerance")
+				options.medianTolerancePct = std::stod(next());
+			else if (arg == "--p99-tolerance")
+				options.p99TolerancePct = std::stod(next());
+			else if (arg == "--update-baseline")
+				options.updateBaseline = true;
+			else
+				throw std::invalid_argument("Unknown argument: " + arg);
+		}
+		return options;
+	}
+};
+
+struct Result {
+	std::uint64_t medianNs{};
+	std::uint64_t p99Ns{};
+};
+
+using Results = std::map<std::string, Result>;
+
+struct Baseline {
+	int version{};
+	double medianTolerancePct{25.0};
+	double p99TolerancePct{50.0};
+	Results results;
+};
+
+inline void PinToCpu(int cpu) {
+	if (cpu < 0)
+		return;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+		std::cerr << "warning: could not pin to CPU " << cpu << ", running unpinned" << std::endl;
+}
+
+// Samples are taken per operation; `setup` runs untimed before every `op`.
+// Each repetition is summarized separately and the best one is kept, which
+// filters out interference from the rest of the machine.
+inline Result Measure(const Options &options, const std::function<void()> &setup, const std::function<void()> &op) {
+	using clock = std::chrono::steady_clock;
+
+	for (std::size_t i = 0; i < options.warmup; ++i) {
+		setup();
+		op();
+	}
+
+	std::vector<std::uint64_t> samples;
+	samples.reserve(options.iterations);
+
+	auto percentile = [&samples](double p) {
+		const auto index = static_cast<std::size_t>(p * (samples.size() - 1));
+		std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+		return samples[index];
+	};
+
+	Result best{UINT64_MAX, UINT64_MAX};
+	for (std::size_t repetition = 0; repetition < options.repetitions; ++repetition) {
+		samples.clear();
+		for (std::size_t i = 0; i < options.iterations; ++i) {
+			setup();
+			const auto start = clock::now();
+			op();
+			const auto end = clock::now();
+			samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+		}
+
+		best.medianNs = std::min(best.medianNs, percentile(0.50));
+		best.p99Ns = std::min(best.p99Ns, percentile(0.99));
+	}
+
+	return best;
+}
+
+// Minimal reader for the flat baseline format written by WriteJson below.
+class JsonReader {
+  public:
+	explicit JsonReader(std::string text) : text_{std::move(text)} {}
+
+	Baseline ReadBaseline() {
+		Baseline baseline;
+		Expect('{');
+		while (!Consume('}')) {
+			const auto key = ReadString();
+			Expect(':');
+			if (key == "version")
+				baseline.version = static_cast<int>(ReadNumber());
+			else if (key == "median_tolerance_pct")
+				baseline.medianTolerancePct = ReadNumber();
+			else if (key == "p99_tolerance_pct")
+				baseline.p99TolerancePct = ReadNumber();
+			else if (key == "results")
+				baseline.results = ReadResults();
+			else
+				SkipValue();
+			Consume(',');
+		}
+		return baseline;
+	}
+
+  private:
+	std::string text_;
+	std::size_t pos_{0};
+
+	void SkipWhitespace() {
+		while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_])))
+			++pos_;
+	}
+
+	bool Consume(char c) {
+		SkipWhitespace();
+		if (pos_ < text_.size() && text_[pos_] == c) {
+			++pos_;
+			return true;
+		}
+		return false;
+	}
+
+	void Expect(char c) {
+		if (!Consume(c))
+			throw std::runtime_error(std::string("Malformed baseline JSON: expected '") + c + "' at offset " + std::to_string(pos_));
+	}
+
+	std::string ReadString() {
+		Expect('"');
+		const auto end = text_.find('"', pos_);
+		if (end == std::string::npos)
+			throw std::runtime_error("Malformed baseline JSON: unterminated string");
+		auto value = text_.substr(pos_, end - pos_);
+		pos_ = end + 1;
+		return value;
+	}
+
+	double ReadNumber() {
+		SkipWhitespace();
+		std::size_t consumed = 0;
+		const double value = std::stod(text_.substr(pos_, 32), &consumed);
+		pos_ += consumed;
+		return value;
+	}
+
+	void SkipValue() {
+		SkipWhitespace();
+		if (text_[pos_] == '"') {
+			ReadString();
+		} else if (text_[pos_] == '{') {
+			int depth = 0;
+			do {
+				if (text_[pos_] == '{')
+					++depth;
+				else if (text_[pos_] == '}')
+					--depth;
+				++pos_;
+			} while (depth > 0 && pos_ < text_.size());
+		} else {
+			ReadNumber();
+		}
+	}
+
+	Results ReadResults() {
+		Results results;
+		Expect('{');
+		while (!Consume('}')) {
+			const auto name = ReadString();
+			Expect(':');
+			Expect('{');
+			Result result;
+			while (!Consume('}')) {
+				const auto key = ReadString();
+				Expect(':');
+				const auto value = static_cast<std::uint64_t>(ReadNumber());
+				if (key == "median_ns")
+					result.medianNs = value;
+				else if (key == "p99_ns")
+					result.p99Ns = value;
+				Consume(',');
+			}
+			results[name] = result;
+			Consume(',');
+		}
+		return results;
+	}
+};
+
+inline Baseline LoadBaseline(const std::string &path) {
+	std::ifstream file(path);
+	if (!file)
+		throw std::runtime_error("Cannot open baseline " + path);
+
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	return JsonReader{buffer.str()}.ReadBaseline();
+}
+
+inline void WriteJson(const std::string &path, const Baseline &baseline) {
+	std::ofstream file(path);
+	if (!file)
+		throw std::runtime_error("Cannot write " + path);
+
+	file << "{\n"
+		 << "  \"version\": " << baseline.version << ",\n"
+		 << "  \"median_tolerance_pct\": " << baseline.medianTolerancePct << ",\n"
+		 << "  \"p99_tolerance_pct\": " << baseline.p99TolerancePct << ",\n"
+		 << "  \"results\": {\n";
+
+	std::size_t i = 0;
+	for (const auto &[name, result] : baseline.results) {
+		file << "    \"" << name << "\": { \"median_ns\": " << result.medianNs << ", \"p99_ns\": " << result.p99Ns << " }"
+			 << (++i < baseline.results.size() ? ",\n" : "\n");
+	}
+	file << "  }\n}\n";
+}
+
+// Prints one row per metric and returns false if any metric exceeds its tolerance.
+// Baseline entries for skipped benchmarks, which this machine cannot run, are
+// reported but do not fail the comparison.
+inline bool Compare(const Baseline &baseline, const Results &current, const std::set<std::string> &skipped, double medianTolerancePct,
+					double p99TolerancePct) {
+	bool ok = true;
+
+	std::printf("%-32s %-7s %12s %12s %9s %9s  %s\n", "benchmark", "metric", "baseline", "current", "delta", "limit", "status");
+	auto row = [&](const std::string &name, const char *metric, std::uint64_t expected, std::uint64_t actual, double tolerance) {
+		const double delta = expected == 0 ? 0.0 : 100.0 * (static_cast<double>(actual) - expected) / expected;
+		const bool regressed = delta > tolerance;
+		ok = ok && !regressed;
+		std::printf("%-32s %-7s %10llu ns %10llu ns %+8.1f%% %+8.1f%%  %s\n", name.c_str(), metric,
+					static_cast<unsigned long long>(expected), static_cast<unsigned long long>(actual), delta, tolerance,
+					regressed ? "REGRESSED" : "ok");
+	};
+
+	for (const auto &[name, result] : current) {
+		auto it = baseline.results.find(name);
+		if (it == baseline.results.end()) {
+			std::printf("%-32s %-7s %12s %10llu ns %9s %9s  %s\n", name.c_str(), "median", "-",
+						static_cast<unsigned long long>(result.medianNs), "-", "-", "new (no baseline)");
+			continue;
+		}
+		row(name, "median", it->second.medianNs, result.medianNs, medianTolerancePct);
+		row(name, "p99", it->second.p99Ns, result.p99Ns, p99TolerancePct);
+	}
+
+	for (const auto &[name, _] : baseline.results) {
+		if (skipped.count(name) != 0) {
+			std::printf("%-32s skipped on this machine\n", name.c_str());
+		} else if (current.find(name) == current.end()) {
+			std::printf("%-32s missing from current run\n", name.c_str());
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+// Shared driver: runs the registered benchmarks, optionally writes results,
+// and gates against the baseline. Returns the process exit code.
+class Suite {
+  public:
+	Suite(std::string name, int argc, char **argv) : name_{std::move(name)}, options_{Options::Parse(argc, argv)} {
+		PinToCpu(options_.cpu);
+	}
+
+	const Options &GetOptions() const { return options_; }
+
+	void Run(const std::string &name, const std::function<void()> &setup, const std::function<void()> &op) {
+		results_[name] = Measure(options_, setup, op);
+		std::cerr << name_ << "/" << name << ": median " << results_[name].medianNs << " ns, p99 " << results_[name].p99Ns << " ns" << std::endl;
+	}
+
+	// Records that name does not run on this machine, keeping its baseline.
+	void Skip(const std::string &name, const char *reason) {
+		skipped_.insert(name);
+		std::cerr << name_ << "/" << name << ": skipped, " << reason << std::endl;
+	}
+
+	int Finish() {
+		Baseline baseline;
+		if (!options_.baselinePath.empty() && (!options_.updateBaseline || std::ifstream{options_.baselinePath}))
+			baseline = LoadBaseline(options_.baselinePath);
+
+		if (!options_.outputPath.empty() || options_.updateBaseline) {
+			Baseline output = baseline;
+			output.version += options_.updateBaseline ? 1 : 0;
+			output.results = results_;
+			for (const auto &name : skipped_) {
+				if (auto it = baseline.results.find(name); it != baseline.results.end())
+					output.results.insert(*it);
+			}
+			WriteJson(options_.updateBaseline ? options_.baselinePath : options_.outputPath, output);
+		}
+
+		if (options_.baselinePath.empty() || options_.updateBaseline)
+			return EXIT_SUCCESS;
+
+		const double medianTolerance = options_.medianTolerancePct >= 0 ? options_.medianTolerancePct : baseline.medianTolerancePct;
+		const double p99Tolerance = options_.p99TolerancePct >= 0 ? options_.p99TolerancePct : baseline.p99TolerancePct;
+
+		std::printf("%s vs baseline v%d (%s)\n", name_.c_str(), baseline.version, options_.baselinePath.c_str());
+		const bool ok = Compare(baseline, results_, skipped_, medianTolerance, p99Tolerance);
+		std::printf("%s\n", ok ? "PASS" : "FAIL: performance regression against stored baseline");
+		return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+  private:
+	std::string name_;
+	Options options_;
+	Results results_;
+	std::set<std::string> skipped_;
+};
+
+} // namespace bench
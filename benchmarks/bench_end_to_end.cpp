@@ -0,0 +1,99 @@
+#include "BenchmarkHarness.hpp"
+
+#include "Orderbook.hpp"
+#include "TradingEngineServer.hpp"
+
+#include <grpcpp/grpcpp.h>
+
+#include <memory>
+
+namespace {
+
+constexpr int MidPrice = 10000;
+
+trading::OrderRequest MakeRequest(std::uint64_t orderId, trading::Side side, int price, unsigned quantity) {
+	trading::OrderRequest request;
+	request.set_order_id(orderId);
+	request.set_side(side);
+	request.set_price(price);
+	request.set_quantity(quantity);
+	request.set_order_type(trading::GOOD_TILL_CANCEL);
+	return request;
+}
+
+} // namespace
+
+// Drives a real in-process gRPC server over loopback so the numbers include
+// (de)serialization, the transport and the handler, not just the book.
+int main(int argc, char **argv) {
+	bench::Suite suite("end_to_end", argc, argv);
+
+	auto orderbook = std::make_shared<Orderbook>();
+	TradingEngineServer service(orderbook);
+
+	int port = 0;
+	grpc::ServerBuilder builder;
+	builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+	builder.RegisterService(&service);
+	auto server = builder.BuildAndStart();
+	if (!server || port == 0) {
+		std::cerr << "Failed to start benchmark server." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	auto stub = trading::TradingEngine::NewStub(
+		grpc::CreateChannel("127.0.0.1:" + std::to_string(port), grpc::InsecureChannelCredentials()));
+
+	std::uint64_t nextOrderId = 1;
+	for (int level = 1; level <= 20; ++level) {
+		trading::TradeResponse response;
+		grpc::ClientContext bidContext, askContext;
+		stub->AddOrder(&bidContext, MakeRequest(nextOrderId++, trading::BUY, MidPrice - 100 - level, 100), &response);
+		stub->AddOrder(&askContext, MakeRequest(nextOrderId++, trading::SELL, MidPrice + 100 + level, 100), &response);
+	}
+
+	std::uint64_t pending = 0;
+	auto cancelPending = [&] {
+		if (pending != 0)
+			orderbook->CancelOrder(pending);
+		pending = 0;
+	};
+
+	suite.Run("add_order_rpc", cancelPending, [&] {
+		pending = nextOrderId++;
+		grpc::ClientContext context;
+		trading::TradeResponse response;
+		stub->AddOrder(&context, MakeRequest(pending, trading::BUY, MidPrice - 1, 100), &response);
+	});
+	cancelPending();
+
+	suite.Run("add_order_match_rpc", [&] {
+		orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, nextOrderId++, Side::Sell, MidPrice, 100));
+	}, [&] {
+		grpc::ClientContext context;
+		trading::TradeResponse response;
+		stub->AddOrder(&context, MakeRequest(nextOrderId++, trading::BUY, MidPrice, 100), &response);
+	});
+
+	suite.Run("cancel_order_rpc", [&] {
+		pending = nextOrderId++;
+		orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, pending, Side::Sell, MidPrice + 1, 100));
+	}, [&] {
+		grpc::ClientContext context;
+		trading::CancelOrderRequest request;
+		trading::CancelOrderResponse response;
+		request.set_order_id(pending);
+		stub->CancelOrder(&context, request, &response);
+		pending = 0;
+	});
+
+	suite.Run("get_orderbook_rpc", [] {}, [&] {
+		grpc::ClientContext context;
+		trading::OrderbookRequest request;
+		trading::OrderbookResponse response;
+		stub->GetOrderbook(&context, request, &response);
+	});
+
+	server->Shutdown();
+	return suite.Finish();
+}
@@ -0,0 +1,116 @@
+#include "BenchmarkHarness.hpp"
+
+#include "MatchingScheduler.hpp"
+#include "Order.hpp"
+#include "OrderModify.hpp"
+#include "Orderbook.hpp"
+
+#include <memory>
+#include <thread>
+
+namespace {
+
+constexpr Price MidPrice = 10000;
+constexpr int RestingLevels = 50;
+constexpr int OrdersPerLevel = 10;
+
+OrderPointer MakeOrder(OrderId orderId, Side side, Price price, Quantity quantity, OrderType type = OrderType::GoodTillCancel) {
+	return std::make_shared<Order>(type, orderId, side, price, quantity);
+}
+
+// Background depth on both sides so the book is not trivially empty.
+void Populate(Orderbook &orderbook, OrderId &nextOrderId) {
+	for (int level = 1; level <= RestingLevels; ++level) {
+		for (int i = 0; i < OrdersPerLevel; ++i) {
+			orderbook.AddOrder(MakeOrder(nextOrderId++, Side::Buy, MidPrice - 100 - level, 100));
+			orderbook.AddOrder(MakeOrder(nextOrderId++, Side::Sell, MidPrice + 100 + level, 100));
+		}
+	}
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	bench::Suite suite("orderbook", argc, argv);
+
+	Orderbook orderbook;
+	OrderId nextOrderId = 1;
+	Populate(orderbook, nextOrderId);
+
+	OrderId pending = 0;
+	auto cancelPending = [&] {
+		if (pending != 0)
+			orderbook.CancelOrder(pending);
+		pending = 0;
+	};
+
+	suite.Run("add_resting", cancelPending, [&] {
+		pending = nextOrderId++;
+		orderbook.AddOrder(MakeOrder(pending, Side::Buy, MidPrice - 1 - static_cast<Price>(pending % 64), 100));
+	});
+	cancelPending();
+
+	suite.Run("add_match_one", [&] { orderbook.AddOrder(MakeOrder(nextOrderId++, Side::Sell, MidPrice, 100)); }, [&] {
+		orderbook.AddOrder(MakeOrder(nextOrderId++, Side::Buy, MidPrice, 100));
+	});
+
+	suite.Run("sweep_level_10_orders", [&] {
+		for (int i = 0; i < 10; ++i)
+			orderbook.AddOrder(MakeOrder(nextOrderId++, Side::Sell, MidPrice, 10));
+	}, [&] {
+		orderbook.AddOrder(MakeOrder(nextOrderId++, Side::Buy, MidPrice, 100));
+	});
+
+	// A separate book so the policy does not change the other cases
+	Orderbook proRataBook;
+	proRataBook.SetMatchingPolicy(MatchingPolicy{MatchingAlgorithm::ProRata});
+	suite.Run("pro_rata_level_10_orders", [&] {
+		for (int i = 0; i < 10; ++i)
+			proRataBook.AddOrder(MakeOrder(nextOrderId++, Side::Sell, MidPrice, 10 + i));
+	}, [&] {
+		// Half the level pro rata, then the rest
+		proRataBook.AddOrder(MakeOrder(nextOrderId++, Side::Buy, MidPrice, 72));
+		proRataBook.AddOrder(MakeOrder(nextOrderId++, Side::Buy, MidPrice, 73));
+	});
+
+	suite.Run("cancel", [&] {
+		pending = nextOrderId++;
+		orderbook.AddOrder(MakeOrder(pending, Side::Sell, MidPrice + 1 + static_cast<Price>(pending % 64), 100));
+	}, [&] {
+		orderbook.CancelOrder(pending);
+		pending = 0;
+	});
+
+	suite.Run("modify", [&] {
+		cancelPending();
+		pending = nextOrderId++;
+		orderbook.AddOrder(MakeOrder(pending, Side::Buy, MidPrice - 10, 100));
+	}, [&] {
+		orderbook.ModifyOrder(OrderModify{pending, Side::Buy, MidPrice - 20, 50});
+	});
+	cancelPending();
+
+	suite.Run("snapshot_100_levels", [] {}, [&] {
+		auto infos = orderbook.GetOrderInfos();
+		if (infos.GetBids().empty())
+			std::abort();
+	});
+
+	// Caller-to-worker-and-back handoff of a trivial book operation, parking
+	// between requests and, given a core each to spin on, polling
+	auto scheduled = std::make_shared<Orderbook>();
+	auto roundTrip = [&](const char *name, WaitPolicy policy) {
+		MatchingScheduler scheduler(1, {}, policy, policy);
+		suite.Run(name, [] {}, [&] {
+			if (scheduler.Run(scheduled, [&] { return scheduled->Size(); }) != 0)
+				std::abort();
+		});
+	};
+	roundTrip("scheduler_round_trip_park", WaitPolicy::Park());
+	if (std::thread::hardware_concurrency() > 2)
+		roundTrip("scheduler_round_trip_poll", WaitPolicy::Poll());
+	else
+		suite.Skip("scheduler_round_trip_poll", "polling needs a core each for the caller and the worker");
+
+	return suite.Finish();
+}
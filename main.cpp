@@ -1,21 +1,116 @@
-#include "Orderbook.hpp"
+#include "Config.hpp"
+#include "InstrumentRegistry.hpp"
+#include "Logging.hpp"
+#include "Platform.hpp"
+#include "Stats.hpp"
+#include "TradeTape.hpp"
 #include "TradingEngineServer.hpp"
+#include "TscClock.hpp"
 #include <grpcpp/grpcpp.h>
 
-int main() {
-	std::string server_address("0.0.0.0:5001");
-	std::shared_ptr<Orderbook> orderbook = std::make_shared<Orderbook>();
+#include <string>
+#include <thread>
 
-	TradingEngineServer service(orderbook);
+#include <signal.h>
 
+int main(int argc, char **argv) {
+	ServerConfig config;
+	if (const auto error = LoadConfig(argc, argv, config); !error.empty()) {
+		std::cerr << "Configuration error: " << error << std::endl;
+		return 1;
+	}
+
+	// SIGINT and SIGTERM are taken by sigwait below; blocked before any thread
+	// starts so that none of them gets the default action instead
+	sigset_t stopSignals;
+	sigemptyset(&stopSignals);
+	sigaddset(&stopSignals, SIGINT);
+	sigaddset(&stopSignals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+
+	// Before any thread starts, so every thread but the matching workers inherits the gateway cpus
+	const auto pinError = config.gatewayCpus_.empty() ? std::string{} : PinCurrentThread(config.gatewayCpus_);
+
+	auto logger = std::make_shared<TextLogger>(config.logFile_, config.logLevel_);
+	if (!pinError.empty())
+		logger->Warning("Startup", "Gateway threads not pinned: " + pinError);
+	if (config.lockMemory_) {
+		if (const auto error = LockMemory(); !error.empty())
+			logger->Warning("Startup", "Memory not locked: " + error);
+	}
+
+	// Calibrates the TSC before anything is timestamped, so no request pays
+	// for it, then keeps conversion tracking the system clock
+	TscCalibrator tscCalibrator{config.tscCalibrationInterval_};
+
+	// Instruments 0 to INSTRUMENT_COUNT - 1; each book is created on its first
+	// order, with address space for MAX_ORDERS
+	InstrumentDefinition definition;
+	definition.matchingPolicy_ = config.matchingPolicy_;
+	definition.capacity_ = BookCapacity{config.maxOrders_, config.hugePages_, config.prefault_};
+	definition.batchCpus_ = config.batchCpus_;
+
+	auto instruments = std::make_shared<InstrumentRegistry>();
+	if (config.prefault_ && config.maxOrders_ != 0) {
+		const auto megabytes = config.instrumentCount_ * config.maxOrders_ * Orderbook::ArenaBytesPerOrder >> 20;
+		logger->Information("Startup", "Prefaulting " + std::to_string(megabytes) + " MB of book arenas for " + std::to_string(config.instrumentCount_) + " instruments");
+	}
+	for (InstrumentId id = 0; id < config.instrumentCount_; ++id) {
+		instruments->List(id, definition);
+		// Prefaulting on the first order would put the page faults right back in the opening burst
+		if (config.prefault_ && config.maxOrders_ != 0)
+			instruments->GetOrCreate(id);
+	}
+
+	TradingEngineServer service(instruments);
+	service.AttachExecutionReports(std::make_shared<ExecutionReportRing>(config.executionReportCapacity_));
+
+	// Every trade onto a columnar tape per instrument and session, off the matching path
+	auto tradeTape = std::make_shared<TradeTapeRecorder>(service.GetExecutionReports(), config.tradeTape_, logger);
+	service.SetTradeTape(tradeTape);
+
+	// MATCHING_THREADS workers share every book; 0 matches on the gRPC threads
+	if (config.matchingThreads_ != 0) {
+		// A thread that never parks takes its core from whatever else the scheduler puts there
+		if (!config.matchingWait_.Parks() && config.matchingCpus_.empty())
+			logger->Warning("Startup", "MATCHING_WAIT polls without MATCHING_CPUS; workers will compete for cores");
+		service.SetScheduler(std::make_shared<MatchingScheduler>(config.matchingThreads_, config.matchingCpus_, config.matchingWait_, config.gatewayWait_));
+	}
+
+	// Per-client rate limits and load shedding; all off unless set
+	service.ConfigureThrottle(config.throttle_);
+	service.SetMaxStreams(config.maxStreams_ != 0 ? config.maxStreams_ : config.gatewayThreads_ / 2);
+
+	// ENABLE_PROFILING adds hardware counters and a periodic stats dump to LOG_FILE; GetStats is always available
+	std::unique_ptr<StatsReporter> statsReporter;
+	if (config.profiling_) {
+		if (const auto error = service.EnableHardwareCounters(); !error.empty())
+			logger->Warning("Stats", "Hardware counters unavailable: " + error);
+		statsReporter = std::make_unique<StatsReporter>([&service] { return service.GetStatsSnapshot(); }, logger, config.statsDumpInterval_);
+	}
+
+	const auto server_address = config.address_ + ":" + std::to_string(config.port_);
 	grpc::ServerBuilder builder;
 	builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
+	if (config.gatewayThreads_ != 0) {
+		grpc::ResourceQuota quota;
+		quota.SetMaxThreads(static_cast<int>(config.gatewayThreads_));
+		builder.SetResourceQuota(quota);
+	}
 	builder.RegisterService(&service);
 
 	std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
 	if (server) {
 		std::cout << "Server listening on " << server_address << std::endl;
+		// Sessions and streams end first, so the server need not wait out their checks
+		std::thread stopThread{[&] {
+			int signal;
+			sigwait(&stopSignals, &signal);
+			service.Shutdown();
+			server->Shutdown();
+		}};
 		server->Wait();
+		stopThread.join();
 	} else {
 		std::cerr << "Failed to start server." << std::endl;
 		return 1;
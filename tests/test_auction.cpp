@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include "../Auction.hpp"
+
+TEST(AuctionTest, MaximizesExecutableVolume) {
+    AuctionLevels levels;
+    levels.Add(99, 0, 15);
+    levels.Add(100, 10, 0);
+    levels.Add(101, 10, 10);
+    levels.Add(102, 10, 0);
+
+    auto equilibrium = FindEquilibrium(levels, std::nullopt);
+    ASSERT_TRUE(equilibrium);
+    EXPECT_EQ(equilibrium->price_, 101);
+    EXPECT_EQ(equilibrium->volume_, 20);
+    EXPECT_EQ(equilibrium->imbalance_, -5);
+}
+
+TEST(AuctionTest, NothingToExecute) {
+    AuctionLevels levels;
+    EXPECT_FALSE(FindEquilibrium(levels, std::nullopt));
+
+    levels.Add(100, 0, 10);
+    EXPECT_FALSE(FindEquilibrium(levels, std::nullopt));
+}
+
+TEST(AuctionTest, SmallestSurplusBreaksVolumeTie) {
+    AuctionLevels levels;
+    levels.Add(100, 0, 10);
+    levels.Add(101, 4, 0);
+    levels.Add(102, 10, 0);
+
+    // 10 executes at every price, but 100 and 101 leave the 4 lot bid at 101 over
+    auto equilibrium = FindEquilibrium(levels, std::nullopt);
+    ASSERT_TRUE(equilibrium);
+    EXPECT_EQ(equilibrium->price_, 102);
+    EXPECT_EQ(equilibrium->imbalance_, 0);
+}
+
+TEST(AuctionTest, MarketPressure) {
+    AuctionLevels buyPressure;
+    buyPressure.Add(100, 0, 5);
+    buyPressure.Add(102, 10, 0);
+    EXPECT_EQ(FindEquilibrium(buyPressure, std::nullopt)->price_, 102);
+
+    AuctionLevels sellPressure;
+    sellPressure.Add(100, 0, 10);
+    sellPressure.Add(102, 5, 0);
+    EXPECT_EQ(FindEquilibrium(sellPressure, std::nullopt)->price_, 100);
+}
+
+TEST(AuctionTest, ReferencePriceBreaksBalancedTie) {
+    AuctionLevels levels;
+    levels.Add(100, 0, 10);
+    levels.Add(102, 10, 0);
+
+    EXPECT_EQ(FindEquilibrium(levels, std::nullopt)->price_, 100);
+    EXPECT_EQ(FindEquilibrium(levels, 102)->price_, 102);
+    EXPECT_EQ(FindEquilibrium(levels, 101)->price_, 100);
+}
+
+TEST(AuctionTest, ReusedLevelsKeepNothingFromTheLastUncross) {
+    AuctionLevels levels;
+    levels.Add(100, 0, 10);
+    levels.Add(101, 10, 10);
+    levels.Add(102, 10, 0);
+    levels.Add(103, 10, 0);
+    ASSERT_TRUE(FindEquilibrium(levels, std::nullopt));
+    const auto capacity = levels.volume_.capacity();
+
+    // Fewer levels, where a stale volume or candidate would change the answer
+    levels.Clear();
+    levels.Add(100, 0, 5);
+    levels.Add(101, 5, 0);
+    auto equilibrium = FindEquilibrium(levels, std::nullopt);
+    ASSERT_TRUE(equilibrium);
+    EXPECT_EQ(equilibrium->volume_, 5);
+    EXPECT_EQ(equilibrium->price_, 100);
+    EXPECT_EQ(levels.volume_.capacity(), capacity);
+}
@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include "../Backoff.hpp"
+
+namespace {
+
+int RoundsBeforeParking(const WaitPolicy &policy) {
+    Backoff backoff{policy};
+    int rounds = 0;
+    while (backoff.Wait() && rounds < 1'000'000)
+        ++rounds;
+    return rounds;
+}
+
+} // namespace
+
+TEST(BackoffTest, ParkPolicyParksAtOnce) {
+    EXPECT_EQ(RoundsBeforeParking(WaitPolicy::Park()), 0);
+    EXPECT_TRUE(WaitPolicy::Park().Parks());
+}
+
+TEST(BackoffTest, StagesRunTheirCountsInTurn) {
+    EXPECT_EQ(RoundsBeforeParking(WaitPolicy{3, 0, 0}), 3);
+    EXPECT_EQ(RoundsBeforeParking(WaitPolicy{0, 4, 0}), 4);
+    EXPECT_EQ(RoundsBeforeParking(WaitPolicy{2, 3, 5}), 10);
+
+    const auto adaptive = WaitPolicy::Adaptive();
+    EXPECT_EQ(RoundsBeforeParking(adaptive), static_cast<int>(adaptive.spins_ + adaptive.pauses_ + adaptive.yields_));
+    EXPECT_TRUE(adaptive.Parks());
+}
+
+TEST(BackoffTest, ForeverNeverParks) {
+    EXPECT_FALSE(WaitPolicy::Poll().Parks());
+    EXPECT_EQ(RoundsBeforeParking(WaitPolicy::Poll()), 1'000'000);
+    EXPECT_EQ(RoundsBeforeParking(WaitPolicy{0, 0, WaitPolicy::Forever}), 1'000'000);
+}
+
+TEST(BackoffTest, ParkedBackoffStaysParked) {
+    Backoff backoff{WaitPolicy{1, 1, 0}};
+    EXPECT_TRUE(backoff.Wait());
+    EXPECT_TRUE(backoff.Wait());
+    EXPECT_FALSE(backoff.Wait());
+    EXPECT_FALSE(backoff.Wait());
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include "../Config.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+class ConfigTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        path_ = (std::filesystem::temp_directory_path() / ("config_test_" + std::to_string(::getpid()) + ".env")).string();
+    }
+
+    void TearDown() override {
+        std::remove(path_.c_str());
+        for (const auto *name : setVariables_)
+            ::unsetenv(name);
+    }
+
+    void WriteFile(const std::string &contents) {
+        std::ofstream file{path_};
+        file << contents;
+    }
+
+    void SetEnv(const char *name, const char *value) {
+        ::setenv(name, value, 1);
+        setVariables_.push_back(name);
+    }
+
+    // Loads with --config pointing at the test file, plus flags
+    std::string Load(ServerConfig &config, std::vector<std::string> flags = {}) {
+        flags.insert(flags.begin(), "--config=" + path_);
+        std::vector<const char *> argv{"trading_server"};
+        for (const auto &flag : flags)
+            argv.push_back(flag.c_str());
+        return LoadConfig(static_cast<int>(argv.size()), argv.data(), config);
+    }
+
+    std::string path_;
+    std::vector<const char *> setVariables_;
+};
+
+} // namespace
+
+TEST_F(ConfigTest, DefaultsWithAnEmptyFile) {
+    WriteFile("");
+    ServerConfig config;
+    ASSERT_EQ(Load(config), "");
+    EXPECT_EQ(config.address_, "0.0.0.0");
+    EXPECT_EQ(config.port_, 5001);
+    EXPECT_EQ(config.matchingThreads_, 0u);
+    EXPECT_TRUE(config.matchingCpus_.empty());
+    EXPECT_EQ(config.maxOrders_, 0u);
+    EXPECT_FALSE(config.lockMemory_);
+}
+
+TEST_F(ConfigTest, ReadsTypedValuesFromTheFile) {
+    WriteFile(
+        "# Server\n"
+        "SERVER_PORT=6001\n"
+        "SERVER_ADDRESS=\"127.0.0.1\"\n"
+        "\n"
+        "THREAD_COUNT=auto\n"
+        "MATCHING_THREADS=2\n"
+        "MATCHING_CPUS=2-3,6\n"
+        "BATCH_CPUS=7\n"
+        "MATCHING_ALGORITHM=pro_rata\n"
+        "MATCHING_TOP_ORDER=on\n"
+        "MAX_ORDERS=50000\n"
+        "HUGE_PAGES=true\n"
+        "LOG_LEVEL=WARN\n"
+        "STATS_DUMP_INTERVAL_MS=250\n"
+        "BUILD_TYPE=Release\n");
+    ServerConfig config;
+    ASSERT_EQ(Load(config), "");
+    EXPECT_EQ(config.port_, 6001);
+    EXPECT_EQ(config.address_, "127.0.0.1");
+    EXPECT_EQ(config.gatewayThreads_, 0u);
+    EXPECT_EQ(config.matchingThreads_, 2u);
+    EXPECT_EQ(config.matchingCpus_, (std::vector<int>{2, 3, 6}));
+    EXPECT_EQ(config.batchCpus_, (std::vector<int>{7}));
+    EXPECT_EQ(config.matchingPolicy_.algorithm_, MatchingAlgorithm::ProRata);
+    EXPECT_TRUE(config.matchingPolicy_.topOrder_);
+    EXPECT_EQ(config.maxOrders_, 50000u);
+    EXPECT_TRUE(config.hugePages_);
+    EXPECT_EQ(config.logLevel_, LogLevel::Warning);
+    EXPECT_EQ(config.statsDumpInterval_, std::chrono::milliseconds{250});
+}
+
+TEST_F(ConfigTest, EnvironmentOverridesFileAndFlagsOverrideBoth) {
+    WriteFile("SERVER_PORT=6001\nMATCHING_THREADS=2\nMAX_ORDERS=10\n");
+    SetEnv("MATCHING_THREADS", "3");
+    SetEnv("MAX_ORDERS", "20");
+    ServerConfig config;
+    ASSERT_EQ(Load(config, {"--max-orders=30", "--prefault"}), "");
+    EXPECT_EQ(config.port_, 6001);
+    EXPECT_EQ(config.matchingThreads_, 3u);
+    EXPECT_EQ(config.maxOrders_, 30u);
+    EXPECT_TRUE(config.prefault_);
+}
+
+TEST_F(ConfigTest, ReportsWhereABadValueCameFrom) {
+    WriteFile("SERVER_PORT=5001\nMATCHING_FIFO_PERCENT=150\n");
+    ServerConfig config;
+    EXPECT_EQ(Load(config), path_ + ":2: invalid MATCHING_FIFO_PERCENT '150'");
+
+    WriteFile("");
+    SetEnv("SERVER_PORT", "70000");
+    EXPECT_EQ(Load(config), "environment: invalid SERVER_PORT '70000'");
+
+    ::unsetenv("SERVER_PORT");
+    EXPECT_EQ(Load(config, {"--lock-memory=maybe"}), "command line: invalid LOCK_MEMORY 'maybe'");
+}
+
+TEST_F(ConfigTest, RejectsUnknownFlagsAndMalformedLines) {
+    WriteFile("");
+    ServerConfig config;
+    EXPECT_EQ(Load(config, {"--no-such-setting=1"}), "unknown flag '--no-such-setting=1'");
+    EXPECT_EQ(Load(config, {"positional"}), "unexpected argument 'positional'");
+
+    WriteFile("SERVER_PORT\n");
+    EXPECT_EQ(Load(config), path_ + ":1: expected KEY=VALUE");
+}
+
+TEST_F(ConfigTest, MissingFileIsAnError) {
+    ServerConfig config;
+    EXPECT_EQ(Load(config), path_ + ": cannot open");
+}
+
+TEST_F(ConfigTest, ParsesWaitPolicies) {
+    WriteFile("MATCHING_WAIT=poll\nGATEWAY_WAIT=100, 2000, 10\n");
+    ServerConfig config;
+    ASSERT_EQ(Load(config), "");
+    EXPECT_EQ(config.matchingWait_, WaitPolicy::Poll());
+    EXPECT_EQ(config.gatewayWait_, (WaitPolicy{100, 2000, 10}));
+
+    ASSERT_EQ(Load(config, {"--gateway-wait=adaptive", "--matching-wait=PARK"}), "");
+    EXPECT_EQ(config.gatewayWait_, WaitPolicy::Adaptive());
+    EXPECT_EQ(config.matchingWait_, WaitPolicy::Park());
+
+    EXPECT_NE(Load(config, {"--matching-wait=1,2"}), "");
+    EXPECT_NE(Load(config, {"--matching-wait=1,2,3,4"}), "");
+    EXPECT_NE(Load(config, {"--matching-wait=spin"}), "");
+}
+
+TEST_F(ConfigTest, ParsesTradeTapeSettings) {
+    WriteFile("TRADE_TAPE_DIR=/var/lib/tape\nTRADE_TAPE_CAPACITY=4096\nTRADE_BAR_INTERVALS_MS=500, 5000\n");
+    ServerConfig config;
+    ASSERT_EQ(Load(config), "");
+    EXPECT_EQ(config.tradeTape_.directory_, "/var/lib/tape");
+    EXPECT_EQ(config.tradeTape_.capacity_, 4096u);
+    EXPECT_EQ(config.tradeTape_.barIntervals_, (std::vector<std::chrono::milliseconds>{std::chrono::milliseconds{500}, std::chrono::seconds{5}}));
+
+    EXPECT_NE(Load(config, {"--trade-bar-intervals-ms=1000,0"}), "");
+    EXPECT_NE(Load(config, {"--trade-tape-capacity=0"}), "");
+}
+
+TEST_F(ConfigTest, StreamsMustLeaveAThreadForOrderEntry) {
+    WriteFile("THREAD_COUNT=8\nMAX_STREAMS=7\n");
+    ServerConfig config;
+    ASSERT_EQ(Load(config), "");
+    EXPECT_EQ(config.maxStreams_, 7u);
+
+    ServerConfig tooMany;
+    EXPECT_NE(Load(tooMany, {"--max-streams=8"}), "");
+}
+
+TEST(ParseCpuListTest, ExpandsRangesAndRejectsGarbage) {
+    std::vector<int> cpus;
+    ASSERT_TRUE(ParseCpuList("0-3,8", cpus));
+    EXPECT_EQ(cpus, (std::vector<int>{0, 1, 2, 3, 8}));
+    ASSERT_TRUE(ParseCpuList(" 5 , 7 ", cpus));
+    EXPECT_EQ(cpus, (std::vector<int>{5, 7}));
+
+    EXPECT_FALSE(ParseCpuList("3-1", cpus));
+    EXPECT_FALSE(ParseCpuList("a", cpus));
+    EXPECT_FALSE(ParseCpuList("1,,2", cpus));
+    EXPECT_EQ(cpus, (std::vector<int>{5, 7}));
+}
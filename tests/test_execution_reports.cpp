@@ -0,0 +1,270 @@
+#include <gtest/gtest.h>
+#include "../ExecutionReports.hpp"
+#include "../Order.hpp"
+#include "../OrderModify.hpp"
+#include "../Orderbook.hpp"
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+ExecutionReport MakeReport(OrderId orderId) {
+    ExecutionReport report;
+    report.orderId_ = orderId;
+    report.type_ = ExecutionType::Cancel;
+    return report;
+}
+
+// Every report published so far, in sequence
+std::vector<ExecutionReport> ReadAll(const ExecutionReportRing &ring) {
+    std::vector<ExecutionReport> reports;
+    ExecutionReport report;
+    for (auto sequence = ring.GetOldestSequence(); ring.Read(sequence, report) == ExecutionReportRing::ReadResult::Read; ++sequence)
+        reports.push_back(report);
+    return reports;
+}
+
+} // namespace
+
+TEST(ExecutionReportRingTest, PublishesInSequence) {
+    ExecutionReportRing ring{4};
+    EXPECT_EQ(ring.GetNextSequence(), 1);
+
+    EXPECT_EQ(ring.Publish(MakeReport(10)), 1);
+    EXPECT_EQ(ring.Publish(MakeReport(11)), 2);
+
+    ExecutionReport report;
+    ASSERT_EQ(ring.Read(1, report), ExecutionReportRing::ReadResult::Read);
+    EXPECT_EQ(report.sequence_, 1);
+    EXPECT_EQ(report.orderId_, 10);
+    EXPECT_EQ(report.type_, ExecutionType::Cancel);
+    ASSERT_EQ(ring.Read(2, report), ExecutionReportRing::ReadResult::Read);
+    EXPECT_EQ(report.orderId_, 11);
+    EXPECT_EQ(ring.Read(3, report), ExecutionReportRing::ReadResult::NotYet);
+}
+
+TEST(ExecutionReportRingTest, RoundsCapacityUpAndOverwritesOldest) {
+    ExecutionReportRing ring{3};
+    EXPECT_EQ(ring.GetCapacity(), 4);
+
+    for (OrderId id = 1; id <= 6; ++id)
+        ring.Publish(MakeReport(id));
+
+    EXPECT_EQ(ring.GetOldestSequence(), 3);
+    ExecutionReport report;
+    EXPECT_EQ(ring.Read(2, report), ExecutionReportRing::ReadResult::Overwritten);
+    ASSERT_EQ(ring.Read(3, report), ExecutionReportRing::ReadResult::Read);
+    EXPECT_EQ(report.orderId_, 3);
+    EXPECT_EQ(ReadAll(ring).size(), 4);
+}
+
+TEST(ExecutionReportRingTest, ConcurrentProducersGetDistinctSequences) {
+    constexpr int Producers = 4;
+    constexpr int PerProducer = 1000;
+    ExecutionReportRing ring{Producers * PerProducer};
+
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < Producers; ++producer) {
+        producers.emplace_back([&ring, producer] {
+            for (int i = 0; i < PerProducer; ++i)
+                ring.Publish(MakeReport(static_cast<OrderId>(producer * PerProducer + i + 1)));
+        });
+    }
+    for (auto &producer : producers)
+        producer.join();
+
+    const auto reports = ReadAll(ring);
+    ASSERT_EQ(reports.size(), Producers * PerProducer);
+    std::vector<bool> seen(Producers * PerProducer + 1);
+    for (std::size_t i = 0; i < reports.size(); ++i) {
+        EXPECT_EQ(reports[i].sequence_, i + 1);
+        EXPECT_FALSE(seen[reports[i].orderId_]);
+        seen[reports[i].orderId_] = true;
+    }
+}
+
+TEST(ExecutionReportRingTest, LappingProducersNeverMoveAStampBack) {
+    // Far more reports than slots, so producers a lap apart race for a slot
+    constexpr int Producers = 4;
+    constexpr int PerProducer = 20000;
+    ExecutionReportRing ring{4};
+
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < Producers; ++producer) {
+        producers.emplace_back([&ring, producer] {
+            for (int i = 0; i < PerProducer; ++i)
+                ring.Publish(MakeReport(static_cast<OrderId>(producer * PerProducer + i + 1)));
+        });
+    }
+    for (auto &producer : producers)
+        producer.join();
+
+    // Every sequence is either still held, intact, or overwritten by a newer
+    // one; none is left looking unpublished
+    const auto next = ring.GetNextSequence();
+    ASSERT_EQ(next, Producers * PerProducer + 1);
+    ExecutionReport report;
+    for (std::uint64_t sequence = 1; sequence < next; ++sequence) {
+        const auto result = ring.Read(sequence, report);
+        ASSERT_NE(result, ExecutionReportRing::ReadResult::NotYet) << sequence;
+        if (result == ExecutionReportRing::ReadResult::Read) {
+            EXPECT_EQ(report.sequence_, sequence);
+            EXPECT_EQ(report.type_, ExecutionType::Cancel);
+        }
+    }
+    EXPECT_EQ(ReadAll(ring).size(), ring.GetCapacity());
+}
+
+TEST(ExecutionReportRingTest, WaitForWakesOnPublish) {
+    ExecutionReportRing ring{4};
+    EXPECT_FALSE(ring.WaitFor(1, std::chrono::milliseconds(1)));
+
+    std::thread producer{[&ring] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ring.Publish(MakeReport(10));
+    }};
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(ring.WaitFor(1, std::chrono::seconds(10)));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    producer.join();
+
+    // Published, then lapped: neither waits
+    EXPECT_TRUE(ring.WaitFor(1, std::chrono::seconds(10)));
+    for (OrderId id = 11; id <= 15; ++id)
+        ring.Publish(MakeReport(id));
+    EXPECT_TRUE(ring.WaitFor(1, std::chrono::seconds(10)));
+}
+
+class OrderbookExecutionReportsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        reports = std::make_shared<ExecutionReportRing>(64);
+        orderbook = std::make_shared<Orderbook>();
+        orderbook->AttachExecutionReports(reports, 3);
+    }
+
+    std::shared_ptr<ExecutionReportRing> reports;
+    std::shared_ptr<Orderbook> orderbook;
+
+    OrderPointer CreateOrder(OrderId id, Side side, Price price, Quantity quantity, ClientId clientId = 0,
+                             OrderType type = OrderType::GoodTillCancel) {
+        auto order = std::make_shared<Order>(type, id, side, price, quantity);
+        order->SetClientId(clientId);
+        return order;
+    }
+};
+
+TEST_F(OrderbookExecutionReportsTest, TradeReportsBothSides) {
+    orderbook->AddOrder(CreateOrder(1, Side::Sell, 100, 10, 7));
+    orderbook->AddOrder(CreateOrder(2, Side::Sell, 101, 10, 7));
+    auto trades = orderbook->AddOrder(CreateOrder(3, Side::Buy, 101, 15, 8));
+
+    ASSERT_EQ(trades.size(), 2);
+    const auto tradeId = trades[0].GetTradeId();
+    EXPECT_NE(tradeId, 0);
+    EXPECT_EQ(trades[1].GetTradeId(), tradeId + 1);
+    EXPECT_EQ(trades[0].GetAggressor(), Side::Buy);
+
+    const auto all = ReadAll(*reports);
+    ASSERT_EQ(all.size(), 4);
+
+    // The buyer and the first seller, at the resting order's price
+    const auto &bid = all[0];
+    EXPECT_EQ(bid.type_, ExecutionType::Fill);
+    EXPECT_EQ(bid.instrumentId_, 3);
+    EXPECT_EQ(bid.orderId_, 3);
+    EXPECT_EQ(bid.clientId_, 8);
+    EXPECT_EQ(bid.side_, Side::Buy);
+    EXPECT_TRUE(bid.aggressor_);
+    EXPECT_EQ(bid.price_, 100);
+    EXPECT_EQ(bid.quantity_, 10);
+    EXPECT_EQ(bid.leavesQuantity_, 5);
+    EXPECT_EQ(bid.tradeId_, tradeId);
+    EXPECT_EQ(bid.counterpartyOrderId_, 1);
+    EXPECT_EQ(bid.counterpartyClientId_, 7);
+    EXPECT_EQ(bid.time_, trades[0].GetMatchTime());
+
+    const auto &ask = all[1];
+    EXPECT_EQ(ask.orderId_, 1);
+    EXPECT_EQ(ask.clientId_, 7);
+    EXPECT_FALSE(ask.aggressor_);
+    EXPECT_EQ(ask.leavesQuantity_, 0);
+    EXPECT_EQ(ask.tradeId_, tradeId);
+    EXPECT_EQ(ask.counterpartyOrderId_, 3);
+
+    EXPECT_EQ(all[2].price_, 101);
+    EXPECT_EQ(all[2].leavesQuantity_, 0);
+    EXPECT_EQ(all[3].orderId_, 2);
+    EXPECT_EQ(all[3].leavesQuantity_, 5);
+    EXPECT_EQ(all[3].tradeId_, tradeId + 1);
+}
+
+TEST_F(OrderbookExecutionReportsTest, CancelAndFillAndKillRemainder) {
+    orderbook->AddOrder(CreateOrder(1, Side::Sell, 100, 10, 7));
+    orderbook->AddOrder(CreateOrder(2, Side::Buy, 100, 25, 8, OrderType::FillAndKill));
+    orderbook->AddOrder(CreateOrder(3, Side::Buy, 90, 5, 8));
+    orderbook->CancelOrder(3);
+
+    const auto all = ReadAll(*reports);
+    ASSERT_EQ(all.size(), 4);
+    EXPECT_EQ(all[2].type_, ExecutionType::Cancel);
+    EXPECT_EQ(all[2].orderId_, 2);
+    EXPECT_EQ(all[2].quantity_, 15);
+    EXPECT_EQ(all[2].leavesQuantity_, 0);
+    EXPECT_EQ(all[3].type_, ExecutionType::Cancel);
+    EXPECT_EQ(all[3].orderId_, 3);
+    EXPECT_EQ(all[3].price_, 90);
+    EXPECT_EQ(all[3].quantity_, 5);
+}
+
+TEST_F(OrderbookExecutionReportsTest, GoodForDayOrdersExpire) {
+    orderbook->AddOrder(CreateOrder(1, Side::Buy, 100, 10, 7, OrderType::GoodForDay));
+    orderbook->AddOrder(CreateOrder(2, Side::Buy, 99, 10, 7));
+    orderbook->CancelGoodForDayOrders();
+
+    const auto all = ReadAll(*reports);
+    ASSERT_EQ(all.size(), 1);
+    EXPECT_EQ(all[0].type_, ExecutionType::Expire);
+    EXPECT_EQ(all[0].orderId_, 1);
+    EXPECT_EQ(all[0].clientId_, 7);
+}
+
+TEST_F(OrderbookExecutionReportsTest, ModifyReportsOneReplace) {
+    orderbook->AddOrder(CreateOrder(1, Side::Buy, 100, 10, 7));
+    orderbook->ModifyOrder(OrderModify{1, Side::Buy, 101, 20});
+
+    const auto all = ReadAll(*reports);
+    ASSERT_EQ(all.size(), 1);
+    EXPECT_EQ(all[0].type_, ExecutionType::Replace);
+    EXPECT_EQ(all[0].orderId_, 1);
+    EXPECT_EQ(all[0].clientId_, 7);
+    EXPECT_EQ(all[0].price_, 101);
+    EXPECT_EQ(all[0].quantity_, 20);
+    EXPECT_EQ(all[0].leavesQuantity_, 20);
+}
+
+TEST(OrderbookTradeIdTest, TradeIdsAreUniqueAcrossBooks) {
+    // Two trades in one book, then one in a second book, as if the first
+    // had been dropped at the close and created again
+    const auto trade = [](Orderbook &orderbook, OrderId id) {
+        orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, id, Side::Buy, 100, 4));
+        auto trades = orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, id + 1, Side::Sell, 99, 4));
+        EXPECT_EQ(trades.size(), 1);
+        return trades.empty() ? Trade{{}, {}, 0} : trades[0];
+    };
+
+    Orderbook first;
+    const auto one = trade(first, 1);
+    const auto two = trade(first, 3);
+    Orderbook recreated;
+    const auto three = trade(recreated, 1);
+
+    EXPECT_NE(one.GetTradeId(), 0);
+    EXPECT_EQ(two.GetTradeId(), one.GetTradeId() + 1);
+    EXPECT_NE(three.GetTradeId(), one.GetTradeId());
+    EXPECT_NE(three.GetTradeId(), two.GetTradeId());
+    EXPECT_EQ(two.GetAggressor(), Side::Sell);
+    EXPECT_EQ(two.GetBidTrade().price_, 100);
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include "../HdrHistogram.hpp"
+
+class HdrHistogramTest : public ::testing::Test {
+protected:
+    HdrHistogram histogram;
+};
+
+TEST_F(HdrHistogramTest, EmptyHistogram) {
+    EXPECT_EQ(histogram.GetTotalCount(), 0);
+    EXPECT_EQ(histogram.GetMin(), 0);
+    EXPECT_EQ(histogram.GetMax(), 0);
+    EXPECT_EQ(histogram.GetValueAtPercentile(99.0), 0);
+}
+
+TEST_F(HdrHistogramTest, SmallValuesAreExact) {
+    for (std::uint64_t value = 1; value <= 1000; ++value)
+        histogram.RecordValue(value);
+
+    EXPECT_EQ(histogram.GetTotalCount(), 1000);
+    EXPECT_EQ(histogram.GetMin(), 1);
+    EXPECT_EQ(histogram.GetMax(), 1000);
+    EXPECT_EQ(histogram.GetValueAtPercentile(50.0), 500);
+    EXPECT_EQ(histogram.GetValueAtPercentile(99.0), 990);
+    EXPECT_EQ(histogram.GetValueAtPercentile(100.0), 1000);
+}
+
+TEST_F(HdrHistogramTest, LargeValuesKeepThreeSignificantDigits) {
+    const std::uint64_t value = 123'456'789;
+    histogram.RecordValue(value);
+
+    const auto reported = histogram.GetValueAtPercentile(50.0);
+    EXPECT_GE(reported, value);
+    EXPECT_LE(reported - value, value / 1000);
+}
+
+TEST_F(HdrHistogramTest, CoordinatedOmissionCorrection) {
+    // One 1ms stall with a 100us send interval hides 9 requests that would
+    // have queued behind it; the corrected histogram accounts for them.
+    histogram.RecordCorrectedValue(1'000'000, 100'000);
+
+    EXPECT_EQ(histogram.GetTotalCount(), 10);
+    EXPECT_EQ(histogram.GetMax(), 1'000'000);
+    EXPECT_LE(histogram.GetMin(), 100'000);
+}
+
+TEST_F(HdrHistogramTest, CorrectionIgnoredWithoutInterval) {
+    histogram.RecordCorrectedValue(1'000'000, 0);
+    EXPECT_EQ(histogram.GetTotalCount(), 1);
+}
+
+TEST_F(HdrHistogramTest, MergeAndReset) {
+    HdrHistogram other;
+    histogram.RecordValue(10);
+    other.RecordValue(20);
+    other.RecordValue(30);
+
+    histogram.Add(other);
+    EXPECT_EQ(histogram.GetTotalCount(), 3);
+    EXPECT_EQ(histogram.GetMin(), 10);
+    EXPECT_EQ(histogram.GetMax(), 30);
+    EXPECT_DOUBLE_EQ(histogram.GetMean(), 20.5);
+
+    histogram.Reset();
+    EXPECT_EQ(histogram.GetTotalCount(), 0);
+    EXPECT_EQ(histogram.GetMax(), 0);
+}
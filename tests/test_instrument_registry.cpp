@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include "../InstrumentRegistry.hpp"
+
+#include <memory>
+
+namespace {
+
+OrderPointer MakeOrder(OrderType type, OrderId id, Side side, Price price, Quantity quantity) {
+    return std::make_shared<Order>(type, id, side, price, quantity);
+}
+
+} // namespace
+
+TEST(InstrumentRegistryTest, BooksAreCreatedLazily) {
+    InstrumentRegistry registry;
+    EXPECT_TRUE(registry.List(1));
+    EXPECT_FALSE(registry.List(1));
+    EXPECT_EQ(registry.ListedCount(), 1);
+    EXPECT_EQ(registry.BookCount(), 0);
+
+    EXPECT_EQ(registry.Find(1), nullptr);
+    EXPECT_EQ(registry.GetOrCreate(2), nullptr);
+
+    const auto orderbook = registry.GetOrCreate(1);
+    ASSERT_NE(orderbook, nullptr);
+    EXPECT_EQ(registry.GetOrCreate(1), orderbook);
+    EXPECT_EQ(registry.Find(1), orderbook);
+    EXPECT_EQ(registry.BookCount(), 1);
+}
+
+TEST(InstrumentRegistryTest, BooksTakeTheInstrumentDefinition) {
+    InstrumentRegistry registry;
+    registry.List(1, InstrumentDefinition{MatchingPolicy{MatchingAlgorithm::ProRata, true, 20}, BookCapacity{1000, false, false}, {}});
+    const auto policy = registry.GetOrCreate(1)->GetMatchingPolicy();
+    EXPECT_EQ(policy.algorithm_, MatchingAlgorithm::ProRata);
+    EXPECT_TRUE(policy.topOrder_);
+    EXPECT_EQ(policy.fifoPercent_, 20);
+}
+
+TEST(InstrumentRegistryTest, CloseDayCancelsGoodForDayAndDropsIdleBooks) {
+    InstrumentRegistry registry;
+    for (InstrumentId id = 1; id <= 3; ++id)
+        registry.List(id);
+
+    // Only good-for-day orders: idle after the close
+    registry.GetOrCreate(1)->AddOrder(MakeOrder(OrderType::GoodForDay, 1, Side::Buy, 100, 10));
+    // A good-till-cancel order survives the close and keeps its book
+    registry.GetOrCreate(2)->AddOrder(MakeOrder(OrderType::GoodTillCancel, 1, Side::Buy, 100, 10));
+    // Held by a request in flight: kept even though idle
+    const auto held = registry.GetOrCreate(3);
+
+    EXPECT_EQ(registry.CloseDay(), 1);
+    EXPECT_EQ(registry.Find(1), nullptr);
+    EXPECT_TRUE(registry.IsListed(1));
+    ASSERT_NE(registry.Find(2), nullptr);
+    EXPECT_EQ(registry.Find(2)->Size(), 1);
+    EXPECT_EQ(registry.Find(3), held);
+}
+
+TEST(InstrumentRegistryTest, DroppedBooksPassTheirLastTradePriceOn) {
+    InstrumentRegistry registry;
+    registry.List(1);
+
+    auto orderbook = registry.GetOrCreate(1);
+    EXPECT_FALSE(orderbook->GetLastTradePrice());
+    orderbook->AddOrder(MakeOrder(OrderType::GoodTillCancel, 1, Side::Buy, 101, 10));
+    orderbook->AddOrder(MakeOrder(OrderType::GoodTillCancel, 2, Side::Sell, 101, 10));
+    orderbook.reset();
+
+    ASSERT_EQ(registry.CloseDay(), 1);
+    orderbook = registry.GetOrCreate(1);
+    EXPECT_EQ(orderbook->GetLastTradePrice(), 101);
+
+    // 98 and 102 uncross equally well; without the seeded reference the
+    // lower would be taken
+    orderbook->StartAuction();
+    orderbook->AddOrder(MakeOrder(OrderType::GoodTillCancel, 3, Side::Buy, 102, 10));
+    orderbook->AddOrder(MakeOrder(OrderType::GoodTillCancel, 4, Side::Sell, 98, 10));
+    const auto indicative = orderbook->GetIndicativeUncross();
+    ASSERT_TRUE(indicative);
+    EXPECT_EQ(indicative->price_, 102);
+}
+
+TEST(InstrumentRegistryTest, AdoptedBooksAreNeverDropped) {
+    InstrumentRegistry registry;
+    registry.List(InstrumentRegistry::DefaultInstrument, std::make_shared<Orderbook>());
+    EXPECT_EQ(registry.CloseDay(), 0);
+    EXPECT_NE(registry.Find(InstrumentRegistry::DefaultInstrument), nullptr);
+}
+
+TEST(InstrumentRegistryTest, BooksWithRiskLimitsAreKept) {
+    InstrumentRegistry registry;
+    registry.List(1);
+    registry.GetOrCreate(1)->SetRiskLimits(5, RiskLimits{100, 0, 0, 0, 0});
+    EXPECT_EQ(registry.CloseDay(), 0);
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include "../Kernels.hpp"
+
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Runs body on every instruction set the CPU supports, then restores the default.
+template <typename Body>
+void ForEachIsa(Body body) {
+    const auto original = GetKernelIsa();
+    for (auto isa : {KernelIsa::Scalar, KernelIsa::Avx2, KernelIsa::Avx512}) {
+        if (!SetKernelIsa(isa))
+            continue;
+        SCOPED_TRACE(ToString(isa));
+        body();
+    }
+    SetKernelIsa(original);
+}
+
+} // namespace
+
+TEST(KernelsTest, ScalarIsAlwaysAvailable) {
+    const auto original = GetKernelIsa();
+    EXPECT_TRUE(SetKernelIsa(KernelIsa::Scalar));
+    EXPECT_EQ(GetKernelIsa(), KernelIsa::Scalar);
+    EXPECT_TRUE(SetKernelIsa(original));
+}
+
+TEST(KernelsTest, SumQuantitiesMatchesScalarForEveryLength) {
+    std::mt19937 random(7);
+    std::uniform_int_distribution<Quantity> quantity(0, 1'000'000);
+    std::vector<Quantity> quantities(67);
+    for (auto &q : quantities)
+        q = quantity(random);
+
+    ForEachIsa([&] {
+        for (std::size_t count = 0; count <= quantities.size(); ++count) {
+            std::uint64_t expected = 0;
+            for (std::size_t i = 0; i < count; ++i)
+                expected += quantities[i];
+            EXPECT_EQ(SumQuantities(quantities.data(), count), expected) << "count " << count;
+        }
+    });
+}
+
+TEST(KernelsTest, SumQuantitiesDoesNotOverflow) {
+    const std::vector<Quantity> quantities(40, std::numeric_limits<Quantity>::max());
+    ForEachIsa([&] {
+        EXPECT_EQ(SumQuantities(quantities.data(), quantities.size()),
+                  40ull * std::numeric_limits<Quantity>::max());
+    });
+}
+
+TEST(KernelsTest, InclusiveScanMatchesScalarForEveryLength) {
+    std::mt19937 random(11);
+    std::uniform_int_distribution<std::int64_t> value(-1'000'000, 1'000'000);
+    std::vector<std::int64_t> values(37);
+    for (auto &v : values)
+        v = value(random);
+
+    ForEachIsa([&] {
+        for (std::size_t count = 0; count <= values.size(); ++count) {
+            // Guard slot past the end must not be written
+            std::vector<std::int64_t> sums(count + 1, -1);
+            InclusiveScan(values.data(), sums.data(), count);
+            std::int64_t expected = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                expected += values[i];
+                EXPECT_EQ(sums[i], expected) << "count " << count << " index " << i;
+            }
+            EXPECT_EQ(sums[count], -1);
+        }
+    });
+}
+
+TEST(KernelsTest, InclusiveScanInPlace) {
+    ForEachIsa([] {
+        std::vector<std::int64_t> values{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+        InclusiveScan(values.data(), values.data(), values.size());
+        EXPECT_EQ(values, (std::vector<std::int64_t>{1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 66}));
+    });
+}
+
+TEST(KernelsTest, FindCumulativeMatchesScalarForEveryLengthAndTarget) {
+    std::mt19937 random(13);
+    std::uniform_int_distribution<Quantity> quantity(0, 100);
+    std::vector<Quantity> quantities(41);
+    for (auto &q : quantities)
+        q = quantity(random);
+
+    ForEachIsa([&] {
+        for (std::size_t count = 0; count <= quantities.size(); ++count) {
+            std::uint64_t total = 0;
+            for (std::size_t i = 0; i < count; ++i)
+                total += quantities[i];
+
+            for (std::uint64_t target = 0; target <= total + 1; target += 7) {
+                std::size_t expected = count;
+                std::uint64_t running = 0;
+                for (std::size_t i = 0; i < count; ++i) {
+                    running += quantities[i];
+                    if (running >= target) {
+                        expected = i;
+                        break;
+                    }
+                }
+                EXPECT_EQ(FindCumulative(quantities.data(), count, target), expected) << "count " << count << " target " << target;
+            }
+            EXPECT_EQ(FindCumulative(quantities.data(), count, total + 1), count);
+        }
+    });
+}
+
+TEST(KernelsTest, FindCumulativeDoesNotOverflow) {
+    const std::vector<Quantity> quantities(40, std::numeric_limits<Quantity>::max());
+    ForEachIsa([&] {
+        EXPECT_EQ(FindCumulative(quantities.data(), quantities.size(), 39ull * std::numeric_limits<Quantity>::max()), 38);
+        EXPECT_EQ(FindCumulative(quantities.data(), quantities.size(), 40ull * std::numeric_limits<Quantity>::max() + 1), 40);
+    });
+}
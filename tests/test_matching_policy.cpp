@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+#include "../MatchingPolicy.hpp"
+
+#include <vector>
+
+namespace {
+
+std::vector<Quantity> Allocate(const MatchingPolicy &policy, const std::vector<Quantity> &quantities, Quantity quantity) {
+    std::vector<Quantity> allocations(quantities.size());
+    AllocateProRata(policy, quantities.data(), allocations.data(), quantities.size(), quantity);
+    return allocations;
+}
+
+} // namespace
+
+TEST(MatchingPolicyTest, AllocatesInProportionToSize) {
+    MatchingPolicy policy{MatchingAlgorithm::ProRata};
+    // Exact shares 2.5, 5, 7.5 and 10; the leftover lot goes to the first order
+    EXPECT_EQ(Allocate(policy, {10, 20, 30, 40}, 25), (std::vector<Quantity>{3, 5, 7, 10}));
+}
+
+TEST(MatchingPolicyTest, LeftoverLotsGoInTimePriority) {
+    MatchingPolicy policy{MatchingAlgorithm::ProRata};
+    EXPECT_EQ(Allocate(policy, {1, 1, 1}, 2), (std::vector<Quantity>{1, 1, 0}));
+    EXPECT_EQ(Allocate(policy, {1, 5, 1}, 3), (std::vector<Quantity>{1, 2, 0}));
+}
+
+TEST(MatchingPolicyTest, FillsTheWholeLevelWhenLarger) {
+    MatchingPolicy policy{MatchingAlgorithm::ProRata};
+    std::vector<Quantity> quantities{4, 6};
+    std::vector<Quantity> allocations(2);
+    EXPECT_EQ(AllocateProRata(policy, quantities.data(), allocations.data(), 2, 50), 10);
+    EXPECT_EQ(allocations, quantities);
+}
+
+TEST(MatchingPolicyTest, TopOrderFillsFirst) {
+    MatchingPolicy policy{MatchingAlgorithm::ProRata, true};
+    // 10 to the top order, then 15 split over 20 and 30
+    EXPECT_EQ(Allocate(policy, {10, 20, 30}, 25), (std::vector<Quantity>{10, 6, 9}));
+}
+
+TEST(MatchingPolicyTest, FifoPercentGoesInTimePriorityFirst) {
+    MatchingPolicy policy{MatchingAlgorithm::ProRata, false, 40};
+    // 8 FIFO to the first order, then 12 pro rata over 2, 20 and 30 left
+    EXPECT_EQ(Allocate(policy, {10, 20, 30}, 20), (std::vector<Quantity>{9, 5, 6}));
+}
+
+TEST(MatchingPolicyTest, NeverExceedsOrderSizes) {
+    MatchingPolicy policy{MatchingAlgorithm::ProRata, true, 25};
+    std::vector<Quantity> quantities;
+    for (Quantity i = 1; i <= 97; ++i)
+        quantities.push_back(i * 7 % 31 + 1);
+
+    for (Quantity quantity = 1; quantity < 1000; quantity += 13) {
+        auto allocations = Allocate(policy, quantities, quantity);
+        Quantity total = 0;
+        for (std::size_t i = 0; i < quantities.size(); ++i) {
+            EXPECT_LE(allocations[i], quantities[i]);
+            total += allocations[i];
+        }
+        EXPECT_EQ(total, quantity);
+    }
+}
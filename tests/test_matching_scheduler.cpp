@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include "../MatchingScheduler.hpp"
+#include "../Orderbook.hpp"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(MatchingSchedulerTest, RunReturnsTheResult) {
+    MatchingScheduler scheduler(2);
+    auto orderbook = std::make_shared<Orderbook>();
+
+    auto trades = scheduler.Run(orderbook, [&] {
+        return orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Buy, 100, 10));
+    });
+    EXPECT_TRUE(trades.empty());
+    trades = scheduler.Run(orderbook, [&] {
+        return orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 2, Side::Sell, 100, 4));
+    });
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].GetBidTrade().quantity_, 4);
+    EXPECT_EQ(scheduler.Run(orderbook, [&] { return orderbook->Size(); }), 1);
+}
+
+TEST(MatchingSchedulerTest, RunRethrows) {
+    MatchingScheduler scheduler(1);
+    auto orderbook = std::make_shared<Orderbook>();
+    EXPECT_THROW(scheduler.Run(orderbook, [] { throw std::runtime_error("failed"); }), std::runtime_error);
+    // The worker survives
+    EXPECT_EQ(scheduler.Run(orderbook, [] { return 7; }), 7);
+}
+
+TEST(MatchingSchedulerTest, BookCommandsRunInOrderOnOneWorkerAtATime) {
+    constexpr int Books = 16;
+    constexpr int Submitters = 4;
+    constexpr int CommandsPerSubmitter = 2000;
+
+    struct Book {
+        std::shared_ptr<Orderbook> orderbook_{std::make_shared<Orderbook>()};
+        std::atomic<int> running_{0};
+        int overlaps_{0};
+        std::vector<int> lastSeen_ = std::vector<int>(Submitters, -1);
+        int outOfOrder_{0};
+        int executed_{0};
+    };
+    std::vector<Book> books(Books);
+
+    {
+        MatchingScheduler scheduler(4);
+        std::vector<std::thread> submitters;
+        for (int submitter = 0; submitter < Submitters; ++submitter) {
+            submitters.emplace_back([&, submitter] {
+                for (int i = 0; i < CommandsPerSubmitter; ++i) {
+                    auto &book = books[(i * 7 + submitter) % Books];
+                    scheduler.Submit(book.orderbook_, [&book, submitter, i] {
+                        if (book.running_.fetch_add(1) != 0)
+                            ++book.overlaps_;
+                        // Each submitter's commands to a book arrive in its order
+                        if (book.lastSeen_[submitter] >= i)
+                            ++book.outOfOrder_;
+                        book.lastSeen_[submitter] = i;
+                        ++book.executed_;
+                        book.running_.fetch_sub(1);
+                    });
+                }
+            });
+        }
+        for (auto &thread : submitters)
+            thread.join();
+        // Destruction finishes everything submitted
+    }
+
+    int executed = 0;
+    for (const auto &book : books) {
+        EXPECT_EQ(book.overlaps_, 0);
+        EXPECT_EQ(book.outOfOrder_, 0);
+        executed += book.executed_;
+    }
+    EXPECT_EQ(executed, Submitters * CommandsPerSubmitter);
+}
+
+TEST(MatchingSchedulerTest, IdleWorkersTakeOtherBooks) {
+    // One book blocks its worker; the other books still run on the rest
+    MatchingScheduler scheduler(2);
+    auto blocked = std::make_shared<Orderbook>();
+    std::atomic<bool> release{false};
+    scheduler.Submit(blocked, [&release] {
+        while (!release.load())
+            std::this_thread::yield();
+    });
+
+    for (int i = 0; i < 8; ++i) {
+        auto orderbook = std::make_shared<Orderbook>();
+        EXPECT_EQ(scheduler.Run(orderbook, [i] { return i; }), i);
+    }
+    release.store(true);
+}
+
+TEST(MatchingSchedulerTest, EveryWaitPolicyHandsOffAndShutsDown) {
+    for (const auto policy : {WaitPolicy::Park(), WaitPolicy::Adaptive(), WaitPolicy::Poll(), WaitPolicy{10, 10, 10}}) {
+        SCOPED_TRACE(testing::Message() << policy.spins_ << "," << policy.pauses_ << "," << policy.yields_);
+        MatchingScheduler scheduler(2, {}, policy, policy);
+        auto orderbook = std::make_shared<Orderbook>();
+
+        std::vector<std::thread> callers;
+        std::atomic<int> wrong{0};
+        for (int caller = 0; caller < 2; ++caller) {
+            callers.emplace_back([&, caller] {
+                for (int i = 0; i < 100; ++i) {
+                    if (scheduler.Run(orderbook, [caller, i] { return caller * 1000 + i; }) != caller * 1000 + i)
+                        ++wrong;
+                    // Let the workers go idle now and then
+                    if (i % 25 == 0)
+                        std::this_thread::sleep_for(std::chrono::milliseconds{2});
+                }
+            });
+        }
+        for (auto &thread : callers)
+            thread.join();
+        EXPECT_EQ(wrong.load(), 0);
+        // Workers that never park still stop when the scheduler does
+    }
+}
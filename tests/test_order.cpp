@@ -108,3 +108,23 @@ TEST_F(OrderTest, QuantityBehavior) {
     EXPECT_EQ(order.GetRemainingQuantity(), 650);
     EXPECT_EQ(order.GetFilledQuantity(), 350);
 }
+
+TEST(OrderIcebergTest, TrancheAccounting) {
+    Order order(OrderType::GoodTillCancel, 1, Side::Buy, 100, 25, 10);
+    EXPECT_TRUE(order.IsIceberg());
+    EXPECT_EQ(order.GetVisibleQuantity(), 10);
+
+    EXPECT_THROW(order.Fill(11), std::logic_error);
+    order.Fill(10);
+    EXPECT_TRUE(order.NeedsReplenish());
+    EXPECT_EQ(order.Replenish(), 10);
+    order.Fill(10);
+    EXPECT_EQ(order.Replenish(), 5);
+    EXPECT_EQ(order.GetRemainingQuantity(), 5);
+}
+
+TEST(OrderIcebergTest, OversizedDisplayIsPlainOrder) {
+    Order order(OrderType::GoodTillCancel, 1, Side::Buy, 100, 25, 25);
+    EXPECT_FALSE(order.IsIceberg());
+    EXPECT_EQ(order.GetVisibleQuantity(), 25);
+}
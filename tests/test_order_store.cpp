@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include "../OrderStore.hpp"
+
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+OrderPointer MakeOrder(OrderId id, Quantity quantity) {
+    return std::make_shared<Order>(OrderType::GoodTillCancel, id, Side::Buy, 100, quantity);
+}
+
+} // namespace
+
+TEST(OrderStoreTest, ReusesReleasedHandles) {
+    OrderStore store;
+    const auto first = store.Add(MakeOrder(1, 10));
+    const auto second = store.Add(MakeOrder(2, 10));
+    EXPECT_NE(first, second);
+    EXPECT_EQ(store.Get(second)->GetOrderId(), 2);
+
+    store.Release(first);
+    EXPECT_EQ(store.Get(first), nullptr);
+    EXPECT_EQ(store.Add(MakeOrder(3, 10)), first);
+}
+
+TEST(OrderStoreTest, FillsUpdateThePackedFieldsOnly) {
+    OrderStore store;
+    auto order = std::make_shared<Order>(OrderType::GoodTillCancel, 7, Side::Sell, 101, 25, 10);
+    order->SetClientId(3);
+    const auto handle = store.Add(order);
+    EXPECT_EQ(store.GetOrderId(handle), 7);
+    EXPECT_EQ(store.GetPrice(handle), 101);
+    EXPECT_EQ(store.GetClientId(handle), 3);
+    EXPECT_EQ(store.GetVisible(handle), 10);
+
+    EXPECT_EQ(store.Fill(handle, 10), 15);
+    EXPECT_THROW(store.Fill(handle, 1), std::logic_error);
+    ASSERT_TRUE(store.NeedsReplenish(handle));
+    EXPECT_EQ(store.Replenish(handle), 10);
+    EXPECT_EQ(store.Fill(handle, 10), 5);
+    EXPECT_EQ(store.Replenish(handle), 5);
+    EXPECT_EQ(store.Fill(handle, 5), 0);
+    EXPECT_FALSE(store.NeedsReplenish(handle));
+
+    // The record keeps the terms the order entered the book with
+    EXPECT_EQ(order->GetRemainingQuantity(), 25);
+}
+
+TEST(LevelQueueTest, FrontSkipsRemovedOrders) {
+    OrderStore store;
+    LevelQueue level;
+    OrderHandle handles[3];
+    for (OrderId id = 0; id < 3; ++id) {
+        handles[id] = store.Add(MakeOrder(id, 10 * (id + 1)));
+        level.PushBack(store, handles[id], 10 * (id + 1));
+    }
+    EXPECT_EQ(level.size(), 3);
+    EXPECT_EQ(level.Visible(), 60);
+
+    // A tombstone in the middle keeps its place with no quantity
+    level.Remove(store.GetPosition(handles[1]));
+    EXPECT_EQ(level.FrontHandle(), handles[0]);
+    EXPECT_EQ(level.Visible(), 40);
+
+    level.Remove(store.GetPosition(handles[0]));
+    EXPECT_EQ(level.FrontHandle(), handles[2]);
+    EXPECT_EQ(level.FrontQuantity(), 30);
+    EXPECT_EQ(level.size(), 1);
+
+    level.Remove(store.GetPosition(handles[2]));
+    EXPECT_TRUE(level.empty());
+    EXPECT_EQ(level.Span(), 0);
+}
+
+TEST(LevelQueueTest, CompactionKeepsTimePriorityAndPositions) {
+    OrderStore store;
+    LevelQueue level;
+    std::vector<OrderHandle> handles;
+    for (OrderId id = 0; id < 40; ++id) {
+        handles.push_back(store.Add(MakeOrder(id, 1)));
+        level.PushBack(store, handles.back(), 1);
+    }
+
+    // Remove all but every fourth order, then append to trigger compaction
+    for (OrderId id = 0; id < 40; ++id) {
+        if (id % 4 != 0)
+            level.Remove(store.GetPosition(handles[id]));
+    }
+    const auto last = store.Add(MakeOrder(40, 1));
+    level.PushBack(store, last, 1);
+    EXPECT_EQ(level.Span(), level.size());
+
+    for (std::size_t i = 0; i < level.Span(); ++i) {
+        const auto handle = level.Handles()[i];
+        EXPECT_EQ(store.GetPosition(handle), i);
+        EXPECT_EQ(store.Get(handle)->GetOrderId(), i == level.Span() - 1 ? 40 : i * 4);
+    }
+}
@@ -2,7 +2,13 @@
 #include "../Orderbook.hpp"
 #include "../Order.hpp"
 #include "../OrderModify.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 class OrderbookTest : public ::testing::Test {
 protected:
@@ -230,6 +236,19 @@ TEST_F(OrderbookTest, FillOrKillOrderFailure) {
     EXPECT_EQ(orderbook->Size(), 1);  // Original sell order should remain
 }
 
+TEST_F(OrderbookTest, FillOrKillChecksDepthAcrossManyLevels) {
+    // More levels than CanFullyFill gathers per block
+    for (OrderId id = 1; id <= 100; ++id)
+        orderbook->AddOrder(CreateOrder(id, Side::Sell, static_cast<Price>(100 + id), 10));
+
+    // 70 levels reach 170 and hold 700; one lot more is refused
+    EXPECT_TRUE(orderbook->AddOrder(CreateOrder(101, Side::Buy, 170, 701, OrderType::FillOrKill)).empty());
+    EXPECT_EQ(orderbook->Size(), 100);
+
+    EXPECT_EQ(orderbook->AddOrder(CreateOrder(102, Side::Buy, 170, 700, OrderType::FillOrKill)).size(), 70);
+    EXPECT_EQ(orderbook->Size(), 30);
+}
+
 TEST_F(OrderbookTest, InvalidOrderRejection) {
     // Test null order
     auto trades1 = orderbook->AddOrder(nullptr);
@@ -253,3 +272,653 @@ TEST_F(OrderbookTest, DuplicateOrderId) {
     EXPECT_TRUE(trades.empty());
     EXPECT_EQ(orderbook->Size(), 1);  // Only first order should remain
 }
+
+TEST_F(OrderbookTest, IcebergShowsOnlyDisplayTranche) {
+    orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Buy, 100, 1000, 100));
+
+    auto orderInfos = orderbook->GetOrderInfos();
+    ASSERT_EQ(orderInfos.GetBids().size(), 1);
+    EXPECT_EQ(orderInfos.GetBids()[0].quantity_, 100);
+}
+
+TEST_F(OrderbookTest, IcebergReplenishLosesTimePriority) {
+    orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Buy, 100, 30, 10));
+    orderbook->AddOrder(CreateOrder(2, Side::Buy, 100, 10));
+
+    // Takes the first tranche of order 1, then order 2 is ahead of the refilled tranche
+    auto trades = orderbook->AddOrder(CreateOrder(3, Side::Sell, 100, 15));
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].GetBidTrade().orderId_, 1);
+    EXPECT_EQ(trades[0].GetBidTrade().quantity_, 10);
+    EXPECT_EQ(trades[1].GetBidTrade().orderId_, 2);
+    EXPECT_EQ(trades[1].GetBidTrade().quantity_, 5);
+
+    auto orderInfos = orderbook->GetOrderInfos();
+    ASSERT_EQ(orderInfos.GetBids().size(), 1);
+    EXPECT_EQ(orderInfos.GetBids()[0].quantity_, 15);  // 5 left of order 2 + a fresh tranche of 10
+}
+
+TEST_F(OrderbookTest, IcebergFillsAcrossTranches) {
+    orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Sell, 100, 25, 10));
+
+    auto trades = orderbook->AddOrder(CreateOrder(2, Side::Buy, 100, 25));
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[2].GetAskTrade().quantity_, 5);
+    EXPECT_EQ(orderbook->Size(), 0);
+    EXPECT_TRUE(orderbook->GetOrderInfos().GetAsks().empty());
+}
+
+TEST_F(OrderbookTest, CancelIcebergClearsLevel) {
+    orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Buy, 100, 30, 10));
+    orderbook->AddOrder(CreateOrder(2, Side::Sell, 100, 12));
+    orderbook->CancelOrder(1);
+
+    EXPECT_EQ(orderbook->Size(), 0);
+    EXPECT_TRUE(orderbook->GetOrderInfos().GetBids().empty());
+
+    // The level aggregates are gone too, so a fill-or-kill cannot see phantom liquidity
+    auto trades = orderbook->AddOrder(CreateOrder(3, Side::Sell, 100, 1, OrderType::FillOrKill));
+    EXPECT_TRUE(trades.empty());
+}
+
+TEST_F(OrderbookTest, StopOrderParksUntilTriggered) {
+    auto stop = CreateOrder(1, Side::Buy, 105, 10);
+    stop->SetStopPrice(102);
+    EXPECT_TRUE(orderbook->AddOrder(stop).empty());
+
+    EXPECT_EQ(orderbook->Size(), 1);
+    EXPECT_TRUE(orderbook->GetOrderInfos().GetBids().empty());
+
+    // A trade below the stop leaves it parked
+    orderbook->AddOrder(CreateOrder(2, Side::Sell, 101, 5));
+    orderbook->AddOrder(CreateOrder(3, Side::Buy, 101, 5));
+    EXPECT_TRUE(orderbook->GetOrderInfos().GetBids().empty());
+
+    // A trade at the stop price releases it as a limit buy at 105, which takes the resting ask
+    orderbook->AddOrder(CreateOrder(4, Side::Sell, 103, 4));
+    orderbook->AddOrder(CreateOrder(5, Side::Sell, 102, 1));
+    auto trades = orderbook->AddOrder(CreateOrder(6, Side::Buy, 102, 1));
+
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[1].GetBidTrade().orderId_, 1);
+    EXPECT_EQ(trades[1].GetAskTrade().orderId_, 4);
+    EXPECT_EQ(trades[1].GetBidTrade().quantity_, 4);
+
+    auto orderInfos = orderbook->GetOrderInfos();
+    ASSERT_EQ(orderInfos.GetBids().size(), 1);
+    EXPECT_EQ(orderInfos.GetBids()[0].price_, 105);
+    EXPECT_EQ(orderInfos.GetBids()[0].quantity_, 6);
+}
+
+TEST_F(OrderbookTest, StopCascadeIsDrained) {
+    orderbook->AddOrder(CreateOrder(1, Side::Buy, 100, 1));
+    orderbook->AddOrder(CreateOrder(2, Side::Buy, 99, 1));
+    orderbook->AddOrder(CreateOrder(3, Side::Buy, 98, 5));
+
+    auto first = std::make_shared<Order>(10, Side::Sell, 1);
+    first->SetStopPrice(100);
+    auto second = std::make_shared<Order>(11, Side::Sell, 1);
+    second->SetStopPrice(99);
+    orderbook->AddOrder(first);
+    orderbook->AddOrder(second);
+
+    // Trade at 100 triggers the first stop, whose trade at 99 triggers the second
+    auto trades = orderbook->AddOrder(CreateOrder(20, Side::Sell, 100, 1));
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[1].GetAskTrade().orderId_, 10);
+    EXPECT_EQ(trades[1].GetBidTrade().orderId_, 2);
+    EXPECT_EQ(trades[2].GetAskTrade().orderId_, 11);
+    EXPECT_EQ(trades[2].GetBidTrade().orderId_, 3);
+
+    auto orderInfos = orderbook->GetOrderInfos();
+    ASSERT_EQ(orderInfos.GetBids().size(), 1);
+    EXPECT_EQ(orderInfos.GetBids()[0].quantity_, 4);
+}
+
+TEST_F(OrderbookTest, TriggeredStopsReleaseInPriceTimeOrder) {
+    const OrderId stopIds[] = {1, 2, 3};
+    const Price stopPrices[] = {101, 100, 100};
+    for (int i = 0; i < 3; ++i) {
+        auto stop = CreateOrder(stopIds[i], Side::Buy, 110, 1);
+        stop->SetStopPrice(stopPrices[i]);
+        orderbook->AddOrder(stop);
+    }
+
+    orderbook->AddOrder(CreateOrder(10, Side::Sell, 101, 1));
+    orderbook->AddOrder(CreateOrder(11, Side::Sell, 105, 3));
+    auto trades = orderbook->AddOrder(CreateOrder(12, Side::Buy, 101, 1));
+
+    ASSERT_EQ(trades.size(), 4);
+    EXPECT_EQ(trades[1].GetBidTrade().orderId_, 2);
+    EXPECT_EQ(trades[2].GetBidTrade().orderId_, 3);
+    EXPECT_EQ(trades[3].GetBidTrade().orderId_, 1);
+}
+
+TEST_F(OrderbookTest, StopThroughLastTradeTriggersImmediately) {
+    orderbook->AddOrder(CreateOrder(1, Side::Sell, 100, 1));
+    orderbook->AddOrder(CreateOrder(2, Side::Buy, 100, 1));
+
+    auto stop = CreateOrder(3, Side::Buy, 100, 1);
+    stop->SetStopPrice(99);
+    orderbook->AddOrder(stop);
+
+    auto orderInfos = orderbook->GetOrderInfos();
+    ASSERT_EQ(orderInfos.GetBids().size(), 1);
+    EXPECT_EQ(orderInfos.GetBids()[0].price_, 100);
+}
+
+TEST_F(OrderbookTest, CancelParkedStop) {
+    auto stop = CreateOrder(1, Side::Sell, 90, 10);
+    stop->SetStopPrice(95);
+    orderbook->AddOrder(stop);
+    orderbook->CancelOrder(1);
+    EXPECT_EQ(orderbook->Size(), 0);
+
+    // Nothing is left to trigger
+    orderbook->AddOrder(CreateOrder(2, Side::Buy, 95, 1));
+    auto trades = orderbook->AddOrder(CreateOrder(3, Side::Sell, 95, 1));
+    EXPECT_EQ(trades.size(), 1);
+    EXPECT_EQ(orderbook->Size(), 0);
+}
+
+TEST_F(OrderbookTest, PrimaryPegFollowsBestBid) {
+    orderbook->AddOrder(CreateOrder(1, Side::Buy, 100, 10));
+    auto peg = std::make_shared<Order>(OrderType::GoodTillCancel, 2, Side::Buy, Constants::InvalidPrice, 5);
+    peg->SetPeg(PegType::Primary, 0);
+    orderbook->AddOrder(peg);
+    EXPECT_EQ(peg->GetPrice(), 100);
+
+    orderbook->AddOrder(CreateOrder(3, Side::Buy, 101, 10));
+    EXPECT_EQ(peg->GetPrice(), 101);
+
+    auto orderInfos = orderbook->GetOrderInfos();
+    ASSERT_EQ(orderInfos.GetBids().size(), 2);
+    EXPECT_EQ(orderInfos.GetBids()[0].quantity_, 15);
+    EXPECT_EQ(orderInfos.GetBids()[1].quantity_, 10);
+
+    // The peg joined the back of 101, so order 3 trades first
+    auto trades = orderbook->AddOrder(CreateOrder(4, Side::Sell, 101, 12));
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].GetBidTrade().orderId_, 3);
+    EXPECT_EQ(trades[1].GetBidTrade().orderId_, 2);
+    EXPECT_EQ(trades[1].GetBidTrade().quantity_, 2);
+
+    // With 101 left to the peg alone, it drops back to the best non-pegged bid
+    EXPECT_EQ(peg->GetPrice(), 100);
+}
+
+TEST_F(OrderbookTest, MidpointAndMarketPegsStayPassive) {
+    orderbook->AddOrder(CreateOrder(1, Side::Buy, 100, 10));
+    orderbook->AddOrder(CreateOrder(2, Side::Sell, 103, 10));
+
+    auto midBuy = std::make_shared<Order>(OrderType::GoodTillCancel, 3, Side::Buy, Constants::InvalidPrice, 5);
+    midBuy->SetPeg(PegType::Midpoint, 0);
+    auto midSell = std::make_shared<Order>(OrderType::GoodTillCancel, 4, Side::Sell, Constants::InvalidPrice, 5);
+    midSell->SetPeg(PegType::Midpoint, 0);
+    auto marketBuy = std::make_shared<Order>(OrderType::GoodTillCancel, 5, Side::Buy, Constants::InvalidPrice, 5);
+    marketBuy->SetPeg(PegType::Market, 0);
+
+    EXPECT_TRUE(orderbook->AddOrder(midBuy).empty());
+    EXPECT_TRUE(orderbook->AddOrder(midSell).empty());
+    EXPECT_EQ(midBuy->GetPrice(), 101);
+    EXPECT_EQ(midSell->GetPrice(), 102);
+
+    // Capped one tick inside the offer, where it meets the midpoint sell peg
+    auto trades = orderbook->AddOrder(marketBuy);
+    EXPECT_EQ(marketBuy->GetPrice(), 102);
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].GetBidTrade().orderId_, 5);
+    EXPECT_EQ(trades[0].GetAskTrade().orderId_, 4);
+
+    // Neither peg touched the non-pegged orders
+    auto orderInfos = orderbook->GetOrderInfos();
+    EXPECT_EQ(orderInfos.GetBids().front().price_, 101);
+    EXPECT_EQ(orderInfos.GetAsks().front().price_, 103);
+}
+
+TEST_F(OrderbookTest, PegRespectsLimitPrice) {
+    orderbook->AddOrder(CreateOrder(1, Side::Buy, 100, 10));
+    auto peg = std::make_shared<Order>(OrderType::GoodTillCancel, 2, Side::Buy, 101, 5);
+    peg->SetPeg(PegType::Primary, 1);
+    orderbook->AddOrder(peg);
+    EXPECT_EQ(peg->GetPrice(), 101);
+
+    orderbook->AddOrder(CreateOrder(3, Side::Buy, 104, 10));
+    EXPECT_EQ(peg->GetPrice(), 101);
+}
+
+TEST_F(OrderbookTest, PegWithoutReferenceIsRejected) {
+    auto peg = std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Sell, Constants::InvalidPrice, 5);
+    peg->SetPeg(PegType::Primary, 0);
+    EXPECT_TRUE(orderbook->AddOrder(peg).empty());
+    EXPECT_EQ(orderbook->Size(), 0);
+}
+
+TEST_F(OrderbookTest, CancelledPegNoLongerMoves) {
+    orderbook->AddOrder(CreateOrder(1, Side::Sell, 105, 10));
+    auto peg = std::make_shared<Order>(OrderType::GoodTillCancel, 2, Side::Sell, Constants::InvalidPrice, 5);
+    peg->SetPeg(PegType::Primary, 1);
+    orderbook->AddOrder(peg);
+    EXPECT_EQ(peg->GetPrice(), 106);
+
+    orderbook->CancelOrder(2);
+    orderbook->AddOrder(CreateOrder(3, Side::Sell, 104, 10));
+    EXPECT_EQ(peg->GetPrice(), 106);
+    EXPECT_EQ(orderbook->Size(), 2);
+    EXPECT_EQ(orderbook->GetOrderInfos().GetAsks().size(), 2);
+}
+
+TEST_F(OrderbookTest, MassQuoteRestsBothSides) {
+    auto result = orderbook->MassQuote(7, 1, {{Side::Buy, 99, 10}, {Side::Sell, 101, 10}});
+    ASSERT_TRUE(result.accepted_);
+    EXPECT_TRUE(result.trades_.empty());
+    ASSERT_EQ(result.orderIds_.size(), 2);
+    EXPECT_GE(result.orderIds_[0], Orderbook::QuoteOrderIdBase);
+    EXPECT_NE(result.orderIds_[0], result.orderIds_[1]);
+    EXPECT_TRUE(orderbook->OrderExists(result.orderIds_[1]));
+    EXPECT_EQ(orderbook->Size(), 2);
+}
+
+TEST_F(OrderbookTest, MassQuoteUnchangedEntryKeepsPriority) {
+    auto first = orderbook->MassQuote(7, 1, {{Side::Buy, 99, 10}, {Side::Sell, 101, 10}});
+    orderbook->AddOrder(CreateOrder(1, Side::Buy, 99, 10));
+
+    // Only the offer moves; the bid stays ahead of order 1
+    auto second = orderbook->MassQuote(7, 1, {{Side::Buy, 99, 10}, {Side::Sell, 102, 10}});
+    ASSERT_TRUE(second.accepted_);
+    EXPECT_EQ(second.orderIds_, first.orderIds_);
+
+    auto trades = orderbook->AddOrder(CreateOrder(2, Side::Sell, 99, 5));
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].GetBidTrade().orderId_, first.orderIds_[0]);
+
+    auto orderInfos = orderbook->GetOrderInfos();
+    ASSERT_EQ(orderInfos.GetAsks().size(), 1);
+    EXPECT_EQ(orderInfos.GetAsks()[0].price_, 102);
+}
+
+TEST_F(OrderbookTest, MassQuoteSizeChangeLosesPriority) {
+    auto first = orderbook->MassQuote(7, 1, {{Side::Buy, 99, 10}});
+    orderbook->AddOrder(CreateOrder(1, Side::Buy, 99, 10));
+
+    auto second = orderbook->MassQuote(7, 1, {{Side::Buy, 99, 20}});
+    EXPECT_EQ(second.orderIds_, first.orderIds_);  // Rewritten in place
+    EXPECT_EQ(orderbook->GetOrderInfos().GetBids()[0].quantity_, 30);
+
+    auto trades = orderbook->AddOrder(CreateOrder(2, Side::Sell, 99, 5));
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].GetBidTrade().orderId_, 1);
+}
+
+TEST_F(OrderbookTest, MassQuotePullsZeroAndDroppedEntries) {
+    orderbook->MassQuote(7, 1, {{Side::Buy, 98, 10}, {Side::Buy, 99, 10}, {Side::Sell, 101, 10}});
+
+    auto result = orderbook->MassQuote(7, 1, {{Side::Buy, 98, 0}, {Side::Buy, 99, 10}});
+    ASSERT_TRUE(result.accepted_);
+    EXPECT_EQ(result.orderIds_[0], 0);
+    EXPECT_EQ(orderbook->Size(), 1);
+
+    auto orderInfos = orderbook->GetOrderInfos();
+    ASSERT_EQ(orderInfos.GetBids().size(), 1);
+    EXPECT_EQ(orderInfos.GetBids()[0].price_, 99);
+    EXPECT_TRUE(orderInfos.GetAsks().empty());
+
+    // Sets of other clients are separate
+    orderbook->MassQuote(8, 1, {{Side::Sell, 101, 10}});
+    orderbook->MassQuote(7, 1, {});
+    EXPECT_EQ(orderbook->Size(), 1);
+    EXPECT_EQ(orderbook->GetOrderInfos().GetAsks().size(), 1);
+}
+
+TEST_F(OrderbookTest, ModifyRejectsQuoteIds) {
+    auto first = orderbook->MassQuote(7, 1, {{Side::Buy, 99, 10}});
+    ASSERT_EQ(first.orderIds_.size(), 1);
+
+    auto trades = orderbook->ModifyOrder(OrderModify(first.orderIds_[0], Side::Buy, 97, 10));
+    EXPECT_TRUE(trades.empty());
+    ASSERT_EQ(orderbook->GetOrderInfos().GetBids().size(), 1);
+    EXPECT_EQ(orderbook->GetOrderInfos().GetBids()[0].price_, 99);
+
+    // The quote set still owns the order and can move it
+    auto second = orderbook->MassQuote(7, 1, {{Side::Buy, 98, 10}});
+    EXPECT_EQ(second.orderIds_, first.orderIds_);
+    auto orderInfos = orderbook->GetOrderInfos();
+    ASSERT_EQ(orderInfos.GetBids().size(), 1);
+    EXPECT_EQ(orderInfos.GetBids()[0].price_, 98);
+    EXPECT_EQ(orderbook->Size(), 1);
+}
+
+TEST_F(OrderbookTest, MassQuoteTradesAndRequotesFilledSlot) {
+    orderbook->AddOrder(CreateOrder(1, Side::Sell, 100, 4));
+
+    auto first = orderbook->MassQuote(7, 1, {{Side::Buy, 100, 4}});
+    ASSERT_EQ(first.trades_.size(), 1);
+    EXPECT_EQ(first.trades_[0].GetAskTrade().orderId_, 1);
+    EXPECT_EQ(orderbook->Size(), 0);
+
+    // The filled slot gets a new order
+    auto second = orderbook->MassQuote(7, 1, {{Side::Buy, 100, 4}});
+    EXPECT_TRUE(second.trades_.empty());
+    EXPECT_NE(second.orderIds_[0], first.orderIds_[0]);
+    EXPECT_EQ(orderbook->Size(), 1);
+}
+
+TEST_F(OrderbookTest, MassQuoteRejectsSelfCrossingSet) {
+    orderbook->MassQuote(7, 1, {{Side::Buy, 99, 10}});
+
+    auto result = orderbook->MassQuote(7, 1, {{Side::Buy, 101, 10}, {Side::Sell, 100, 10}});
+    EXPECT_FALSE(result.accepted_);
+    EXPECT_TRUE(result.orderIds_.empty());
+
+    // The previous quote is untouched
+    auto orderInfos = orderbook->GetOrderInfos();
+    ASSERT_EQ(orderInfos.GetBids().size(), 1);
+    EXPECT_EQ(orderInfos.GetBids()[0].price_, 99);
+    EXPECT_TRUE(orderInfos.GetAsks().empty());
+}
+
+TEST_F(OrderbookTest, MassCancelFiltersBySideAndPrice) {
+    OrderId id = 1;
+    for (auto price : {98, 99, 100}) {
+        auto order = CreateOrder(id++, Side::Buy, price, 10);
+        order->SetClientId(7);
+        orderbook->AddOrder(order);
+    }
+    for (auto price : {102, 103}) {
+        auto order = CreateOrder(id++, Side::Sell, price, 10);
+        order->SetClientId(7);
+        orderbook->AddOrder(order);
+    }
+    auto other = CreateOrder(id++, Side::Buy, 99, 10);
+    other->SetClientId(8);
+    orderbook->AddOrder(other);
+
+    EXPECT_EQ(orderbook->MassCancel(7, Side::Buy, 99, 100), 2);
+    EXPECT_EQ(orderbook->Size(), 4);
+    EXPECT_TRUE(orderbook->OrderExists(1));
+
+    EXPECT_EQ(orderbook->MassCancel(7, Side::Sell), 2);
+    EXPECT_EQ(orderbook->MassCancel(7), 1);
+    EXPECT_EQ(orderbook->MassCancel(7), 0);
+    EXPECT_EQ(orderbook->Size(), 1);
+    EXPECT_TRUE(orderbook->OrderExists(other->GetOrderId()));
+}
+
+TEST_F(OrderbookTest, MassCancelSkipsFilledAndCoversStopsAndQuotes) {
+    auto resting = CreateOrder(1, Side::Sell, 100, 10);
+    resting->SetClientId(7);
+    orderbook->AddOrder(resting);
+    auto stop = CreateOrder(2, Side::Buy, 110, 10);
+    stop->SetStopPrice(105);
+    stop->SetClientId(7);
+    orderbook->AddOrder(stop);
+    orderbook->MassQuote(7, 1, {{Side::Buy, 90, 10}, {Side::Sell, 120, 10}});
+
+    // Filling order 1 takes it off the client's list
+    orderbook->AddOrder(CreateOrder(3, Side::Buy, 100, 10));
+    EXPECT_EQ(orderbook->Size(), 3);
+
+    EXPECT_EQ(orderbook->MassCancel(7), 3);
+    EXPECT_EQ(orderbook->Size(), 0);
+    EXPECT_TRUE(orderbook->GetOrderInfos().GetBids().empty());
+}
+
+TEST_F(OrderbookTest, RiskLimitsRejectAndTrackFills) {
+    RiskLimits limits;
+    limits.maxOpenOrders_ = 1;
+    limits.maxPosition_ = 10;
+    ASSERT_TRUE(orderbook->SetRiskLimits(7, limits));
+
+    auto first = CreateOrder(1, Side::Buy, 100, 10);
+    first->SetClientId(7);
+    auto check = RiskCheck::OpenOrders;
+    orderbook->AddOrder(first, &check);
+    EXPECT_EQ(check, RiskCheck::Passed);
+
+    auto second = CreateOrder(2, Side::Buy, 99, 5);
+    second->SetClientId(7);
+    EXPECT_TRUE(orderbook->AddOrder(second, &check).empty());
+    EXPECT_EQ(check, RiskCheck::OpenOrders);
+    EXPECT_FALSE(orderbook->OrderExists(2));
+
+    // Filling order 1 frees the slot but leaves the client long 10
+    orderbook->AddOrder(CreateOrder(3, Side::Sell, 100, 10));
+    orderbook->AddOrder(second, &check);
+    EXPECT_EQ(check, RiskCheck::Position);
+
+    auto sell = CreateOrder(4, Side::Sell, 101, 10);
+    sell->SetClientId(7);
+    orderbook->AddOrder(sell, &check);
+    EXPECT_EQ(check, RiskCheck::Passed);
+
+    // A modify takes over the slot it replaces but is still size checked
+    EXPECT_TRUE(orderbook->ModifyOrder(OrderModify(4, Side::Sell, 102, 21), &check).empty());
+    EXPECT_EQ(check, RiskCheck::Position);
+    EXPECT_TRUE(orderbook->OrderExists(4));
+    orderbook->ModifyOrder(OrderModify(4, Side::Sell, 102, 20), &check);
+    EXPECT_EQ(check, RiskCheck::Passed);
+}
+
+TEST_F(OrderbookTest, AuctionUncrossesAtOnePrice) {
+    orderbook->StartAuction();
+    EXPECT_EQ(orderbook->GetTradingPhase(), TradingPhase::Auction);
+
+    EXPECT_TRUE(orderbook->AddOrder(CreateOrder(1, Side::Buy, 102, 10)).empty());
+    EXPECT_TRUE(orderbook->AddOrder(CreateOrder(2, Side::Buy, 101, 10)).empty());
+    EXPECT_TRUE(orderbook->AddOrder(CreateOrder(3, Side::Buy, 100, 10)).empty());
+    EXPECT_TRUE(orderbook->AddOrder(CreateOrder(4, Side::Sell, 99, 15)).empty());
+    EXPECT_TRUE(orderbook->AddOrder(CreateOrder(5, Side::Sell, 101, 10)).empty());
+    EXPECT_EQ(orderbook->Size(), 5);
+
+    auto indicative = orderbook->GetIndicativeUncross();
+    ASSERT_TRUE(indicative);
+    EXPECT_EQ(indicative->price_, 101);
+    EXPECT_EQ(indicative->volume_, 20);
+
+    auto result = orderbook->Uncross();
+    EXPECT_EQ(orderbook->GetTradingPhase(), TradingPhase::Continuous);
+    ASSERT_TRUE(result.equilibrium_);
+    Quantity volume = 0;
+    for (const auto &trade : result.trades_) {
+        EXPECT_EQ(trade.GetBidTrade().price_, 101);
+        EXPECT_EQ(trade.GetAskTrade().price_, 101);
+        volume += trade.GetBidTrade().quantity_;
+    }
+    EXPECT_EQ(volume, 20);
+
+    // Orders 3 and the rest of order 5 remain, uncrossed
+    auto orderInfos = orderbook->GetOrderInfos();
+    ASSERT_EQ(orderInfos.GetBids().size(), 1);
+    EXPECT_EQ(orderInfos.GetBids()[0].price_, 100);
+    ASSERT_EQ(orderInfos.GetAsks().size(), 1);
+    EXPECT_EQ(orderInfos.GetAsks()[0].price_, 101);
+    EXPECT_EQ(orderInfos.GetAsks()[0].quantity_, 5);
+
+    // Back to continuous matching
+    EXPECT_EQ(orderbook->AddOrder(CreateOrder(6, Side::Buy, 101, 5)).size(), 1);
+}
+
+TEST_F(OrderbookTest, AuctionRejectsImmediateOrdersAndTriggersStops) {
+    orderbook->StartAuction();
+    orderbook->AddOrder(CreateOrder(1, Side::Buy, 100, 10));
+    EXPECT_TRUE(orderbook->AddOrder(CreateOrder(2, Side::Sell, 100, 5, OrderType::FillAndKill)).empty());
+    EXPECT_FALSE(orderbook->OrderExists(2));
+
+    auto stop = CreateOrder(3, Side::Sell, 95, 5);
+    stop->SetStopPrice(100);
+    orderbook->AddOrder(stop);
+    orderbook->AddOrder(CreateOrder(4, Side::Sell, 100, 5));
+    EXPECT_EQ(orderbook->Size(), 3);
+
+    // The uncross prints at 100, which triggers the stop into the remaining bid
+    auto result = orderbook->Uncross();
+    ASSERT_EQ(result.trades_.size(), 2);
+    EXPECT_EQ(result.trades_[1].GetAskTrade().orderId_, 3);
+    EXPECT_EQ(orderbook->Size(), 0);
+}
+
+TEST_F(OrderbookTest, FrequentBatchClearsEachIntervalAtOnePrice) {
+    std::mutex mutex;
+    std::condition_variable batchCleared;
+    std::vector<AuctionResult> batches;
+    orderbook->SetBatchListener([&](const AuctionResult &result) {
+        std::scoped_lock lock{mutex};
+        batches.push_back(result);
+        batchCleared.notify_one();
+    });
+
+    orderbook->StartFrequentBatchAuctions(std::chrono::milliseconds{1});
+    EXPECT_EQ(orderbook->GetTradingPhase(), TradingPhase::FrequentBatch);
+
+    // Nothing matches on arrival; the batch thread clears the cross
+    EXPECT_TRUE(orderbook->AddOrder(CreateOrder(1, Side::Buy, 102, 10)).empty());
+    EXPECT_TRUE(orderbook->AddOrder(CreateOrder(2, Side::Sell, 100, 10)).empty());
+    EXPECT_TRUE(orderbook->AddOrder(CreateOrder(3, Side::Sell, 100, 5, OrderType::FillAndKill)).empty());
+    EXPECT_FALSE(orderbook->OrderExists(3));
+
+    {
+        std::unique_lock lock{mutex};
+        ASSERT_TRUE(batchCleared.wait_for(lock, std::chrono::seconds{5}, [&] { return !batches.empty(); }));
+        ASSERT_TRUE(batches[0].equilibrium_);
+        ASSERT_EQ(batches[0].trades_.size(), 1);
+        EXPECT_EQ(batches[0].trades_[0].GetBidTrade().price_, batches[0].equilibrium_->price_);
+        EXPECT_EQ(batches[0].trades_[0].GetAskTrade().price_, batches[0].equilibrium_->price_);
+        EXPECT_EQ(batches[0].trades_[0].GetBidTrade().quantity_, 10);
+    }
+    EXPECT_EQ(orderbook->Size(), 0);
+    EXPECT_EQ(orderbook->GetTradingPhase(), TradingPhase::FrequentBatch);
+
+    // Uncrossing stops the batch thread and resumes continuous matching
+    orderbook->AddOrder(CreateOrder(4, Side::Buy, 101, 5));
+    orderbook->Uncross();
+    EXPECT_EQ(orderbook->GetTradingPhase(), TradingPhase::Continuous);
+    EXPECT_EQ(orderbook->AddOrder(CreateOrder(5, Side::Sell, 101, 5)).size(), 1);
+}
+
+TEST_F(OrderbookTest, ProRataSharesAnIncomingOrderAcrossTheLevel) {
+    orderbook->SetMatchingPolicy(MatchingPolicy{MatchingAlgorithm::ProRata});
+    orderbook->AddOrder(CreateOrder(1, Side::Sell, 100, 10));
+    orderbook->AddOrder(CreateOrder(2, Side::Sell, 100, 30));
+    orderbook->AddOrder(CreateOrder(3, Side::Sell, 101, 10));
+
+    auto trades = orderbook->AddOrder(CreateOrder(4, Side::Buy, 100, 20));
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].GetAskTrade().orderId_, 1);
+    EXPECT_EQ(trades[0].GetAskTrade().quantity_, 5);
+    EXPECT_EQ(trades[1].GetAskTrade().orderId_, 2);
+    EXPECT_EQ(trades[1].GetAskTrade().quantity_, 15);
+    EXPECT_FALSE(orderbook->OrderExists(4));
+
+    // A larger order takes the rest of the level, then moves on to the next
+    trades = orderbook->AddOrder(CreateOrder(5, Side::Buy, 101, 25));
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[2].GetAskTrade().orderId_, 3);
+    EXPECT_EQ(trades[2].GetAskTrade().quantity_, 5);
+    EXPECT_EQ(orderbook->Size(), 1);
+}
+
+TEST_F(OrderbookTest, ProRataSharesTheRestingSideWhenTheAggressorsLevelIsDeep) {
+    orderbook->SetMatchingPolicy(MatchingPolicy{MatchingAlgorithm::ProRata});
+    orderbook->AddOrder(CreateOrder(1, Side::Buy, 100, 10));
+    orderbook->AddOrder(CreateOrder(2, Side::Sell, 110, 10));
+
+    // Pegs cross only each other: two buy pegs at 105, and two sell pegs at
+    // 107 that move together
+    auto peg = [](OrderId id, Side side, Price offset, Quantity quantity) {
+        auto order = std::make_shared<Order>(OrderType::GoodTillCancel, id, side, Constants::InvalidPrice, quantity);
+        order->SetPeg(PegType::Primary, offset);
+        return order;
+    };
+    orderbook->AddOrder(peg(3, Side::Buy, 5, 10));
+    orderbook->AddOrder(peg(4, Side::Buy, 5, 30));
+    auto sellPeg1 = peg(5, Side::Sell, -3, 4);
+    auto sellPeg2 = peg(6, Side::Sell, -3, 4);
+    orderbook->AddOrder(sellPeg1);
+    orderbook->AddOrder(sellPeg2);
+    ASSERT_EQ(sellPeg1->GetPrice(), 107);
+
+    // A better offer moves both sell pegs onto the buy pegs at once. The sells
+    // are the aggressors, so each is shared across the bids rather than the
+    // first bid filling both FIFO.
+    auto trades = orderbook->AddOrder(CreateOrder(7, Side::Sell, 108, 10));
+    ASSERT_EQ(sellPeg1->GetPrice(), 105);
+    std::map<OrderId, Quantity> bought;
+    for (const auto &trade : trades)
+        bought[trade.GetBidTrade().orderId_] += trade.GetBidTrade().quantity_;
+    EXPECT_EQ(bought[3], 2);
+    EXPECT_EQ(bought[4], 6);
+}
+
+TEST_F(OrderbookTest, DeepLevelSurvivesCancelsAndRefills) {
+    // Cancel most of a deep level so it compacts, then sweep what is left
+    for (OrderId id = 1; id <= 64; ++id)
+        orderbook->AddOrder(CreateOrder(id, Side::Sell, 100, 10));
+    for (OrderId id = 1; id <= 64; ++id) {
+        if (id % 8 != 0)
+            orderbook->CancelOrder(id);
+    }
+    orderbook->AddOrder(CreateOrder(65, Side::Sell, 100, 10));
+    EXPECT_EQ(orderbook->Size(), 9);
+    EXPECT_EQ(orderbook->GetOrderInfos().GetAsks()[0].quantity_, 90);
+
+    auto trades = orderbook->AddOrder(CreateOrder(66, Side::Buy, 100, 85));
+    ASSERT_EQ(trades.size(), 9);
+    for (std::size_t i = 0; i < 8; ++i)
+        EXPECT_EQ(trades[i].GetAskTrade().orderId_, (i + 1) * 8);
+    EXPECT_EQ(trades[8].GetAskTrade().orderId_, 65);
+    EXPECT_EQ(trades[8].GetAskTrade().quantity_, 5);
+    EXPECT_EQ(orderbook->GetOrderInfos().GetAsks()[0].quantity_, 5);
+}
+
+TEST_F(OrderbookTest, VisitLevelsReservesThenVisitsBestFirst) {
+    orderbook->AddOrder(CreateOrder(1, Side::Buy, 99, 10));
+    orderbook->AddOrder(CreateOrder(2, Side::Buy, 100, 20));
+    orderbook->AddOrder(CreateOrder(3, Side::Buy, 100, 5));
+    orderbook->AddOrder(CreateOrder(4, Side::Sell, 102, 7));
+
+    std::size_t reservedBids = 0, reservedAsks = 0;
+    std::vector<std::pair<Side, LevelInfo>> visited;
+    orderbook->VisitLevels([&](std::size_t bidLevels, std::size_t askLevels) {
+        EXPECT_TRUE(visited.empty());
+        reservedBids = bidLevels;
+        reservedAsks = askLevels;
+    }, [&](Side side, const LevelInfo &level) {
+        visited.emplace_back(side, level);
+    });
+
+    EXPECT_EQ(reservedBids, 2u);
+    EXPECT_EQ(reservedAsks, 1u);
+    ASSERT_EQ(visited.size(), 3u);
+    EXPECT_EQ(visited[0].first, Side::Buy);
+    EXPECT_EQ(visited[0].second.price_, 100);
+    EXPECT_EQ(visited[0].second.quantity_, 25u);
+    EXPECT_EQ(visited[1].second.price_, 99);
+    EXPECT_EQ(visited[2].first, Side::Sell);
+    EXPECT_EQ(visited[2].second.quantity_, 7u);
+}
+
+TEST_F(OrderbookTest, VisitSnapshotReportsThePhaseWithTheLevels) {
+    orderbook->AddOrder(CreateOrder(1, Side::Buy, 100, 10));
+    auto status = orderbook->VisitSnapshot([](std::size_t, std::size_t) {}, [](Side, const LevelInfo &) {});
+    EXPECT_EQ(status.phase_, TradingPhase::Continuous);
+    EXPECT_FALSE(status.indicativeUncross_);
+
+    orderbook->StartAuction();
+    orderbook->AddOrder(CreateOrder(2, Side::Sell, 99, 4));
+    std::size_t levels = 0;
+    status = orderbook->VisitSnapshot([](std::size_t, std::size_t) {}, [&](Side, const LevelInfo &) { ++levels; });
+    EXPECT_EQ(levels, 2u);
+    EXPECT_EQ(status.phase_, TradingPhase::Auction);
+    ASSERT_TRUE(status.indicativeUncross_);
+    EXPECT_EQ(status.indicativeUncross_->volume_, 4);
+    EXPECT_EQ(status.indicativeUncross_->price_, orderbook->GetIndicativeUncross()->price_);
+}
+
+TEST_F(OrderbookTest, GoodForDayOrdersRestUntilTheOwnerExpiresThem) {
+    // A book outside a registry has no close of its own
+    orderbook->AddOrder(CreateOrder(1, Side::Buy, 100, 10, OrderType::GoodForDay));
+    EXPECT_TRUE(orderbook->OrderExists(1));
+
+    EXPECT_EQ(orderbook->CancelGoodForDayOrders(), 1);
+    EXPECT_FALSE(orderbook->OrderExists(1));
+}
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include "../Orderbook.hpp"
+#include "../Platform.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+TEST(ArenaResourceTest, AllocatesFromTheHeapWithoutAReservation) {
+    ArenaResource arena;
+    auto *pointer = arena.allocate(64, 16);
+    EXPECT_EQ(arena.GetUsed(), 0u);
+    arena.deallocate(pointer, 64, 16);
+}
+
+TEST(ArenaResourceTest, BumpsThroughTheRegionThenFallsBack) {
+    ArenaResource arena;
+    ASSERT_TRUE(arena.Reserve(4096, false, true));
+    EXPECT_EQ(arena.GetReserved(), 4096u);
+    EXPECT_FALSE(arena.Reserve(4096, false, false));
+
+    auto *first = static_cast<std::byte *>(arena.allocate(100, 8));
+    auto *second = static_cast<std::byte *>(arena.allocate(64, 64));
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(second) % 64, 0u);
+    EXPECT_GE(second, first + 100);
+    EXPECT_EQ(arena.GetUsed(), static_cast<std::size_t>(second - first) + 64);
+
+    // Past the region: the heap, given back on deallocate
+    auto *large = arena.allocate(8192, 8);
+    EXPECT_EQ(arena.GetUsed(), static_cast<std::size_t>(second - first) + 64);
+    arena.deallocate(large, 8192, 8);
+    arena.deallocate(second, 64, 64);
+    arena.deallocate(first, 100, 8);
+}
+
+namespace {
+std::size_t ResidentPages(void *region, std::size_t bytes) {
+    const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::vector<unsigned char> resident((bytes + pageSize - 1) / pageSize);
+    EXPECT_EQ(mincore(region, bytes, resident.data()), 0);
+    std::size_t count = 0;
+    for (const auto page : resident)
+        count += page & 1;
+    return count;
+}
+}
+
+TEST(ArenaResourceTest, ReservesAddressSpaceUntilTouched) {
+    constexpr std::size_t Bytes = std::size_t{64} << 20;
+    ArenaResource arena;
+    ASSERT_TRUE(arena.Reserve(Bytes, false, false));
+    const auto pages = Bytes / static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    auto *pointer = static_cast<char *>(arena.allocate(64, 8));
+    EXPECT_EQ(ResidentPages(pointer, Bytes), 0u);
+    // One page, or one transparent huge page
+    pointer[0] = 1;
+    EXPECT_GE(ResidentPages(pointer, Bytes), 1u);
+    EXPECT_LT(ResidentPages(pointer, Bytes), pages);
+
+    ArenaResource prefaulted;
+    ASSERT_TRUE(prefaulted.Reserve(Bytes, false, true));
+    EXPECT_EQ(ResidentPages(prefaulted.allocate(64, 8), Bytes), pages);
+}
+
+TEST(ArenaResourceTest, HugePagesFallBackToNormalPages) {
+    // Whether or not the machine has huge pages reserved, the region is usable
+    ArenaResource arena;
+    ASSERT_TRUE(arena.Reserve(1, true, false));
+    EXPECT_EQ(arena.GetReserved(), std::size_t{2} << 20);
+    auto *pointer = static_cast<char *>(arena.allocate(1 << 20, 8));
+    pointer[0] = 1;
+    pointer[(1 << 20) - 1] = 2;
+    arena.deallocate(pointer, 1 << 20, 8);
+}
+
+TEST(PlatformTest, PinsTheCallingThread) {
+    std::string error;
+    int cpu = -1;
+    std::thread worker([&] {
+        const auto current = sched_getcpu();
+        error = PinCurrentThread({current});
+        cpu = sched_getcpu();
+        EXPECT_EQ(cpu, current);
+    });
+    worker.join();
+    EXPECT_EQ(error, "");
+
+    EXPECT_NE(PinCurrentThread({-1}), "");
+}
+
+namespace {
+int AllowedCpuCount() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+    return CPU_COUNT(&set);
+}
+}
+
+TEST(PlatformTest, UnpinsTheCallingThread) {
+    const auto allowed = AllowedCpuCount();
+    std::thread worker([&] {
+        EXPECT_EQ(PinCurrentThread({sched_getcpu()}), "");
+        EXPECT_EQ(AllowedCpuCount(), 1);
+        EXPECT_EQ(UnpinCurrentThread(), "");
+        EXPECT_EQ(AllowedCpuCount(), allowed);
+    });
+    worker.join();
+}
+
+TEST(PlatformTest, BatchThreadSetsItsOwnAffinity) {
+    const auto allowed = AllowedCpuCount();
+    auto orderbook = std::make_shared<Orderbook>();
+    std::mutex mutex;
+    std::condition_variable batchCleared;
+    int batchCpuCount = 0;
+    orderbook->SetBatchListener([&](const AuctionResult &) {
+        std::scoped_lock lock{mutex};
+        batchCpuCount = AllowedCpuCount();
+        batchCleared.notify_one();
+    });
+    OrderId id = 0;
+    auto runBatch = [&] {
+        {
+            std::scoped_lock lock{mutex};
+            batchCpuCount = 0;
+        }
+        // Started from a pinned thread, which the batch thread must not inherit
+        std::thread starter([&] {
+            EXPECT_EQ(PinCurrentThread({sched_getcpu()}), "");
+            orderbook->StartFrequentBatchAuctions(std::chrono::milliseconds{1});
+        });
+        starter.join();
+        orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, ++id, Side::Buy, 102, 10));
+        orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, ++id, Side::Sell, 100, 10));
+        std::unique_lock lock{mutex};
+        EXPECT_TRUE(batchCleared.wait_for(lock, std::chrono::seconds{5}, [&] { return batchCpuCount != 0; }));
+        const auto count = batchCpuCount;
+        lock.unlock();
+        orderbook->Uncross();
+        return count;
+    };
+
+    EXPECT_EQ(runBatch(), allowed);
+
+    orderbook->SetBatchCpus({sched_getcpu()});
+    EXPECT_EQ(runBatch(), 1);
+}
+
+TEST(PlatformTest, PresizedBookTradesNormally) {
+    auto orderbook = std::make_shared<Orderbook>(BookCapacity{1000, false, true});
+    for (OrderId id = 1; id <= 2000; ++id)
+        orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, id, Side::Buy, static_cast<Price>(100 + id % 50), 10));
+    EXPECT_EQ(orderbook->Size(), 2000u);
+
+    const auto trades = orderbook->AddOrder(std::make_shared<Order>(OrderType::FillAndKill, 5000, Side::Sell, 100, 20'000));
+    EXPECT_EQ(trades.size(), 2000u);
+    EXPECT_EQ(orderbook->Size(), 0u);
+
+    for (OrderId id = 1; id <= 2000; ++id)
+        orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 10'000 + id, Side::Sell, 200, 1));
+    for (OrderId id = 1; id <= 2000; ++id)
+        orderbook->CancelOrder(10'000 + id);
+    EXPECT_EQ(orderbook->Size(), 0u);
+}
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include "../PreTradeRisk.hpp"
+
+TEST(PreTradeRiskTest, ClientsWithoutLimitsPass) {
+    PreTradeRisk risk;
+    EXPECT_EQ(risk.Check(7, Side::Buy, 100, 1000000, std::nullopt, std::nullopt, true), RiskCheck::Passed);
+    EXPECT_FALSE(risk.SetLimits(0, RiskLimits{}, 0));
+    EXPECT_FALSE(risk.SetLimits(PreTradeRisk::MaxClients, RiskLimits{}, 0));
+}
+
+TEST(PreTradeRiskTest, SizeNotionalAndOpenOrders) {
+    PreTradeRisk risk;
+    RiskLimits limits;
+    limits.maxOrderQuantity_ = 100;
+    limits.maxNotional_ = 5000;
+    limits.maxOpenOrders_ = 2;
+    ASSERT_TRUE(risk.SetLimits(7, limits, 1));
+
+    EXPECT_EQ(risk.Check(7, Side::Buy, 10, 101, std::nullopt, std::nullopt, true), RiskCheck::OrderQuantity);
+    EXPECT_EQ(risk.Check(7, Side::Buy, 60, 100, std::nullopt, std::nullopt, true), RiskCheck::Notional);
+    // Market orders are valued at the opposite best price
+    EXPECT_EQ(risk.Check(7, Side::Buy, 0, 100, 40, 60, true), RiskCheck::Notional);
+    EXPECT_EQ(risk.Check(7, Side::Sell, 0, 100, 40, 60, true), RiskCheck::Passed);
+
+    risk.OnOrderOpened(7);
+    EXPECT_EQ(risk.Check(7, Side::Buy, 10, 10, std::nullopt, std::nullopt, true), RiskCheck::OpenOrders);
+    EXPECT_EQ(risk.Check(7, Side::Buy, 10, 10, std::nullopt, std::nullopt, false), RiskCheck::Passed);
+    risk.OnOrderClosed(7);
+    EXPECT_EQ(risk.Check(7, Side::Buy, 10, 10, std::nullopt, std::nullopt, true), RiskCheck::Passed);
+}
+
+TEST(PreTradeRiskTest, PositionFollowsFills) {
+    PreTradeRisk risk;
+    RiskLimits limits;
+    limits.maxPosition_ = 100;
+    ASSERT_TRUE(risk.SetLimits(7, limits, 0));
+
+    risk.OnFill(7, Side::Buy, 80);
+    EXPECT_EQ(risk.Find(7)->position_, 80);
+    EXPECT_EQ(risk.Check(7, Side::Buy, 10, 30, std::nullopt, std::nullopt, true), RiskCheck::Position);
+    EXPECT_EQ(risk.Check(7, Side::Sell, 10, 180, std::nullopt, std::nullopt, true), RiskCheck::Passed);
+    EXPECT_EQ(risk.Check(7, Side::Sell, 10, 181, std::nullopt, std::nullopt, true), RiskCheck::Position);
+}
+
+TEST(PreTradeRiskTest, PriceBandAroundOppositeBest) {
+    PreTradeRisk risk;
+    RiskLimits limits;
+    limits.priceBandBps_ = 500; // 5%
+    ASSERT_TRUE(risk.SetLimits(7, limits, 0));
+
+    EXPECT_EQ(risk.Check(7, Side::Buy, 105, 1, 90, 100, true), RiskCheck::Passed);
+    EXPECT_EQ(risk.Check(7, Side::Buy, 106, 1, 90, 100, true), RiskCheck::PriceBand);
+    EXPECT_EQ(risk.Check(7, Side::Sell, 85, 1, 90, 100, true), RiskCheck::PriceBand);
+    // With one side empty the other is the reference; with none there is no band
+    EXPECT_EQ(risk.Check(7, Side::Buy, 94, 1, 100, std::nullopt, true), RiskCheck::PriceBand);
+    EXPECT_EQ(risk.Check(7, Side::Buy, 1000, 1, std::nullopt, std::nullopt, true), RiskCheck::Passed);
+}
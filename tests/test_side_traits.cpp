@@ -0,0 +1,33 @@
+#include <gtest/gtest.h>
+#include "../SideTraits.hpp"
+
+TEST(SideTraitsTest, BetterPricesRankFirst) {
+    EXPECT_TRUE(IsBetter<Side::Buy>(101, 100));
+    EXPECT_FALSE(IsBetter<Side::Buy>(100, 100));
+    EXPECT_TRUE(IsBetter<Side::Sell>(100, 101));
+
+    BookLevels<Side::Buy> bids{{100, {}}, {102, {}}};
+    BookLevels<Side::Sell> asks{{105, {}}, {103, {}}};
+    EXPECT_EQ(bids.begin()->first, 102);
+    EXPECT_EQ(asks.begin()->first, 103);
+}
+
+TEST(SideTraitsTest, ReachesIncludesTheThreshold) {
+    // A buy at 100 meets asks at or below 100
+    EXPECT_TRUE(Reaches<Side::Buy>(100, 100));
+    EXPECT_TRUE(Reaches<Side::Buy>(100, 99));
+    EXPECT_FALSE(Reaches<Side::Buy>(100, 101));
+    // A sell at 100 meets bids at or above 100
+    EXPECT_TRUE(Reaches<Side::Sell>(100, 101));
+    EXPECT_FALSE(Reaches<Side::Sell>(100, 99));
+}
+
+TEST(SideTraitsTest, StopsTriggerInTheOppositeOrder) {
+    // Buy stops trigger as the price rises, so the lowest is next
+    StopLevels<Side::Buy> buyStops{{105, {}}, {103, {}}};
+    StopLevels<Side::Sell> sellStops{{95, {}}, {97, {}}};
+    EXPECT_EQ(buyStops.begin()->first, 103);
+    EXPECT_EQ(sellStops.begin()->first, 97);
+    EXPECT_EQ(Worse<Side::Buy>(100, 98), 98);
+    EXPECT_EQ(Worse<Side::Sell>(100, 98), 100);
+}
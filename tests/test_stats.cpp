@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include "../Stats.hpp"
+
+#include <memory>
+#include <thread>
+
+TEST(StatsTest, EmptySnapshot) {
+    Stats stats;
+    auto snapshot = stats.Snapshot();
+
+    EXPECT_EQ(snapshot.GetCounter(StatsCounter::Adds), 0);
+    EXPECT_EQ(snapshot.GetLatency(StatsOperation::AddOrder, StatsStage::Total).GetTotalCount(), 0);
+}
+
+TEST(StatsTest, MergesThreadSlabs) {
+    Stats stats;
+
+    auto record = [&stats] {
+        for (int i = 0; i < 1000; ++i) {
+            stats.Increment(StatsCounter::Adds);
+            stats.Record(StatsOperation::AddOrder, StatsStage::Match, 500);
+        }
+    };
+    std::thread first{record};
+    std::thread second{record};
+    first.join();
+    second.join();
+    record();
+
+    auto snapshot = stats.Snapshot();
+    EXPECT_EQ(snapshot.GetCounter(StatsCounter::Adds), 3000);
+
+    const auto &match = snapshot.GetLatency(StatsOperation::AddOrder, StatsStage::Match);
+    EXPECT_EQ(match.GetTotalCount(), 3000);
+    EXPECT_GE(match.GetValueAtPercentile(50.0), 500);
+    EXPECT_LE(match.GetValueAtPercentile(50.0), 505);
+}
+
+TEST(StatsTest, ExitedThreadsHandOnTheirSlabs) {
+    auto stats = std::make_unique<Stats>();
+    for (int i = 0; i < 8; ++i) {
+        std::thread thread{[&stats] {
+            stats->Increment(StatsCounter::Adds);
+            stats->Record(StatsOperation::AddOrder, StatsStage::Total, 1000);
+        }};
+        thread.join();
+    }
+
+    // One slab, carried on by each thread in turn, and no count lost
+    EXPECT_EQ(stats->GetSlabCount(), 1);
+    auto snapshot = stats->Snapshot();
+    EXPECT_EQ(snapshot.GetCounter(StatsCounter::Adds), 8);
+    EXPECT_EQ(snapshot.GetLatency(StatsOperation::AddOrder, StatsStage::Total).GetTotalCount(), 8);
+
+    // A thread outliving its Stats has nothing to give back
+    std::thread outliving{[&stats] {
+        stats->Increment(StatsCounter::Adds);
+        stats.reset();
+    }};
+    outliving.join();
+}
+
+TEST(StatsTest, InstancesAreIndependent) {
+    Stats first;
+    Stats second;
+
+    first.Increment(StatsCounter::Trades, 2);
+    second.Increment(StatsCounter::Trades, 5);
+    first.Increment(StatsCounter::Trades);
+
+    EXPECT_EQ(first.Snapshot().GetCounter(StatsCounter::Trades), 3);
+    EXPECT_EQ(second.Snapshot().GetCounter(StatsCounter::Trades), 5);
+}
+
+TEST(StatsTest, ScopedTimerRecordsOnce) {
+    Stats stats;
+    {
+        ScopedStageTimer timer{&stats, StatsOperation::CancelOrder, StatsStage::Total};
+        timer.Stop();
+    }
+
+    EXPECT_EQ(stats.Snapshot().GetLatency(StatsOperation::CancelOrder, StatsStage::Total).GetTotalCount(), 1);
+}
+
+TEST(StatsTest, SnapshotText) {
+    Stats stats;
+    stats.Record(StatsOperation::GetOrderbook, StatsStage::Encode, 1000);
+
+    const auto text = stats.Snapshot().ToText();
+    EXPECT_NE(text.find("GetOrderbook"), std::string::npos);
+    EXPECT_NE(text.find("encode"), std::string::npos);
+    EXPECT_EQ(text.find("AddOrder"), std::string::npos);
+}
+
+TEST(StatsTest, PerfScopeIsNoOpWhenDisabled) {
+    Stats stats;
+    {
+        ScopedPerfCounters scope{&stats, PerfRegion::MatchOrders};
+    }
+
+    EXPECT_FALSE(stats.HardwareCountersEnabled());
+    EXPECT_EQ(stats.Snapshot().GetPerf(PerfRegion::MatchOrders).samples_, 0);
+}
+
+TEST(StatsTest, MultiplexedCountsAreScaledToTheEnabledTime) {
+    PerfCounterReading start;
+    start.values_.fill(100);
+    start.timeEnabled_ = 1000;
+    start.timeRunning_ = 1000;
+
+    auto end = start;
+    end.values_.fill(400);
+    end.timeEnabled_ = 2000;
+    end.timeRunning_ = 1500;
+
+    PerfCounterValues delta;
+    ASSERT_TRUE(ScaleDifference(start, end, delta));
+    EXPECT_EQ(delta[static_cast<std::size_t>(PerfEvent::Cycles)], 600u);
+
+    end.timeRunning_ = start.timeRunning_;
+    EXPECT_FALSE(ScaleDifference(start, end, delta));
+}
+
+TEST(StatsTest, HardwareCountersWhenAvailable) {
+    Stats stats;
+    const auto error = stats.EnableHardwareCounters();
+    if (!error.empty()) {
+        EXPECT_FALSE(stats.HardwareCountersEnabled());
+        GTEST_SKIP() << error;
+    }
+
+    volatile std::uint64_t sink = 0;
+    {
+        ScopedPerfCounters scope{&stats, PerfRegion::AddOrder};
+        for (int i = 0; i < 10000; ++i)
+            sink = sink + i;
+    }
+
+    const auto snapshot = stats.Snapshot();
+    const auto &totals = snapshot.GetPerf(PerfRegion::AddOrder);
+    EXPECT_EQ(totals.samples_, 1);
+    EXPECT_GT(totals.events_[static_cast<std::size_t>(PerfEvent::Instructions)], 10000);
+    EXPECT_NE(snapshot.ToText().find("Orderbook::AddOrder"), std::string::npos);
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include "../Throttle.hpp"
+
+namespace {
+
+Timestamp TicksPerSecond() {
+    return static_cast<Timestamp>(1e9 / TscClock::NanosecondsPerTick());
+}
+
+} // namespace
+
+TEST(ThrottleTest, UnconfiguredAdmitsEverything) {
+    Throttle throttle;
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_EQ(throttle.Admit(7, 1), Admission::Admitted);
+}
+
+TEST(ThrottleTest, MessageBucketRefills) {
+    Throttle throttle;
+    throttle.Configure(ThrottleConfig{10, 0, 5, 0});
+    const auto second = TicksPerSecond();
+    const Timestamp start = 1000 * second;
+
+    for (int i = 0; i < 5; ++i)
+        EXPECT_EQ(throttle.Admit(7, 0, start), Admission::Admitted);
+    EXPECT_EQ(throttle.Admit(7, 0, start), Admission::MessageRate);
+
+    // Other clients have their own bucket
+    EXPECT_EQ(throttle.Admit(8, 0, start), Admission::Admitted);
+
+    // One token back every tenth of a second
+    EXPECT_EQ(throttle.Admit(7, 0, start + second / 10 + 1), Admission::Admitted);
+    EXPECT_EQ(throttle.Admit(7, 0, start + second / 10 + 1), Admission::MessageRate);
+}
+
+TEST(ThrottleTest, OrderBucketCountsEachOrder) {
+    Throttle throttle;
+    throttle.Configure(ThrottleConfig{0, 100, 10, 0});
+    const Timestamp start = 1000 * TicksPerSecond();
+
+    EXPECT_EQ(throttle.Admit(7, 8, start), Admission::Admitted);
+    EXPECT_EQ(throttle.Admit(7, 3, start), Admission::OrderRate);
+    EXPECT_EQ(throttle.Admit(7, 2, start), Admission::Admitted);
+    // Cancels carry no orders
+    EXPECT_EQ(throttle.Admit(7, 0, start), Admission::Admitted);
+}
+
+TEST(ThrottleTest, OrderRateRefusalKeepsTheMessageToken) {
+    Throttle throttle;
+    throttle.Configure(ThrottleConfig{10, 10, 2, 0});
+    const Timestamp start = 1000 * TicksPerSecond();
+
+    EXPECT_EQ(throttle.Admit(7, 2, start), Admission::Admitted);
+    // The order bucket is empty; the refusals leave the message bucket alone
+    for (int i = 0; i < 5; ++i)
+        EXPECT_EQ(throttle.Admit(7, 1, start), Admission::OrderRate);
+    EXPECT_EQ(throttle.Admit(7, 0, start), Admission::Admitted);
+    EXPECT_EQ(throttle.Admit(7, 0, start), Admission::MessageRate);
+}
+
+TEST(ThrottleTest, RequestsLargerThanTheBurstAreRefusedOutright) {
+    Throttle throttle;
+    throttle.Configure(ThrottleConfig{100, 100, 10, 0});
+    const auto second = TicksPerSecond();
+    const Timestamp start = 1000 * second;
+
+    // Even against a full bucket, and without using up any tokens
+    EXPECT_EQ(throttle.Admit(7, 11, start), Admission::TooManyOrders);
+    EXPECT_EQ(throttle.Admit(7, 11, start + 60 * second), Admission::TooManyOrders);
+    EXPECT_EQ(throttle.Admit(7, 10, start + 60 * second), Admission::Admitted);
+    EXPECT_STREQ(ToString(Admission::TooManyOrders), "too_many_orders");
+}
+
+TEST(ThrottleTest, ShedsOrdersAboveHighWater) {
+    Throttle throttle;
+    throttle.Configure(ThrottleConfig{0, 0, 0, 2});
+
+    Throttle::InFlight first{throttle};
+    EXPECT_EQ(throttle.Admit(7, 1), Admission::Admitted);
+    {
+        Throttle::InFlight second{throttle};
+        EXPECT_EQ(throttle.GetInFlight(), 2);
+        EXPECT_EQ(throttle.Admit(7, 1), Admission::Overloaded);
+        EXPECT_EQ(throttle.Admit(7, 0), Admission::Admitted);
+    }
+    EXPECT_EQ(throttle.Admit(7, 1), Admission::Admitted);
+}
@@ -0,0 +1,269 @@
+#include <gtest/gtest.h>
+#include "../InstrumentRegistry.hpp"
+#include "../Order.hpp"
+#include "../Orderbook.hpp"
+#include "../TradeTape.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+namespace {
+
+constexpr std::int64_t Second = 1'000'000'000;
+
+std::string TapePath(const char *name) {
+    return (std::filesystem::temp_directory_path() / (std::string{name} + "_" + std::to_string(::getpid()) + ".tape")).string();
+}
+
+// Waits for the recorder's thread to get a tape to size trades
+std::shared_ptr<const TradeTape> WaitForTrades(const TradeTapeRecorder &recorder, InstrumentId id, std::size_t size) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (auto tape = recorder.Find(id); tape && tape->Size() >= size)
+            return tape;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return recorder.Find(id);
+}
+
+} // namespace
+
+TEST(TradeTapeTest, AppendsColumnsAndSummarizes) {
+    TradeTape tape;
+    ASSERT_EQ(tape.Open("", 8), "");
+    EXPECT_EQ(tape.Size(), 0);
+
+    EXPECT_TRUE(tape.Append(10 * Second, 100, 10, Side::Buy));
+    EXPECT_TRUE(tape.Append(11 * Second, 102, 30, Side::Sell));
+    EXPECT_TRUE(tape.Append(12 * Second, 101, 60, std::nullopt));
+
+    ASSERT_EQ(tape.Size(), 3);
+    EXPECT_EQ(tape.GetPrice(1), 102);
+    EXPECT_EQ(tape.GetQuantity(1), 30);
+    EXPECT_EQ(tape.GetTime(2), 12 * Second);
+    EXPECT_EQ(tape.GetAggressor(0), Side::Buy);
+    EXPECT_EQ(tape.GetAggressor(1), Side::Sell);
+    EXPECT_EQ(tape.GetAggressor(2), std::nullopt);
+
+    const auto summary = tape.GetSummary();
+    EXPECT_EQ(summary.lastPrice_, 101);
+    EXPECT_EQ(summary.lastQuantity_, 60);
+    EXPECT_EQ(summary.lastTime_, 12 * Second);
+    EXPECT_EQ(summary.volume_, 100);
+    EXPECT_EQ(summary.turnover_, 100 * 10 + 102 * 30 + 101 * 60);
+    EXPECT_EQ(summary.trades_, 3);
+    EXPECT_DOUBLE_EQ(summary.GetVwap(), 10120.0 / 100);
+}
+
+TEST(TradeTapeTest, FullTapeRefusesTrades) {
+    TradeTape tape;
+    ASSERT_EQ(tape.Open("", 2), "");
+    EXPECT_TRUE(tape.Append(Second, 100, 1, std::nullopt));
+    EXPECT_TRUE(tape.Append(Second, 100, 1, std::nullopt));
+    EXPECT_FALSE(tape.Append(Second, 100, 1, std::nullopt));
+    EXPECT_EQ(tape.Size(), 2);
+    EXPECT_EQ(tape.GetSummary().trades_, 2);
+}
+
+TEST(TradeTapeTest, KeepsTheTimeColumnSorted) {
+    TradeTape tape;
+    ASSERT_EQ(tape.Open("", 4), "");
+    tape.Append(5 * Second, 100, 1, std::nullopt);
+    tape.Append(4 * Second, 100, 1, std::nullopt);
+    EXPECT_EQ(tape.GetTime(1), 5 * Second);
+}
+
+TEST(TradeTapeTest, BarsOverARangeSkipEmptyIntervals) {
+    TradeTape tape;
+    ASSERT_EQ(tape.Open("", 16), "");
+    tape.Append(60 * Second, 100, 10, std::nullopt);
+    tape.Append(60 * Second + Second / 2, 105, 10, std::nullopt);
+    tape.Append(61 * Second, 99, 20, std::nullopt);
+    tape.Append(63 * Second, 101, 5, std::nullopt);
+    tape.Append(64 * Second, 200, 5, std::nullopt);
+
+    const auto bars = tape.GetBars(60 * Second, 64 * Second, std::chrono::seconds{1});
+    ASSERT_EQ(bars.size(), 3);
+    EXPECT_EQ(bars[0].start_, 60 * Second);
+    EXPECT_EQ(bars[0].open_, 100);
+    EXPECT_EQ(bars[0].high_, 105);
+    EXPECT_EQ(bars[0].low_, 100);
+    EXPECT_EQ(bars[0].close_, 105);
+    EXPECT_EQ(bars[0].volume_, 20);
+    EXPECT_EQ(bars[0].trades_, 2);
+    EXPECT_DOUBLE_EQ(bars[0].GetVwap(), 102.5);
+    EXPECT_EQ(bars[1].start_, 61 * Second);
+    EXPECT_EQ(bars[2].start_, 63 * Second);
+    EXPECT_EQ(bars[2].close_, 101);
+
+    // Bars align to the interval, not to the start of the range
+    const auto minute = tape.GetBars(60 * Second + 1, 120 * Second, std::chrono::minutes{1});
+    ASSERT_EQ(minute.size(), 1);
+    EXPECT_EQ(minute[0].start_, 60 * Second);
+    EXPECT_EQ(minute[0].open_, 105);
+    EXPECT_EQ(minute[0].high_, 200);
+    EXPECT_EQ(minute[0].low_, 99);
+    EXPECT_EQ(minute[0].volume_, 40);
+
+    EXPECT_TRUE(tape.GetBars(70 * Second, 80 * Second, std::chrono::seconds{1}).empty());
+    EXPECT_TRUE(tape.GetBars(60 * Second, 70 * Second, std::chrono::seconds{0}).empty());
+}
+
+TEST(TradeTapeTest, RollingBarsStartOverEachInterval) {
+    TradeTape tape{{std::chrono::seconds{1}, std::chrono::minutes{1}}};
+    ASSERT_EQ(tape.Open("", 16), "");
+    EXPECT_TRUE(tape.GetRollingBars().empty());
+
+    tape.Append(60 * Second + Second / 2, 100, 10, std::nullopt);
+    tape.Append(60 * Second + Second * 9 / 10, 102, 10, std::nullopt);
+    tape.Append(61 * Second + Second / 5, 98, 5, std::nullopt);
+
+    const auto bars = tape.GetRollingBars();
+    ASSERT_EQ(bars.size(), 2);
+    EXPECT_EQ(bars[0].first, std::chrono::seconds{1});
+    EXPECT_EQ(bars[0].second.start_, 61 * Second);
+    EXPECT_EQ(bars[0].second.trades_, 1);
+    EXPECT_EQ(bars[0].second.open_, 98);
+    EXPECT_EQ(bars[1].first, std::chrono::minutes{1});
+    EXPECT_EQ(bars[1].second.start_, 60 * Second);
+    EXPECT_EQ(bars[1].second.trades_, 3);
+    EXPECT_EQ(bars[1].second.high_, 102);
+    EXPECT_EQ(bars[1].second.volume_, 25);
+}
+
+TEST(TradeTapeTest, ReopenedFileCarriesOn) {
+    const auto path = TapePath("trade_tape_reopen");
+    std::remove(path.c_str());
+    {
+        TradeTape tape{{std::chrono::seconds{1}}};
+        ASSERT_EQ(tape.Open(path, 4), "");
+        tape.Append(Second, 100, 10, Side::Buy);
+        tape.Append(2 * Second, 110, 10, Side::Sell);
+    }
+
+    // The file's own capacity wins
+    TradeTape tape{{std::chrono::seconds{1}}};
+    ASSERT_EQ(tape.Open(path, 1000), "");
+    EXPECT_EQ(tape.GetCapacity(), 4);
+    ASSERT_EQ(tape.Size(), 2);
+    EXPECT_EQ(tape.GetPrice(1), 110);
+    EXPECT_EQ(tape.GetAggressor(1), Side::Sell);
+    EXPECT_EQ(tape.GetSummary().volume_, 20);
+    ASSERT_EQ(tape.GetRollingBars().size(), 1);
+    EXPECT_EQ(tape.GetRollingBars()[0].second.start_, 2 * Second);
+
+    EXPECT_TRUE(tape.Append(3 * Second, 120, 10, std::nullopt));
+    EXPECT_EQ(tape.GetSummary().trades_, 3);
+    std::remove(path.c_str());
+}
+
+TEST(TradeTapeTest, RefusesAFileThatIsNotATape) {
+    const auto path = TapePath("trade_tape_garbage");
+    {
+        std::ofstream file{path};
+        file << "not a tape";
+    }
+    TradeTape tape;
+    EXPECT_NE(tape.Open(path, 4), "");
+    EXPECT_FALSE(tape.Append(Second, 100, 1, std::nullopt));
+    std::remove(path.c_str());
+}
+
+TEST(TradingSessionTest, RunsFromOneEndOfDayToTheNext) {
+    const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    const auto session = GetTradingSession(now, std::chrono::hours{16});
+    EXPECT_LE(session.start_, now);
+    EXPECT_LT(now, session.end_);
+    // A day, give or take a daylight saving change
+    EXPECT_GE(session.end_ - session.start_, 23 * 3600 * Second);
+    EXPECT_LE(session.end_ - session.start_, 25 * 3600 * Second);
+    EXPECT_GT(session.date_, 20000101u);
+
+    // The end belongs to the next session, the last moment before it to this one
+    const auto next = GetTradingSession(session.end_, std::chrono::hours{16});
+    EXPECT_EQ(next.start_, session.end_);
+    EXPECT_GT(next.date_, session.date_);
+    const auto last = GetTradingSession(session.end_ - 1, std::chrono::hours{16});
+    EXPECT_EQ(last.start_, session.start_);
+    EXPECT_EQ(last.date_, session.date_);
+}
+
+TEST(TradeTapeRecorderTest, RecordsEachTradeOnceFromTheReports) {
+    auto reports = std::make_shared<ExecutionReportRing>(64);
+    auto orderbook = std::make_shared<Orderbook>();
+    orderbook->AttachExecutionReports(reports, 4);
+
+    TradeTapeRecorder recorder{reports, TradeTapeConfig{"", 16, {std::chrono::seconds{1}}}};
+    orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Buy, 100, 10));
+    orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 2, Side::Sell, 100, 4));
+    orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 3, Side::Sell, 101, 5));
+    orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 4, Side::Buy, 101, 5));
+    orderbook->CancelOrder(1);
+
+    const auto tape = WaitForTrades(recorder, 4, 2);
+    ASSERT_NE(tape, nullptr);
+    ASSERT_EQ(tape->Size(), 2);
+    EXPECT_EQ(tape->GetPrice(0), 100);
+    EXPECT_EQ(tape->GetQuantity(0), 4);
+    EXPECT_EQ(tape->GetAggressor(0), Side::Sell);
+    EXPECT_EQ(tape->GetPrice(1), 101);
+    EXPECT_EQ(tape->GetAggressor(1), Side::Buy);
+    EXPECT_EQ(tape->GetSummary().volume_, 9);
+    EXPECT_EQ(recorder.Find(5), nullptr);
+    EXPECT_EQ(recorder.GetDroppedTrades(), 0);
+    EXPECT_EQ(recorder.GetError(), "");
+}
+
+TEST(TradeTapeRecorderTest, CountsTradesAFullTapeDrops) {
+    auto reports = std::make_shared<ExecutionReportRing>(64);
+    auto orderbook = std::make_shared<Orderbook>();
+    orderbook->AttachExecutionReports(reports, 0);
+    orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Buy, 100, 10));
+    orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 2, Side::Sell, 100, 4));
+    orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 3, Side::Sell, 100, 4));
+
+    // Started after the trades: it begins from the oldest report the ring holds
+    TradeTapeRecorder recorder{reports, TradeTapeConfig{"", 1, {}}};
+    const auto tape = WaitForTrades(recorder, 0, 1);
+    ASSERT_NE(tape, nullptr);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (recorder.GetDroppedTrades() == 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(tape->Size(), 1);
+    EXPECT_EQ(recorder.GetDroppedTrades(), 1);
+    EXPECT_NE(recorder.GetError().find("full"), std::string::npos);
+}
+
+TEST(TradeTapeRecorderTest, NamesEachFileForItsSession) {
+    const auto directory = std::filesystem::temp_directory_path() / ("trade_tape_sessions_" + std::to_string(::getpid()));
+    std::filesystem::remove_all(directory);
+    auto orderbook = std::make_shared<Orderbook>();
+
+    // A restart within the session carries on the session's file
+    for (std::size_t pass = 1; pass <= 2; ++pass) {
+        auto reports = std::make_shared<ExecutionReportRing>(64);
+        orderbook->AttachExecutionReports(reports, 2);
+        TradeTapeRecorder recorder{reports, TradeTapeConfig{directory.string(), 16, {}}};
+        const auto id = static_cast<OrderId>(10 * pass);
+        orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, id, Side::Buy, 100, 10));
+        orderbook->AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, id + 1, Side::Sell, 100, 10));
+
+        const auto tape = WaitForTrades(recorder, 2, pass);
+        ASSERT_NE(tape, nullptr);
+        EXPECT_EQ(tape->Size(), pass);
+        EXPECT_EQ(tape->GetSummary().volume_, 10 * pass);
+        EXPECT_EQ(recorder.GetError(), "");
+    }
+
+    const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    const auto session = GetTradingSession(now, InstrumentRegistry::EndOfDay);
+    EXPECT_TRUE(std::filesystem::exists(directory / ("instrument-2-" + std::to_string(session.date_) + ".tape")));
+    std::filesystem::remove_all(directory);
+}
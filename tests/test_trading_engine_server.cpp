@@ -245,3 +245,558 @@ TEST_F(TradingEngineServerTest, ConcurrentOrderHandling) {
     // At least some orders should be in the book
     EXPECT_GT(orderbook->Size(), 0);
 }
+
+TEST_F(TradingEngineServerTest, GetStatsCountsOperations) {
+    trading::TradeResponse tradeResponse;
+    auto buyRequest = CreateOrderRequest(1, trading::BUY, 100, 10);
+    auto sellRequest = CreateOrderRequest(2, trading::SELL, 100, 4);
+    auto restingRequest = CreateOrderRequest(3, trading::SELL, 105, 10);
+    server->AddOrder(context.get(), &buyRequest, &tradeResponse);
+    server->AddOrder(context.get(), &sellRequest, &tradeResponse);
+    server->AddOrder(context.get(), &restingRequest, &tradeResponse);
+
+    trading::CancelOrderRequest cancelRequest;
+    cancelRequest.set_order_id(3);
+    trading::CancelOrderResponse cancelResponse;
+    server->CancelOrder(context.get(), &cancelRequest, &cancelResponse);
+
+    trading::ModifyOrderRequest modifyRequest;
+    modifyRequest.set_order_id(999);
+    server->ModifyOrder(context.get(), &modifyRequest, &tradeResponse);
+
+    trading::StatsRequest request;
+    trading::StatsResponse response;
+    auto status = server->GetStats(context.get(), &request, &response);
+
+    EXPECT_TRUE(status.ok());
+    EXPECT_EQ(response.adds(), 3);
+    EXPECT_EQ(response.cancels(), 1);
+    EXPECT_EQ(response.trades(), 1);
+    EXPECT_EQ(response.rejects(), 1);
+    EXPECT_EQ(response.resting_orders(), 1);
+    EXPECT_EQ(response.bid_levels(), 1);
+    EXPECT_EQ(response.ask_levels(), 0);
+
+    bool sawAddTotal = false;
+    for (const auto &latency : response.latencies()) {
+        if (latency.operation() == "AddOrder" && latency.stage() == "total") {
+            sawAddTotal = true;
+            EXPECT_EQ(latency.count(), 3);
+            EXPECT_LE(latency.p50_ns(), latency.max_ns());
+        }
+    }
+    EXPECT_TRUE(sawAddTotal);
+}
+
+TEST_F(TradingEngineServerTest, ResponsesCarryTimestamps) {
+    trading::TradeResponse buyResponse;
+    auto buyRequest = CreateOrderRequest(1, trading::BUY, 100, 10);
+    server->AddOrder(context.get(), &buyRequest, &buyResponse);
+
+    trading::TradeResponse sellResponse;
+    auto sellRequest = CreateOrderRequest(2, trading::SELL, 100, 10);
+    server->AddOrder(context.get(), &sellRequest, &sellResponse);
+
+    EXPECT_GT(buyResponse.receive_timestamp(), 0);
+    EXPECT_LE(buyResponse.receive_timestamp(), buyResponse.timestamp());
+
+    ASSERT_EQ(sellResponse.trades_size(), 2);
+    const auto matchTime = sellResponse.trades(0).timestamp();
+    EXPECT_EQ(sellResponse.trades(1).timestamp(), matchTime);
+    EXPECT_LE(sellResponse.receive_timestamp(), matchTime);
+    EXPECT_LE(matchTime, sellResponse.timestamp());
+    EXPECT_LE(buyResponse.timestamp(), sellResponse.receive_timestamp());
+}
+
+TEST_F(TradingEngineServerTest, MassQuoteReplacesQuotes) {
+    trading::MassQuoteRequest request;
+    request.set_client_id(7);
+    request.set_quote_set_id(1);
+    auto *bid = request.add_entries();
+    bid->set_side(trading::BUY);
+    bid->set_price(99);
+    bid->set_quantity(10);
+    auto *ask = request.add_entries();
+    ask->set_side(trading::SELL);
+    ask->set_price(101);
+    ask->set_quantity(10);
+
+    trading::MassQuoteResponse response;
+    EXPECT_TRUE(server->MassQuote(context.get(), &request, &response).ok());
+    EXPECT_EQ(response.status(), trading::ACCEPTED);
+    ASSERT_EQ(response.order_ids_size(), 2);
+    EXPECT_EQ(orderbook->Size(), 2);
+    EXPECT_LE(response.receive_timestamp(), response.timestamp());
+
+    ask->set_price(98);
+    trading::MassQuoteResponse rejected;
+    server->MassQuote(context.get(), &request, &rejected);
+    EXPECT_EQ(rejected.status(), trading::REJECTED);
+
+    trading::StatsRequest statsRequest;
+    trading::StatsResponse stats;
+    server->GetStats(context.get(), &statsRequest, &stats);
+    EXPECT_EQ(stats.quotes(), 4);
+    EXPECT_EQ(stats.rejects(), 1);
+}
+
+TEST_F(TradingEngineServerTest, MassCancelByClient) {
+    for (uint32_t id = 1; id <= 3; ++id) {
+        auto request = CreateOrderRequest(id, trading::BUY, 100 + id, 10);
+        request.set_client_id(id == 3 ? 8 : 7);
+        trading::TradeResponse response;
+        server->AddOrder(context.get(), &request, &response);
+    }
+
+    trading::MassCancelRequest request;
+    request.set_client_id(7);
+    trading::MassCancelResponse response;
+    EXPECT_TRUE(server->MassCancel(context.get(), &request, &response).ok());
+    EXPECT_EQ(response.cancelled(), 2);
+    EXPECT_EQ(orderbook->Size(), 1);
+    EXPECT_LE(response.receive_timestamp(), response.timestamp());
+}
+
+TEST_F(TradingEngineServerTest, CancelOnDisconnect) {
+    grpc::ServerBuilder builder;
+    builder.RegisterService(server.get());
+    auto grpcServer = builder.BuildAndStart();
+    ASSERT_NE(grpcServer, nullptr);
+    auto stub = trading::TradingEngine::NewStub(grpcServer->InProcessChannel(grpc::ChannelArguments()));
+
+    trading::SessionRequest sessionRequest;
+    sessionRequest.set_client_id(7);
+    sessionRequest.set_cancel_on_disconnect(true);
+    grpc::ClientContext sessionContext;
+    auto session = stub->OpenSession(&sessionContext, sessionRequest);
+    trading::SessionEvent opened;
+    ASSERT_TRUE(session->Read(&opened));
+    EXPECT_GT(opened.timestamp(), 0);
+
+    auto request = CreateOrderRequest(1, trading::SELL, 100, 10);
+    request.set_client_id(7);
+    trading::TradeResponse response;
+    grpc::ClientContext addContext;
+    ASSERT_TRUE(stub->AddOrder(&addContext, request, &response).ok());
+    EXPECT_EQ(orderbook->Size(), 1);
+
+    sessionContext.TryCancel();
+    session->Finish();
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (orderbook->Size() != 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(orderbook->Size(), 0);
+
+    grpcServer->Shutdown();
+}
+
+TEST_F(TradingEngineServerTest, ShutdownEndsOpenSessions) {
+    grpc::ServerBuilder builder;
+    builder.RegisterService(server.get());
+    auto grpcServer = builder.BuildAndStart();
+    ASSERT_NE(grpcServer, nullptr);
+    auto stub = trading::TradingEngine::NewStub(grpcServer->InProcessChannel(grpc::ChannelArguments()));
+
+    trading::SessionRequest sessionRequest;
+    sessionRequest.set_client_id(7);
+    sessionRequest.set_cancel_on_disconnect(true);
+    grpc::ClientContext sessionContext;
+    auto session = stub->OpenSession(&sessionContext, sessionRequest);
+    trading::SessionEvent event;
+    ASSERT_TRUE(session->Read(&event));
+
+    auto request = CreateOrderRequest(1, trading::SELL, 100, 10);
+    request.set_client_id(7);
+    trading::TradeResponse response;
+    grpc::ClientContext addContext;
+    ASSERT_TRUE(stub->AddOrder(&addContext, request, &response).ok());
+
+    // The session returns without its client going away, and still cleans up
+    server->Shutdown();
+    EXPECT_FALSE(session->Read(&event));
+    EXPECT_EQ(session->Finish().error_code(), grpc::StatusCode::CANCELLED);
+    EXPECT_EQ(orderbook->Size(), 0);
+
+    grpcServer->Shutdown();
+}
+
+TEST_F(TradingEngineServerTest, StreamsPastTheCapAreRefused) {
+    server->SetMaxStreams(1);
+    grpc::ServerBuilder builder;
+    builder.RegisterService(server.get());
+    auto grpcServer = builder.BuildAndStart();
+    ASSERT_NE(grpcServer, nullptr);
+    auto stub = trading::TradingEngine::NewStub(grpcServer->InProcessChannel(grpc::ChannelArguments()));
+
+    trading::SessionRequest sessionRequest;
+    grpc::ClientContext sessionContext;
+    auto session = stub->OpenSession(&sessionContext, sessionRequest);
+    trading::SessionEvent opened;
+    ASSERT_TRUE(session->Read(&opened));
+
+    // The session holds the only place, so the drop copy is refused and
+    // order entry still gets through
+    trading::ExecutionStreamRequest streamRequest;
+    grpc::ClientContext streamContext;
+    auto stream = stub->StreamExecutions(&streamContext, streamRequest);
+    trading::ExecutionReport report;
+    EXPECT_FALSE(stream->Read(&report));
+    EXPECT_EQ(stream->Finish().error_code(), grpc::StatusCode::RESOURCE_EXHAUSTED);
+
+    auto request = CreateOrderRequest(1, trading::BUY, 100, 10);
+    trading::TradeResponse response;
+    grpc::ClientContext addContext;
+    ASSERT_TRUE(stub->AddOrder(&addContext, request, &response).ok());
+    EXPECT_EQ(response.status(), trading::ACCEPTED);
+
+    sessionContext.TryCancel();
+    session->Finish();
+    grpcServer->Shutdown();
+}
+
+TEST_F(TradingEngineServerTest, StreamExecutionsFromSequence) {
+    auto sell = CreateOrderRequest(1, trading::SELL, 100, 10);
+    sell.set_client_id(7);
+    auto buy = CreateOrderRequest(2, trading::BUY, 100, 4);
+    buy.set_client_id(8);
+    trading::TradeResponse response;
+    server->AddOrder(context.get(), &sell, &response);
+    server->AddOrder(context.get(), &buy, &response);
+    ASSERT_EQ(response.trades_size(), 2);
+    const auto tradeId = response.trades(0).trade_id();
+    EXPECT_NE(tradeId, 0);
+    EXPECT_EQ(response.trades(1).trade_id(), tradeId);
+    EXPECT_TRUE(response.trades(0).aggressor());
+    EXPECT_FALSE(response.trades(1).aggressor());
+
+    grpc::ServerBuilder builder;
+    builder.RegisterService(server.get());
+    auto grpcServer = builder.BuildAndStart();
+    ASSERT_NE(grpcServer, nullptr);
+    auto stub = trading::TradingEngine::NewStub(grpcServer->InProcessChannel(grpc::ChannelArguments()));
+
+    // Client 7's reports from the start: its fill, then its cancel once published
+    trading::ExecutionStreamRequest request;
+    request.set_from_sequence(1);
+    request.set_client_id(7);
+    grpc::ClientContext streamContext;
+    auto stream = stub->StreamExecutions(&streamContext, request);
+
+    trading::ExecutionReport report;
+    ASSERT_TRUE(stream->Read(&report));
+    EXPECT_EQ(report.sequence(), 2);
+    EXPECT_EQ(report.execution_type(), trading::FILL);
+    EXPECT_EQ(report.order_id(), 1);
+    EXPECT_EQ(report.side(), trading::SELL);
+    EXPECT_EQ(report.quantity(), 4);
+    EXPECT_EQ(report.leaves_quantity(), 6);
+    EXPECT_EQ(report.trade_id(), tradeId);
+    EXPECT_EQ(report.counterparty_order_id(), 2);
+    EXPECT_EQ(report.counterparty_client_id(), 8);
+    EXPECT_FALSE(report.aggressor());
+    EXPECT_GT(report.timestamp(), 0);
+
+    trading::CancelOrderRequest cancel;
+    cancel.set_order_id(1);
+    trading::CancelOrderResponse cancelResponse;
+    server->CancelOrder(context.get(), &cancel, &cancelResponse);
+
+    ASSERT_TRUE(stream->Read(&report));
+    EXPECT_EQ(report.sequence(), 3);
+    EXPECT_EQ(report.execution_type(), trading::CANCEL);
+    EXPECT_EQ(report.quantity(), 6);
+
+    streamContext.TryCancel();
+    stream->Finish();
+    grpcServer->Shutdown();
+}
+
+TEST_F(TradingEngineServerTest, StreamExecutionsOutOfRange) {
+    server->AttachExecutionReports(std::make_shared<ExecutionReportRing>(2));
+    for (uint32_t id = 1; id <= 3; ++id) {
+        auto request = CreateOrderRequest(id, trading::BUY, 100, 10);
+        trading::TradeResponse response;
+        server->AddOrder(context.get(), &request, &response);
+        trading::CancelOrderRequest cancel;
+        cancel.set_order_id(id);
+        trading::CancelOrderResponse cancelResponse;
+        server->CancelOrder(context.get(), &cancel, &cancelResponse);
+    }
+    EXPECT_EQ(server->GetExecutionReports()->GetOldestSequence(), 2);
+
+    grpc::ServerBuilder builder;
+    builder.RegisterService(server.get());
+    auto grpcServer = builder.BuildAndStart();
+    ASSERT_NE(grpcServer, nullptr);
+    auto stub = trading::TradingEngine::NewStub(grpcServer->InProcessChannel(grpc::ChannelArguments()));
+
+    trading::ExecutionStreamRequest request;
+    request.set_from_sequence(1);
+    grpc::ClientContext streamContext;
+    auto stream = stub->StreamExecutions(&streamContext, request);
+    trading::ExecutionReport report;
+    EXPECT_FALSE(stream->Read(&report));
+    EXPECT_EQ(stream->Finish().error_code(), grpc::StatusCode::OUT_OF_RANGE);
+
+    grpcServer->Shutdown();
+}
+
+TEST_F(TradingEngineServerTest, TradeTapeFeedsSummaryAndBars) {
+    trading::TradeBarsRequest barsRequest;
+    barsRequest.set_interval_ms(60'000);
+    trading::TradeBarsResponse barsResponse;
+    EXPECT_EQ(server->GetTradeBars(context.get(), &barsRequest, &barsResponse).error_code(), grpc::StatusCode::FAILED_PRECONDITION);
+
+    auto recorder = std::make_shared<TradeTapeRecorder>(server->GetExecutionReports(), TradeTapeConfig{"", 16, {std::chrono::minutes{1}}});
+    server->SetTradeTape(recorder);
+
+    trading::TradeResponse response;
+    auto sell = CreateOrderRequest(1, trading::SELL, 100, 10);
+    server->AddOrder(context.get(), &sell, &response);
+    auto firstBuy = CreateOrderRequest(2, trading::BUY, 100, 4);
+    server->AddOrder(context.get(), &firstBuy, &response);
+    auto secondBuy = CreateOrderRequest(3, trading::BUY, 100, 6);
+    server->AddOrder(context.get(), &secondBuy, &response);
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    std::shared_ptr<const TradeTape> tape;
+    while ((!(tape = recorder->Find(0)) || tape->Size() < 2) && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    trading::OrderbookRequest bookRequest;
+    trading::OrderbookResponse book;
+    ASSERT_TRUE(server->GetOrderbook(context.get(), &bookRequest, &book).ok());
+    EXPECT_EQ(book.last_trade_price(), 100);
+    EXPECT_EQ(book.last_trade_quantity(), 6);
+    EXPECT_GT(book.last_trade_timestamp(), 0);
+    EXPECT_EQ(book.session_volume(), 10);
+    EXPECT_EQ(book.session_turnover(), 1000);
+    EXPECT_EQ(book.session_trades(), 2);
+    EXPECT_DOUBLE_EQ(book.vwap(), 100.0);
+
+    ASSERT_TRUE(server->GetTradeBars(context.get(), &barsRequest, &barsResponse).ok());
+    ASSERT_GE(barsResponse.bars_size(), 1);
+    std::uint64_t volume = 0;
+    for (const auto &bar : barsResponse.bars()) {
+        EXPECT_EQ(bar.interval_ms(), 60'000);
+        EXPECT_EQ(bar.timestamp() % 60'000'000'000, 0);
+        volume += bar.volume();
+    }
+    EXPECT_EQ(volume, 10);
+    ASSERT_EQ(barsResponse.rolling_bars_size(), 1);
+    EXPECT_EQ(barsResponse.rolling_bars(0).close(), 100);
+
+    barsRequest.set_interval_ms(0);
+    EXPECT_EQ(server->GetTradeBars(context.get(), &barsRequest, &barsResponse).error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+    barsRequest.set_interval_ms(1'000);
+    barsRequest.set_instrument_id(9);
+    EXPECT_EQ(server->GetTradeBars(context.get(), &barsRequest, &barsResponse).error_code(), grpc::StatusCode::NOT_FOUND);
+}
+
+TEST_F(TradingEngineServerTest, RiskRejectCarriesReason) {
+    trading::RiskLimitsRequest limitsRequest;
+    limitsRequest.set_client_id(7);
+    limitsRequest.set_max_order_quantity(100);
+    trading::RiskLimitsResponse limitsResponse;
+    server->SetRiskLimits(context.get(), &limitsRequest, &limitsResponse);
+    EXPECT_TRUE(limitsResponse.success());
+
+    auto request = CreateOrderRequest(1, trading::BUY, 100, 101);
+    request.set_client_id(7);
+    trading::TradeResponse response;
+    server->AddOrder(context.get(), &request, &response);
+    EXPECT_EQ(response.status(), trading::REJECTED);
+    EXPECT_EQ(response.reject_reason(), "order_quantity");
+    EXPECT_EQ(orderbook->Size(), 0);
+
+    trading::StatsRequest statsRequest;
+    trading::StatsResponse stats;
+    server->GetStats(context.get(), &statsRequest, &stats);
+    EXPECT_EQ(stats.risk_rejects(), 1);
+    EXPECT_EQ(stats.rejects(), 1);
+}
+
+TEST_F(TradingEngineServerTest, ThrottledRequestsAreRejected) {
+    server->ConfigureThrottle(ThrottleConfig{0, 1, 2, 0});
+
+    for (uint32_t id = 1; id <= 3; ++id) {
+        auto request = CreateOrderRequest(id, trading::BUY, 100, 10);
+        request.set_client_id(7);
+        trading::TradeResponse response;
+        server->AddOrder(context.get(), &request, &response);
+        if (id <= 2) {
+            EXPECT_EQ(response.status(), trading::ACCEPTED);
+        } else {
+            EXPECT_EQ(response.status(), trading::REJECTED);
+            EXPECT_EQ(response.reject_reason(), "order_rate");
+        }
+    }
+    EXPECT_EQ(orderbook->Size(), 2);
+
+    // Another client is unaffected
+    auto request = CreateOrderRequest(4, trading::BUY, 100, 10);
+    request.set_client_id(8);
+    trading::TradeResponse response;
+    server->AddOrder(context.get(), &request, &response);
+    EXPECT_EQ(response.status(), trading::ACCEPTED);
+
+    trading::StatsRequest statsRequest;
+    trading::StatsResponse stats;
+    server->GetStats(context.get(), &statsRequest, &stats);
+    EXPECT_EQ(stats.throttled(), 1);
+}
+
+TEST_F(TradingEngineServerTest, MassCancelIsHeldToTheMessageRate) {
+    server->ConfigureThrottle(ThrottleConfig{1, 0, 1, 0});
+
+    auto order = CreateOrderRequest(1, trading::BUY, 100, 10);
+    order.set_client_id(7);
+    trading::TradeResponse orderResponse;
+    server->AddOrder(context.get(), &order, &orderResponse);
+    EXPECT_EQ(orderResponse.status(), trading::ACCEPTED);
+
+    // The order took client 7's only token
+    trading::MassCancelRequest request;
+    request.set_client_id(7);
+    trading::MassCancelResponse response;
+    EXPECT_TRUE(server->MassCancel(context.get(), &request, &response).ok());
+    EXPECT_EQ(response.reject_reason(), "message_rate");
+    EXPECT_EQ(response.cancelled(), 0);
+    EXPECT_EQ(orderbook->Size(), 1);
+
+    trading::StatsRequest statsRequest;
+    trading::StatsResponse stats;
+    server->GetStats(context.get(), &statsRequest, &stats);
+    EXPECT_EQ(stats.throttled(), 1);
+}
+
+TEST_F(TradingEngineServerTest, AuctionPhaseRpc) {
+    trading::TradingPhaseRequest auction;
+    auction.set_phase(trading::AUCTION);
+    trading::TradingPhaseResponse auctionResponse;
+    EXPECT_TRUE(server->SetTradingPhase(context.get(), &auction, &auctionResponse).ok());
+
+    trading::TradeResponse response;
+    auto buy = CreateOrderRequest(1, trading::BUY, 102, 10);
+    server->AddOrder(context.get(), &buy, &response);
+    auto sell = CreateOrderRequest(2, trading::SELL, 100, 10);
+    server->AddOrder(context.get(), &sell, &response);
+    EXPECT_EQ(response.trades_size(), 0);
+
+    trading::OrderbookRequest bookRequest;
+    trading::OrderbookResponse book;
+    server->GetOrderbook(context.get(), &bookRequest, &book);
+    EXPECT_EQ(book.phase(), trading::AUCTION);
+    EXPECT_EQ(book.indicative_volume(), 10);
+
+    trading::TradingPhaseRequest continuous;
+    continuous.set_phase(trading::CONTINUOUS);
+    continuous.set_reference_price(102);
+    trading::TradingPhaseResponse uncross;
+    EXPECT_TRUE(server->SetTradingPhase(context.get(), &continuous, &uncross).ok());
+    EXPECT_EQ(uncross.uncross_price(), 102);
+    EXPECT_EQ(uncross.uncross_volume(), 10);
+    EXPECT_EQ(uncross.trades_size(), 2);
+    EXPECT_EQ(orderbook->Size(), 0);
+}
+
+TEST_F(TradingEngineServerTest, FrequentBatchPhaseRpc) {
+    trading::TradingPhaseRequest batch;
+    batch.set_phase(trading::FREQUENT_BATCH);
+    batch.set_batch_interval_us(500);
+    trading::TradingPhaseResponse batchResponse;
+    EXPECT_EQ(server->SetTradingPhase(context.get(), &batch, &batchResponse).error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+
+    batch.set_batch_interval_us(100'000);
+    EXPECT_TRUE(server->SetTradingPhase(context.get(), &batch, &batchResponse).ok());
+    EXPECT_EQ(batchResponse.phase(), trading::FREQUENT_BATCH);
+
+    trading::OrderbookRequest bookRequest;
+    trading::OrderbookResponse book;
+    server->GetOrderbook(context.get(), &bookRequest, &book);
+    EXPECT_EQ(book.phase(), trading::FREQUENT_BATCH);
+
+    trading::TradingPhaseRequest continuous;
+    continuous.set_phase(trading::CONTINUOUS);
+    trading::TradingPhaseResponse uncross;
+    EXPECT_TRUE(server->SetTradingPhase(context.get(), &continuous, &uncross).ok());
+    EXPECT_EQ(orderbook->GetTradingPhase(), TradingPhase::Continuous);
+}
+
+TEST_F(TradingEngineServerTest, UnknownInstrumentIsRejected) {
+    auto request = CreateOrderRequest(1, trading::BUY, 100, 1000);
+    request.set_instrument_id(7);
+    trading::TradeResponse response;
+    EXPECT_TRUE(server->AddOrder(context.get(), &request, &response).ok());
+    EXPECT_EQ(response.status(), trading::REJECTED);
+    EXPECT_EQ(response.reject_reason(), TradingEngineServer::UnknownInstrument);
+
+    trading::OrderbookRequest bookRequest;
+    bookRequest.set_instrument_id(7);
+    trading::OrderbookResponse bookResponse;
+    EXPECT_EQ(server->GetOrderbook(context.get(), &bookRequest, &bookResponse).error_code(), grpc::StatusCode::NOT_FOUND);
+    EXPECT_EQ(orderbook->Size(), 0);
+}
+
+TEST(TradingEngineServerInstrumentsTest, BooksAreCreatedOnFirstOrder) {
+    auto instruments = std::make_shared<InstrumentRegistry>();
+    for (InstrumentId id = 0; id < 3; ++id)
+        instruments->List(id);
+    TradingEngineServer server(instruments);
+    grpc::ServerContext context;
+
+    // Reading an untraded instrument shows an empty book without creating one
+    trading::OrderbookRequest bookRequest;
+    bookRequest.set_instrument_id(2);
+    trading::OrderbookResponse bookResponse;
+    EXPECT_TRUE(server.GetOrderbook(&context, &bookRequest, &bookResponse).ok());
+    EXPECT_EQ(bookResponse.bids_size(), 0);
+    EXPECT_EQ(instruments->BookCount(), 0);
+
+    // The same order id in two instruments is two orders
+    for (InstrumentId id : {1u, 2u}) {
+        trading::OrderRequest request;
+        request.set_order_id(1);
+        request.set_side(trading::BUY);
+        request.set_price(100);
+        request.set_quantity(10);
+        request.set_order_type(trading::GOOD_TILL_CANCEL);
+        request.set_instrument_id(id);
+        request.set_client_id(9);
+        trading::TradeResponse response;
+        server.AddOrder(&context, &request, &response);
+        EXPECT_EQ(response.status(), trading::ACCEPTED);
+    }
+    EXPECT_EQ(instruments->BookCount(), 2);
+    EXPECT_EQ(server.GetStatsSnapshot().depth_.orders_, 2);
+
+    trading::MassCancelRequest cancelRequest;
+    cancelRequest.set_client_id(9);
+    cancelRequest.set_all_instruments(true);
+    trading::MassCancelResponse cancelResponse;
+    server.MassCancel(&context, &cancelRequest, &cancelResponse);
+    EXPECT_EQ(cancelResponse.cancelled(), 2);
+}
+
+TEST_F(TradingEngineServerTest, MatchesOnSchedulerWorkers) {
+    server->SetScheduler(std::make_shared<MatchingScheduler>(2));
+
+    auto buyRequest = CreateOrderRequest(1, trading::BUY, 100, 1000);
+    trading::TradeResponse buyResponse;
+    server->AddOrder(context.get(), &buyRequest, &buyResponse);
+    EXPECT_EQ(buyResponse.status(), trading::ACCEPTED);
+
+    auto sellRequest = CreateOrderRequest(2, trading::SELL, 100, 400);
+    trading::TradeResponse sellResponse;
+    server->AddOrder(context.get(), &sellRequest, &sellResponse);
+    EXPECT_EQ(sellResponse.status(), trading::FILLED);
+    EXPECT_EQ(sellResponse.trades_size(), 2);
+
+    trading::CancelOrderRequest cancelRequest;
+    cancelRequest.set_order_id(1);
+    trading::CancelOrderResponse cancelResponse;
+    server->CancelOrder(context.get(), &cancelRequest, &cancelResponse);
+    EXPECT_TRUE(cancelResponse.success());
+    EXPECT_EQ(orderbook->Size(), 0);
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include "../TscClock.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+namespace {
+
+std::int64_t SystemNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+TEST(TscClockTest, TicksAreMonotonic) {
+    auto previous = TscClock::Now();
+    for (int i = 0; i < 1000; ++i) {
+        const auto current = TscClock::Now();
+        EXPECT_GE(current, previous);
+        previous = current;
+    }
+}
+
+TEST(TscClockTest, EpochNanosecondsTrackSystemClock) {
+    const auto before = SystemNanoseconds();
+    const auto stamped = TscClock::EpochNanoseconds();
+    const auto after = SystemNanoseconds();
+
+    // Generous bound: calibration error plus scheduling noise on a shared host
+    EXPECT_GE(stamped, before - 1'000'000);
+    EXPECT_LE(stamped, after + 1'000'000);
+}
+
+TEST(TscClockTest, ElapsedTicksConvertToDuration) {
+    const auto start = TscClock::Now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const auto elapsed = TscClock::ToNanoseconds(TscClock::Now() - start);
+
+    EXPECT_GE(elapsed, 19'000'000);
+    EXPECT_LT(elapsed, 500'000'000);
+}
+
+TEST(TscClockTest, CalibrateKeepsEarlierTimestampsConsistent) {
+    const auto ticks = TscClock::Now();
+    const auto beforeCalibration = TscClock::ToEpochNanoseconds(ticks);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    TscClock::Calibrate();
+
+    // Re-anchoring continues from the previous conversion, so only the rate
+    // change over the 5ms since the stamp can move it
+    EXPECT_LT(std::llabs(TscClock::ToEpochNanoseconds(ticks) - beforeCalibration), 50'000);
+    EXPECT_GT(TscClock::NanosecondsPerTick(), 0.0);
+}
+
+TEST(TscClockTest, ConversionsStayMonotonicAcrossCalibrations) {
+    if (!TscClock::UsesTsc())
+        GTEST_SKIP() << "no invariant TSC";
+
+    auto previousTicks = TscClock::Now();
+    auto previous = TscClock::ToEpochNanoseconds(previousTicks);
+    for (int i = 0; i < 20; ++i) {
+        TscClock::Calibrate();
+        const auto ticks = TscClock::Now();
+        const auto converted = TscClock::ToEpochNanoseconds(ticks);
+        EXPECT_GE(converted, previous);
+        // A tick stamped before the calibration converts no later than one after it
+        EXPECT_LE(TscClock::ToEpochNanoseconds(previousTicks), converted);
+        previousTicks = ticks;
+        previous = converted;
+    }
+}
@@ -0,0 +1,396 @@
+#include "HdrHistogram.hpp"
+#include "trading_optimized.grpc.pb.h"
+
+#include <grpcpp/grpcpp.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Load generator for trading_server.
+//
+// Closed loop: every connection keeps one request outstanding and issues the
+// next as soon as the previous completes (optionally paced to --rate). Open
+// loop: every connection sends on a fixed schedule and latency is measured
+// from the *intended* send time, so a stalled server is charged for the
+// requests it delayed. In closed loop with a rate, the histogram applies
+// coordinated-omission correction using the expected interval instead.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Operation {
+	Add,
+	Cancel,
+	Modify,
+	GetOrderbook,
+};
+
+constexpr std::size_t OperationCount = 4;
+constexpr std::array<const char *, OperationCount> OperationNames{"AddOrder", "CancelOrder", "ModifyOrder", "GetOrderbook"};
+
+enum class Mode {
+	Closed,
+	Open,
+};
+
+enum class PriceDistribution {
+	Uniform,
+	Normal,
+};
+
+struct Options {
+	std::string target{"localhost:5001"};
+	Mode mode{Mode::Closed};
+	std::size_t connections{4};
+	double rate{0.0}; // Total requests per second across all connections; 0 = unpaced (closed loop only)
+	double durationSeconds{10.0};
+	double warmupSeconds{1.0};
+	std::array<unsigned, OperationCount> mix{70, 20, 5, 5};
+	PriceDistribution priceDistribution{PriceDistribution::Normal};
+	int midPrice{10000};
+	int priceWidth{50}; // Half-width for uniform, standard deviation for normal
+	unsigned minQuantity{1};
+	unsigned maxQuantity{1000};
+	std::uint64_t seed{42};
+	std::string histogramOutput;
+};
+
+void PrintUsage() {
+	std::cout << "Usage: trading_loadgen [options]\n"
+			  << "  --target HOST:PORT         server address (default localhost:5001)\n"
+			  << "  --mode closed|open         loop model (default closed)\n"
+			  << "  --connections N            channels, one driver thread each (default 4)\n"
+			  << "  --rate N                   total requests/s; required for open loop\n"
+			  << "  --duration SECONDS         measured run time (default 10)\n"
+			  << "  --warmup SECONDS           unmeasured lead-in (default 1)\n"
+			  << "  --mix A,C,M,B              weights for add,cancel,modify,book (default 70,20,5,5)\n"
+			  << "  --price-dist uniform|normal\n"
+			  << "  --mid PRICE                centre of the price distribution (default 10000)\n"
+			  << "  --width TICKS              half-width (uniform) or stddev (normal) (default 50)\n"
+			  << "  --quantity MIN,MAX         uniform order size range (default 1,1000)\n"
+			  << "  --seed N                   RNG seed (default 42)\n"
+			  << "  --histogram-output FILE    write the full AddOrder percentile distribution\n";
+}
+
+Options ParseOptions(int argc, char **argv) {
+	Options options;
+
+	auto parseList = [](const std::string &value) {
+		std::vector<std::string> parts;
+		std::stringstream stream(value);
+		for (std::string part; std::getline(stream, part, ',');)
+			parts.push_back(part);
+		return parts;
+	};
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		auto next = [&]() -> std::string {
+			if (i + 1 >= argc)
+				throw std::invalid_argument("Missing value for " + arg);
+			return argv[++i];
+		};
+
+		if (arg == "--target") {
+			options.target = next();
+		} else if (arg == "--mode") {
+			const auto mode = next();
+			if (mode != "closed" && mode != "open")
+				throw std::invalid_argument("Unknown mode: " + mode);
+			options.mode = mode == "open" ? Mode::Open : Mode::Closed;
+		} else if (arg == "--connections") {
+			options.connections = std::max<std::size_t>(1, std::stoul(next()));
+		} else if (arg == "--rate") {
+			options.rate = std::stod(next());
+		} else if (arg == "--duration") {
+			options.durationSeconds = std::stod(next());
+		} else if (arg == "--warmup") {
+			options.warmupSeconds = std::stod(next());
+		} else if (arg == "--mix") {
+			const auto parts = parseList(next());
+			if (parts.size() != OperationCount)
+				throw std::invalid_argument("--mix expects four weights");
+			for (std::size_t op = 0; op < OperationCount; ++op)
+				options.mix[op] = static_cast<unsigned>(std::stoul(parts[op]));
+		} else if (arg == "--price-dist") {
+			const auto distribution = next();
+			if (distribution != "uniform" && distribution != "normal")
+				throw std::invalid_argument("Unknown price distribution: " + distribution);
+			options.priceDistribution = distribution == "uniform" ? PriceDistribution::Uniform : PriceDistribution::Normal;
+		} else if (arg == "--mid") {
+			options.midPrice = std::stoi(next());
+		} else if (arg == "--width") {
+			options.priceWidth = std::max(1, std::stoi(next()));
+		} else if (arg == "--quantity") {
+			const auto parts = parseList(next());
+			if (parts.size() != 2)
+				throw std::invalid_argument("--quantity expects MIN,MAX");
+			options.minQuantity = static_cast<unsigned>(std::stoul(parts[0]));
+			options.maxQuantity = std::max(options.minQuantity, static_cast<unsigned>(std::stoul(parts[1])));
+		} else if (arg == "--seed") {
+			options.seed = std::stoull(next());
+		} else if (arg == "--histogram-output") {
+			options.histogramOutput = next();
+		} else if (arg == "--help" || arg == "-h") {
+			PrintUsage();
+			std::exit(EXIT_SUCCESS);
+		} else {
+			throw std::invalid_argument("Unknown argument: " + arg);
+		}
+	}
+
+	if (options.mode == Mode::Open && options.rate <= 0.0)
+		throw std::invalid_argument("Open-loop mode requires --rate");
+
+	return options;
+}
+
+struct OperationStats {
+	HdrHistogram latency;
+	std::uint64_t errors{0};
+};
+
+using WorkerStats = std::array<OperationStats, OperationCount>;
+
+class Worker {
+  public:
+	Worker(const Options &options, std::size_t index, const std::atomic<bool> &measuring)
+		: options_{options},
+		  index_{index},
+		  measuring_{measuring},
+		  random_{options.seed + index},
+		  operation_{options.mix.begin(), options.mix.end()},
+		  uniformPrice_{options.midPrice - options.priceWidth, options.midPrice + options.priceWidth},
+		  normalPrice_{static_cast<double>(options.midPrice), static_cast<double>(options.priceWidth)},
+		  quantity_{options.minQuantity, options.maxQuantity} {
+		// One channel per connection; distinct channel args keep gRPC from sharing a subchannel.
+		grpc::ChannelArguments arguments;
+		arguments.SetInt("loadgen.connection", static_cast<int>(index));
+		stub_ = trading::TradingEngine::NewStub(grpc::CreateCustomChannel(options.target, grpc::InsecureChannelCredentials(), arguments));
+	}
+
+	void Run(Clock::time_point start, Clock::time_point end) {
+		const double perConnectionRate = options_.rate / static_cast<double>(options_.connections);
+		const auto interval = perConnectionRate > 0.0
+								  ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / perConnectionRate))
+								  : Clock::duration::zero();
+		const auto expectedIntervalNs = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count());
+
+		// Stagger connections so paced senders do not fire in lockstep.
+		Clock::time_point intended = start + interval * static_cast<Clock::rep>(index_) / static_cast<Clock::rep>(options_.connections);
+
+		while (true) {
+			auto now = Clock::now();
+			if (now >= end)
+				break;
+
+			if (interval != Clock::duration::zero()) {
+				if (options_.mode == Mode::Closed)
+					intended = std::max(intended, now);
+				std::this_thread::sleep_until(intended);
+			} else {
+				intended = now;
+			}
+
+			const auto operation = static_cast<Operation>(operation_(random_));
+			const auto sendTime = options_.mode == Mode::Open ? intended : Clock::now();
+			const bool ok = Issue(operation);
+			const auto latency = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sendTime).count());
+
+			if (measuring_.load(std::memory_order_relaxed)) {
+				auto &stats = stats_[static_cast<std::size_t>(operation)];
+				if (options_.mode == Mode::Closed)
+					stats.latency.RecordCorrectedValue(latency, expectedIntervalNs);
+				else
+					stats.latency.RecordValue(latency);
+				stats.errors += ok ? 0 : 1;
+			}
+
+			intended += interval;
+		}
+	}
+
+	const WorkerStats &GetStats() const { return stats_; }
+
+  private:
+	const Options &options_;
+	std::size_t index_;
+	const std::atomic<bool> &measuring_;
+	std::unique_ptr<trading::TradingEngine::Stub> stub_;
+	std::mt19937_64 random_;
+	std::discrete_distribution<std::size_t> operation_;
+	std::uniform_int_distribution<int> uniformPrice_;
+	std::normal_distribution<double> normalPrice_;
+	std::uniform_int_distribution<unsigned> quantity_;
+	std::vector<std::uint64_t> liveOrders_;
+	std::uint64_t nextSequence_{1};
+	WorkerStats stats_;
+
+	int NextPrice() {
+		if (options_.priceDistribution == PriceDistribution::Uniform)
+			return uniformPrice_(random_);
+		return std::max(1, static_cast<int>(std::lround(normalPrice_(random_))));
+	}
+
+	// Each connection owns a disjoint id range so cancels and modifies target its own orders.
+	std::uint64_t NextOrderId() { return (static_cast<std::uint64_t>(index_ + 1) << 40) | nextSequence_++; }
+
+	std::uint64_t TakeLiveOrder(bool remove) {
+		std::uniform_int_distribution<std::size_t> pick{0, liveOrders_.size() - 1};
+		const auto position = pick(random_);
+		const auto orderId = liveOrders_[position];
+		if (remove) {
+			liveOrders_[position] = liveOrders_.back();
+			liveOrders_.pop_back();
+		}
+		return orderId;
+	}
+
+	bool Issue(Operation operation) {
+		if ((operation == Operation::Cancel || operation == Operation::Modify) && liveOrders_.empty())
+			operation = Operation::Add;
+
+		grpc::ClientContext context;
+		switch (operation) {
+		case Operation::Add: {
+			trading::OrderRequest request;
+			const auto price = NextPrice();
+			request.set_order_id(NextOrderId());
+			request.set_side(price <= options_.midPrice ? trading::BUY : trading::SELL);
+			request.set_price(price);
+			request.set_quantity(quantity_(random_));
+			request.set_order_type(trading::GOOD_TILL_CANCEL);
+
+			trading::TradeResponse response;
+			const auto status = stub_->AddOrder(&context, request, &response);
+			if (status.ok() && response.status() == trading::ACCEPTED)
+				liveOrders_.push_back(request.order_id());
+			return status.ok();
+		}
+		case Operation::Cancel: {
+			trading::CancelOrderRequest request;
+			request.set_order_id(TakeLiveOrder(true));
+
+			trading::CancelOrderResponse response;
+			return stub_->CancelOrder(&context, request, &response).ok();
+		}
+		case Operation::Modify: {
+			trading::ModifyOrderRequest request;
+			const auto price = NextPrice();
+			request.set_order_id(TakeLiveOrder(false));
+			request.set_side(price <= options_.midPrice ? trading::BUY : trading::SELL);
+			request.set_new_price(price);
+			request.set_new_quantity(quantity_(random_));
+
+			trading::TradeResponse response;
+			return stub_->ModifyOrder(&context, request, &response).ok();
+		}
+		case Operation::GetOrderbook: {
+			trading::OrderbookRequest request;
+			trading::OrderbookResponse response;
+			return stub_->GetOrderbook(&context, request, &response).ok();
+		}
+		}
+		return false;
+	}
+};
+
+void PrintReport(const Options &options, const WorkerStats &totals, double elapsedSeconds) {
+	std::printf("\nmode=%s connections=%zu target_rate=%.0f/s duration=%.1fs\n",
+				options.mode == Mode::Open ? "open" : "closed", options.connections, options.rate, elapsedSeconds);
+	std::printf("%-13s %10s %8s %10s %9s %9s %9s %9s %9s %9s\n",
+				"operation", "count", "errors", "rate/s", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us", "mean us");
+
+	std::uint64_t totalCount = 0;
+	for (std::size_t op = 0; op < OperationCount; ++op) {
+		const auto &histogram = totals[op].latency;
+		const auto count = histogram.GetTotalCount();
+		totalCount += count;
+		if (count == 0)
+			continue;
+
+		auto us = [](std::uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+		std::printf("%-13s %10llu %8llu %10.0f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", OperationNames[op],
+					static_cast<unsigned long long>(count), static_cast<unsigned long long>(totals[op].errors),
+					static_cast<double>(count) / elapsedSeconds,
+					us(histogram.GetValueAtPercentile(50.0)), us(histogram.GetValueAtPercentile(90.0)),
+					us(histogram.GetValueAtPercentile(99.0)), us(histogram.GetValueAtPercentile(99.9)),
+					us(histogram.GetMax()), histogram.GetMean() / 1000.0);
+	}
+	std::printf("total %llu samples (%.0f/s, includes coordinated-omission back-fill)\n",
+				static_cast<unsigned long long>(totalCount), static_cast<double>(totalCount) / elapsedSeconds);
+}
+
+void WriteDistribution(const std::string &path, const HdrHistogram &histogram) {
+	FILE *file = std::fopen(path.c_str(), "w");
+	if (!file)
+		throw std::runtime_error("Cannot write " + path);
+
+	std::fprintf(file, "%12s %12s %10s\n", "value_ns", "percentile", "count");
+	std::uint64_t running = 0;
+	histogram.ForEachBucket([&](std::uint64_t value, std::uint64_t count) {
+		running += count;
+		std::fprintf(file, "%12llu %12.6f %10llu\n", static_cast<unsigned long long>(value),
+					 100.0 * static_cast<double>(running) / static_cast<double>(histogram.GetTotalCount()),
+					 static_cast<unsigned long long>(count));
+	});
+	std::fclose(file);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	Options options;
+	try {
+		options = ParseOptions(argc, argv);
+	} catch (const std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	std::atomic<bool> measuring{false};
+	std::vector<std::unique_ptr<Worker>> workers;
+	for (std::size_t i = 0; i < options.connections; ++i)
+		workers.push_back(std::make_unique<Worker>(options, i, measuring));
+
+	const auto start = Clock::now();
+	const auto measureStart = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.warmupSeconds));
+	const auto end = measureStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.durationSeconds));
+
+	std::vector<std::thread> threads;
+	for (auto &worker : workers)
+		threads.emplace_back([&worker, start, end] { worker->Run(start, end); });
+
+	std::this_thread::sleep_until(measureStart);
+	measuring.store(true, std::memory_order_relaxed);
+
+	for (auto &thread : threads)
+		thread.join();
+
+	WorkerStats totals;
+	for (const auto &worker : workers) {
+		for (std::size_t op = 0; op < OperationCount; ++op) {
+			totals[op].latency.Add(worker->GetStats()[op].latency);
+			totals[op].errors += worker->GetStats()[op].errors;
+		}
+	}
+
+	PrintReport(options, totals, options.durationSeconds);
+	if (!options.histogramOutput.empty())
+		WriteDistribution(options.histogramOutput, totals[static_cast<std::size_t>(Operation::Add)].latency);
+
+	return EXIT_SUCCESS;
+}